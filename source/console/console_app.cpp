@@ -2,6 +2,8 @@
 
 #include "console_app.h"
 
+#include <thread>
+
 PACKER_NAMESPACE_BEGIN
 
 void ConsoleApp::_add_hidden_command(Function p_function, const String& p_name) {
@@ -137,6 +139,286 @@ void ConsoleApp::_set_extension_adjust() {
     console.print_line("Extension case changed to '" + input + "'.");
 }
 
+bool ConsoleApp::_parse_number(int& p_number, int p_minimum) {
+    if (input.empty() || input.length() > 9 || input.find_first_not_of("0123456789") != String::npos) {
+        return false;
+    }
+    p_number = std::atoi(input.c_str());
+    return p_number >= p_minimum;
+}
+
+bool ConsoleApp::_parse_count(int& p_count) {
+    if (input == "all") {
+        p_count = 0;
+        return true;
+    }
+    return _parse_number(p_count);
+}
+
+void ConsoleApp::_set_thread_count() {
+    int thread_count;
+    if (!_parse_count(thread_count)) {
+        console.print_line("Thread count '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_thread_count(thread_count);
+    console.print_line("Thread count changed to '" + std::to_string(packer.get_thread_count()) + "'.");
+}
+
+void ConsoleApp::_set_pipeline_enabled() {
+    packer.set_pipeline_enabled(!packer.get_pipeline_enabled());
+    console.print_line("Pipeline is " + String(packer.get_pipeline_enabled() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_filter_thread_count() {
+    int thread_count;
+    if (!_parse_count(thread_count)) {
+        console.print_line("Filter thread count '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_filter_thread_count(thread_count);
+    console.print_line("Filter thread count changed to '" + std::to_string(packer.get_filter_thread_count()) + "'.");
+}
+
+void ConsoleApp::_set_copy_thread_count() {
+    int thread_count;
+    if (!_parse_count(thread_count)) {
+        console.print_line("Copy thread count '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_copy_thread_count(thread_count);
+    console.print_line("Copy thread count changed to '" + std::to_string(packer.get_copy_thread_count()) + "'.");
+}
+
+void ConsoleApp::_set_post_thread_count() {
+    int thread_count;
+    if (!_parse_count(thread_count)) {
+        console.print_line("Post thread count '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_post_thread_count(thread_count);
+    console.print_line("Post thread count changed to '" + std::to_string(packer.get_post_thread_count()) + "'.");
+}
+
+void ConsoleApp::_set_queue_size() {
+    int queue_size;
+    if (!_parse_number(queue_size, 1)) {
+        console.print_line("Queue size '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_queue_size(queue_size);
+    console.print_line("Queue size changed to '" + std::to_string(packer.get_queue_size()) + "'.");
+}
+
+void ConsoleApp::_set_copy_engine() {
+    FileCopy::Engine engine = FileCopy::find_engine(input);
+    if (engine == FileCopy::Engine::Unknown) {
+        console.print_line("Copy engine '" + input + "' is invalid.");
+        return;
+    }
+    if (engine == packer.get_copy_engine()) {
+        console.print_line("Copy engine is already '" + input + "'.");
+        return;
+    }
+    packer.set_copy_engine(engine);
+    console.print_line("Copy engine changed to '" + input + "'.");
+}
+
+void ConsoleApp::_set_clone_files() {
+    packer.set_clone_files(!packer.get_clone_files());
+    console.print_line("Clone files is " + String(packer.get_clone_files() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_traversal() {
+    Packer::Traversal traversal = Packer::find_traversal(input);
+    if (traversal == Packer::Traversal::Unknown) {
+        console.print_line("Traversal '" + input + "' is invalid.");
+        return;
+    }
+    if (traversal == packer.get_traversal()) {
+        console.print_line("Traversal is already '" + input + "'.");
+        return;
+    }
+    packer.set_traversal(traversal);
+    console.print_line("Traversal changed to '" + input + "'.");
+}
+
+void ConsoleApp::_set_destination_index_enabled() {
+    packer.set_destination_index_enabled(!packer.get_destination_index_enabled());
+    console.print_line("Destination index is " + String(packer.get_destination_index_enabled() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_incremental_enabled() {
+    packer.set_incremental_enabled(!packer.get_incremental_enabled());
+    console.print_line("Incremental mode is " + String(packer.get_incremental_enabled() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_manifest_file_name() {
+    String manifest_file_name = input != "default" ? input : DEFAULT_MANIFEST_FILE_NAME;
+    if (manifest_file_name == packer.get_manifest_file_name()) {
+        console.print_line("Manifest file name is already '" + manifest_file_name + "'.");
+        return;
+    }
+    packer.set_manifest_file_name(manifest_file_name);
+    console.print_line("Manifest file name changed to '" + packer.get_manifest_file_name() + "'.");
+}
+
+void ConsoleApp::_set_quick_check_enabled() {
+    packer.set_quick_check_enabled(!packer.get_quick_check_enabled());
+    console.print_line("Quick check is " + String(packer.get_quick_check_enabled() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_quick_check_tolerance() {
+    int tolerance;
+    if (!_parse_number(tolerance)) {
+        console.print_line("Quick check tolerance '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_quick_check_tolerance(tolerance);
+    console.print_line("Quick check tolerance changed to '" + std::to_string(packer.get_quick_check_tolerance()) + "' ms.");
+}
+
+void ConsoleApp::_set_preserve_times() {
+    packer.set_preserve_times(!packer.get_preserve_times());
+    console.print_line("Preserve times is " + String(packer.get_preserve_times() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_verify_files() {
+    packer.set_verify_files(!packer.get_verify_files());
+    console.print_line("Verify files is " + String(packer.get_verify_files() ? "enabled" : "disabled") + ".");
+}
+
+void ConsoleApp::_set_split_copy_size() {
+    int size;
+    if (!_parse_number(size)) {
+        console.print_line("Split copy size '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_split_copy_size(size);
+    console.print_line("Split copy size changed to '" + std::to_string(packer.get_split_copy_size()) + "' MB.");
+}
+
+void ConsoleApp::_set_durability() {
+    Packer::Durability durability = Packer::find_durability(input);
+    if (durability == Packer::Durability::Unknown) {
+        console.print_line("Durability '" + input + "' is invalid.");
+        return;
+    }
+    if (durability == packer.get_durability()) {
+        console.print_line("Durability is already '" + input + "'.");
+        return;
+    }
+    packer.set_durability(durability);
+    console.print_line("Durability changed to '" + input + "'.");
+}
+
+void ConsoleApp::_set_sync_batch_files() {
+    int files;
+    if (!_parse_number(files, 1)) {
+        console.print_line("Sync batch files '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_sync_batch_files(files);
+    console.print_line("Sync batch files changed to '" + std::to_string(packer.get_sync_batch_files()) + "'.");
+}
+
+void ConsoleApp::_set_sync_batch_size() {
+    int size;
+    if (!_parse_number(size, 1)) {
+        console.print_line("Sync batch size '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_sync_batch_size(size);
+    console.print_line("Sync batch size changed to '" + std::to_string(packer.get_sync_batch_size()) + "' MB.");
+}
+
+void ConsoleApp::_set_dedup_mode() {
+    Packer::DedupMode mode = Packer::find_dedup_mode(input);
+    if (mode == Packer::DedupMode::Unknown) {
+        console.print_line("Dedup mode '" + input + "' is invalid.");
+        return;
+    }
+    if (mode == packer.get_dedup_mode()) {
+        console.print_line("Dedup mode is already '" + input + "'.");
+        return;
+    }
+    packer.set_dedup_mode(mode);
+    console.print_line("Dedup mode changed to '" + input + "'.");
+}
+
+void ConsoleApp::_set_output_mode() {
+    Packer::OutputMode mode = Packer::find_output_mode(input);
+    if (mode == Packer::OutputMode::Unknown) {
+        console.print_line("Output mode '" + input + "' is invalid.");
+        return;
+    }
+    if (mode == packer.get_output_mode()) {
+        console.print_line("Output mode is already '" + input + "'.");
+        return;
+    }
+    packer.set_output_mode(mode);
+    console.print_line("Output mode changed to '" + input + "'.");
+}
+
+void ConsoleApp::_set_compression() {
+    Codec::Type compression = Codec::find_type(input);
+    if (compression == Codec::Type::Unknown) {
+        console.print_line("Compression '" + input + "' is invalid.");
+        return;
+    }
+    if (compression != Codec::Type::None && Codec::get_codec(compression) == nullptr) {
+        console.print_line("Compression '" + input + "' is not available in this build.");
+        return;
+    }
+    if (compression == packer.get_compression()) {
+        console.print_line("Compression is already '" + input + "'.");
+        return;
+    }
+    packer.set_compression(compression);
+    console.print_line("Compression changed to '" + input + "'.");
+}
+
+void ConsoleApp::_set_compression_block_size() {
+    int block_size;
+    if (!_parse_number(block_size, 1)) {
+        console.print_line("Compression block size '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_compression_block_size(block_size);
+    console.print_line("Compression block size changed to '" + std::to_string(packer.get_compression_block_size()) + "' bytes.");
+}
+
+void ConsoleApp::_add_store_extension() {
+    if (packer.add_store_extension(input)) {
+        console.print_line("Store extension '" + input + "' added.");
+    } else {
+        console.print_line("Store extension '" + input + "' already exists.");
+    }
+}
+
+void ConsoleApp::_remove_store_extension() {
+    if (packer.remove_store_extension(input)) {
+        console.print_line("Store extension '" + input + "' removed.");
+    } else {
+        console.print_line("Store extension '" + input + "' does not exists.");
+    }
+}
+
+void ConsoleApp::_clear_store_extensions() {
+    packer.clear_store_extensions();
+    console.print_line("Store extensions cleared.");
+}
+
+void ConsoleApp::_set_watch_delay() {
+    int delay;
+    if (!_parse_number(delay)) {
+        console.print_line("Watch delay '" + input + "' is invalid.");
+        return;
+    }
+    packer.set_watch_delay(delay);
+    console.print_line("Watch delay changed to '" + std::to_string(packer.get_watch_delay()) + "' ms.");
+}
+
 #ifdef IGNORE_FILE_ENABLED
 void ConsoleApp::_set_ignore_file_name() {
     String ignore_file_name = input != "default" ? input : DEFAULT_IGNORE_FILE_NAME;
@@ -236,6 +518,43 @@ void ConsoleApp::_print_info() {
     console.print_line("Suffix: " + String(packer.get_suffix_enabled() ? "enabled" : "disabled"));
     console.print_line("Extension insensitive: " + String(packer.get_extension_insensitive() ? "enabled" : "disabled"));
     console.print_line("Extension adjust: " + Packer::get_extension_adjust_name(packer.get_extension_adjust()));
+    console.print_line("Thread count: " + std::to_string(packer.get_thread_count()));
+    console.print_line("Pipeline: " + String(packer.get_pipeline_enabled() ? "enabled" : "disabled"));
+    console.print_line("Filter thread count: " + std::to_string(packer.get_filter_thread_count()));
+    console.print_line("Copy thread count: " + std::to_string(packer.get_copy_thread_count()));
+    console.print_line("Post thread count: " + std::to_string(packer.get_post_thread_count()));
+    console.print_line("Queue size: " + std::to_string(packer.get_queue_size()));
+    console.print_line("Copy engine: " + FileCopy::get_engine_name(packer.get_copy_engine()));
+    console.print_line("Clone files: " + String(packer.get_clone_files() ? "enabled" : "disabled"));
+    console.print_line("Traversal: " + Packer::get_traversal_name(packer.get_traversal()));
+    console.print_line("Destination index: " + String(packer.get_destination_index_enabled() ? "enabled" : "disabled"));
+    console.print_line("Incremental: " + String(packer.get_incremental_enabled() ? "enabled" : "disabled"));
+    console.print_line("Manifest file name: " + packer.get_manifest_file_name());
+    console.print_line("Quick check: " + String(packer.get_quick_check_enabled() ? "enabled" : "disabled"));
+    console.print_line("Quick check tolerance: " + std::to_string(packer.get_quick_check_tolerance()) + " ms");
+    console.print_line("Preserve times: " + String(packer.get_preserve_times() ? "enabled" : "disabled"));
+    console.print_line("Verify files: " + String(packer.get_verify_files() ? "enabled" : "disabled"));
+    console.print_line("Split copy size: " + std::to_string(packer.get_split_copy_size()) + " MB");
+    console.print_line("Durability: " + Packer::get_durability_name(packer.get_durability()));
+    console.print_line("Sync batch files: " + std::to_string(packer.get_sync_batch_files()));
+    console.print_line("Sync batch size: " + std::to_string(packer.get_sync_batch_size()) + " MB");
+    console.print_line("Dedup mode: " + Packer::get_dedup_mode_name(packer.get_dedup_mode()));
+    console.print_line("Output mode: " + Packer::get_output_mode_name(packer.get_output_mode()));
+    console.print_line("Compression: " + Codec::get_type_name(packer.get_compression()));
+    console.print_line("Compression block size: " + std::to_string(packer.get_compression_block_size()) + " bytes");
+    if (packer.get_store_extension_count()) {
+        String extension_string = "Store extensions: ";
+        for (size_t i = 0; i < packer.get_store_extension_count(); ++i) {
+            extension_string += packer.get_store_extension(i);
+            if (i < (packer.get_store_extension_count() - 1)) {
+                extension_string += ", ";
+            }
+        }
+        console.print_line(extension_string);
+    } else {
+        console.print_line("No store extensions added");
+    }
+    console.print_line("Watch delay: " + std::to_string(packer.get_watch_delay()) + " ms");
 #ifdef IGNORE_FILE_ENABLED
     console.print_line("Ignore file name: " + packer.get_ignore_file_name());
     console.print_line("Ignore file: " + String(packer.get_ignore_file_enabled() ? "enabled" : "disabled"));
@@ -304,6 +623,49 @@ void ConsoleApp::_run_packer() {
     }
     LOG_INFO("Extension insensitive: " + String(packer.get_extension_insensitive() ? "enabled" : "disabled") + "\n");
     LOG_INFO("Extension adjust: " + Packer::get_extension_adjust_name(packer.get_extension_adjust()) + "\n");
+    LOG_INFO("Thread count: " + std::to_string(packer.get_thread_count()) + "\n");
+    LOG_INFO("Pipeline: " + String(packer.get_pipeline_enabled() ? "enabled" : "disabled") + "\n");
+    if (packer.get_pipeline_enabled()) {
+        LOG_INFO("Filter thread count: " + std::to_string(packer.get_filter_thread_count()) + "\n");
+        LOG_INFO("Copy thread count: " + std::to_string(packer.get_copy_thread_count()) + "\n");
+        LOG_INFO("Post thread count: " + std::to_string(packer.get_post_thread_count()) + "\n");
+        LOG_INFO("Queue size: " + std::to_string(packer.get_queue_size()) + "\n");
+    }
+    LOG_INFO("Copy engine: " + FileCopy::get_engine_name(packer.get_copy_engine()) + "\n");
+    LOG_INFO("Clone files: " + String(packer.get_clone_files() ? "enabled" : "disabled") + "\n");
+    LOG_INFO("Traversal: " + Packer::get_traversal_name(packer.get_traversal()) + "\n");
+    LOG_INFO("Destination index: " + String(packer.get_destination_index_enabled() ? "enabled" : "disabled") + "\n");
+    LOG_INFO("Incremental: " + String(packer.get_incremental_enabled() ? "enabled" : "disabled") + "\n");
+    if (packer.get_incremental_enabled()) {
+        LOG_INFO("Manifest file name: " + packer.get_manifest_file_name() + "\n");
+    }
+    LOG_INFO("Quick check: " + String(packer.get_quick_check_enabled() ? "enabled" : "disabled") + "\n");
+    if (packer.get_quick_check_enabled()) {
+        LOG_INFO("Quick check tolerance: " + std::to_string(packer.get_quick_check_tolerance()) + " ms\n");
+        if (!packer.get_preserve_times()) {
+            LOG_WARN("Quick check is enabled but times are not preserved, copies will not match their sources on the next run\n");
+        }
+    }
+    LOG_INFO("Preserve times: " + String(packer.get_preserve_times() ? "enabled" : "disabled") + "\n");
+    LOG_INFO("Verify files: " + String(packer.get_verify_files() ? "enabled" : "disabled") + "\n");
+    LOG_INFO("Split copy size: " + std::to_string(packer.get_split_copy_size()) + " MB\n");
+    LOG_INFO("Durability: " + Packer::get_durability_name(packer.get_durability()) + "\n");
+    if (packer.get_durability() == Packer::Durability::Batch) {
+        LOG_INFO("Sync batch files: " + std::to_string(packer.get_sync_batch_files()) + "\n");
+        LOG_INFO("Sync batch size: " + std::to_string(packer.get_sync_batch_size()) + " MB\n");
+    }
+    LOG_INFO("Dedup mode: " + Packer::get_dedup_mode_name(packer.get_dedup_mode()) + "\n");
+    LOG_INFO("Output mode: " + Packer::get_output_mode_name(packer.get_output_mode()) + "\n");
+    if (packer.get_output_mode() == Packer::OutputMode::Archive) {
+        LOG_INFO("Compression: " + Codec::get_type_name(packer.get_compression()) + "\n");
+        if (packer.get_compression() != Codec::Type::None) {
+            LOG_INFO("Compression block size: " + std::to_string(packer.get_compression_block_size()) + " bytes\n");
+        }
+    }
+    LOG_INFO("Watch delay: " + std::to_string(packer.get_watch_delay()) + " ms\n");
+    if (packer.get_output_mode() == Packer::OutputMode::Tar && TarWriter::is_standard_output(packer.get_write_path())) {
+        LOG_WARN("Tar output is written to standard output, which the console also prints to\n");
+    }
 #ifdef IGNORE_FILE_ENABLED
     LOG_INFO("Ignore file name: " + packer.get_ignore_file_name() + "\n");
     LOG_INFO("Ignore file: " + String(packer.get_ignore_file_enabled() ? "enabled" : "disabled") + "\n");
@@ -323,9 +685,78 @@ void ConsoleApp::_run_packer() {
 
     packer.pack_files();
 
+    const PackStats& stats = packer.get_stats();
+    for (int i = 0; i < static_cast<int>(PackStats::Counter::Max); ++i) {
+        PackStats::Counter counter = static_cast<PackStats::Counter>(i);
+        if (stats.get(counter)) {
+            LOG_INFO(PackStats::get_counter_name(counter) + ": " + std::to_string(stats.get(counter)) + "\n");
+        }
+    }
+    if (stats.get(PackStats::Counter::VerifyNanoseconds)) {
+        // Bytes per nanosecond of verification work equals gigabytes per second, reported in megabytes.
+        uint64_t throughput = stats.get(PackStats::Counter::BytesVerified) * 1000 / stats.get(PackStats::Counter::VerifyNanoseconds);
+        LOG_INFO("verify throughput: " + std::to_string(throughput) + " MB/s\n");
+    }
+
     console.print_line("Finished packing");
 }
 
+void ConsoleApp::_plan_packer() {
+    PackPlan plan;
+    Error error = packer.plan(plan);
+    if (error != Error::OK) {
+        LOG_ERROR("Failed to plan the pack: " + get_error_name(error) + "\n");
+        return;
+    }
+
+    for (int i = 0; i < static_cast<int>(PackPlan::Operation::Max); ++i) {
+        PackPlan::Operation operation = static_cast<PackPlan::Operation>(i);
+        LOG_INFO(PackPlan::get_operation_name(operation) + ": " + std::to_string(plan.get_count(operation)) + " files, " + std::to_string(plan.get_bytes(operation)) + " bytes\n");
+    }
+    for (int i = 1; i < static_cast<int>(PackPlan::Reason::Max); ++i) {
+        PackPlan::Reason reason = static_cast<PackPlan::Reason>(i);
+        if (plan.get_skip_count(reason)) {
+            LOG_INFO("skip (" + PackPlan::get_reason_name(reason) + "): " + std::to_string(plan.get_skip_count(reason)) + " files, " + std::to_string(plan.get_skip_bytes(reason)) + " bytes\n");
+        }
+    }
+    LOG_INFO("directories to create: " + std::to_string(plan.get_create_count()) + "\n");
+}
+
+void ConsoleApp::_watch_packer() {
+#ifdef LOG_ENABLED
+    LogFile log_file;
+    if (packer.get_log_enabled() && log_file_name.length()) {
+        log_file.open(log_file_name);
+    }
+#endif // LOG_ENABLED
+
+    console.print_line("Watching for changes, press Enter to stop...");
+
+    Error error = Error::OK;
+    std::exception_ptr exception;
+    std::thread watch_thread([this, &error, &exception]() {
+        try {
+            error = packer.watch();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+    });
+
+    String line;
+    std::getline(std::cin, line);
+    packer.stop_watch();
+    watch_thread.join();
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+    if (error != Error::OK) {
+        LOG_ERROR("Failed to watch the read path: " + get_error_name(error) + "\n");
+        return;
+    }
+    console.print_line("Finished watching");
+}
+
 void ConsoleApp::_quit_program() {
     process_commands = false;
 }
@@ -399,7 +830,7 @@ void ConsoleApp::_to_config_file(ConfigFile& p_file) const {
 
 void ConsoleApp::_from_config_file(const ConfigFile& p_file) {
 #ifdef LOG_ENABLED
-    log_file_name = p_file.get_value("log_file_name", DEFAULT_LOG_FILE_NAME);
+    log_file_name = p_file.get_value("log_file_name", DEFAULT_LOG_FILE_NAME).operator const String&();
 #endif // LOG_ENABLED
     packer.from_config_file(p_file);
 }
@@ -475,6 +906,34 @@ ConsoleApp::ConsoleApp() :
     _add_simple_command(&ConsoleApp::_set_suffix_enabled, "suffix_enabled", "Enable suffix string removal");
     _add_simple_command(&ConsoleApp::_set_extension_insensitive, "extension_insensitive", "Ignore extension case in the extension list");
     _add_prompt_command(&ConsoleApp::_set_extension_adjust, "extension_adjust", "Adjust the extension case", "Type '" + Packer::get_extension_adjust_name(Packer::ExtensionAdjust::Default) + "', '" + Packer::get_extension_adjust_name(Packer::ExtensionAdjust::Lower) + "', '" + Packer::get_extension_adjust_name(Packer::ExtensionAdjust::Upper) + ":");
+    _add_prompt_command(&ConsoleApp::_set_thread_count, "thread_count", "Change the number of threads used to walk the read path", "Type the number of threads (or 'all' to use every hardware thread):");
+    _add_simple_command(&ConsoleApp::_set_pipeline_enabled, "pipeline_enabled", "Pack files with separate scan, filter, copy and post-action stages");
+    _add_prompt_command(&ConsoleApp::_set_filter_thread_count, "filter_thread_count", "Change the number of threads in the pipeline filter stage", "Type the number of threads (or 'all' to use every hardware thread):");
+    _add_prompt_command(&ConsoleApp::_set_copy_thread_count, "copy_thread_count", "Change the number of threads in the pipeline copy stage", "Type the number of threads (or 'all' to use every hardware thread):");
+    _add_prompt_command(&ConsoleApp::_set_post_thread_count, "post_thread_count", "Change the number of threads in the pipeline post-action stage", "Type the number of threads (or 'all' to use every hardware thread):");
+    _add_prompt_command(&ConsoleApp::_set_queue_size, "queue_size", "Change the number of files that can wait between pipeline stages", "Type the queue size:");
+    _add_prompt_command(&ConsoleApp::_set_copy_engine, "copy_engine", "Change the engine used to copy file data", "Type '" + FileCopy::get_engine_name(FileCopy::Engine::Filesystem) + "', '" + FileCopy::get_engine_name(FileCopy::Engine::Kernel) + "', '" + FileCopy::get_engine_name(FileCopy::Engine::IoUring) + "':");
+    _add_simple_command(&ConsoleApp::_set_clone_files, "clone_files", "Clone files instead of copying them when the filesystem supports it");
+    _add_prompt_command(&ConsoleApp::_set_traversal, "traversal", "Change the backend used to walk the read path", "Type '" + Packer::get_traversal_name(Packer::Traversal::Filesystem) + "', '" + Packer::get_traversal_name(Packer::Traversal::Posix) + "':");
+    _add_simple_command(&ConsoleApp::_set_destination_index_enabled, "destination_index_enabled", "List each destination directory once instead of checking every file");
+    _add_simple_command(&ConsoleApp::_set_incremental_enabled, "incremental_enabled", "Skip files that are unchanged since the last pack");
+    _add_prompt_command(&ConsoleApp::_set_manifest_file_name, "manifest_file_name", "Change the name of the manifest file saved in the write path", "Type the name of the manifest file (or 'default' to use to the default):");
+    _add_simple_command(&ConsoleApp::_set_quick_check_enabled, "quick_check_enabled", "Keep existing files with the same size and modification time instead of replacing older ones");
+    _add_prompt_command(&ConsoleApp::_set_quick_check_tolerance, "quick_check_tolerance", "Change the modification time difference accepted by the quick check", "Type the tolerance in milliseconds:");
+    _add_simple_command(&ConsoleApp::_set_preserve_times, "preserve_times", "Give copied files the modification times of their sources");
+    _add_simple_command(&ConsoleApp::_set_verify_files, "verify_files", "Read copied files back and check them against their sources");
+    _add_prompt_command(&ConsoleApp::_set_split_copy_size, "split_copy_size", "Change the size from which a file is copied in ranges by several threads", "Type the size in megabytes, 0 to never split:");
+    _add_prompt_command(&ConsoleApp::_set_durability, "durability", "Change when copies are flushed to the destination device", "Type '" + Packer::get_durability_name(Packer::Durability::None) + "', '" + Packer::get_durability_name(Packer::Durability::File) + "', '" + Packer::get_durability_name(Packer::Durability::Batch) + "', '" + Packer::get_durability_name(Packer::Durability::End) + "':");
+    _add_prompt_command(&ConsoleApp::_set_sync_batch_files, "sync_batch_files", "Change the number of copies after which the batched durability policy syncs", "Type the number of files:");
+    _add_prompt_command(&ConsoleApp::_set_sync_batch_size, "sync_batch_size", "Change the amount of data after which the batched durability policy syncs", "Type the size in megabytes:");
+    _add_prompt_command(&ConsoleApp::_set_output_mode, "output_mode", "Change the form the packed files are written in", "Type '" + Packer::get_output_mode_name(Packer::OutputMode::Directory) + "', '" + Packer::get_output_mode_name(Packer::OutputMode::Archive) + "', '" + Packer::get_output_mode_name(Packer::OutputMode::Tar) + "':");
+    _add_prompt_command(&ConsoleApp::_set_compression, "compression", "Change the codec compressing the files of an archive", "Type '" + Codec::get_type_name(Codec::Type::None) + "', '" + Codec::get_type_name(Codec::Type::LZ) + "', '" + Codec::get_type_name(Codec::Type::Deflate) + "', '" + Codec::get_type_name(Codec::Type::Zstd) + "':");
+    _add_prompt_command(&ConsoleApp::_set_compression_block_size, "compression_block_size", "Change the number of bytes of a file compressed in each block", "Type the block size in bytes:");
+    _add_prompt_command(&ConsoleApp::_add_store_extension, "add_store_extension", "Add an extension to the list of extensions stored without compression", "Type the extension to add:");
+    _add_prompt_command(&ConsoleApp::_remove_store_extension, "remove_store_extension", "Remove an extension from the list of extensions stored without compression", "Type the extension to remove:");
+    _add_simple_command(&ConsoleApp::_clear_store_extensions, "clear_store_extensions", "Clear all of the extensions stored without compression");
+    _add_prompt_command(&ConsoleApp::_set_watch_delay, "watch_delay", "Change how long changes must settle before watch mode packs them", "Type the delay in milliseconds:");
+    _add_prompt_command(&ConsoleApp::_set_dedup_mode, "dedup_mode", "Change how files with the same content as an earlier file are written", "Type '" + Packer::get_dedup_mode_name(Packer::DedupMode::None) + "', '" + Packer::get_dedup_mode_name(Packer::DedupMode::HardLink) + "', '" + Packer::get_dedup_mode_name(Packer::DedupMode::Reflink) + "':");
 #ifdef IGNORE_FILE_ENABLED
     _add_prompt_command(&ConsoleApp::_set_ignore_file_name, "ignore_file_name", "Change the name of the ignore file", "Type the name of the ignore file (or 'default' to use to the default):");
     _add_simple_command(&ConsoleApp::_set_ignore_file_enabled, "ignore_file_enabled", "Check for an ignore file");
@@ -489,6 +948,8 @@ ConsoleApp::ConsoleApp() :
     _add_prompt_command(&ConsoleApp::_load_config, "load", "Load a state from a config file", "Type the name of the config file (or 'default' to use the default):");
     _add_simple_command(&ConsoleApp::_print_info, "info", "Print the current state of the packer");
     _add_simple_command(&ConsoleApp::_run_packer, "run", "Run the packer");
+    _add_simple_command(&ConsoleApp::_plan_packer, "plan", "Print what the packer would do without writing anything");
+    _add_simple_command(&ConsoleApp::_watch_packer, "watch", "Run the packer, then keep packing changed files until Enter is pressed");
     _add_simple_command(&ConsoleApp::_quit_program, "quit", "Quit the application");
     _add_hidden_command(&ConsoleApp::_print_help, "help");
 }
@@ -183,6 +183,161 @@ class ConsoleApp {
      */
     void _set_extension_adjust();
 
+    /**
+     * @brief Parses the user's input as a non-negative number.
+     * @param p_number The parsed number.
+     * @param p_minimum The smallest number accepted.
+     * @return `true` if the input is a valid number no smaller than the minimum, `false` otherwise.
+     */
+    bool _parse_number(int& p_number, int p_minimum = 0);
+
+    /**
+     * @brief Parses the user's input as a count, where 'all' is parsed as 0.
+     * @param p_count The parsed count.
+     * @return `true` if the input is a valid count, `false` otherwise.
+     */
+    bool _parse_count(int& p_count);
+
+    /**
+     * @brief Sets the number of threads used to walk the read path.
+     */
+    void _set_thread_count();
+
+    /**
+     * @brief Sets whether files are packed with the staged pipeline.
+     */
+    void _set_pipeline_enabled();
+
+    /**
+     * @brief Sets the number of threads in the pipeline filter stage.
+     */
+    void _set_filter_thread_count();
+
+    /**
+     * @brief Sets the number of threads in the pipeline copy stage.
+     */
+    void _set_copy_thread_count();
+
+    /**
+     * @brief Sets the number of threads in the pipeline post-action stage.
+     */
+    void _set_post_thread_count();
+
+    /**
+     * @brief Sets the capacity of the queues joining the pipeline stages.
+     */
+    void _set_queue_size();
+
+    /**
+     * @brief Sets the engine used to copy file data (Filesystem, Kernel, IoUring).
+     */
+    void _set_copy_engine();
+
+    /**
+     * @brief Sets whether files are cloned on copy-on-write filesystems.
+     */
+    void _set_clone_files();
+
+    /**
+     * @brief Sets the backend used to walk the read path (Filesystem, Posix).
+     */
+    void _set_traversal();
+
+    /**
+     * @brief Sets whether destination existence checks are answered from an in-memory index.
+     */
+    void _set_destination_index_enabled();
+
+    /**
+     * @brief Sets whether files unchanged since the last pack are skipped.
+     */
+    void _set_incremental_enabled();
+
+    /**
+     * @brief Sets the name of the manifest file saved in the write path.
+     */
+    void _set_manifest_file_name();
+
+    /**
+     * @brief Sets whether existing destinations are compared by size and modification time.
+     */
+    void _set_quick_check_enabled();
+
+    /**
+     * @brief Sets the modification time difference accepted by the quick check.
+     */
+    void _set_quick_check_tolerance();
+
+    /**
+     * @brief Sets whether copied files receive the modification times of their sources.
+     */
+    void _set_preserve_times();
+
+    /**
+     * @brief Sets whether copied files are read back and checked against their sources.
+     */
+    void _set_verify_files();
+
+    /**
+     * @brief Sets the size from which a file is copied in ranges by several threads.
+     */
+    void _set_split_copy_size();
+
+    /**
+     * @brief Sets when copies are flushed to the destination device (none, file, batch, end).
+     */
+    void _set_durability();
+
+    /**
+     * @brief Sets the number of copies after which the batched durability policy syncs the destination.
+     */
+    void _set_sync_batch_files();
+
+    /**
+     * @brief Sets the number of megabytes copied after which the batched durability policy syncs the destination.
+     */
+    void _set_sync_batch_size();
+
+    /**
+     * @brief Sets how files with the same content as an earlier file are written (None, HardLink, Reflink).
+     */
+    void _set_dedup_mode();
+
+    /**
+     * @brief Sets the form the packed files are written in (Directory, Archive).
+     */
+    void _set_output_mode();
+
+    /**
+     * @brief Sets the codec compressing the files of an archive (None, LZ, Deflate, Zstd).
+     */
+    void _set_compression();
+
+    /**
+     * @brief Sets the number of bytes of a file compressed in each block.
+     */
+    void _set_compression_block_size();
+
+    /**
+     * @brief Adds an extension to the list of extensions stored without compression.
+     */
+    void _add_store_extension();
+
+    /**
+     * @brief Removes an extension from the list of extensions stored without compression.
+     */
+    void _remove_store_extension();
+
+    /**
+     * @brief Clears the list of extensions stored without compression.
+     */
+    void _clear_store_extensions();
+
+    /**
+     * @brief Sets how long changes must settle before watch mode packs them.
+     */
+    void _set_watch_delay();
+
 #ifdef IGNORE_FILE_ENABLED
     /**
      * @brief Sets the name of the ignore file.
@@ -237,6 +392,16 @@ class ConsoleApp {
      */
     void _run_packer();
 
+    /**
+     * @brief Plans a pack and prints what it would do without writing anything.
+     */
+    void _plan_packer();
+
+    /**
+     * @brief Runs the Packer in watch mode until Enter is pressed.
+     */
+    void _watch_packer();
+
     /**
      * @brief Quits the application.
      */
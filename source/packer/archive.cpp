@@ -0,0 +1,37 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "archive.h"
+
+PACKER_NAMESPACE_BEGIN
+
+static_assert(sizeof(Archive::Header) == 16, "The archive header must have the same size on every platform.");
+static_assert(sizeof(Archive::Entry) == 48, "The archive index entries must have the same size on every platform.");
+static_assert(sizeof(Archive::BlockHeader) == 16, "The block header must have the same size on every platform.");
+static_assert(sizeof(Archive::Trailer) == 56, "The archive trailer must have the same size on every platform.");
+
+constexpr uint32_t Archive::codec_mask;
+
+const char Archive::magic[8] = { 'P', 'K', 'A', 'R', 0, 0, 0, 2 };
+
+uint64_t Archive::hash(const char* p_name, size_t p_length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < p_length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(p_name[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+uint32_t Archive::get_bucket_bits(uint64_t p_entry_count) {
+    uint32_t bits = 0;
+    while (bits < 32 && (1ull << bits) < p_entry_count) {
+        ++bits;
+    }
+    return bits;
+}
+
+uint64_t Archive::get_bucket(uint64_t p_hash, uint32_t p_bucket_bits) {
+    // A shift by the full width of the hash is undefined, a table without bits has a single bucket.
+    return p_bucket_bits == 0 ? 0 : p_hash >> (64 - p_bucket_bits);
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,121 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <cstdint>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class Archive
+ * @brief The layout of a packed archive, a single file holding the data of many files.
+ *
+ * An archive is laid out front to back as it is written: a header, the data of every file one after another,
+ * the buffer holding every entry name, the index, the bucket table, then a trailer at the very end of the file.
+ * The trailer locates the index, the name buffer and the bucket table. The index is an array of fixed-size
+ * entries sorted by the hash of their name, then by name, so it can be searched straight from a memory mapping
+ * of the archive without being parsed or copied. The index, the bucket table and the trailer are aligned to 8
+ * bytes.
+ *
+ * The bucket table turns a lookup into a constant number of probes: the leading `bucket_bits` bits of a hash
+ * select a bucket, and the bucket table holds the index of the first entry of every bucket, followed by the
+ * number of entries, so the entries of bucket `b` are those from `buckets[b]` up to `buckets[b + 1]`. There are
+ * at least as many buckets as entries.
+ *
+ * The data of a file is either stored as is or compressed in blocks, as recorded by the codec in the flags of
+ * its entry. Compressed data starts with a `BlockHeader`, then the block table, `block_count + 1` offsets from
+ * the start of the data, then the blocks, block `i` spanning from offset `i` to offset `i + 1`. Every block but
+ * the last holds `block_size` bytes of the file. Blocks are compressed independently, so any part of a file can
+ * be read by decompressing only the blocks holding it. A block that does not shrink is stored as is, which shows
+ * as a stored size equal to its size in the file.
+ *
+ * Entry names are paths relative to the archive root, separated by forward slashes. Integers are stored in
+ * native byte order.
+ */
+class Archive {
+public:
+    /**
+     * @struct Header
+     * @brief The start of an archive.
+     */
+    struct Header {
+        char magic[8]; ///< The archive identifier, including the format version.
+        uint64_t reserved; ///< Unused, always zero.
+    };
+
+    /**
+     * @struct Entry
+     * @brief A file of the archive, as stored in the index.
+     */
+    struct Entry {
+        uint64_t hash; ///< The hash of the name of the file, see `hash`.
+        uint64_t offset; ///< The offset of the file data from the start of the archive.
+        uint64_t size; ///< The size of the data as stored in the archive, in bytes.
+        int64_t mtime; ///< The modification time of the source file in nanoseconds.
+        uint64_t name; ///< The offset of the name of the file in the name buffer.
+        uint32_t name_length; ///< The length of the name of the file.
+        uint32_t flags; ///< Flags describing how the data is stored, the low byte holds its `Codec::Type`, see `codec_mask`.
+    };
+
+    /**
+     * @struct BlockHeader
+     * @brief The start of the data of a compressed file, followed by its block table.
+     */
+    struct BlockHeader {
+        uint64_t size; ///< The size of the file in bytes.
+        uint32_t block_size; ///< The number of bytes of the file held by every block but the last.
+        uint32_t block_count; ///< The number of blocks.
+    };
+
+    /**
+     * @struct Trailer
+     * @brief The end of an archive, locating its index.
+     */
+    struct Trailer {
+        uint64_t index_offset; ///< The offset of the index from the start of the archive.
+        uint64_t entry_count; ///< The number of entries of the index.
+        uint64_t names_offset; ///< The offset of the name buffer from the start of the archive.
+        uint64_t names_size; ///< The size of the name buffer.
+        uint64_t buckets_offset; ///< The offset of the bucket table from the start of the archive.
+        uint32_t bucket_bits; ///< The number of leading hash bits selecting a bucket, the table holds `2^bucket_bits + 1` indices.
+        uint32_t reserved; ///< Unused, always zero.
+        char magic[8]; ///< The archive identifier again, marking a completely written archive.
+    };
+
+    /**
+     * @brief The identifier at the start and the end of every archive, including the format version.
+     */
+    static const char magic[8];
+
+    /**
+     * @brief The bits of the entry flags holding the codec of the data, zero for data stored as is.
+     */
+    static constexpr uint32_t codec_mask = 0xff;
+
+    /**
+     * @brief Hash an entry name, the index is sorted by this hash.
+     * @param p_name The characters of the name.
+     * @param p_length The number of characters.
+     * @return The 64-bit FNV-1a hash of the name.
+     */
+    static uint64_t hash(const char* p_name, size_t p_length);
+
+    /**
+     * @brief Get the number of leading hash bits selecting a bucket for an index.
+     * @param p_entry_count The number of entries of the index.
+     * @return The smallest number of bits giving at least one bucket per entry.
+     */
+    static uint32_t get_bucket_bits(uint64_t p_entry_count);
+
+    /**
+     * @brief Get the bucket of a hash.
+     * @param p_hash The hash of an entry name.
+     * @param p_bucket_bits The number of leading hash bits selecting a bucket.
+     * @return The bucket holding the entries with this hash.
+     */
+    static uint64_t get_bucket(uint64_t p_hash, uint32_t p_bucket_bits);
+};
+
+PACKER_NAMESPACE_END
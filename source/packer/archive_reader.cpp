@@ -0,0 +1,464 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "archive_reader.h"
+#include "thread_pool.h"
+
+#include <cstring>
+#include <mutex>
+#include <numeric>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif // __linux__
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @brief The number of members extracted by a single task of the thread pool.
+ */
+static constexpr size_t extract_run_size = 64;
+
+/**
+ * @brief Returns true when a member name stays inside the directory it is extracted into.
+ */
+static bool is_safe_name(const char* p_name, size_t p_length) {
+    if (p_length == 0 || p_name[0] == '/') {
+        return false;
+    }
+    for (size_t start = 0; start < p_length;) {
+        const char* separator = static_cast<const char*>(std::memchr(p_name + start, '/', p_length - start));
+        size_t end = separator ? separator - p_name : p_length;
+        if (end - start == 2 && p_name[start] == '.' && p_name[start + 1] == '.') {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+#ifdef __linux__
+/**
+ * @brief Writes a buffer at an offset of a file.
+ * @return The error that stopped the write, or an empty error code.
+ */
+static std::error_code write_region(int p_fd, const char* p_data, uint64_t p_size, uint64_t p_offset) {
+    while (p_size > 0) {
+        ssize_t written = ::pwrite(p_fd, p_data, p_size, static_cast<off_t>(p_offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::error_code(errno, std::generic_category());
+        }
+        p_data += written;
+        p_size -= written;
+        p_offset += written;
+    }
+    return std::error_code();
+}
+#endif // __linux__
+
+ArchiveReader::Member::Member() :
+    name(nullptr),
+    name_length(0),
+    data(nullptr),
+    stored_size(0),
+    size(0),
+    offset(0),
+    mtime(0),
+    codec(Codec::Type::None),
+    block_size(0),
+    block_count(0) {
+}
+
+bool ArchiveReader::_get_member(const Archive::Entry& p_entry, Member& p_member) const {
+    if (p_entry.name > names_size || p_entry.name_length > names_size - p_entry.name ||
+        p_entry.offset > size || p_entry.size > size - p_entry.offset) {
+        return false;
+    }
+    uint32_t codec = p_entry.flags & Archive::codec_mask;
+    if (codec >= static_cast<uint32_t>(Codec::Type::Max)) {
+        return false;
+    }
+
+    p_member.name = names + p_entry.name;
+    p_member.name_length = p_entry.name_length;
+    p_member.data = memory + p_entry.offset;
+    p_member.stored_size = p_entry.size;
+    p_member.size = p_entry.size;
+    p_member.offset = p_entry.offset;
+    p_member.mtime = p_entry.mtime;
+    p_member.codec = static_cast<Codec::Type>(codec);
+    p_member.block_size = 0;
+    p_member.block_count = 0;
+    if (p_member.codec == Codec::Type::None) {
+        return true;
+    }
+
+    // The offsets of the block table are checked as each block is read.
+    Archive::BlockHeader header;
+    if (p_entry.size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, p_member.data, sizeof(header));
+    uint64_t block_count = header.block_size > 0 ? header.size / header.block_size + (header.size % header.block_size != 0) : 0;
+    if (header.block_size == 0 || header.block_count != block_count ||
+        (block_count + 1) * sizeof(uint64_t) > p_entry.size - sizeof(header)) {
+        return false;
+    }
+    p_member.size = header.size;
+    p_member.block_size = header.block_size;
+    p_member.block_count = header.block_count;
+    return true;
+}
+
+void ArchiveReader::_extract_member(const Member& p_member, const String& p_path, const FileCopy::Options& p_options) const {
+#ifdef __linux__
+    int out = ::open(p_path.c_str(), O_WRONLY | O_CREAT | (p_options.overwrite ? O_TRUNC : O_EXCL) | O_CLOEXEC, 0666);
+    if (out < 0) {
+        if (errno == EEXIST && !p_options.overwrite) {
+            return;
+        }
+        throw FileAccess::filesystem_error("cannot extract file", p_path, std::error_code(errno, std::generic_category()));
+    }
+
+    std::error_code error;
+    if (p_member.codec != Codec::Type::None) {
+        // Every block lands at its own offset of the file, so the blocks are decompressed and written in parallel.
+        std::mutex error_mutex;
+        ThreadPool::parallel_for(p_member.block_count, [this, &p_member, out, &error, &error_mutex](size_t p_index) {
+            static thread_local Vector<char> block;
+            uint64_t offset = p_index * static_cast<uint64_t>(p_member.block_size);
+            size_t size = std::min<uint64_t>(p_member.block_size, p_member.size - offset);
+            block.resize(size);
+            std::error_code block_error;
+            if (!read(p_member, offset, block.data(), size)) {
+                block_error = std::make_error_code(std::errc::illegal_byte_sequence);
+            } else {
+                block_error = write_region(out, block.data(), size, offset);
+            }
+            if (block_error) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = block_error;
+                }
+            }
+        });
+    } else if (p_options.engine == FileCopy::Engine::Filesystem) {
+        // Write straight from the mapping, the data is already in memory.
+        error = write_region(out, p_member.data, p_member.size, 0);
+    } else {
+        FileCopy::Result result;
+        error = FileCopy::copy_range(fd, p_member.offset, out, 0, p_member.size, result);
+    }
+    if (!error && p_options.preserve_times) {
+        int64_t seconds = p_member.mtime / 1000000000;
+        int64_t nanoseconds = p_member.mtime % 1000000000;
+        if (nanoseconds < 0) {
+            seconds -= 1;
+            nanoseconds += 1000000000;
+        }
+        struct timespec times[2] = { { 0, UTIME_OMIT }, { static_cast<time_t>(seconds), static_cast<long>(nanoseconds) } };
+        if (::futimens(out, times) != 0) {
+            error = std::error_code(errno, std::generic_category());
+        }
+    }
+    if (::close(out) != 0 && !error) {
+        error = std::error_code(errno, std::generic_category());
+    }
+    if (error) {
+        ::unlink(p_path.c_str());
+        throw FileAccess::filesystem_error("cannot extract file", p_path, error);
+    }
+#else
+    if (!p_options.overwrite && FileAccess::exists(p_path)) {
+        return;
+    }
+
+    FileStreamO out(p_path, std::ios::binary | std::ios::trunc);
+    if (p_member.codec != Codec::Type::None) {
+        static thread_local Vector<char> block;
+        block.resize(p_member.block_size);
+        for (uint64_t offset = 0; offset < p_member.size && out.good(); offset += p_member.block_size) {
+            size_t size = std::min<uint64_t>(p_member.block_size, p_member.size - offset);
+            if (!read(p_member, offset, block.data(), size)) {
+                out.setstate(std::ios::failbit);
+                break;
+            }
+            out.write(block.data(), size);
+        }
+    } else {
+        out.write(p_member.data, p_member.size);
+    }
+    out.close();
+    if (out.fail()) {
+        std::error_code error;
+        FileAccess::remove(p_path, error);
+        throw FileAccess::filesystem_error("cannot extract file", p_path, std::make_error_code(std::errc::io_error));
+    }
+    if (p_options.preserve_times) {
+        FileAccess::last_write_time(p_path, FileAccess::file_time_type(std::chrono::duration_cast<FileAccess::file_time_type::duration>(std::chrono::nanoseconds(p_member.mtime))));
+    }
+#endif // __linux__
+}
+
+Error ArchiveReader::open(const String& p_path) {
+    close();
+
+#ifdef __linux__
+    fd = ::open(p_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Error::FileCantOpen;
+    }
+    struct stat archive_stat;
+    if (::fstat(fd, &archive_stat) != 0) {
+        close();
+        return Error::FileCantOpen;
+    }
+    size = archive_stat.st_size;
+    if (size < sizeof(Archive::Header) + sizeof(Archive::Trailer)) {
+        close();
+        return Error::InvalidData;
+    }
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close();
+        return Error::Failed;
+    }
+    memory = static_cast<const char*>(mapping);
+#else
+    FileStreamI file(p_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return Error::FileCantOpen;
+    }
+    size = static_cast<uint64_t>(file.tellg());
+    if (size < sizeof(Archive::Header) + sizeof(Archive::Trailer)) {
+        return Error::InvalidData;
+    }
+    buffer.resize(size);
+    file.seekg(0);
+    file.read(buffer.data(), size);
+    if (!file.good()) {
+        buffer.clear();
+        return Error::Failed;
+    }
+    memory = buffer.data();
+#endif // __linux__
+
+    // Check every region the trailer locates against the archive before anything is read through it.
+    Archive::Trailer trailer;
+    uint64_t trailer_offset = size - sizeof(trailer);
+    std::memcpy(&trailer, memory + trailer_offset, sizeof(trailer));
+    if (std::memcmp(memory, Archive::magic, sizeof(Archive::magic)) != 0 ||
+        std::memcmp(trailer.magic, Archive::magic, sizeof(Archive::magic)) != 0 ||
+        trailer.names_offset > trailer_offset || trailer.names_size > trailer_offset - trailer.names_offset ||
+        trailer.index_offset % 8 != 0 || trailer.index_offset > trailer_offset ||
+        trailer.entry_count > (trailer_offset - trailer.index_offset) / sizeof(Archive::Entry) ||
+        trailer.buckets_offset % 8 != 0 || trailer.buckets_offset > trailer_offset || trailer.bucket_bits > 32 ||
+        (1ull << trailer.bucket_bits) + 1 > (trailer_offset - trailer.buckets_offset) / sizeof(uint64_t)) {
+        close();
+        return Error::InvalidData;
+    }
+
+    entries = reinterpret_cast<const Archive::Entry*>(memory + trailer.index_offset);
+    entry_count = trailer.entry_count;
+    names = memory + trailer.names_offset;
+    names_size = trailer.names_size;
+    buckets = reinterpret_cast<const uint64_t*>(memory + trailer.buckets_offset);
+    bucket_bits = trailer.bucket_bits;
+
+    order.resize(entry_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](uint64_t p_a, uint64_t p_b) {
+        return entries[p_a].offset < entries[p_b].offset;
+    });
+    return Error::OK;
+}
+
+void ArchiveReader::close() {
+#ifdef __linux__
+    if (memory) {
+        ::munmap(const_cast<char*>(memory), size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+#else
+    buffer.clear();
+    buffer.shrink_to_fit();
+#endif // __linux__
+    memory = nullptr;
+    size = 0;
+    entries = nullptr;
+    entry_count = 0;
+    names = nullptr;
+    names_size = 0;
+    buckets = nullptr;
+    bucket_bits = 0;
+    order.clear();
+}
+
+bool ArchiveReader::is_open() const {
+    return memory != nullptr;
+}
+
+size_t ArchiveReader::get_member_count() const {
+    return order.size();
+}
+
+bool ArchiveReader::get_member(size_t p_index, Member& p_member) const {
+    if (p_index >= order.size()) {
+        return false;
+    }
+    return _get_member(entries[order[p_index]], p_member);
+}
+
+bool ArchiveReader::find(const char* p_name, size_t p_length, Member& p_member) const {
+    if (!is_open()) {
+        return false;
+    }
+
+    uint64_t hash = Archive::hash(p_name, p_length);
+    uint64_t bucket = Archive::get_bucket(hash, bucket_bits);
+    uint64_t end = std::min(buckets[bucket + 1], entry_count);
+    for (uint64_t i = buckets[bucket]; i < end; ++i) {
+        const Archive::Entry& entry = entries[i];
+        if (entry.hash > hash) {
+            break;
+        }
+        if (entry.hash == hash && entry.name_length == p_length && _get_member(entry, p_member) &&
+            std::memcmp(p_member.name, p_name, p_length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ArchiveReader::find(const String& p_name, Member& p_member) const {
+    return find(p_name.data(), p_name.size(), p_member);
+}
+
+bool ArchiveReader::read(const Member& p_member, uint64_t p_offset, char* p_buffer, size_t p_size) const {
+    if (p_offset > p_member.size || p_size > p_member.size - p_offset) {
+        return false;
+    }
+    if (p_member.codec == Codec::Type::None) {
+        std::memcpy(p_buffer, p_member.data + p_offset, p_size);
+        return true;
+    }
+    const Codec* codec = Codec::get_codec(p_member.codec);
+    if (codec == nullptr) {
+        return false;
+    }
+
+    static thread_local Vector<char> block;
+    const char* table = p_member.data + sizeof(Archive::BlockHeader);
+    while (p_size > 0) {
+        uint64_t index = p_offset / p_member.block_size;
+        uint64_t block_offset = index * p_member.block_size;
+        size_t block_size = std::min<uint64_t>(p_member.block_size, p_member.size - block_offset);
+        uint64_t begin;
+        uint64_t end;
+        std::memcpy(&begin, table + index * sizeof(uint64_t), sizeof(begin));
+        std::memcpy(&end, table + (index + 1) * sizeof(uint64_t), sizeof(end));
+        if (begin > end || end > p_member.stored_size) {
+            return false;
+        }
+
+        size_t skip = p_offset - block_offset;
+        size_t count = std::min<uint64_t>(p_size, block_size - skip);
+        const char* stored = p_member.data + begin;
+        if (end - begin == block_size) {
+            // The block did not shrink and was stored as is.
+            std::memcpy(p_buffer, stored + skip, count);
+        } else if (count == block_size) {
+            if (!codec->decompress(stored, end - begin, p_buffer, block_size)) {
+                return false;
+            }
+        } else {
+            block.resize(block_size);
+            if (!codec->decompress(stored, end - begin, block.data(), block_size)) {
+                return false;
+            }
+            std::memcpy(p_buffer, block.data() + skip, count);
+        }
+        p_buffer += count;
+        p_offset += count;
+        p_size -= count;
+    }
+    return true;
+}
+
+Error ArchiveReader::extract(const String& p_directory, const FileCopy::Options& p_options, size_t p_thread_count) const {
+    if (!is_open()) {
+        return Error::Unconfigured;
+    }
+
+    FileAccess::create_directories(p_directory);
+
+    auto extract_run = [this, &p_directory, &p_options](size_t p_begin, size_t p_end) {
+        static thread_local String path;
+        // Members are laid out in the order their directories were walked, so neighbours share a parent.
+        String parent = p_directory;
+        for (size_t i = p_begin; i < p_end; ++i) {
+            Member member;
+            if (!get_member(i, member)) {
+                throw FileAccess::filesystem_error("corrupt archive member", p_directory, std::make_error_code(std::errc::illegal_byte_sequence));
+            }
+            if (!is_safe_name(member.name, member.name_length)) {
+                throw FileAccess::filesystem_error("invalid archive member name", String(member.name, member.name_length), std::make_error_code(std::errc::invalid_argument));
+            }
+
+            path.assign(p_directory);
+            path.push_back('/');
+            path.append(member.name, member.name_length);
+            size_t separator = path.find_last_of('/');
+            if (parent.size() != separator || path.compare(0, separator, parent) != 0) {
+                parent.assign(path, 0, separator);
+                FileAccess::create_directories(parent);
+            }
+            _extract_member(member, path, p_options);
+        }
+    };
+
+    size_t count = order.size();
+    if (ThreadPool::resolve_thread_count(p_thread_count) > 1 && count > extract_run_size) {
+        ThreadPool pool(p_thread_count);
+        for (size_t begin = 0; begin < count; begin += extract_run_size) {
+            size_t end = std::min(begin + extract_run_size, count);
+            pool.push([&extract_run, begin, end]() {
+                extract_run(begin, end);
+            });
+        }
+        pool.wait();
+    } else {
+        extract_run(0, count);
+    }
+
+    return Error::OK;
+}
+
+ArchiveReader::ArchiveReader() :
+    memory(nullptr),
+    size(0),
+#ifdef __linux__
+    fd(-1),
+#endif // __linux__
+    entries(nullptr),
+    entry_count(0),
+    names(nullptr),
+    names_size(0),
+    buckets(nullptr),
+    bucket_bits(0) {
+}
+
+ArchiveReader::~ArchiveReader() {
+    close();
+}
+
+PACKER_NAMESPACE_END
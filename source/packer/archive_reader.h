@@ -0,0 +1,173 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "archive.h"
+#include "codec.h"
+#include "error.h"
+#include "file_copy.h"
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class ArchiveReader
+ * @brief Reads a packed archive, see `Archive` for its layout.
+ *
+ * On Linux the archive is mapped into memory, elsewhere it is read into a buffer. Members are looked up by name
+ * through the bucket table and the index with a constant number of probes, and their data is returned as a view
+ * of the mapping, so nothing is parsed or copied. Members that were compressed are read with `read`, which
+ * decompresses only the blocks holding the requested part of the file. Once an archive is open, every const
+ * function is safe to call from any number of threads at once.
+ *
+ * The archive is validated when it is opened, and the name and the data of every member are checked against the
+ * size of the archive before they are returned, so a corrupt archive never leads to a read outside the mapping.
+ */
+class ArchiveReader {
+public:
+    /**
+     * @struct Member
+     * @brief A file of the archive, viewed in place.
+     */
+    struct Member {
+        const char* name; ///< The characters of the name, not null-terminated.
+        size_t name_length; ///< The length of the name.
+        const char* data; ///< The data as stored in the archive, valid while the archive is open.
+        uint64_t stored_size; ///< The size of the data as stored in the archive.
+        uint64_t size; ///< The size of the file in bytes.
+        uint64_t offset; ///< The offset of the stored data from the start of the archive.
+        int64_t mtime; ///< The modification time of the source file in nanoseconds.
+        Codec::Type codec; ///< The codec of the data, `Codec::Type::None` for data stored as is.
+        uint32_t block_size; ///< The number of bytes of the file held by each compressed block.
+        uint32_t block_count; ///< The number of compressed blocks.
+
+        /**
+         * @brief Constructor for the Member struct.
+         */
+        Member();
+    };
+
+private:
+    const char* memory; ///< The contents of the archive.
+    uint64_t size; ///< The size of the archive.
+#ifdef __linux__
+    int fd; ///< The open archive, or -1.
+#else
+    Vector<char> buffer; ///< The contents of the archive.
+#endif // __linux__
+    const Archive::Entry* entries; ///< The index.
+    uint64_t entry_count; ///< The number of entries of the index.
+    const char* names; ///< The name buffer.
+    uint64_t names_size; ///< The size of the name buffer.
+    const uint64_t* buckets; ///< The bucket table.
+    uint32_t bucket_bits; ///< The number of leading hash bits selecting a bucket.
+    Vector<uint64_t> order; ///< The indices of the entries, sorted by the offset of their data.
+
+    /**
+     * @brief Get a member from its index entry.
+     * @param p_entry The index entry.
+     * @param p_member Receives the member.
+     * @return `true` if the name, the data and the block table of the entry lie inside the archive, `false` otherwise.
+     */
+    bool _get_member(const Archive::Entry& p_entry, Member& p_member) const;
+
+    /**
+     * @brief Write the data of a member to a file.
+     * @param p_member The member.
+     * @param p_path The path of the file.
+     * @param p_options The options controlling the copy.
+     * @throws FileAccess::filesystem_error If the file cannot be written.
+     */
+    void _extract_member(const Member& p_member, const String& p_path, const FileCopy::Options& p_options) const;
+
+public:
+    /**
+     * @brief Open an archive, closing any archive already open.
+     * @param p_path The path of the archive.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error open(const String& p_path);
+
+    /**
+     * @brief Close the archive, the views of its members are no longer valid.
+     */
+    void close();
+
+    /**
+     * @brief Check if an archive is open.
+     * @return `true` if an archive is open, `false` otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Get the number of members of the archive.
+     * @return The number of members.
+     */
+    size_t get_member_count() const;
+
+    /**
+     * @brief Get a member by its position in the archive, members are ordered as their data is laid out.
+     * @param p_index The position of the member, less than `get_member_count`.
+     * @param p_member Receives the member.
+     * @return `true` if the member was found, `false` if the index is out of range or the entry is corrupt.
+     */
+    bool get_member(size_t p_index, Member& p_member) const;
+
+    /**
+     * @brief Find a member by name.
+     * @param p_name The characters of the name.
+     * @param p_length The number of characters.
+     * @param p_member Receives the member.
+     * @return `true` if the member was found, `false` otherwise.
+     */
+    bool find(const char* p_name, size_t p_length, Member& p_member) const;
+
+    /**
+     * @brief Find a member by name.
+     * @param p_name The name of the member.
+     * @param p_member Receives the member.
+     * @return `true` if the member was found, `false` otherwise.
+     */
+    bool find(const String& p_name, Member& p_member) const;
+
+    /**
+     * @brief Read part of the file of a member, decompressing only the blocks holding it.
+     * @param p_member The member.
+     * @param p_offset The offset of the part in the file.
+     * @param p_buffer Receives the part.
+     * @param p_size The size of the part.
+     * @return `true` if the part was read, `false` if it lies outside the file, the data is corrupt or its codec was not built.
+     */
+    bool read(const Member& p_member, uint64_t p_offset, char* p_buffer, size_t p_size) const;
+
+    /**
+     * @brief Extract every member into a directory tree.
+     *
+     * The members are split into runs in the order their data is laid out and the runs are written by a thread
+     * pool. Stored data is copied with `FileCopy::copy_range` by the kernel and io_uring engines, and written from
+     * the mapping by the std::filesystem engine. The blocks of compressed members are decompressed in parallel
+     * on the same pool. Existing files are replaced, unless `overwrite` is unset, and the files receive the
+     * modification time of their source when `preserve_times` is set.
+     *
+     * @param p_directory The directory to extract into, created when it does not exist.
+     * @param p_options The options controlling the copies.
+     * @param p_thread_count The number of threads to use, 0 for every hardware thread.
+     * @return An `Error` code indicating the success or failure of the operation.
+     * @throws FileAccess::filesystem_error If a member cannot be written.
+     */
+    Error extract(const String& p_directory, const FileCopy::Options& p_options, size_t p_thread_count = 0) const;
+
+    /**
+     * @brief Constructor for the ArchiveReader class.
+     */
+    ArchiveReader();
+
+    /**
+     * @brief Destructor for the ArchiveReader class, closes the archive.
+     */
+    ~ArchiveReader();
+
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,390 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "archive_writer.h"
+#include "thread_pool.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif // __linux__
+
+PACKER_NAMESPACE_BEGIN
+
+#ifndef __linux__
+/**
+ * @brief The size of the buffer used to copy the data of a file into the archive.
+ */
+static constexpr size_t archive_buffer_size = 1 << 20;
+#endif // __linux__
+
+/**
+ * @brief Rounds an offset up to the alignment of the index.
+ */
+static uint64_t align_offset(uint64_t p_offset) {
+    return (p_offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+bool ArchiveWriter::_write(const char* p_data, size_t p_size, uint64_t p_offset) {
+#ifdef __linux__
+    while (p_size > 0) {
+        ssize_t written = ::pwrite(fd, p_data, p_size, static_cast<off_t>(p_offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p_data += written;
+        p_size -= written;
+        p_offset += written;
+    }
+    return true;
+#else
+    file.seekp(p_offset);
+    file.write(p_data, p_size);
+    return file.good();
+#endif // __linux__
+}
+
+int ArchiveWriter::_add_compressed(const char* p_data, uint64_t p_size, Archive::Entry& p_entry) {
+    uint64_t block_count = (p_size + block_size - 1) / block_size;
+    uint64_t head_size = sizeof(Archive::BlockHeader) + (block_count + 1) * sizeof(uint64_t);
+    if (block_count > UINT32_MAX || head_size >= p_size) {
+        return 0;
+    }
+
+    // Blocks never grow, so the compressed data fits in the head and the size of the file. The region is trimmed
+    // to the data written once the file is done, when no other file has reserved the data after it.
+    uint64_t reserved = head_size + p_size;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        p_entry.offset = data_end;
+        data_end += reserved;
+    }
+
+    Vector<char> head(head_size);
+    Archive::BlockHeader header;
+    header.size = p_size;
+    header.block_size = block_size;
+    header.block_count = static_cast<uint32_t>(block_count);
+    std::memcpy(head.data(), &header, sizeof(header));
+
+    // Only a window of blocks is held in memory at a time, enough to keep every thread of the pool busy.
+    size_t window = std::max<size_t>(ThreadPool::get_current_thread_count(), 1) * 2;
+    Vector<Vector<char>> blocks(std::min<uint64_t>(window, block_count));
+    const Codec& block_codec = *codec;
+    uint64_t end = head_size;
+    bool written = true;
+    for (uint64_t first = 0; written && first < block_count && end < p_size; first += blocks.size()) {
+        size_t count = std::min<uint64_t>(blocks.size(), block_count - first);
+        ThreadPool::parallel_for(count, [this, p_data, p_size, first, &blocks, &block_codec](size_t p_index) {
+            uint64_t offset = (first + p_index) * static_cast<uint64_t>(block_size);
+            size_t size = std::min<uint64_t>(block_size, p_size - offset);
+            // A block is only kept compressed when it shrinks, so its destination is one byte smaller than the block.
+            Vector<char>& block = blocks[p_index];
+            block.resize(size > 0 ? size - 1 : 0);
+            size_t compressed = block_codec.compress(p_data + offset, size, block.data(), block.size());
+            if (compressed == 0) {
+                block.assign(p_data + offset, p_data + offset + size);
+            } else {
+                block.resize(compressed);
+            }
+        });
+
+#ifndef __linux__
+        // Streams cannot be written from several threads, the data is written while holding the lock.
+        std::lock_guard<std::mutex> lock(mutex);
+#endif // __linux__
+        for (size_t i = 0; written && i < count; ++i) {
+            // Past the size of the file the data cannot shrink anymore, nothing is written beyond it.
+            if (end + blocks[i].size() >= p_size) {
+                end = p_size;
+                break;
+            }
+            std::memcpy(head.data() + sizeof(header) + (first + i) * sizeof(uint64_t), &end, sizeof(uint64_t));
+            written = _write(blocks[i].data(), blocks[i].size(), p_entry.offset + end);
+            end += blocks[i].size();
+        }
+    }
+    std::memcpy(head.data() + sizeof(header) + block_count * sizeof(uint64_t), &end, sizeof(uint64_t));
+
+    // A file that does not shrink is stored as is over the start of its region.
+    bool stored = end >= p_size;
+    {
+#ifndef __linux__
+        std::lock_guard<std::mutex> lock(mutex);
+#endif // __linux__
+        if (written) {
+            written = stored ? _write(p_data, p_size, p_entry.offset) : _write(head.data(), head.size(), p_entry.offset);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (data_end == p_entry.offset + reserved) {
+            data_end = p_entry.offset + end;
+        }
+    }
+    p_entry.size = end;
+    p_entry.flags = stored ? 0 : static_cast<uint32_t>(block_codec.get_type());
+    return written ? 1 : -1;
+}
+
+Error ArchiveWriter::open(const String& p_path) {
+    abort();
+
+    path = p_path;
+    temporary_path = p_path + ".tmp";
+#ifdef __linux__
+    fd = ::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return Error::FileCantOpen;
+    }
+#else
+    file.open(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return Error::FileCantOpen;
+    }
+#endif // __linux__
+
+    Archive::Header header;
+    std::memcpy(header.magic, Archive::magic, sizeof(header.magic));
+    header.reserved = 0;
+    if (!_write(reinterpret_cast<const char*>(&header), sizeof(header), 0)) {
+        abort();
+        return Error::Failed;
+    }
+    data_end = sizeof(header);
+    return Error::OK;
+}
+
+void ArchiveWriter::set_codec(Codec::Type p_codec, uint32_t p_block_size) {
+    codec = Codec::get_codec(p_codec);
+    block_size = p_block_size > 0 ? p_block_size : 1;
+}
+
+std::error_code ArchiveWriter::add(const char* p_name, size_t p_length, const FileCopy::Location& p_source, bool p_compress, uint64_t& p_size, uint64_t& p_stored_size) {
+    Archive::Entry entry;
+    entry.hash = Archive::hash(p_name, p_length);
+    entry.name_length = static_cast<uint32_t>(p_length);
+    entry.flags = 0;
+    int compressed = 0;
+
+#ifdef __linux__
+    int source = ::openat(p_source.directory >= 0 ? p_source.directory : AT_FDCWD, p_source.directory >= 0 ? p_source.name : p_source.path->c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        return std::error_code(errno, std::generic_category());
+    }
+    struct stat source_stat;
+    if (::fstat(source, &source_stat) != 0) {
+        int error = errno;
+        ::close(source);
+        return std::error_code(error, std::generic_category());
+    }
+    uint64_t size = source_stat.st_size;
+    entry.mtime = static_cast<int64_t>(source_stat.st_mtim.tv_sec) * 1000000000 + source_stat.st_mtim.tv_nsec;
+
+    // The blocks are compressed straight from a mapping of the file, a file that cannot be mapped is stored.
+    if (p_compress && codec && size > 0) {
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, source, 0);
+        if (mapping != MAP_FAILED) {
+            compressed = _add_compressed(static_cast<const char*>(mapping), size, entry);
+            ::munmap(mapping, size);
+        }
+    }
+
+    if (compressed == 0) {
+        // Reserve the next region of the data, then copy into it without holding the lock.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entry.offset = data_end;
+            data_end += size;
+        }
+        entry.size = size;
+        FileCopy::Result result;
+        std::error_code error = FileCopy::copy_range(source, 0, fd, entry.offset, size, result);
+        if (error) {
+            ::close(source);
+            return error;
+        }
+    }
+    ::close(source);
+#else
+    std::error_code error;
+    uint64_t size = FileAccess::file_size(*p_source.path, error);
+    if (error) {
+        return error;
+    }
+    auto mtime = FileAccess::last_write_time(*p_source.path, error);
+    if (error) {
+        return error;
+    }
+    entry.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+
+    FileStreamI source(*p_source.path, std::ios::binary);
+    if (!source.is_open()) {
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    if (p_compress && codec && size > 0) {
+        static thread_local Vector<char> contents;
+        contents.resize(size);
+        if (!source.read(contents.data(), size)) {
+            return std::make_error_code(std::errc::io_error);
+        }
+        compressed = _add_compressed(contents.data(), size, entry);
+        source.seekg(0);
+    }
+
+    if (compressed == 0) {
+        // Streams cannot be written from several threads, the data is copied while holding the lock.
+        std::lock_guard<std::mutex> lock(mutex);
+        entry.offset = data_end;
+        entry.size = size;
+        data_end += size;
+        file.seekp(entry.offset);
+        static thread_local Vector<char> buffer(archive_buffer_size);
+        for (uint64_t remaining = size; remaining > 0;) {
+            source.read(buffer.data(), std::min<uint64_t>(remaining, buffer.size()));
+            if (source.gcount() <= 0) {
+                return std::make_error_code(std::errc::io_error);
+            }
+            file.write(buffer.data(), source.gcount());
+            remaining -= source.gcount();
+        }
+        if (!file.good()) {
+            return std::make_error_code(std::errc::io_error);
+        }
+    }
+#endif // __linux__
+
+    if (compressed < 0) {
+        return std::make_error_code(std::errc::io_error);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entry.name = names.size();
+    names.append(p_name, p_length);
+    entries.push_back(entry);
+    p_size = size;
+    p_stored_size = entry.size;
+    return std::error_code();
+}
+
+Error ArchiveWriter::close() {
+    if (!is_open()) {
+        return Error::Unconfigured;
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [this](const Archive::Entry& p_a, const Archive::Entry& p_b) {
+        if (p_a.hash != p_b.hash) {
+            return p_a.hash < p_b.hash;
+        }
+        return names.compare(p_a.name, p_a.name_length, names, p_b.name, p_b.name_length) < 0;
+    });
+
+    // The sort is stable, so the first of the entries sharing a name is the one added first.
+    auto last = std::unique(entries.begin(), entries.end(), [this](const Archive::Entry& p_a, const Archive::Entry& p_b) {
+        return p_a.hash == p_b.hash && names.compare(p_a.name, p_a.name_length, names, p_b.name, p_b.name_length) == 0;
+    });
+    entries.erase(last, entries.end());
+
+    Archive::Trailer trailer;
+    trailer.names_offset = data_end;
+    trailer.names_size = names.size();
+    trailer.index_offset = align_offset(data_end + names.size());
+    trailer.entry_count = entries.size();
+    trailer.buckets_offset = trailer.index_offset + entries.size() * sizeof(Archive::Entry);
+    trailer.bucket_bits = Archive::get_bucket_bits(entries.size());
+    trailer.reserved = 0;
+    std::memcpy(trailer.magic, Archive::magic, sizeof(trailer.magic));
+
+    // The entries are sorted by hash, so the first entry of each bucket is found in a single pass.
+    Vector<uint64_t> buckets((1ull << trailer.bucket_bits) + 1);
+    size_t entry = 0;
+    for (uint64_t bucket = 0; bucket < buckets.size(); ++bucket) {
+        while (entry < entries.size() && Archive::get_bucket(entries[entry].hash, trailer.bucket_bits) < bucket) {
+            ++entry;
+        }
+        buckets[bucket] = entry;
+    }
+    buckets.back() = entries.size();
+
+    static const char padding[8] = {};
+    uint64_t trailer_offset = trailer.buckets_offset + buckets.size() * sizeof(uint64_t);
+    bool written = _write(names.data(), names.size(), trailer.names_offset) &&
+        _write(padding, trailer.index_offset - (data_end + names.size()), data_end + names.size()) &&
+        _write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Archive::Entry), trailer.index_offset) &&
+        _write(reinterpret_cast<const char*>(buckets.data()), buckets.size() * sizeof(uint64_t), trailer.buckets_offset) &&
+        _write(reinterpret_cast<const char*>(&trailer), sizeof(trailer), trailer_offset);
+
+#ifdef __linux__
+    written = ::close(fd) == 0 && written;
+    fd = -1;
+#else
+    file.close();
+    written = !file.fail() && written;
+#endif // __linux__
+
+    std::error_code error;
+    if (written) {
+        FileAccess::rename(temporary_path, path, error);
+    }
+    if (!written || error) {
+        FileAccess::remove(temporary_path, error);
+        entries.clear();
+        names.clear();
+        return Error::Failed;
+    }
+
+    entries.clear();
+    names.clear();
+    return Error::OK;
+}
+
+void ArchiveWriter::abort() {
+    if (!is_open()) {
+        return;
+    }
+#ifdef __linux__
+    ::close(fd);
+    fd = -1;
+#else
+    file.close();
+#endif // __linux__
+    std::error_code error;
+    FileAccess::remove(temporary_path, error);
+    entries.clear();
+    names.clear();
+}
+
+bool ArchiveWriter::is_open() const {
+#ifdef __linux__
+    return fd >= 0;
+#else
+    return file.is_open();
+#endif // __linux__
+}
+
+size_t ArchiveWriter::get_entry_count() const {
+    return entries.size();
+}
+
+ArchiveWriter::ArchiveWriter() :
+#ifdef __linux__
+    fd(-1),
+#endif // __linux__
+    codec(nullptr),
+    block_size(1 << 20),
+    data_end(0) {
+}
+
+ArchiveWriter::~ArchiveWriter() {
+    abort();
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,123 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "archive.h"
+#include "codec.h"
+#include "error.h"
+#include "file_copy.h"
+
+#include <mutex>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class ArchiveWriter
+ * @brief Writes a packed archive, see `Archive` for its layout.
+ *
+ * The archive is written to a temporary file next to its path and renamed into place once its index is written,
+ * so an archive that exists is always complete. Files can be added from several threads at once: each file
+ * reserves the next region of the data in the order it is added, so the archive is laid out front to back, and
+ * on Linux the data is then copied into its region with copy_file_range outside of the lock. When the same name
+ * is added twice, the first file added keeps the name.
+ *
+ * When a codec is set, files can be added compressed: the file is split into blocks that are compressed on the
+ * thread pool of the calling thread (see `ThreadPool::parallel_for`), then the compressed data is written into
+ * its region. The blocks are compressed and written a window at a time, two blocks per thread of the pool, so a
+ * large file never holds more than a window in memory. A file that does not shrink is stored as is.
+ */
+class ArchiveWriter {
+    String path; ///< The path of the archive.
+    String temporary_path; ///< The path the archive is written to until it is complete.
+#ifdef __linux__
+    int fd; ///< The open temporary file, or -1.
+#else
+    FileStreamO file; ///< The open temporary file.
+#endif // __linux__
+    const Codec* codec; ///< The codec compressing the files added compressed, or `nullptr`.
+    uint32_t block_size; ///< The number of bytes of a file compressed in each block.
+    uint64_t data_end; ///< The end of the data reserved so far.
+    Vector<Archive::Entry> entries; ///< The entries, in the order they were added.
+    String names; ///< The buffer holding every entry name.
+    std::mutex mutex; ///< Guards the reserved data, the entries and the names.
+
+    /**
+     * @brief Write a buffer at an offset of the temporary file.
+     * @param p_data The buffer.
+     * @param p_size The size of the buffer.
+     * @param p_offset The offset to write at.
+     * @return `true` if the buffer was written, `false` otherwise.
+     */
+    bool _write(const char* p_data, size_t p_size, uint64_t p_offset);
+
+    /**
+     * @brief Compress a file in blocks and write it into the next region of the data, see `Archive` for the layout.
+     * @param p_data The contents of the file.
+     * @param p_size The size of the file.
+     * @param p_entry Receives the offset, the stored size and the codec of the data.
+     * @return 1 if the file was written, compressed or stored as is when its blocks do not shrink, 0 if it cannot be split into blocks and must be stored as is, -1 if it could not be written.
+     */
+    int _add_compressed(const char* p_data, uint64_t p_size, Archive::Entry& p_entry);
+
+public:
+    /**
+     * @brief Start writing an archive, replacing any archive with the same path once it is complete.
+     * @param p_path The path of the archive, its directory must exist.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error open(const String& p_path);
+
+    /**
+     * @brief Set the codec used for the files added compressed.
+     * @param p_codec The codec type, `Codec::Type::None` or a codec that was not built stores every file as is.
+     * @param p_block_size The number of bytes of a file compressed in each block.
+     */
+    void set_codec(Codec::Type p_codec, uint32_t p_block_size);
+
+    /**
+     * @brief Add a file to the archive, this function is thread-safe.
+     * @param p_name The characters of the entry name.
+     * @param p_length The number of characters.
+     * @param p_source The location of the source file.
+     * @param p_compress `true` to compress the file with the codec, `false` to store it as is.
+     * @param p_size Receives the size of the file.
+     * @param p_stored_size Receives the number of bytes stored, less than the size of the file when it was compressed.
+     * @return The error that prevented adding the file, or an empty error code.
+     */
+    std::error_code add(const char* p_name, size_t p_length, const FileCopy::Location& p_source, bool p_compress, uint64_t& p_size, uint64_t& p_stored_size);
+
+    /**
+     * @brief Write the name buffer, the index and the trailer, then move the archive to its path.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error close();
+
+    /**
+     * @brief Stop writing the archive and remove the temporary file, any archive already at the path is kept.
+     */
+    void abort();
+
+    /**
+     * @brief Check if an archive is being written.
+     * @return `true` if an archive is open, `false` otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Get the number of files added so far.
+     * @return The number of files.
+     */
+    size_t get_entry_count() const;
+
+    /**
+     * @brief Constructor for the ArchiveWriter class.
+     */
+    ArchiveWriter();
+
+    /**
+     * @brief Destructor for the ArchiveWriter class, an archive that was not closed is aborted.
+     */
+    ~ArchiveWriter();
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,106 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class BoundedQueue
+ * @brief A thread-safe first-in first-out queue with a fixed capacity.
+ *
+ * Producers block while the queue is full and consumers block while it is empty. Once the queue is
+ * closed, producers are rejected and consumers drain the remaining items before being released.
+ *
+ * @tparam T The type of items stored in the queue.
+ */
+template <class T>
+class BoundedQueue {
+    std::mutex mutex; ///< Guards the queue state.
+    std::condition_variable not_empty; ///< Signalled when an item is pushed or the queue is closed.
+    std::condition_variable not_full; ///< Signalled when an item is popped or the queue is closed.
+    std::deque<T> items; ///< The queued items.
+    size_t capacity; ///< The maximum number of queued items.
+    bool closed; ///< Flag indicating no more items will be pushed.
+
+public:
+    /**
+     * @brief Push an item, blocking while the queue is full.
+     * @param p_item The item to push.
+     * @return `true` if the item was queued, `false` if the queue has been closed.
+     */
+    bool push(T p_item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(p_item));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Pop an item, blocking while the queue is empty and open.
+     * @param p_item The item that was popped.
+     * @return `true` if an item was popped, `false` if the queue is closed and empty.
+     */
+    bool pop(T& p_item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) {
+            return false;
+        }
+        p_item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Pop an item without blocking.
+     * @param p_item The item that was popped.
+     * @return `true` if an item was popped, `false` if the queue is empty.
+     */
+    bool try_pop(T& p_item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.empty()) {
+            return false;
+        }
+        p_item = std::move(items.front());
+        items.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Close the queue, releasing all blocked producers and consumers.
+     */
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    /**
+     * @brief Constructor for the BoundedQueue class.
+     * @param p_capacity The maximum number of queued items, at least 1.
+     */
+    BoundedQueue(size_t p_capacity) :
+        capacity(p_capacity > 0 ? p_capacity : 1),
+        closed(false) {
+    }
+};
+
+PACKER_NAMESPACE_END
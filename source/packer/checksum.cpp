@@ -0,0 +1,317 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "checksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define CHECKSUM_SSE2_ENABLED
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define CHECKSUM_AVX2_ENABLED
+#define CHECKSUM_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define CHECKSUM_AVX2_ENABLED
+#define CHECKSUM_AVX2_TARGET
+#include <immintrin.h>
+#endif
+#endif
+
+PACKER_NAMESPACE_BEGIN
+
+static const char* kernel_names[] = {
+    "scalar",
+    "sse2",
+    "avx2"
+};
+
+/**
+ * @brief The size of the secret the stripe keys are taken from.
+ */
+static constexpr size_t secret_size = 192;
+
+/**
+ * @brief The number of stripes between two scrambles, each stripe moves its keys 8 bytes along the secret.
+ */
+static constexpr size_t stripes_per_block = (secret_size - Checksum::STRIPE_SIZE) / 8;
+
+static constexpr uint64_t prime32_1 = 0x9E3779B1u;
+static constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ull;
+
+/**
+ * @brief Returns the secret, generated once from a fixed seed with splitmix64.
+ */
+static const unsigned char* get_secret() {
+    static const struct Secret {
+        uint64_t words[secret_size / 8];
+
+        Secret() {
+            uint64_t state = 0x243F6A8885A308D3ull;
+            for (uint64_t& word : words) {
+                uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                word = z ^ (z >> 31);
+            }
+        }
+    } secret;
+    return reinterpret_cast<const unsigned char*>(secret.words);
+}
+
+static uint64_t read64(const unsigned char* p_data) {
+    uint64_t value;
+    std::memcpy(&value, p_data, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Multiplies two 64-bit values and folds the 128-bit product into 64 bits.
+ */
+static uint64_t multiply_fold(uint64_t p_a, uint64_t p_b) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 product = static_cast<unsigned __int128>(p_a) * p_b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t a_low = p_a & 0xFFFFFFFF, a_high = p_a >> 32;
+    uint64_t b_low = p_b & 0xFFFFFFFF, b_high = p_b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t high_high = a_high * b_high;
+    uint64_t cross = (low_low >> 32) + (high_low & 0xFFFFFFFF) + low_high;
+    uint64_t upper = (high_low >> 32) + (cross >> 32) + high_high;
+    uint64_t lower = (cross << 32) | (low_low & 0xFFFFFFFF);
+    return lower ^ upper;
+#endif
+}
+
+static void accumulate_scalar(uint64_t* p_accumulators, const unsigned char* p_data, size_t p_count, const unsigned char* p_secret) {
+    for (size_t s = 0; s < p_count; ++s) {
+        const unsigned char* data = p_data + s * Checksum::STRIPE_SIZE;
+        const unsigned char* secret = p_secret + s * 8;
+        for (size_t i = 0; i < 8; ++i) {
+            uint64_t value = read64(data + i * 8);
+            uint64_t key = value ^ read64(secret + i * 8);
+            p_accumulators[i ^ 1] += value;
+            p_accumulators[i] += (key & 0xFFFFFFFF) * (key >> 32);
+        }
+    }
+}
+
+#ifdef CHECKSUM_SSE2_ENABLED
+static void accumulate_sse2(uint64_t* p_accumulators, const unsigned char* p_data, size_t p_count, const unsigned char* p_secret) {
+    __m128i accumulators[4];
+    for (size_t i = 0; i < 4; ++i) {
+        accumulators[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_accumulators) + i);
+    }
+    for (size_t s = 0; s < p_count; ++s) {
+        const __m128i* data = reinterpret_cast<const __m128i*>(p_data + s * Checksum::STRIPE_SIZE);
+        const __m128i* secret = reinterpret_cast<const __m128i*>(p_secret + s * 8);
+        for (size_t i = 0; i < 4; ++i) {
+            __m128i value = _mm_loadu_si128(data + i);
+            __m128i key = _mm_xor_si128(value, _mm_loadu_si128(secret + i));
+            __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            accumulators[i] = _mm_add_epi64(accumulators[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p_accumulators) + i, accumulators[i]);
+    }
+}
+#endif // CHECKSUM_SSE2_ENABLED
+
+#ifdef CHECKSUM_AVX2_ENABLED
+CHECKSUM_AVX2_TARGET static void accumulate_avx2(uint64_t* p_accumulators, const unsigned char* p_data, size_t p_count, const unsigned char* p_secret) {
+    __m256i accumulators[2];
+    for (size_t i = 0; i < 2; ++i) {
+        accumulators[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_accumulators) + i);
+    }
+    for (size_t s = 0; s < p_count; ++s) {
+        const __m256i* data = reinterpret_cast<const __m256i*>(p_data + s * Checksum::STRIPE_SIZE);
+        const __m256i* secret = reinterpret_cast<const __m256i*>(p_secret + s * 8);
+        for (size_t i = 0; i < 2; ++i) {
+            __m256i value = _mm256_loadu_si256(data + i);
+            __m256i key = _mm256_xor_si256(value, _mm256_loadu_si256(secret + i));
+            __m256i product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            accumulators[i] = _mm256_add_epi64(accumulators[i], _mm256_add_epi64(product, swapped));
+        }
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_accumulators) + i, accumulators[i]);
+    }
+}
+#endif // CHECKSUM_AVX2_ENABLED
+
+static void accumulate(Checksum::Kernel p_kernel, uint64_t* p_accumulators, const unsigned char* p_data, size_t p_count, const unsigned char* p_secret) {
+    switch (p_kernel) {
+#ifdef CHECKSUM_AVX2_ENABLED
+    case Checksum::Kernel::AVX2:
+        accumulate_avx2(p_accumulators, p_data, p_count, p_secret);
+        break;
+#endif // CHECKSUM_AVX2_ENABLED
+#ifdef CHECKSUM_SSE2_ENABLED
+    case Checksum::Kernel::SSE2:
+        accumulate_sse2(p_accumulators, p_data, p_count, p_secret);
+        break;
+#endif // CHECKSUM_SSE2_ENABLED
+    default:
+        accumulate_scalar(p_accumulators, p_data, p_count, p_secret);
+        break;
+    }
+}
+
+static void scramble(uint64_t* p_accumulators, const unsigned char* p_secret) {
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t accumulator = p_accumulators[i];
+        accumulator ^= accumulator >> 47;
+        accumulator ^= read64(p_secret + i * 8);
+        p_accumulators[i] = accumulator * prime32_1;
+    }
+}
+
+void Checksum::_consume(const unsigned char* p_data, size_t p_count) {
+    const unsigned char* secret = get_secret();
+    while (p_count > 0) {
+        size_t count = std::min(p_count, stripes_per_block - stripe);
+        accumulate(kernel, accumulators, p_data, count, secret + stripe * 8);
+        stripe += count;
+        p_data += count * STRIPE_SIZE;
+        p_count -= count;
+        if (stripe == stripes_per_block) {
+            scramble(accumulators, secret + secret_size - STRIPE_SIZE);
+            stripe = 0;
+        }
+    }
+}
+
+String Checksum::get_kernel_name(Kernel p_kernel) {
+    if (p_kernel >= static_cast<Kernel>(0) && p_kernel < Kernel::Max) {
+        return kernel_names[static_cast<size_t>(p_kernel)];
+    } else {
+        return "unknown";
+    }
+}
+
+Checksum::Kernel Checksum::find_kernel(const String& p_kernel) {
+    for (size_t i = 0; i < static_cast<size_t>(Kernel::Max); ++i) {
+        if (p_kernel == kernel_names[i]) {
+            return static_cast<Kernel>(i);
+        }
+    }
+    return Kernel::Unknown;
+}
+
+bool Checksum::is_kernel_supported(Kernel p_kernel) {
+    switch (p_kernel) {
+    case Kernel::Scalar:
+        return true;
+#ifdef CHECKSUM_SSE2_ENABLED
+    case Kernel::SSE2:
+        return true;
+#endif // CHECKSUM_SSE2_ENABLED
+#ifdef CHECKSUM_AVX2_ENABLED
+    case Kernel::AVX2:
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return true;
+#endif
+#endif // CHECKSUM_AVX2_ENABLED
+    default:
+        return false;
+    }
+}
+
+Checksum::Kernel Checksum::get_best_kernel() {
+    static const Kernel best = []() {
+        for (int i = static_cast<int>(Kernel::Max) - 1; i > 0; --i) {
+            if (is_kernel_supported(static_cast<Kernel>(i))) {
+                return static_cast<Kernel>(i);
+            }
+        }
+        return Kernel::Scalar;
+    }();
+    return best;
+}
+
+uint64_t Checksum::compute(const void* p_data, size_t p_size) {
+    Checksum checksum;
+    checksum.update(p_data, p_size);
+    return checksum.digest();
+}
+
+void Checksum::update(const void* p_data, size_t p_size) {
+    if (p_size == 0) {
+        return;
+    }
+
+    const unsigned char* data = static_cast<const unsigned char*>(p_data);
+    length += p_size;
+
+    if (buffered > 0) {
+        size_t count = std::min(p_size, STRIPE_SIZE - buffered);
+        std::memcpy(buffer + buffered, data, count);
+        buffered += count;
+        data += count;
+        p_size -= count;
+        if (buffered < STRIPE_SIZE) {
+            return;
+        }
+        _consume(buffer, 1);
+        buffered = 0;
+    }
+
+    size_t stripes = p_size / STRIPE_SIZE;
+    _consume(data, stripes);
+    data += stripes * STRIPE_SIZE;
+    p_size -= stripes * STRIPE_SIZE;
+
+    std::memcpy(buffer, data, p_size);
+    buffered = p_size;
+}
+
+uint64_t Checksum::digest() const {
+    const unsigned char* secret = get_secret();
+
+    uint64_t result[8];
+    std::memcpy(result, accumulators, sizeof(result));
+    if (buffered > 0) {
+        unsigned char last[STRIPE_SIZE] = {};
+        std::memcpy(last, buffer, buffered);
+        accumulate(kernel, result, last, 1, secret + stripe * 8);
+    }
+
+    uint64_t hash = length * prime64_1;
+    for (size_t i = 0; i < 4; ++i) {
+        hash += multiply_fold(result[i * 2] ^ read64(secret + 11 + i * 16), result[i * 2 + 1] ^ read64(secret + 19 + i * 16));
+    }
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+void Checksum::reset() {
+    static const uint64_t initial[8] = {
+        prime32_1, prime64_1, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+        0x85EBCA77C2B2AE63ull, 0x85EBCA77u, 0x27D4EB2F165667C5ull, 0xC2B2AE3Du
+    };
+    std::memcpy(accumulators, initial, sizeof(accumulators));
+    buffered = 0;
+    stripe = 0;
+    length = 0;
+}
+
+Checksum::Kernel Checksum::get_kernel() const {
+    return kernel;
+}
+
+Checksum::Checksum(Kernel p_kernel) :
+    kernel(is_kernel_supported(p_kernel) ? p_kernel : get_best_kernel()) {
+    reset();
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,125 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <cstdint>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class Checksum
+ * @brief A fast streaming 64-bit non-cryptographic checksum, built like xxHash3's long input loop.
+ *
+ * Data is consumed in 64-byte stripes by eight 64-bit accumulators. Each lane adds the product of the low and
+ * high halves of the data mixed with a key to itself and the raw data to its neighbour, the keys slide along a
+ * fixed secret from one stripe to the next, and the accumulators are scrambled after every block of 16 stripes.
+ * The final partial stripe is padded with zeros and the total length is mixed into the digest.
+ *
+ * The stripe loop has SSE2 and AVX2 kernels next to a portable scalar one; every kernel computes the same
+ * digest. AVX2 is selected at run time when the processor supports it. The checksum is meant to detect
+ * corruption, it offers no protection against deliberate collisions.
+ */
+class Checksum {
+public:
+    /**
+     * @enum Kernel
+     * @brief Enumeration defining the implementations of the stripe loop.
+     */
+    enum class Kernel {
+        Unknown = -1, ///< An unknown kernel, selects the fastest supported kernel when constructing.
+        Scalar,       ///< The portable kernel.
+        SSE2,         ///< The SSE2 kernel, processing two lanes per instruction.
+        AVX2,         ///< The AVX2 kernel, processing four lanes per instruction.
+        Max           ///< The maximum value for the Kernel enumeration.
+    };
+
+    /**
+     * @brief The number of bytes consumed by the accumulators at a time.
+     */
+    static constexpr size_t STRIPE_SIZE = 64;
+
+private:
+    uint64_t accumulators[8]; ///< The lane accumulators.
+    unsigned char buffer[STRIPE_SIZE]; ///< The bytes of the current partial stripe.
+    size_t buffered; ///< The number of bytes in the partial stripe.
+    size_t stripe; ///< The index of the next stripe in the current block.
+    uint64_t length; ///< The total number of bytes consumed.
+    Kernel kernel; ///< The kernel running the stripe loop.
+
+    /**
+     * @brief Consume whole stripes, scrambling the accumulators at the end of each block.
+     * @param p_data The stripes.
+     * @param p_count The number of stripes.
+     */
+    void _consume(const unsigned char* p_data, size_t p_count);
+
+public:
+    /**
+     * @brief Get a string representation of a Kernel enum value.
+     * @param p_kernel The Kernel enum value.
+     * @return A string representation of the Kernel.
+     */
+    static String get_kernel_name(Kernel p_kernel);
+
+    /**
+     * @brief Find a Kernel enum value based on its string representation.
+     * @param p_kernel The string representation of the Kernel.
+     * @return The corresponding Kernel enum value.
+     */
+    static Kernel find_kernel(const String& p_kernel);
+
+    /**
+     * @brief Check if a kernel can run on this processor.
+     * @param p_kernel The kernel to check.
+     * @return `true` if the kernel is supported, `false` otherwise.
+     */
+    static bool is_kernel_supported(Kernel p_kernel);
+
+    /**
+     * @brief Get the fastest kernel supported by this processor.
+     * @return The fastest supported kernel.
+     */
+    static Kernel get_best_kernel();
+
+    /**
+     * @brief Compute the checksum of a block of memory in one call.
+     * @param p_data The data.
+     * @param p_size The size of the data in bytes.
+     * @return The checksum of the data.
+     */
+    static uint64_t compute(const void* p_data, size_t p_size);
+
+    /**
+     * @brief Consume more data.
+     * @param p_data The data.
+     * @param p_size The size of the data in bytes.
+     */
+    void update(const void* p_data, size_t p_size);
+
+    /**
+     * @brief Get the checksum of the data consumed so far, more data can still be consumed afterwards.
+     * @return The checksum.
+     */
+    uint64_t digest() const;
+
+    /**
+     * @brief Forget the data consumed so far.
+     */
+    void reset();
+
+    /**
+     * @brief Get the kernel running the stripe loop.
+     * @return The kernel.
+     */
+    Kernel get_kernel() const;
+
+    /**
+     * @brief Constructor for the Checksum class.
+     * @param p_kernel The kernel to use, unsupported kernels and `Kernel::Unknown` select the fastest supported one.
+     */
+    Checksum(Kernel p_kernel = Kernel::Unknown);
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,315 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "codec.h"
+
+#include <cstring>
+
+#ifdef ZLIB_ENABLED
+#include <zlib.h>
+#endif // ZLIB_ENABLED
+
+#ifdef ZSTD_ENABLED
+#include <zstd.h>
+#endif // ZSTD_ENABLED
+
+PACKER_NAMESPACE_BEGIN
+
+static const char* type_names[] = {
+    "none",
+    "lz",
+    "deflate",
+    "zstd",
+};
+
+/**
+ * @brief The number of bits of the hash table used to find matches.
+ */
+static constexpr int lz_hash_bits = 14;
+
+/**
+ * @brief The shortest match encoded.
+ */
+static constexpr size_t lz_min_match = 4;
+
+/**
+ * @brief The farthest match encoded, offsets are stored in two bytes.
+ */
+static constexpr size_t lz_max_offset = 65535;
+
+/**
+ * @brief The number of bytes at the end of a block that are always encoded as literals.
+ */
+static constexpr size_t lz_end_literals = 5;
+
+static uint32_t read_uint32(const uint8_t* p_data) {
+    uint32_t value;
+    std::memcpy(&value, p_data, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Writes the extension bytes of a literal or match length, returns false if they do not fit.
+ */
+static bool lz_write_length(uint8_t*& p_output, const uint8_t* p_end, size_t p_length) {
+    while (p_length >= 255) {
+        if (p_output == p_end) {
+            return false;
+        }
+        *p_output++ = 255;
+        p_length -= 255;
+    }
+    if (p_output == p_end) {
+        return false;
+    }
+    *p_output++ = static_cast<uint8_t>(p_length);
+    return true;
+}
+
+/**
+ * @brief Reads the extension bytes of a literal or match length, returns false if they run past the input.
+ */
+static bool lz_read_length(const uint8_t* p_input, size_t p_size, size_t& p_position, size_t& p_length) {
+    uint8_t byte;
+    do {
+        if (p_position >= p_size) {
+            return false;
+        }
+        byte = p_input[p_position++];
+        p_length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * @brief Writes a sequence: a token, the literals, then the offset and length of a match unless it is the last.
+ *
+ * The token holds the literal length in its high nibble and the match length minus the shortest match in its
+ * low nibble, a nibble of 15 is followed by extension bytes. The last sequence of a block has no match.
+ */
+static bool lz_write_sequence(uint8_t*& p_output, const uint8_t* p_end, const uint8_t* p_literals, size_t p_literal_length, size_t p_offset, size_t p_match_length) {
+    if (p_output == p_end) {
+        return false;
+    }
+    bool last = p_match_length == 0;
+    size_t match_length = last ? 0 : p_match_length - lz_min_match;
+    *p_output++ = static_cast<uint8_t>((std::min<size_t>(p_literal_length, 15) << 4) | std::min<size_t>(match_length, 15));
+    if (p_literal_length >= 15 && !lz_write_length(p_output, p_end, p_literal_length - 15)) {
+        return false;
+    }
+    if (static_cast<size_t>(p_end - p_output) < p_literal_length) {
+        return false;
+    }
+    std::memcpy(p_output, p_literals, p_literal_length);
+    p_output += p_literal_length;
+    if (last) {
+        return true;
+    }
+
+    if (p_end - p_output < 2) {
+        return false;
+    }
+    *p_output++ = static_cast<uint8_t>(p_offset);
+    *p_output++ = static_cast<uint8_t>(p_offset >> 8);
+    return match_length < 15 || lz_write_length(p_output, p_end, match_length - 15);
+}
+
+/**
+ * @class LZCodec
+ * @brief The built-in codec, a greedy LZ77 with a single-probe hash table in the style of LZ4.
+ */
+class LZCodec : public Codec {
+public:
+    virtual Type get_type() const override {
+        return Type::LZ;
+    }
+
+    virtual size_t compress(const char* p_source, size_t p_size, char* p_destination, size_t p_capacity) const override {
+        // The table holds the position of the last sequence with each hash plus one, 0 marks an empty slot.
+        static thread_local Vector<uint32_t> table(1 << lz_hash_bits);
+        std::fill(table.begin(), table.end(), 0);
+
+        const uint8_t* input = reinterpret_cast<const uint8_t*>(p_source);
+        uint8_t* output = reinterpret_cast<uint8_t*>(p_destination);
+        const uint8_t* end = output + p_capacity;
+        size_t anchor = 0;
+
+        if (p_size > lz_end_literals + lz_min_match) {
+            size_t match_end = p_size - lz_end_literals;
+            size_t position = 0;
+            while (position + lz_min_match <= match_end) {
+                uint32_t sequence = read_uint32(input + position);
+                uint32_t& slot = table[(sequence * 2654435761u) >> (32 - lz_hash_bits)];
+                size_t candidate = slot;
+                slot = static_cast<uint32_t>(position + 1);
+
+                if (candidate == 0 || position - (candidate - 1) > lz_max_offset || read_uint32(input + candidate - 1) != sequence) {
+                    // Skip ahead faster the longer no match is found, incompressible data is passed over quickly.
+                    position += 1 + ((position - anchor) >> 6);
+                    continue;
+                }
+
+                size_t match = candidate - 1;
+                size_t length = lz_min_match;
+                while (position + length < match_end && input[match + length] == input[position + length]) {
+                    ++length;
+                }
+                if (!lz_write_sequence(output, end, input + anchor, position - anchor, position - match, length)) {
+                    return 0;
+                }
+                position += length;
+                anchor = position;
+            }
+        }
+
+        if (!lz_write_sequence(output, end, input + anchor, p_size - anchor, 0, 0)) {
+            return 0;
+        }
+        return output - reinterpret_cast<uint8_t*>(p_destination);
+    }
+
+    virtual bool decompress(const char* p_source, size_t p_size, char* p_destination, size_t p_destination_size) const override {
+        const uint8_t* input = reinterpret_cast<const uint8_t*>(p_source);
+        size_t position = 0;
+        size_t written = 0;
+
+        while (position < p_size) {
+            uint8_t token = input[position++];
+            size_t literal_length = token >> 4;
+            if (literal_length == 15 && !lz_read_length(input, p_size, position, literal_length)) {
+                return false;
+            }
+            if (literal_length > p_size - position || literal_length > p_destination_size - written) {
+                return false;
+            }
+            std::memcpy(p_destination + written, input + position, literal_length);
+            position += literal_length;
+            written += literal_length;
+            if (position == p_size) {
+                return written == p_destination_size;
+            }
+
+            if (p_size - position < 2) {
+                return false;
+            }
+            size_t offset = input[position] | (static_cast<size_t>(input[position + 1]) << 8);
+            position += 2;
+            size_t match_length = token & 15;
+            if (match_length == 15 && !lz_read_length(input, p_size, position, match_length)) {
+                return false;
+            }
+            match_length += lz_min_match;
+            if (offset == 0 || offset > written || match_length > p_destination_size - written) {
+                return false;
+            }
+
+            char* destination = p_destination + written;
+            const char* match = destination - offset;
+            if (offset >= match_length) {
+                std::memcpy(destination, match, match_length);
+            } else {
+                // An overlapping match repeats the bytes it has just written.
+                for (size_t i = 0; i < match_length; ++i) {
+                    destination[i] = match[i];
+                }
+            }
+            written += match_length;
+        }
+        return false;
+    }
+};
+
+#ifdef ZLIB_ENABLED
+/**
+ * @class DeflateCodec
+ * @brief Compresses blocks with zlib at its fastest level.
+ */
+class DeflateCodec : public Codec {
+public:
+    virtual Type get_type() const override {
+        return Type::Deflate;
+    }
+
+    virtual size_t compress(const char* p_source, size_t p_size, char* p_destination, size_t p_capacity) const override {
+        uLongf size = static_cast<uLongf>(p_capacity);
+        if (::compress2(reinterpret_cast<Bytef*>(p_destination), &size, reinterpret_cast<const Bytef*>(p_source), static_cast<uLong>(p_size), Z_BEST_SPEED) != Z_OK) {
+            return 0;
+        }
+        return size;
+    }
+
+    virtual bool decompress(const char* p_source, size_t p_size, char* p_destination, size_t p_destination_size) const override {
+        uLongf size = static_cast<uLongf>(p_destination_size);
+        return ::uncompress(reinterpret_cast<Bytef*>(p_destination), &size, reinterpret_cast<const Bytef*>(p_source), static_cast<uLong>(p_size)) == Z_OK && size == p_destination_size;
+    }
+};
+#endif // ZLIB_ENABLED
+
+#ifdef ZSTD_ENABLED
+/**
+ * @class ZstdCodec
+ * @brief Compresses blocks with libzstd at its fastest standard level.
+ */
+class ZstdCodec : public Codec {
+public:
+    virtual Type get_type() const override {
+        return Type::Zstd;
+    }
+
+    virtual size_t compress(const char* p_source, size_t p_size, char* p_destination, size_t p_capacity) const override {
+        size_t size = ::ZSTD_compress(p_destination, p_capacity, p_source, p_size, 1);
+        return ::ZSTD_isError(size) ? 0 : size;
+    }
+
+    virtual bool decompress(const char* p_source, size_t p_size, char* p_destination, size_t p_destination_size) const override {
+        size_t size = ::ZSTD_decompress(p_destination, p_destination_size, p_source, p_size);
+        return !::ZSTD_isError(size) && size == p_destination_size;
+    }
+};
+#endif // ZSTD_ENABLED
+
+String Codec::get_type_name(Type p_type) {
+    if (p_type >= static_cast<Type>(0) && p_type < Type::Max) {
+        return type_names[static_cast<size_t>(p_type)];
+    } else {
+        return "unknown";
+    }
+}
+
+Codec::Type Codec::find_type(const String& p_type) {
+    for (size_t i = 0; i < static_cast<size_t>(Type::Max); ++i) {
+        if (p_type == type_names[i]) {
+            return static_cast<Type>(i);
+        }
+    }
+    return Type::Unknown;
+}
+
+const Codec* Codec::get_codec(Type p_type) {
+    static const LZCodec lz_codec;
+#ifdef ZLIB_ENABLED
+    static const DeflateCodec deflate_codec;
+#endif // ZLIB_ENABLED
+#ifdef ZSTD_ENABLED
+    static const ZstdCodec zstd_codec;
+#endif // ZSTD_ENABLED
+
+    switch (p_type) {
+    case Type::LZ:
+        return &lz_codec;
+#ifdef ZLIB_ENABLED
+    case Type::Deflate:
+        return &deflate_codec;
+#endif // ZLIB_ENABLED
+#ifdef ZSTD_ENABLED
+    case Type::Zstd:
+        return &zstd_codec;
+#endif // ZSTD_ENABLED
+    default:
+        return nullptr;
+    }
+}
+
+Codec::~Codec() {
+}
+
+PACKER_NAMESPACE_END
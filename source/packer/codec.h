@@ -0,0 +1,89 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <cstdint>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class Codec
+ * @brief A block compression codec.
+ *
+ * Codecs compress independent blocks, so the blocks of a file can be compressed on several threads and a single
+ * block can be decompressed without the blocks before it. The LZ codec is built in. The deflate codec is built
+ * when zlib is found at build time (`ZLIB_ENABLED`), and the zstd codec when libzstd is found (`ZSTD_ENABLED`).
+ *
+ * The codec type is stored in archives, so the value of each type must never change.
+ */
+class Codec {
+public:
+    /**
+     * @enum Type
+     * @brief Enumeration defining the available codecs.
+     */
+    enum class Type {
+        Unknown = -1, ///< An unknown codec.
+        None,         ///< The data is stored as is.
+        LZ,           ///< The built-in byte-oriented LZ77 codec, fast with a modest ratio.
+        Deflate,      ///< Deflate with zlib, slower with a better ratio.
+        Zstd,         ///< Zstandard with libzstd, fast with a good ratio.
+        Max           ///< The maximum value for the Type enumeration.
+    };
+
+    /**
+     * @brief Get a string representation of a Type enum value.
+     * @param p_type The Type enum value.
+     * @return A string representation of the Type.
+     */
+    static String get_type_name(Type p_type);
+
+    /**
+     * @brief Find a Type enum value based on its string representation.
+     * @param p_type The string representation of the Type.
+     * @return The corresponding Type enum value.
+     */
+    static Type find_type(const String& p_type);
+
+    /**
+     * @brief Get the codec of a type.
+     * @param p_type The codec type.
+     * @return The codec, or `nullptr` for `Type::None` and for codecs that were not built.
+     */
+    static const Codec* get_codec(Type p_type);
+
+    /**
+     * @brief Get the type of the codec.
+     * @return The codec type.
+     */
+    virtual Type get_type() const = 0;
+
+    /**
+     * @brief Compress a block, this function is thread-safe.
+     * @param p_source The block.
+     * @param p_size The size of the block.
+     * @param p_destination Receives the compressed block.
+     * @param p_capacity The capacity of the destination.
+     * @return The size of the compressed block, or 0 if it does not fit the destination.
+     */
+    virtual size_t compress(const char* p_source, size_t p_size, char* p_destination, size_t p_capacity) const = 0;
+
+    /**
+     * @brief Decompress a block, this function is thread-safe.
+     * @param p_source The compressed block.
+     * @param p_size The size of the compressed block.
+     * @param p_destination Receives the block.
+     * @param p_destination_size The size of the block.
+     * @return `true` if the block was decompressed to exactly its size, `false` if the data is corrupt.
+     */
+    virtual bool decompress(const char* p_source, size_t p_size, char* p_destination, size_t p_destination_size) const = 0;
+
+    /**
+     * @brief Destructor for the Codec class.
+     */
+    virtual ~Codec();
+};
+
+PACKER_NAMESPACE_END
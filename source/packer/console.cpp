@@ -64,7 +64,7 @@ static bool set_console_text_color(Console::Color p_color) {
         return false;
     }
 #elif defined(__unix__) || defined(__APPLE__)
-    std::cout << "\x1B[" << text_colors[p_color] << "m";
+    std::cout << "\x1B[" << text_colors[static_cast<int>(p_color)] << "m";
 #endif // (__unix__) || defined(__APPLE__)
     return true;
 }
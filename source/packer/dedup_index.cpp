@@ -0,0 +1,154 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "dedup_index.h"
+#include "checksum.h"
+
+#include <cstring>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @brief The size of the buffer files are read through.
+ */
+static constexpr size_t hash_buffer_size = 1 << 16;
+
+bool DedupIndex::_hash_file(const String& p_path, uint64_t p_limit, uint64_t& p_checksum) {
+    FileStreamI file(p_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    Vector<char> buffer(hash_buffer_size);
+    Checksum checksum;
+    while (p_limit > 0 && file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(std::min<uint64_t>(p_limit, buffer.size())));
+        size_t count = static_cast<size_t>(file.gcount());
+        checksum.update(buffer.data(), count);
+        p_limit -= count;
+    }
+    if (file.bad()) {
+        return false;
+    }
+    p_checksum = checksum.digest();
+    return true;
+}
+
+bool DedupIndex::compare_files(const String& p_path, const String& p_other, uint64_t p_size) {
+    FileStreamI file(p_path, std::ios::binary);
+    FileStreamI other(p_other, std::ios::binary);
+    if (!file.is_open() || !other.is_open()) {
+        return false;
+    }
+    Vector<char> buffer(hash_buffer_size);
+    Vector<char> other_buffer(hash_buffer_size);
+    while (p_size > 0) {
+        std::streamsize count = static_cast<std::streamsize>(std::min<uint64_t>(p_size, buffer.size()));
+        file.read(buffer.data(), count);
+        other.read(other_buffer.data(), count);
+        if (file.gcount() != count || other.gcount() != count || std::memcmp(buffer.data(), other_buffer.data(), static_cast<size_t>(count)) != 0) {
+            return false;
+        }
+        p_size -= static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+void DedupIndex::_store(uint64_t p_size, size_t p_index, const Entry& p_entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = sizes[p_size][p_index];
+    if (p_entry.sample_valid) {
+        entry.sample = p_entry.sample;
+        entry.sample_valid = true;
+    }
+    if (p_entry.checksum_valid) {
+        entry.checksum = p_entry.checksum;
+        entry.checksum_valid = true;
+    }
+}
+
+bool DedupIndex::find(const String& p_path, uint64_t p_size, String& p_target) {
+    if (p_size == 0) {
+        return false;
+    }
+
+    // Entries are only ever appended during a pack, so the copy keeps the index of each entry.
+    Vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = sizes.find(p_size);
+        if (it == sizes.end()) {
+            return false;
+        }
+        entries = it->second;
+    }
+
+    uint64_t sample;
+    if (!_hash_file(p_path, SAMPLE_SIZE, sample)) {
+        return false;
+    }
+
+    // The sample of a small file is already the checksum of the whole file.
+    bool whole = p_size <= SAMPLE_SIZE;
+    uint64_t checksum = sample;
+    bool checksum_valid = whole;
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        Entry& entry = entries[i];
+        if (!entry.sample_valid) {
+            entry.sample_valid = _hash_file(entry.path, SAMPLE_SIZE, entry.sample);
+            if (!entry.sample_valid) {
+                continue;
+            }
+            if (whole) {
+                entry.checksum = entry.sample;
+                entry.checksum_valid = true;
+            }
+            _store(p_size, i, entry);
+        }
+        if (entry.sample != sample) {
+            continue;
+        }
+
+        if (!checksum_valid) {
+            checksum_valid = _hash_file(p_path, p_size, checksum);
+            if (!checksum_valid) {
+                return false;
+            }
+        }
+        if (!entry.checksum_valid) {
+            entry.checksum_valid = _hash_file(entry.path, p_size, entry.checksum);
+            if (!entry.checksum_valid) {
+                continue;
+            }
+            _store(p_size, i, entry);
+        }
+        if (entry.checksum == checksum && compare_files(p_path, entry.path, p_size)) {
+            p_target = entry.path;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DedupIndex::add(const String& p_path, uint64_t p_size) {
+    if (p_size == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    sizes[p_size].emplace_back(p_path);
+}
+
+void DedupIndex::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    sizes.clear();
+}
+
+DedupIndex::Entry::Entry(const String& p_path) :
+    path(p_path),
+    sample(0),
+    checksum(0),
+    sample_valid(false),
+    checksum_valid(false) {
+}
+
+PACKER_NAMESPACE_END
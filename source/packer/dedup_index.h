@@ -0,0 +1,103 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class DedupIndex
+ * @brief An index of the files written by a pack, used to find files whose content was already written.
+ *
+ * Files are grouped by size. A file is only read when another file of the same size was written: first the
+ * checksum of its first `SAMPLE_SIZE` bytes is compared, then the checksum of the whole file. The checksums of
+ * indexed files are computed the first time they are needed and kept for the rest of the pack. `Checksum` is
+ * not meant to resist deliberately crafted collisions, so a file whose checksums match is only reported once
+ * both files compare equal byte for byte.
+ *
+ * Files are hashed without holding the index lock, so several threads can look up and add files at once.
+ */
+class DedupIndex {
+public:
+    /**
+     * @brief The number of bytes at the start of a file that are compared before the whole file.
+     */
+    static constexpr size_t SAMPLE_SIZE = 4096;
+
+private:
+    /**
+     * @struct Entry
+     * @brief A file in the index.
+     */
+    struct Entry {
+        String path; ///< The path of the file.
+        uint64_t sample; ///< The checksum of the start of the file.
+        uint64_t checksum; ///< The checksum of the whole file.
+        bool sample_valid; ///< Flag indicating whether the sample checksum was computed.
+        bool checksum_valid; ///< Flag indicating whether the whole file checksum was computed.
+
+        /**
+         * @brief Constructor for the Entry struct.
+         * @param p_path The path of the file.
+         */
+        Entry(const String& p_path = String());
+    };
+
+    std::unordered_map<uint64_t, Vector<Entry>> sizes; ///< The indexed files, grouped by size.
+    std::mutex mutex; ///< Mutex protecting the index.
+
+    /**
+     * @brief Computes the checksum of the start of a file.
+     * @param p_path The path of the file.
+     * @param p_limit The largest number of bytes to read.
+     * @param p_checksum Receives the checksum.
+     * @return `true` if the file was read, `false` otherwise.
+     */
+    static bool _hash_file(const String& p_path, uint64_t p_limit, uint64_t& p_checksum);
+
+    /**
+     * @brief Stores the checksums computed for an indexed file.
+     * @param p_size The size of the file.
+     * @param p_index The index of the file among the files of its size.
+     * @param p_entry The entry holding the checksums.
+     */
+    void _store(uint64_t p_size, size_t p_index, const Entry& p_entry);
+
+public:
+    /**
+     * @brief Find an indexed file with the same content as a file.
+     * @param p_path The path of the file.
+     * @param p_size The size of the file.
+     * @param p_target Receives the path of the indexed file.
+     * @return `true` if an indexed file has the same content, `false` otherwise.
+     */
+    bool find(const String& p_path, uint64_t p_size, String& p_target);
+
+    /**
+     * @brief Compares the content of two files of the same size byte for byte.
+     * @param p_path The path of the first file.
+     * @param p_other The path of the second file.
+     * @param p_size The size of both files.
+     * @return `true` if both files were read and are identical, `false` otherwise.
+     */
+    static bool compare_files(const String& p_path, const String& p_other, uint64_t p_size);
+
+    /**
+     * @brief Add a file to the index, empty files are never added.
+     * @param p_path The path of the file.
+     * @param p_size The size of the file.
+     */
+    void add(const String& p_path, uint64_t p_size);
+
+    /**
+     * @brief Remove every file from the index.
+     */
+    void clear();
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,267 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "directory_watcher.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif // __linux__
+
+PACKER_NAMESPACE_BEGIN
+
+#ifdef __linux__
+/**
+ * @brief The events watched on every directory.
+ *
+ * Files are reported once they are closed after writing or moved in, not on every write, so a file being
+ * exported is packed once it is complete.
+ */
+static constexpr uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR;
+
+/**
+ * @brief The size of the buffer inotify events are read into.
+ */
+static constexpr size_t watch_buffer_size = 1 << 16;
+
+/**
+ * @brief Joins a relative directory path and an entry name.
+ */
+static String join_path(const String& p_directory, const char* p_name) {
+    return p_directory.empty() ? String(p_name) : p_directory + "/" + p_name;
+}
+
+bool DirectoryWatcher::_add_tree(const String& p_path) {
+    String path = p_path.empty() ? root : root + "/" + p_path;
+    int descriptor = ::inotify_add_watch(fd, path.c_str(), watch_mask);
+    if (descriptor < 0) {
+        // A directory removed before it could be watched has nothing left to report.
+        return errno == ENOENT || errno == ENOTDIR;
+    }
+    paths[descriptor] = p_path;
+    watches[p_path] = descriptor;
+
+    std::error_code error;
+    if (!ignore_file_name.empty() && FileAccess::exists(path + "/" + ignore_file_name, error)) {
+        ignored.insert(p_path);
+        return true;
+    }
+
+    // Entries removed while the directory is listed are skipped, their events say what became of them.
+    bool added = true;
+    for (FileAccess::directory_iterator entry(path, error), end; !error && entry != end; entry.increment(error)) {
+        if (entry->is_directory(error)) {
+            added = _add_tree(join_path(p_path, entry->path().filename().string().c_str())) && added;
+        }
+    }
+    return added;
+}
+
+void DirectoryWatcher::_remove_tree(const String& p_path, bool p_self) {
+    auto remove = [this](Map<String, int>::iterator p_watch) {
+        ::inotify_rm_watch(fd, p_watch->second);
+        paths.erase(p_watch->second);
+        ignored.erase(p_watch->first);
+        return watches.erase(p_watch);
+    };
+
+    if (p_self) {
+        auto watch = watches.find(p_path);
+        if (watch != watches.end()) {
+            remove(watch);
+        }
+    }
+
+    // The directories below the path are contiguous in the map, they all start with the path and a separator.
+    String prefix = p_path.empty() ? String() : p_path + "/";
+    auto watch = watches.lower_bound(prefix);
+    while (watch != watches.end() && watch->first.compare(0, prefix.size(), prefix) == 0) {
+        if (watch->first.empty()) {
+            ++watch;
+            continue;
+        }
+        watch = remove(watch);
+    }
+}
+
+void DirectoryWatcher::_handle_event(int p_descriptor, uint32_t p_mask, const char* p_name, Vector<Change>& p_changes) {
+    if (p_mask & IN_Q_OVERFLOW) {
+        p_changes.push_back({ ChangeType::Overflow, String() });
+        return;
+    }
+
+    auto directory = paths.find(p_descriptor);
+    if (directory == paths.end()) {
+        return;
+    }
+    if (p_mask & IN_IGNORED) {
+        // The kernel removed the watch, the directory was deleted or moved out of the filesystem.
+        watches.erase(directory->second);
+        ignored.erase(directory->second);
+        paths.erase(directory);
+        return;
+    }
+    if (p_name[0] == '\0') {
+        return;
+    }
+
+    const String directory_path = directory->second;
+    String path = join_path(directory_path, p_name);
+    bool is_ignored = ignored.count(directory_path) != 0;
+
+    if (!(p_mask & IN_ISDIR) && !ignore_file_name.empty() && ignore_file_name == p_name) {
+        if ((p_mask & (IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE)) && !is_ignored) {
+            _remove_tree(directory_path, false);
+            ignored.insert(directory_path);
+        } else if ((p_mask & (IN_DELETE | IN_MOVED_FROM)) && is_ignored) {
+            // The directory is still watched, watching it again adds the directories below it.
+            ignored.erase(directory_path);
+            complete = _add_tree(directory_path) && complete;
+            p_changes.push_back({ ChangeType::Directory, directory_path });
+        }
+        return;
+    }
+    if (is_ignored) {
+        return;
+    }
+
+    if (p_mask & IN_ISDIR) {
+        if (p_mask & (IN_CREATE | IN_MOVED_TO)) {
+            // Entries may have been added before the watch, so the whole new subtree is reported.
+            complete = _add_tree(path) && complete;
+            p_changes.push_back({ ChangeType::Directory, path });
+        } else if (p_mask & (IN_DELETE | IN_MOVED_FROM)) {
+            _remove_tree(path, true);
+        }
+    } else if (p_mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+        p_changes.push_back({ ChangeType::File, path });
+    }
+}
+#endif // __linux__
+
+Error DirectoryWatcher::open(const String& p_root, const String& p_ignore_file_name) {
+    close();
+
+#ifdef __linux__
+    fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        return Error::Failed;
+    }
+    root = p_root;
+    ignore_file_name = p_ignore_file_name;
+    complete = _add_tree(String());
+    if (!complete || watches.empty()) {
+        close();
+        return Error::Failed;
+    }
+    return Error::OK;
+#else
+    return Error::Unsupported;
+#endif // __linux__
+}
+
+void DirectoryWatcher::close() {
+#ifdef __linux__
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    paths.clear();
+    watches.clear();
+    ignored.clear();
+#endif // __linux__
+    root.clear();
+    ignore_file_name.clear();
+    complete = true;
+}
+
+bool DirectoryWatcher::is_open() const {
+#ifdef __linux__
+    return fd >= 0;
+#else
+    return false;
+#endif // __linux__
+}
+
+size_t DirectoryWatcher::get_watch_count() const {
+#ifdef __linux__
+    return watches.size();
+#else
+    return 0;
+#endif // __linux__
+}
+
+bool DirectoryWatcher::is_complete() const {
+    return complete;
+}
+
+bool DirectoryWatcher::wait(int p_timeout, Vector<Change>& p_changes) {
+#ifdef __linux__
+    if (fd < 0) {
+        return false;
+    }
+
+    struct pollfd fds[2] = { { fd, POLLIN, 0 }, { wake_fd, POLLIN, 0 } };
+    int ready = ::poll(fds, 2, p_timeout);
+    if (ready < 0) {
+        return errno == EINTR;
+    }
+    if (fds[1].revents & POLLIN) {
+        uint64_t value;
+        ssize_t read = ::read(wake_fd, &value, sizeof(value));
+        (void)read;
+        return false;
+    }
+    if (!(fds[0].revents & POLLIN)) {
+        return true;
+    }
+
+    static thread_local Vector<char> buffer(watch_buffer_size);
+    while (true) {
+        ssize_t size = ::read(fd, buffer.data(), buffer.size());
+        if (size <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < size;) {
+            struct inotify_event event;
+            std::memcpy(&event, buffer.data() + offset, sizeof(event));
+            const char* name = event.len > 0 ? buffer.data() + offset + sizeof(event) : "";
+            _handle_event(event.wd, event.mask, name, p_changes);
+            offset += sizeof(event) + event.len;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif // __linux__
+}
+
+void DirectoryWatcher::stop() {
+#ifdef __linux__
+    uint64_t value = 1;
+    ssize_t written = ::write(wake_fd, &value, sizeof(value));
+    (void)written;
+#endif // __linux__
+}
+
+DirectoryWatcher::DirectoryWatcher() :
+#ifdef __linux__
+    fd(-1),
+    wake_fd(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+#endif // __linux__
+    complete(true) {
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    close();
+#ifdef __linux__
+    if (wake_fd >= 0) {
+        ::close(wake_fd);
+    }
+#endif // __linux__
+}
+
+PACKER_NAMESPACE_END
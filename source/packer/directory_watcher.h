@@ -0,0 +1,139 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "error.h"
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class DirectoryWatcher
+ * @brief Watches a directory tree for files that are written or moved into it, with inotify.
+ *
+ * Every directory of the tree is watched, and directories created or moved into the tree are watched as they
+ * appear. A directory holding the ignore file is watched on its own but its sub-directories are not, so an
+ * ignored subtree costs a single watch. When the ignore file appears the watches below the directory are removed,
+ * and when it disappears they are added again and the directory is reported so its subtree can be packed.
+ *
+ * Waiting for changes blocks in `poll` without a timeout unless one is given, so an idle watcher uses no CPU.
+ * Watching is only supported on Linux, `open` returns `Error::Unsupported` elsewhere.
+ */
+class DirectoryWatcher {
+public:
+    /**
+     * @enum ChangeType
+     * @brief Enumeration defining the kinds of changes reported.
+     */
+    enum class ChangeType {
+        File,      ///< A file was written or moved into the tree.
+        Directory, ///< A directory was created, moved into the tree or no longer ignored, its whole subtree may have changed.
+        Overflow   ///< Events were lost, the whole tree may have changed.
+    };
+
+    /**
+     * @struct Change
+     * @brief A change to the tree.
+     */
+    struct Change {
+        ChangeType type; ///< The kind of change.
+        String path; ///< The path of the file or directory relative to the root, empty for the root.
+    };
+
+private:
+    String root; ///< The root directory of the tree.
+    String ignore_file_name; ///< The name of the ignore file, empty when ignore files are not checked.
+#ifdef __linux__
+    int fd; ///< The inotify instance, or -1.
+    int wake_fd; ///< The eventfd signalled to stop waiting.
+    Map<int, String> paths; ///< The relative path of the directory of each watch descriptor.
+    Map<String, int> watches; ///< The watch descriptor of each watched directory, ordered so subtrees are contiguous.
+    HashSet<String> ignored; ///< The watched directories holding the ignore file.
+#endif // __linux__
+    bool complete; ///< Flag indicating whether every directory of the tree could be watched.
+
+#ifdef __linux__
+    /**
+     * @brief Watch a directory and, unless it holds the ignore file, every directory below it.
+     * @param p_path The path of the directory relative to the root.
+     * @return `true` if every directory could be watched, `false` otherwise.
+     */
+    bool _add_tree(const String& p_path);
+
+    /**
+     * @brief Stop watching every directory below a directory, and the directory itself when requested.
+     * @param p_path The path of the directory relative to the root.
+     * @param p_self `true` to also stop watching the directory.
+     */
+    void _remove_tree(const String& p_path, bool p_self);
+
+    /**
+     * @brief Turn an inotify event into the changes it makes to the tree.
+     * @param p_descriptor The watch descriptor of the event.
+     * @param p_mask The event mask.
+     * @param p_name The name of the entry, empty for events on the directory itself.
+     * @param p_changes Receives the changes.
+     */
+    void _handle_event(int p_descriptor, uint32_t p_mask, const char* p_name, Vector<Change>& p_changes);
+#endif // __linux__
+
+public:
+    /**
+     * @brief Start watching a tree, closing any tree already watched.
+     * @param p_root The root directory of the tree.
+     * @param p_ignore_file_name The name of the ignore file, or empty to not check for one.
+     * @return An `Error` code indicating the success or failure of the operation, `Error::Failed` when a
+     * directory could not be watched, for example because the inotify watch limit was reached.
+     */
+    Error open(const String& p_root, const String& p_ignore_file_name);
+
+    /**
+     * @brief Stop watching the tree.
+     */
+    void close();
+
+    /**
+     * @brief Check if a tree is being watched.
+     * @return `true` if a tree is watched, `false` otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Get the number of directories watched.
+     * @return The number of directories.
+     */
+    size_t get_watch_count() const;
+
+    /**
+     * @brief Check if every directory of the tree is watched.
+     * @return `false` once a directory could not be watched, its changes are then missed.
+     */
+    bool is_complete() const;
+
+    /**
+     * @brief Wait for changes to the tree.
+     * @param p_timeout The longest time to wait in milliseconds, or -1 to wait until a change or `stop`.
+     * @param p_changes Receives the changes, which may be none when the timeout expires.
+     * @return `true` if waiting should continue, `false` once `stop` was called or the tree is not watched.
+     */
+    bool wait(int p_timeout, Vector<Change>& p_changes);
+
+    /**
+     * @brief Make the current or the next `wait` return `false`, this function is thread-safe.
+     */
+    void stop();
+
+    /**
+     * @brief Constructor for the DirectoryWatcher class.
+     */
+    DirectoryWatcher();
+
+    /**
+     * @brief Destructor for the DirectoryWatcher class, stops watching the tree.
+     */
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+};
+
+PACKER_NAMESPACE_END
@@ -15,6 +15,8 @@ static const char* error_names[] = {
     "file cant open",
     "invalid data",
     "does not exist",
+    "already exists",
+    "unsupported",
 };
 
 String get_error_name(Error p_error) {
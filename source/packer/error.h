@@ -22,6 +22,8 @@ enum class Error {
     FileCantOpen,        ///< Unable to open file.
     InvalidData,         ///< Invalid data format.
     DoesNotExist,        ///< The requested item does not exist.
+    AlreadyExists,       ///< The item to create already exists.
+    Unsupported,         ///< The operation is not supported on this platform or with these settings.
     Max                  ///< Maximum value for error codes.
 };
 
@@ -0,0 +1,101 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "extension_matcher.h"
+
+PACKER_NAMESPACE_BEGIN
+
+static inline char fold_case(char p_char) {
+    return p_char >= 'A' && p_char <= 'Z' ? static_cast<char>(p_char - 'A' + 'a') : p_char;
+}
+
+uint64_t ExtensionMatcher::_hash(const char* p_extension, size_t p_length) const {
+    // 64-bit FNV-1a, extensions are short so a simple byte hash is enough.
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < p_length; ++i) {
+        hash ^= static_cast<unsigned char>(insensitive ? fold_case(p_extension[i]) : p_extension[i]);
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+bool ExtensionMatcher::_equals(size_t p_index, const char* p_extension, size_t p_length) const {
+    size_t begin = offsets[p_index];
+    if (offsets[p_index + 1] - begin != p_length) {
+        return false;
+    }
+    const char* key = keys.data() + begin;
+    for (size_t i = 0; i < p_length; ++i) {
+        if (key[i] != (insensitive ? fold_case(p_extension[i]) : p_extension[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ExtensionMatcher::match(const char* p_extension, size_t p_length) const {
+    if (slots.empty()) {
+        return false;
+    }
+    for (size_t slot = _hash(p_extension, p_length) & mask;; slot = (slot + 1) & mask) {
+        uint32_t index = slots[slot];
+        if (index == 0) {
+            return false;
+        }
+        if (_equals(index - 1, p_extension, p_length)) {
+            return true;
+        }
+    }
+}
+
+bool ExtensionMatcher::match(const String& p_extension) const {
+    return match(p_extension.data(), p_extension.size());
+}
+
+bool ExtensionMatcher::match_path(const String& p_path) const {
+    size_t begin = p_path.find_last_of('.') + 1;
+    return match(p_path.data() + begin, p_path.size() - begin);
+}
+
+size_t ExtensionMatcher::get_extension_count() const {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+bool ExtensionMatcher::is_insensitive() const {
+    return insensitive;
+}
+
+ExtensionMatcher::ExtensionMatcher(const Vector<String>& p_extensions, bool p_insensitive) :
+    mask(0),
+    insensitive(p_insensitive) {
+    if (p_extensions.empty()) {
+        return;
+    }
+
+    // Keep the table at most half full so probe sequences stay short.
+    size_t size = 2;
+    while (size < p_extensions.size() * 2) {
+        size <<= 1;
+    }
+    slots.assign(size, 0);
+    mask = size - 1;
+    offsets.push_back(0);
+
+    for (const String& extension : p_extensions) {
+        if (match(extension)) {
+            continue;
+        }
+
+        size_t slot = _hash(extension.data(), extension.size()) & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = static_cast<uint32_t>(offsets.size());
+
+        for (char c : extension) {
+            keys.push_back(insensitive ? fold_case(c) : c);
+        }
+        offsets.push_back(keys.size());
+    }
+}
+
+PACKER_NAMESPACE_END
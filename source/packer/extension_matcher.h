@@ -0,0 +1,87 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class ExtensionMatcher
+ * @brief An immutable set of file extensions compiled for fast matching.
+ *
+ * The extensions are folded to lower case once, when the matcher is built, and stored in an open addressing
+ * hash table over a single name buffer. Matching hashes and compares the extension in place, so it never
+ * allocates and does not depend on the number of extensions.
+ */
+class ExtensionMatcher {
+    String keys; ///< The stored extensions, folded when matching is case-insensitive, one after another.
+    Vector<size_t> offsets; ///< The offset of each stored extension in the key buffer, plus the end of the buffer.
+    Vector<uint32_t> slots; ///< The hash table, each slot holds an extension index plus one, or 0 when empty.
+    size_t mask; ///< The hash table size minus one.
+    bool insensitive; ///< Flag indicating whether matching ignores case.
+
+    /**
+     * @brief Hash an extension, folding it to lower case when matching is case-insensitive.
+     * @param p_extension The extension characters.
+     * @param p_length The number of characters.
+     * @return The hash of the extension.
+     */
+    uint64_t _hash(const char* p_extension, size_t p_length) const;
+
+    /**
+     * @brief Compare an extension with a stored extension.
+     * @param p_index The index of the stored extension.
+     * @param p_extension The extension characters.
+     * @param p_length The number of characters.
+     * @return `true` if the extensions are equal, `false` otherwise.
+     */
+    bool _equals(size_t p_index, const char* p_extension, size_t p_length) const;
+
+public:
+    /**
+     * @brief Check if an extension is in the set.
+     * @param p_extension The extension characters, without the leading dot.
+     * @param p_length The number of characters.
+     * @return `true` if the extension is in the set, `false` otherwise.
+     */
+    bool match(const char* p_extension, size_t p_length) const;
+
+    /**
+     * @brief Check if an extension is in the set.
+     * @param p_extension The extension, without the leading dot.
+     * @return `true` if the extension is in the set, `false` otherwise.
+     */
+    bool match(const String& p_extension) const;
+
+    /**
+     * @brief Check if the extension of a path is in the set.
+     *
+     * The extension is everything after the last dot of the path, or the whole path when it has no dot.
+     *
+     * @param p_path The path to check.
+     * @return `true` if the extension of the path is in the set, `false` otherwise.
+     */
+    bool match_path(const String& p_path) const;
+
+    /**
+     * @brief Get the number of distinct extensions in the set.
+     * @return The number of extensions.
+     */
+    size_t get_extension_count() const;
+
+    /**
+     * @brief Check if matching ignores case.
+     * @return `true` if matching is case-insensitive, `false` otherwise.
+     */
+    bool is_insensitive() const;
+
+    /**
+     * @brief Constructor for the ExtensionMatcher class.
+     * @param p_extensions The extensions to match, without the leading dot.
+     * @param p_insensitive `true` to ignore the case of ASCII letters when matching.
+     */
+    ExtensionMatcher(const Vector<String>& p_extensions = Vector<String>(), bool p_insensitive = false);
+};
+
+PACKER_NAMESPACE_END
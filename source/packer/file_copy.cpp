@@ -0,0 +1,1456 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "file_copy.h"
+#include "checksum.h"
+#include "io_uring.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <stdio.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif // __linux__
+
+PACKER_NAMESPACE_BEGIN
+
+static const char* engine_names[] = {
+    "filesystem",
+    "kernel",
+    "io_uring"
+};
+
+static const char* method_names[] = {
+    "none",
+    "rename",
+    "link",
+    "clone",
+    "filesystem",
+    "copy_file_range",
+    "sendfile",
+    "read_write",
+    "io_uring"
+};
+
+/**
+ * @brief The size of the buffer used by the read/write copy loop and to read copies back.
+ */
+static constexpr size_t copy_buffer_size = 1 << 20;
+
+/**
+ * @brief Returns the nanoseconds elapsed since a time point.
+ */
+static uint64_t get_elapsed(std::chrono::steady_clock::time_point p_start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - p_start).count();
+}
+
+#ifdef __linux__
+/**
+ * @brief The largest number of bytes requested from a single copy_file_range or sendfile call.
+ */
+static constexpr size_t copy_chunk_size = 1 << 30;
+
+/**
+ * @brief The largest range of a split file copied by one thread at a time.
+ */
+static constexpr uint64_t split_range_size = 1 << 26;
+
+/**
+ * @brief The size from which the blocks of a dense copy are reserved before its data is written.
+ *
+ * Smaller files are allocated whole by delayed allocation anyway, reserving their blocks would only add a call.
+ */
+static constexpr uint64_t preallocate_size = 1 << 20;
+
+/**
+ * @class FileDescriptor
+ * @brief Closes a file descriptor when it goes out of scope.
+ */
+class FileDescriptor {
+    int fd;
+
+public:
+    int get() const {
+        return fd;
+    }
+
+    int release() {
+        int result = fd;
+        fd = -1;
+        return result;
+    }
+
+    FileDescriptor(int p_fd) :
+        fd(p_fd) {
+    }
+
+    ~FileDescriptor() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+/**
+ * @class TemporaryFile
+ * @brief Removes a file written under a temporary name when it goes out of scope, unless it was renamed into place.
+ */
+class TemporaryFile {
+    int directory;
+    String name;
+
+public:
+    const char* get_name() const {
+        return name.c_str();
+    }
+
+    bool is_valid() const {
+        return !name.empty();
+    }
+
+    bool rename(int p_directory, const char* p_name) {
+        if (::renameat(directory, name.c_str(), p_directory, p_name) != 0) {
+            return false;
+        }
+        name.clear();
+        return true;
+    }
+
+    TemporaryFile(int p_directory, const String& p_name) :
+        directory(p_directory),
+        name(p_name) {
+    }
+
+    ~TemporaryFile() {
+        if (!name.empty()) {
+            ::unlinkat(directory, name.c_str(), 0);
+        }
+    }
+};
+
+static void throw_copy_error(const FileCopy::Location& p_from, const FileCopy::Location& p_to, int p_error) {
+    throw FileAccess::filesystem_error("cannot copy file", *p_from.path, *p_to.path, std::error_code(p_error, std::generic_category()));
+}
+
+/**
+ * @brief Returns the directory descriptor a location is resolved against by the `*at` system calls.
+ */
+static int get_directory(const FileCopy::Location& p_location) {
+    return p_location.directory >= 0 ? p_location.directory : AT_FDCWD;
+}
+
+/**
+ * @brief Returns the name a location is resolved with by the `*at` system calls.
+ */
+static const char* get_name(const FileCopy::Location& p_location) {
+    return p_location.directory >= 0 ? p_location.name : p_location.path->c_str();
+}
+
+/**
+ * @brief Flushes the data of a copy to its device with fdatasync.
+ * @return 0 if the data was flushed, the errno value otherwise.
+ */
+static int sync_location(const FileCopy::Location& p_location) {
+    FileDescriptor fd(::openat(get_directory(p_location), get_name(p_location), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0 || ::fdatasync(fd.get()) != 0) {
+        return errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the name a split copy is written under before it is renamed over the destination.
+ */
+static String get_temporary_name(const FileCopy::Location& p_location) {
+    String name = get_name(p_location);
+    size_t separator = name.find_last_of('/') + 1;
+    return name.substr(0, separator) + "." + name.substr(separator) + ".pkpart";
+}
+
+/**
+ * @brief Returns the size of the ranges a file is copied in, or 0 when it is copied as a whole.
+ *
+ * Verified copies are checksummed in order as they are written, and the std::filesystem engine copies whole
+ * files, so neither is split.
+ */
+static uint64_t get_split_range_size(uint64_t p_size, const FileCopy::Options& p_options) {
+    if (p_options.split_size == 0 || p_size < p_options.split_size || p_options.verify || p_options.engine == FileCopy::Engine::Filesystem) {
+        return 0;
+    }
+    uint64_t range_size = std::min(p_options.split_size, split_range_size);
+    return p_size > range_size ? range_size : 0;
+}
+
+static int64_t to_nanoseconds(const struct timespec& p_time) {
+    return static_cast<int64_t>(p_time.tv_sec) * 1000000000 + p_time.tv_nsec;
+}
+
+/**
+ * @brief Sets the access and modification times of an open copy to those of its source.
+ */
+static int set_file_times(int p_fd, const struct timespec& p_atime, const struct timespec& p_mtime) {
+    struct timespec times[2] = { p_atime, p_mtime };
+    return ::futimens(p_fd, times);
+}
+
+static Vector<char>& get_copy_buffer() {
+    static thread_local Vector<char> buffer(copy_buffer_size);
+    return buffer;
+}
+
+/**
+ * @brief Reads a copy back from its start and checks it against the checksum of its source.
+ * @return 0 if the copy matches, EIO if it does not, another errno value if it cannot be read.
+ */
+static int verify_copy(int p_fd, uint64_t p_size, uint64_t p_checksum, FileCopy::Result& p_result) {
+    auto start = std::chrono::steady_clock::now();
+    Vector<char>& buffer = get_copy_buffer();
+    Checksum checksum;
+    uint64_t offset = 0;
+
+    while (true) {
+        ssize_t read = ::pread(p_fd, buffer.data(), buffer.size(), offset);
+        if (read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (read == 0) {
+            break;
+        }
+        checksum.update(buffer.data(), read);
+        offset += read;
+    }
+
+    p_result.verify_time += get_elapsed(start);
+    if (offset != p_size || checksum.digest() != p_checksum) {
+        return EIO;
+    }
+    p_result.verified = true;
+    p_result.checksum = p_checksum;
+    return 0;
+}
+#endif // __linux__
+
+/**
+ * @brief Returns true when an existing destination does not need to be replaced by its source.
+ *
+ * Without the quick check, the destination is kept unless it is older than the source. With it, the destination
+ * is kept only when it has the same size and a modification time within the tolerance.
+ */
+static bool is_up_to_date(uint64_t p_from_size, int64_t p_from_mtime, uint64_t p_to_size, int64_t p_to_mtime, const FileCopy::Options& p_options) {
+    if (!p_options.quick_check) {
+        return p_to_mtime >= p_from_mtime;
+    }
+    int64_t difference = p_to_mtime > p_from_mtime ? p_to_mtime - p_from_mtime : p_from_mtime - p_to_mtime;
+    return p_to_size == p_from_size && difference <= p_options.quick_check_tolerance;
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Returns true when a copy_file_range or sendfile error means the call is not usable for this file pair.
+ */
+static bool is_unsupported(int p_error) {
+    return p_error == ENOSYS || p_error == EXDEV || p_error == EINVAL || p_error == EOPNOTSUPP || p_error == EBADF || p_error == EPERM;
+}
+
+/**
+ * @brief Returns true when a clone error means cloning is not possible for this file pair.
+ */
+static bool is_clone_unsupported(int p_error) {
+    return p_error == EOPNOTSUPP || p_error == ENOTTY || p_error == EXDEV || p_error == EINVAL || p_error == EBADF || p_error == EPERM || p_error == ETXTBSY;
+}
+
+/**
+ * @brief Returns true when the destination directory of a file is on the given device.
+ */
+static bool is_same_device(const FileCopy::Location& p_to, dev_t p_device) {
+    struct stat directory_stat;
+    if (p_to.directory >= 0) {
+        if (::fstat(p_to.directory, &directory_stat) != 0) {
+            return false;
+        }
+    } else {
+        String directory = FileAccess::path(*p_to.path).parent_path().string();
+        if (::stat(directory.empty() ? "." : directory.c_str(), &directory_stat) != 0) {
+            return false;
+        }
+    }
+    return directory_stat.st_dev == p_device;
+}
+
+/**
+ * @brief Returns true when an open file has holes that can be skipped with SEEK_DATA and SEEK_HOLE.
+ *
+ * Only files with fewer allocated blocks than their size are checked. Filesystems that cannot report holes
+ * answer SEEK_HOLE with the end of the file, so they copy every file densely. The file offset is restored, the
+ * copy loops continue from it.
+ */
+static bool is_sparse(int p_fd, const struct stat& p_stat) {
+    if (static_cast<uint64_t>(p_stat.st_blocks) * 512 >= static_cast<uint64_t>(p_stat.st_size)) {
+        return false;
+    }
+    off_t hole = ::lseek(p_fd, 0, SEEK_HOLE);
+    bool sparse = hole >= 0 && hole < p_stat.st_size;
+    ::lseek(p_fd, 0, SEEK_SET);
+    return sparse;
+}
+
+/**
+ * @brief Reserves the blocks of a copy before its data is written, so the filesystem can allocate them in few extents.
+ *
+ * The size of the copy is kept, so a source that shrinks while it is copied does not leave zeros at the end of it.
+ *
+ * @return 0 if the blocks were reserved or the filesystem cannot reserve them, the errno value otherwise.
+ */
+static int preallocate(int p_fd, uint64_t p_size) {
+    if (::fallocate(p_fd, FALLOC_FL_KEEP_SIZE, 0, p_size) != 0 && errno != EOPNOTSUPP && errno != ENOSYS) {
+        return errno;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copies the data extents of a region of a sparse file to the same offsets of its copy, skipping its holes.
+ *
+ * The extents are found with explicit offsets, so several threads can copy regions of the same descriptors at once
+ * even though SEEK_DATA and SEEK_HOLE also move the shared file offset. The copy must be extended to the size of
+ * the source afterwards, a hole at its end is never written.
+ *
+ * @return The error that stopped the copy, or an empty error code.
+ */
+static std::error_code copy_data_extents(int p_in, int p_out, uint64_t p_offset, uint64_t p_size, FileCopy::Result& p_result) {
+    p_result = FileCopy::Result();
+    p_result.method = FileCopy::Method::CopyFileRange;
+
+    uint64_t end = p_offset + p_size;
+    while (p_offset < end) {
+        off_t data = ::lseek(p_in, static_cast<off_t>(p_offset), SEEK_DATA);
+        if (data < 0) {
+            // Only a hole is left before the end of the file.
+            if (errno == ENXIO) {
+                break;
+            }
+            return std::error_code(errno, std::generic_category());
+        }
+        if (static_cast<uint64_t>(data) >= end) {
+            break;
+        }
+        off_t hole = ::lseek(p_in, data, SEEK_HOLE);
+        if (hole < 0) {
+            return std::error_code(errno, std::generic_category());
+        }
+
+        uint64_t length = std::min<uint64_t>(hole, end) - data;
+        FileCopy::Result extent;
+        std::error_code error = FileCopy::copy_range(p_in, data, p_out, data, length, extent);
+        if (error) {
+            return error;
+        }
+        if (extent.method == FileCopy::Method::ReadWrite) {
+            p_result.method = FileCopy::Method::ReadWrite;
+        }
+        p_result.bytes += extent.bytes;
+        p_offset = data + length;
+    }
+
+    p_result.holes = p_size - p_result.bytes;
+    return std::error_code();
+}
+
+/**
+ * @brief Copies an open file to an open copy in ranges, which several threads copy concurrently.
+ *
+ * On a pool with several workers the ranges are shared with the pool. Elsewhere, on a single worker, outside a
+ * pool or on a pipeline copy thread, helper threads are started for the copy, one for each hardware thread, so a
+ * split copy always runs its ranges in parallel. The ranges of a sparse file only copy their data extents. Once a
+ * range fails the ranges that have not started are skipped.
+ *
+ * @return The error of the first range that failed, or an empty error code.
+ */
+static std::error_code copy_ranges(int p_in, int p_out, uint64_t p_size, uint64_t p_range_size, bool p_sparse, FileCopy::Result& p_result) {
+    size_t count = (p_size + p_range_size - 1) / p_range_size;
+    Vector<FileCopy::Result> results(count);
+    Vector<std::error_code> errors(count);
+    std::atomic<bool> failed(false);
+    auto copy = [&](size_t p_index) {
+        if (failed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        uint64_t offset = p_index * p_range_size;
+        uint64_t size = std::min(p_range_size, p_size - offset);
+        if (p_sparse) {
+            errors[p_index] = copy_data_extents(p_in, p_out, offset, size, results[p_index]);
+        } else {
+            errors[p_index] = FileCopy::copy_range(p_in, offset, p_out, offset, size, results[p_index]);
+        }
+        if (errors[p_index]) {
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    if (ThreadPool::get_current_thread_count() > 1) {
+        ThreadPool::parallel_for(count, copy);
+    } else {
+        std::atomic<size_t> next(0);
+        auto run = [&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                copy(i);
+            }
+        };
+        Vector<std::thread> helpers;
+        size_t helper_count = std::min(count, ThreadPool::resolve_thread_count(0)) - 1;
+        for (size_t i = 0; i < helper_count; ++i) {
+            try {
+                helpers.emplace_back(run);
+            } catch (const std::system_error&) {
+                // The ranges left are copied by the threads already running.
+                break;
+            }
+        }
+        run();
+        for (auto& helper : helpers) {
+            helper.join();
+        }
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            return error;
+        }
+    }
+
+    // A range that fell back to reading and writing makes the whole file count as copied that way.
+    p_result.method = FileCopy::Method::CopyFileRange;
+    for (size_t i = 0; i < count; ++i) {
+        if (results[i].method == FileCopy::Method::ReadWrite) {
+            p_result.method = FileCopy::Method::ReadWrite;
+        }
+        p_result.bytes += results[i].bytes;
+        p_result.holes += results[i].holes;
+    }
+    p_result.ranges = count;
+    return std::error_code();
+}
+
+static bool copy_posix(const FileCopy::Location& p_from, const FileCopy::Location& p_to, const FileCopy::Options& p_options, FileCopy::Result& p_result) {
+    FileDescriptor in(::openat(get_directory(p_from), get_name(p_from), O_RDONLY | O_CLOEXEC));
+    if (in.get() < 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+
+    struct stat from_stat;
+    if (::fstat(in.get(), &from_stat) != 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+    if (!S_ISREG(from_stat.st_mode)) {
+        throw_copy_error(p_from, p_to, EINVAL);
+    }
+
+    struct stat to_stat;
+    if (::fstatat(get_directory(p_to), get_name(p_to), &to_stat, 0) == 0) {
+        if (from_stat.st_dev == to_stat.st_dev && from_stat.st_ino == to_stat.st_ino) {
+            throw_copy_error(p_from, p_to, EEXIST);
+        }
+        if (is_up_to_date(from_stat.st_size, to_nanoseconds(from_stat.st_mtim), to_stat.st_size, to_nanoseconds(to_stat.st_mtim), p_options)) {
+            return false;
+        }
+        if (p_options.break_links && to_stat.st_nlink > 1 && ::unlinkat(get_directory(p_to), get_name(p_to), 0) != 0 && errno != ENOENT) {
+            throw_copy_error(p_from, p_to, errno);
+        }
+    }
+
+    // A split copy is written under a temporary name and renamed over the destination once every range is complete.
+    uint64_t range_size = get_split_range_size(from_stat.st_size, p_options);
+    TemporaryFile temporary(get_directory(p_to), range_size > 0 ? get_temporary_name(p_to) : String());
+
+    // Verified copies are read back through the same descriptor.
+    FileDescriptor out(::openat(get_directory(p_to), temporary.is_valid() ? temporary.get_name() : get_name(p_to), (p_options.verify ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+    if (out.get() < 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+    if (::fchmod(out.get(), from_stat.st_mode & 07777) != 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+
+#ifdef FICLONE
+    if (p_options.clone && is_same_device(p_to, from_stat.st_dev)) {
+        if (::ioctl(out.get(), FICLONE, in.get()) == 0) {
+            if (p_options.preserve_times && set_file_times(out.get(), from_stat.st_atim, from_stat.st_mtim) != 0) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+            if (p_options.sync && ::fdatasync(out.get()) != 0) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+            if (::close(out.release()) != 0) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+            if (temporary.is_valid() && !temporary.rename(get_directory(p_to), get_name(p_to))) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+            p_result.method = FileCopy::Method::Clone;
+            p_result.bytes = from_stat.st_size;
+            p_result.synced = p_options.sync;
+            return true;
+        }
+        if (!is_clone_unsupported(errno)) {
+            throw_copy_error(p_from, p_to, errno);
+        }
+    }
+#endif // FICLONE
+
+    if (p_options.engine == FileCopy::Engine::Filesystem && !p_options.verify) {
+        if (::close(out.release()) != 0) {
+            throw_copy_error(p_from, p_to, errno);
+        }
+        FileAccess::copy_file(*p_from.path, *p_to.path, FileAccess::copy_options::overwrite_existing);
+        if (p_options.preserve_times) {
+            struct timespec times[2] = { from_stat.st_atim, from_stat.st_mtim };
+            if (::utimensat(get_directory(p_to), get_name(p_to), times, 0) != 0) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+        }
+        if (p_options.sync) {
+            int error = sync_location(p_to);
+            if (error != 0) {
+                throw_copy_error(p_from, p_to, error);
+            }
+        }
+        p_result.method = FileCopy::Method::Filesystem;
+        p_result.bytes = from_stat.st_size;
+        p_result.synced = p_options.sync;
+        return true;
+    }
+
+    uint64_t remaining = from_stat.st_size;
+    // Verification needs the data in the copy buffer, so it skips the in-kernel methods.
+    FileCopy::Method method = p_options.verify ? FileCopy::Method::ReadWrite : FileCopy::Method::CopyFileRange;
+    Checksum checksum;
+
+    // Verified copies checksum the holes as zeros, so they are written densely.
+    bool sparse = !p_options.verify && is_sparse(in.get(), from_stat);
+    if (!sparse && remaining >= preallocate_size) {
+        int error = preallocate(out.get(), remaining);
+        if (error != 0) {
+            throw_copy_error(p_from, p_to, error);
+        }
+    }
+
+    // Split and sparse copies write at explicit offsets and leave nothing for the loops below.
+    if (range_size > 0 || sparse) {
+        std::error_code error = range_size > 0 ? copy_ranges(in.get(), out.get(), remaining, range_size, sparse, p_result) : copy_data_extents(in.get(), out.get(), 0, remaining, p_result);
+        if (error) {
+            throw_copy_error(p_from, p_to, error.value());
+        }
+        if (sparse && ::ftruncate(out.get(), remaining) != 0) {
+            throw_copy_error(p_from, p_to, errno);
+        }
+        method = p_result.method;
+        remaining = 0;
+    }
+
+    // Each method continues from the current file offsets, so a fall back can happen part way through a file.
+    while (remaining > 0 && method == FileCopy::Method::CopyFileRange) {
+        ssize_t copied = ::copy_file_range(in.get(), nullptr, out.get(), nullptr, std::min<uint64_t>(remaining, copy_chunk_size), 0);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!is_unsupported(errno)) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+            method = FileCopy::Method::Sendfile;
+        } else if (copied == 0) {
+            break;
+        } else {
+            remaining -= copied;
+            p_result.bytes += copied;
+        }
+    }
+
+    while (remaining > 0 && method == FileCopy::Method::Sendfile) {
+        ssize_t copied = ::sendfile(out.get(), in.get(), nullptr, std::min<uint64_t>(remaining, copy_chunk_size));
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!is_unsupported(errno)) {
+                throw_copy_error(p_from, p_to, errno);
+            }
+            method = FileCopy::Method::ReadWrite;
+        } else if (copied == 0) {
+            break;
+        } else {
+            remaining -= copied;
+            p_result.bytes += copied;
+        }
+    }
+
+    if (method == FileCopy::Method::ReadWrite && remaining > 0) {
+        Vector<char>& buffer = get_copy_buffer();
+        while (true) {
+            ssize_t read = ::read(in.get(), buffer.data(), buffer.size());
+            if (read < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_copy_error(p_from, p_to, errno);
+            }
+            if (read == 0) {
+                break;
+            }
+            if (p_options.verify) {
+                auto start = std::chrono::steady_clock::now();
+                checksum.update(buffer.data(), read);
+                p_result.verify_time += get_elapsed(start);
+            }
+            for (ssize_t written = 0; written < read;) {
+                ssize_t result = ::write(out.get(), buffer.data() + written, read - written);
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_copy_error(p_from, p_to, errno);
+                }
+                written += result;
+            }
+            p_result.bytes += read;
+        }
+    }
+
+    if (p_options.verify) {
+        int error = verify_copy(out.get(), p_result.bytes, checksum.digest(), p_result);
+        if (error != 0) {
+            ::close(out.release());
+            ::unlinkat(get_directory(p_to), get_name(p_to), 0);
+            throw_copy_error(p_from, p_to, error);
+        }
+    }
+    if (p_options.preserve_times && set_file_times(out.get(), from_stat.st_atim, from_stat.st_mtim) != 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+    if (p_options.sync && ::fdatasync(out.get()) != 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+    if (::close(out.release()) != 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+    if (temporary.is_valid() && !temporary.rename(get_directory(p_to), get_name(p_to))) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+
+    p_result.method = method;
+    p_result.synced = p_options.sync;
+    return true;
+}
+
+/**
+ * @brief Tries to move a file with renameat2 when the destination directory is on the same device.
+ * @return 1 if the file was renamed, 0 if an up to date destination exists, -1 if the file must be copied instead.
+ */
+static int rename_posix(const FileCopy::Location& p_from, const FileCopy::Location& p_to, const FileCopy::Options& p_options, FileCopy::Result& p_result) {
+#ifdef RENAME_NOREPLACE
+    struct stat from_stat;
+    if (::fstatat(get_directory(p_from), get_name(p_from), &from_stat, 0) != 0) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+    if (!S_ISREG(from_stat.st_mode) || !is_same_device(p_to, from_stat.st_dev)) {
+        return -1;
+    }
+
+    if (p_options.overwrite) {
+        struct stat to_stat;
+        if (::fstatat(get_directory(p_to), get_name(p_to), &to_stat, 0) == 0) {
+            if (from_stat.st_dev == to_stat.st_dev && from_stat.st_ino == to_stat.st_ino) {
+                throw_copy_error(p_from, p_to, EEXIST);
+            }
+            if (is_up_to_date(from_stat.st_size, to_nanoseconds(from_stat.st_mtim), to_stat.st_size, to_nanoseconds(to_stat.st_mtim), p_options)) {
+                return 0;
+            }
+        }
+    }
+
+    if (::renameat2(get_directory(p_from), get_name(p_from), get_directory(p_to), get_name(p_to), p_options.overwrite ? 0 : RENAME_NOREPLACE) == 0) {
+        p_result.method = FileCopy::Method::Rename;
+        p_result.bytes = from_stat.st_size;
+        return 1;
+    }
+    if (errno == EEXIST) {
+        return 0;
+    }
+    if (errno != EXDEV && errno != EINVAL && errno != ENOSYS) {
+        throw_copy_error(p_from, p_to, errno);
+    }
+#endif // RENAME_NOREPLACE
+    return -1;
+}
+
+#ifdef IO_URING_ENABLED
+/**
+ * @brief The number of bytes each file reads and writes per io_uring round.
+ */
+static constexpr size_t io_uring_block_size = 1 << 17;
+
+/**
+ * @brief The number of files copied together by the io_uring engine.
+ */
+static constexpr size_t io_uring_batch_size = 32;
+
+/**
+ * @struct IoUringFile
+ * @brief The state of one file copied by the io_uring engine.
+ */
+struct IoUringFile {
+    FileCopy::Job* job = nullptr;
+    struct statx from_stat;
+    struct statx to_stat;
+    int in = -1;
+    int out = -1;
+    uint64_t offset = 0;
+    uint32_t length = 0;
+    bool active = false;
+    bool created = false;
+    bool deferred = false;
+    Checksum checksum;
+};
+
+static IoUring& get_io_uring() {
+    static thread_local IoUring ring;
+    return ring;
+}
+
+/**
+ * @brief Checks if the kernel supports every opcode of a batched copy, OPENAT, STATX and READ need 5.6.
+ */
+static bool can_copy_io_uring(const IoUring& p_ring, const FileCopy::Options& p_options) {
+    for (uint8_t opcode : { IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+        if (!p_ring.is_supported(opcode)) {
+            return false;
+        }
+    }
+    return !p_options.sync || p_ring.is_supported(IORING_OP_FSYNC);
+}
+
+static int64_t to_nanoseconds(const struct statx_timestamp& p_time) {
+    return static_cast<int64_t>(p_time.tv_sec) * 1000000000 + p_time.tv_nsec;
+}
+
+static void fail_io_uring_file(IoUringFile& p_file, int p_error) {
+    p_file.job->error = std::error_code(p_error, std::generic_category());
+    p_file.active = false;
+}
+
+static IoUring::Operation prepare_io_uring_operation(uint8_t p_opcode, int p_fd, const void* p_address, uint32_t p_length, uint64_t p_offset) {
+    IoUring::Operation operation(p_opcode);
+    operation.sqe.fd = p_fd;
+    operation.sqe.addr = reinterpret_cast<uint64_t>(p_address);
+    operation.sqe.len = p_length;
+    operation.sqe.off = p_offset;
+    return operation;
+}
+
+/**
+ * @brief Copies a batch of files with io_uring, running each step of every file in the same submission round.
+ *
+ * The rounds are: statx of the sources and destinations with the opening of the sources, opening of the
+ * destinations, repeated read then write rounds of one block per file, and closing of every descriptor.
+ */
+static void copy_batch_io_uring(Vector<FileCopy::Job*>& p_jobs, const FileCopy::Options& p_options, IoUring& p_ring) {
+    Vector<IoUringFile> files(p_jobs.size());
+    Vector<IoUring::Operation> operations;
+    Vector<size_t> indices;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        files[i].job = p_jobs[i];
+        files[i].active = true;
+        const FileCopy::Location& from = files[i].job->from;
+        const FileCopy::Location& to = files[i].job->to;
+        operations.push_back(prepare_io_uring_operation(IORING_OP_STATX, get_directory(from), get_name(from), STATX_BASIC_STATS, reinterpret_cast<uint64_t>(&files[i].from_stat)));
+        operations.push_back(prepare_io_uring_operation(IORING_OP_STATX, get_directory(to), get_name(to), STATX_BASIC_STATS, reinterpret_cast<uint64_t>(&files[i].to_stat)));
+        IoUring::Operation open = prepare_io_uring_operation(IORING_OP_OPENAT, get_directory(from), get_name(from), 0, 0);
+        open.sqe.open_flags = O_RDONLY | O_CLOEXEC;
+        operations.push_back(open);
+    }
+
+    bool ring_ok = p_ring.run(operations);
+    int ring_error = ring_ok ? 0 : errno;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        IoUringFile& file = files[i];
+        int32_t from_result = operations[i * 3].result;
+        int32_t to_result = operations[i * 3 + 1].result;
+        int32_t open_result = operations[i * 3 + 2].result;
+
+        if (open_result >= 0) {
+            file.in = open_result;
+        }
+        if (!ring_ok) {
+            fail_io_uring_file(file, ring_error);
+        } else if (open_result < 0) {
+            fail_io_uring_file(file, -open_result);
+        } else if (from_result < 0) {
+            fail_io_uring_file(file, -from_result);
+        } else if (!S_ISREG(file.from_stat.stx_mode)) {
+            fail_io_uring_file(file, EINVAL);
+        } else if (to_result == 0) {
+            if (file.from_stat.stx_ino == file.to_stat.stx_ino && file.from_stat.stx_dev_major == file.to_stat.stx_dev_major && file.from_stat.stx_dev_minor == file.to_stat.stx_dev_minor) {
+                fail_io_uring_file(file, EEXIST);
+            } else if (is_up_to_date(file.from_stat.stx_size, to_nanoseconds(file.from_stat.stx_mtime), file.to_stat.stx_size, to_nanoseconds(file.to_stat.stx_mtime), p_options)) {
+                file.active = false;
+            } else if (p_options.break_links && file.to_stat.stx_nlink > 1) {
+                // Rare enough to unlink synchronously rather than add a round for it.
+                const FileCopy::Location& to = file.job->to;
+                if (::unlinkat(get_directory(to), get_name(to), 0) != 0 && errno != ENOENT) {
+                    fail_io_uring_file(file, errno);
+                }
+            }
+        }
+        // Files large enough to split, and files that may be sparse, are copied with offsets once the batch is done.
+        bool sparse = !p_options.verify && file.from_stat.stx_blocks * 512 < file.from_stat.stx_size;
+        if (file.active && (sparse || get_split_range_size(file.from_stat.stx_size, p_options) > 0)) {
+            file.active = false;
+            file.deferred = true;
+        }
+    }
+
+    operations.clear();
+    indices.clear();
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (files[i].active) {
+            const FileCopy::Location& to = files[i].job->to;
+            IoUring::Operation open = prepare_io_uring_operation(IORING_OP_OPENAT, get_directory(to), get_name(to), 0600, 0);
+            open.sqe.open_flags = (p_options.verify ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC | O_CLOEXEC;
+            operations.push_back(open);
+            indices.push_back(i);
+        }
+    }
+
+    ring_ok = p_ring.run(operations);
+    ring_error = ring_ok ? 0 : errno;
+
+    for (size_t i = 0; i < indices.size(); ++i) {
+        IoUringFile& file = files[indices[i]];
+        if (operations[i].result >= 0) {
+            file.out = operations[i].result;
+            file.created = true;
+        }
+        if (!ring_ok) {
+            fail_io_uring_file(file, ring_error);
+        } else if (operations[i].result < 0) {
+            fail_io_uring_file(file, -operations[i].result);
+        } else if (::fchmod(file.out, file.from_stat.stx_mode & 07777) != 0) {
+            fail_io_uring_file(file, errno);
+        } else if (file.from_stat.stx_size >= preallocate_size) {
+            int error = preallocate(file.out, file.from_stat.stx_size);
+            if (error != 0) {
+                fail_io_uring_file(file, error);
+            }
+        }
+    }
+
+    static thread_local Vector<char> buffer;
+    if (buffer.size() < files.size() * io_uring_block_size) {
+        buffer.resize(files.size() * io_uring_block_size);
+    }
+
+    while (true) {
+        operations.clear();
+        indices.clear();
+        for (size_t i = 0; i < files.size(); ++i) {
+            IoUringFile& file = files[i];
+            if (file.active && file.offset < file.from_stat.stx_size) {
+                uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(file.from_stat.stx_size - file.offset, io_uring_block_size));
+                operations.push_back(prepare_io_uring_operation(IORING_OP_READ, file.in, buffer.data() + i * io_uring_block_size, length, file.offset));
+                indices.push_back(i);
+            }
+        }
+        if (operations.empty()) {
+            break;
+        }
+
+        ring_ok = p_ring.run(operations);
+        ring_error = ring_ok ? 0 : errno;
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+            IoUringFile& file = files[indices[i]];
+            if (!ring_ok) {
+                fail_io_uring_file(file, ring_error);
+            } else if (operations[i].result < 0) {
+                fail_io_uring_file(file, -operations[i].result);
+            } else if (operations[i].result == 0) {
+                // The source shrank while it was copied, stop at its new end.
+                file.from_stat.stx_size = file.offset;
+            } else {
+                file.length = operations[i].result;
+                if (p_options.verify) {
+                    auto start = std::chrono::steady_clock::now();
+                    file.checksum.update(buffer.data() + indices[i] * io_uring_block_size, file.length);
+                    file.job->result.verify_time += get_elapsed(start);
+                }
+            }
+        }
+
+        operations.clear();
+        indices.clear();
+        for (size_t i = 0; i < files.size(); ++i) {
+            IoUringFile& file = files[i];
+            if (file.active && file.length > 0) {
+                operations.push_back(prepare_io_uring_operation(IORING_OP_WRITE, file.out, buffer.data() + i * io_uring_block_size, file.length, file.offset));
+                indices.push_back(i);
+            }
+        }
+
+        ring_ok = p_ring.run(operations);
+        ring_error = ring_ok ? 0 : errno;
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+            IoUringFile& file = files[indices[i]];
+            int32_t written = operations[i].result;
+            if (!ring_ok) {
+                fail_io_uring_file(file, ring_error);
+                continue;
+            }
+            if (written < 0) {
+                fail_io_uring_file(file, -written);
+                continue;
+            }
+            // Finish short writes on the calling thread, they are rare on regular files.
+            const char* data = buffer.data() + indices[i] * io_uring_block_size;
+            while (static_cast<uint32_t>(written) < file.length) {
+                ssize_t result = ::pwrite(file.out, data + written, file.length - written, file.offset + written);
+                if (result < 0 && errno != EINTR) {
+                    fail_io_uring_file(file, errno);
+                    break;
+                }
+                written += result > 0 ? static_cast<int32_t>(result) : 0;
+            }
+            file.offset += file.length;
+            file.length = 0;
+        }
+    }
+
+    // Copies are read back on the calling thread, a copy that does not match is removed once it is closed.
+    if (p_options.verify) {
+        for (auto& file : files) {
+            if (file.active) {
+                int error = verify_copy(file.out, file.offset, file.checksum.digest(), file.job->result);
+                if (error != 0) {
+                    fail_io_uring_file(file, error);
+                }
+            }
+        }
+    }
+
+    // io_uring has no opcode to set file times, they are set on the calling thread before the closing round.
+    if (p_options.preserve_times) {
+        for (auto& file : files) {
+            if (file.active) {
+                struct timespec times[2] = { { file.from_stat.stx_atime.tv_sec, file.from_stat.stx_atime.tv_nsec }, { file.from_stat.stx_mtime.tv_sec, file.from_stat.stx_mtime.tv_nsec } };
+                if (::futimens(file.out, times) != 0) {
+                    fail_io_uring_file(file, errno);
+                }
+            }
+        }
+    }
+
+    if (p_options.sync) {
+        operations.clear();
+        indices.clear();
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (files[i].active) {
+                IoUring::Operation sync = prepare_io_uring_operation(IORING_OP_FSYNC, files[i].out, nullptr, 0, 0);
+                sync.sqe.fsync_flags = IORING_FSYNC_DATASYNC;
+                operations.push_back(sync);
+                indices.push_back(i);
+            }
+        }
+
+        ring_ok = p_ring.run(operations);
+        ring_error = ring_ok ? 0 : errno;
+
+        for (size_t i = 0; i < indices.size(); ++i) {
+            IoUringFile& file = files[indices[i]];
+            if (!ring_ok) {
+                fail_io_uring_file(file, ring_error);
+            } else if (operations[i].result < 0) {
+                fail_io_uring_file(file, -operations[i].result);
+            }
+        }
+    }
+
+    operations.clear();
+    indices.clear();
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (files[i].in >= 0) {
+            operations.push_back(prepare_io_uring_operation(IORING_OP_CLOSE, files[i].in, nullptr, 0, 0));
+            indices.push_back(files.size());
+        }
+        if (files[i].out >= 0) {
+            operations.push_back(prepare_io_uring_operation(IORING_OP_CLOSE, files[i].out, nullptr, 0, 0));
+            indices.push_back(i);
+        }
+    }
+
+    if (!p_ring.run(operations)) {
+        // Only descriptors whose close never reached the kernel are closed here, closing others again could
+        // close a descriptor opened since by another thread.
+        for (auto& operation : operations) {
+            if (operation.result == -ECANCELED) {
+                ::close(operation.sqe.fd);
+            }
+        }
+    } else {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i] < files.size() && operations[i].result < 0 && files[indices[i]].active) {
+                fail_io_uring_file(files[indices[i]], -operations[i].result);
+            }
+        }
+    }
+
+    for (auto& file : files) {
+        if (p_options.verify && file.created && !file.active) {
+            ::unlinkat(get_directory(file.job->to), get_name(file.job->to), 0);
+        }
+        if (file.active) {
+            file.job->copied = true;
+            file.job->result.method = FileCopy::Method::IoUring;
+            file.job->result.bytes = file.offset;
+            file.job->result.synced = p_options.sync;
+        }
+    }
+
+    for (auto& file : files) {
+        if (file.deferred) {
+            try {
+                file.job->copied = copy_posix(file.job->from, file.job->to, p_options, file.job->result);
+            } catch (const FileAccess::filesystem_error& e) {
+                file.job->error = e.code();
+            }
+        }
+    }
+}
+#endif // IO_URING_ENABLED
+#endif // __linux__
+
+/**
+ * @brief Computes the checksum of a file with buffered reads.
+ * @return `true` if the file was read, `false` otherwise.
+ */
+static bool checksum_file(const String& p_path, uint64_t& p_checksum) {
+    FileStreamI file(p_path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    Vector<char> buffer(copy_buffer_size);
+    Checksum checksum;
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        checksum.update(buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+    if (file.bad()) {
+        return false;
+    }
+    p_checksum = checksum.digest();
+    return true;
+}
+
+/**
+ * @brief Removes a destination that shares its data with other hard links, so replacing it leaves them unchanged.
+ */
+static void break_link(const String& p_to) {
+    std::error_code error;
+    if (FileAccess::hard_link_count(p_to, error) > 1 && !error) {
+        FileAccess::remove(p_to);
+    }
+}
+
+static bool copy_filesystem(const String& p_from, const String& p_to, const FileCopy::Options& p_options, FileCopy::Result& p_result) {
+    if (p_options.quick_check) {
+        std::error_code error;
+        if (FileAccess::exists(p_to, error)) {
+            auto from_mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(FileAccess::last_write_time(p_from).time_since_epoch()).count();
+            auto to_mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(FileAccess::last_write_time(p_to).time_since_epoch()).count();
+            if (is_up_to_date(FileAccess::file_size(p_from), from_mtime, FileAccess::file_size(p_to), to_mtime, p_options)) {
+                return false;
+            }
+            if (p_options.break_links) {
+                break_link(p_to);
+            }
+        }
+        FileAccess::copy_file(p_from, p_to, FileAccess::copy_options::overwrite_existing);
+    } else {
+        if (p_options.break_links && FileAccess::exists(p_to)) {
+            if (FileAccess::last_write_time(p_to) >= FileAccess::last_write_time(p_from)) {
+                return false;
+            }
+            break_link(p_to);
+        }
+        if (FileAccess::copy_file(p_from, p_to, FileAccess::copy_options::update_existing) == false) {
+            return false;
+        }
+    }
+    if (p_options.verify) {
+        // std::filesystem copies without exposing the data, so both files are read after the copy.
+        auto start = std::chrono::steady_clock::now();
+        uint64_t from_checksum = 0;
+        uint64_t to_checksum = 0;
+        bool matched = checksum_file(p_from, from_checksum) && checksum_file(p_to, to_checksum) && from_checksum == to_checksum;
+        p_result.verify_time += get_elapsed(start);
+        if (!matched) {
+            std::error_code error;
+            FileAccess::remove(p_to, error);
+            throw FileAccess::filesystem_error("cannot copy file", p_from, p_to, std::make_error_code(std::errc::io_error));
+        }
+        p_result.verified = true;
+        p_result.checksum = from_checksum;
+    }
+    if (p_options.preserve_times) {
+        FileAccess::last_write_time(p_to, FileAccess::last_write_time(p_from));
+    }
+#ifdef __linux__
+    if (p_options.sync) {
+        int error = sync_location(FileCopy::Location(&p_to));
+        if (error != 0) {
+            throw FileAccess::filesystem_error("cannot copy file", p_from, p_to, std::error_code(error, std::generic_category()));
+        }
+        p_result.synced = true;
+    }
+#endif // __linux__
+    p_result.method = FileCopy::Method::Filesystem;
+    p_result.bytes = FileAccess::file_size(p_to);
+    return true;
+}
+
+static bool copy_location(const FileCopy::Location& p_from, const FileCopy::Location& p_to, const FileCopy::Options& p_options, FileCopy::Result& p_result) {
+    p_result = FileCopy::Result();
+
+#ifdef __linux__
+    if (p_options.engine == FileCopy::Engine::Kernel || p_options.engine == FileCopy::Engine::IoUring || p_options.clone || p_options.verify) {
+        return copy_posix(p_from, p_to, p_options, p_result);
+    }
+#endif // __linux__
+
+    return copy_filesystem(*p_from.path, *p_to.path, p_options, p_result);
+}
+
+static bool move_location(const FileCopy::Location& p_from, const FileCopy::Location& p_to, const FileCopy::Options& p_options, FileCopy::Result& p_result) {
+    p_result = FileCopy::Result();
+
+#ifdef __linux__
+    int renamed = rename_posix(p_from, p_to, p_options, p_result);
+    if (renamed >= 0) {
+        return renamed == 1;
+    }
+#endif // __linux__
+
+    return copy_location(p_from, p_to, p_options, p_result);
+}
+
+FileCopy::Options::Options(Engine p_engine, bool p_clone) :
+    engine(p_engine),
+    clone(p_clone),
+    overwrite(true),
+    quick_check(false),
+    quick_check_tolerance(0),
+    preserve_times(false),
+    verify(false),
+    break_links(false),
+    split_size(0),
+    sync(false) {
+}
+
+FileCopy::Location::Location(const String* p_path, int p_directory, const char* p_name) :
+    path(p_path),
+    directory(p_directory),
+    name(p_name) {
+}
+
+FileCopy::Job::Job(const Location& p_from, const Location& p_to) :
+    from(p_from),
+    to(p_to),
+    copied(false) {
+}
+
+FileCopy::Result::Result() :
+    method(Method::None),
+    bytes(0),
+    verified(false),
+    checksum(0),
+    verify_time(0),
+    ranges(0),
+    holes(0),
+    synced(false) {
+}
+
+String FileCopy::get_engine_name(Engine p_engine) {
+    if (p_engine >= static_cast<Engine>(0) && p_engine < Engine::Max) {
+        return engine_names[static_cast<size_t>(p_engine)];
+    } else {
+        return "unknown";
+    }
+}
+
+FileCopy::Engine FileCopy::find_engine(const String& p_engine) {
+    for (size_t i = 0; i < static_cast<size_t>(Engine::Max); ++i) {
+        if (p_engine == engine_names[i]) {
+            return static_cast<Engine>(i);
+        }
+    }
+    return Engine::Unknown;
+}
+
+String FileCopy::get_method_name(Method p_method) {
+    if (p_method >= static_cast<Method>(0) && p_method < Method::Max) {
+        return method_names[static_cast<size_t>(p_method)];
+    } else {
+        return "unknown";
+    }
+}
+
+PackStats::Counter FileCopy::get_method_counter(Method p_method) {
+    switch (p_method) {
+    case Method::Rename:
+        return PackStats::Counter::FilesRenamed;
+    case Method::Link:
+        return PackStats::Counter::FilesLinked;
+    case Method::Clone:
+        return PackStats::Counter::FilesCloned;
+    case Method::Filesystem:
+        return PackStats::Counter::FilesystemCopies;
+    case Method::CopyFileRange:
+        return PackStats::Counter::CopyFileRangeCopies;
+    case Method::Sendfile:
+        return PackStats::Counter::SendfileCopies;
+    case Method::ReadWrite:
+        return PackStats::Counter::ReadWriteCopies;
+    case Method::IoUring:
+        return PackStats::Counter::IoUringCopies;
+    default:
+        return PackStats::Counter::Unknown;
+    }
+}
+
+bool FileCopy::copy(const String& p_from, const String& p_to, const Options& p_options, Result& p_result) {
+    return copy_location(Location(&p_from), Location(&p_to), p_options, p_result);
+}
+
+bool FileCopy::is_destination_up_to_date(const String& p_from, const String& p_to, const Options& p_options) {
+    std::error_code error;
+    uint64_t to_size = FileAccess::file_size(p_to, error);
+    if (error) {
+        return false;
+    }
+    uint64_t from_size = FileAccess::file_size(p_from, error);
+    if (error) {
+        return false;
+    }
+    auto to_mtime = FileAccess::last_write_time(p_to, error);
+    if (error) {
+        return false;
+    }
+    auto from_mtime = FileAccess::last_write_time(p_from, error);
+    if (error) {
+        return false;
+    }
+    return is_up_to_date(from_size, std::chrono::duration_cast<std::chrono::nanoseconds>(from_mtime.time_since_epoch()).count(), to_size, std::chrono::duration_cast<std::chrono::nanoseconds>(to_mtime.time_since_epoch()).count(), p_options);
+}
+
+bool FileCopy::clone(const String& p_from, const String& p_to, Result& p_result) {
+    p_result = Result();
+
+#if defined(__linux__) && defined(FICLONE)
+    FileDescriptor in(::open(p_from.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat from_stat;
+    if (in.get() < 0 || ::fstat(in.get(), &from_stat) != 0 || !S_ISREG(from_stat.st_mode)) {
+        return false;
+    }
+
+    FileDescriptor out(::open(p_to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+    if (out.get() < 0) {
+        return false;
+    }
+    if (::ioctl(out.get(), FICLONE, in.get()) != 0 || ::close(out.release()) != 0) {
+        ::unlink(p_to.c_str());
+        return false;
+    }
+
+    p_result.method = Method::Clone;
+    p_result.bytes = from_stat.st_size;
+    return true;
+#else
+    return false;
+#endif // __linux__ && FICLONE
+}
+
+#ifdef __linux__
+std::error_code FileCopy::copy_range(int p_from, uint64_t p_from_offset, int p_to, uint64_t p_to_offset, uint64_t p_size, Result& p_result) {
+    p_result = Result();
+
+    loff_t in_offset = static_cast<loff_t>(p_from_offset);
+    loff_t out_offset = static_cast<loff_t>(p_to_offset);
+    uint64_t remaining = p_size;
+    Method method = Method::CopyFileRange;
+
+    while (remaining > 0 && method == Method::CopyFileRange) {
+        ssize_t copied = ::copy_file_range(p_from, &in_offset, p_to, &out_offset, std::min<uint64_t>(remaining, copy_chunk_size), 0);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!is_unsupported(errno)) {
+                return std::error_code(errno, std::generic_category());
+            }
+            method = Method::ReadWrite;
+        } else if (copied == 0) {
+            // The source is shorter than the region.
+            return std::make_error_code(std::errc::io_error);
+        } else {
+            remaining -= copied;
+            p_result.bytes += copied;
+        }
+    }
+
+    if (method == Method::ReadWrite) {
+        Vector<char>& buffer = get_copy_buffer();
+        while (remaining > 0) {
+            ssize_t read = ::pread(p_from, buffer.data(), std::min<uint64_t>(remaining, buffer.size()), in_offset);
+            if (read < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return std::error_code(errno, std::generic_category());
+            }
+            if (read == 0) {
+                return std::make_error_code(std::errc::io_error);
+            }
+            for (ssize_t written = 0; written < read;) {
+                ssize_t result = ::pwrite(p_to, buffer.data() + written, read - written, out_offset);
+                if (result < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return std::error_code(errno, std::generic_category());
+                }
+                written += result;
+                out_offset += result;
+            }
+            in_offset += read;
+            remaining -= read;
+            p_result.bytes += read;
+        }
+    }
+
+    p_result.method = method;
+    return std::error_code();
+}
+#endif // __linux__
+
+std::error_code FileCopy::sync_filesystem(const String& p_path) {
+#ifdef __linux__
+    FileDescriptor fd(::open(p_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.get() < 0 || ::syncfs(fd.get()) != 0) {
+        return std::error_code(errno, std::generic_category());
+    }
+    return std::error_code();
+#else
+    return std::make_error_code(std::errc::not_supported);
+#endif // __linux__
+}
+
+size_t FileCopy::get_batch_size(Engine p_engine) {
+#ifdef IO_URING_ENABLED
+    if (p_engine == Engine::IoUring) {
+        return io_uring_batch_size;
+    }
+#endif // IO_URING_ENABLED
+    return 1;
+}
+
+void FileCopy::copy_batch(Vector<Job>& p_jobs, const Options& p_options, bool p_move) {
+    Vector<Job*> pending;
+
+    for (auto& job : p_jobs) {
+        job.copied = false;
+        job.result = Result();
+        job.error.clear();
+
+        try {
+#ifdef IO_URING_ENABLED
+            // Clones are tried one file at a time by the kernel engine, the ioctl has no io_uring opcode, and so are
+            // copies on kernels missing one of the opcodes of a batch.
+            if (p_options.engine == Engine::IoUring && !p_options.clone && can_copy_io_uring(get_io_uring(), p_options)) {
+                int renamed = p_move ? rename_posix(job.from, job.to, p_options, job.result) : -1;
+                if (renamed < 0) {
+                    pending.push_back(&job);
+                } else {
+                    job.copied = renamed == 1;
+                }
+                continue;
+            }
+#endif // IO_URING_ENABLED
+            if (p_move) {
+                job.copied = move_location(job.from, job.to, p_options, job.result);
+            } else {
+                job.copied = copy_location(job.from, job.to, p_options, job.result);
+            }
+        } catch (const FileAccess::filesystem_error& e) {
+            job.error = e.code();
+        }
+    }
+
+#ifdef IO_URING_ENABLED
+    if (!pending.empty()) {
+        copy_batch_io_uring(pending, p_options, get_io_uring());
+    }
+#endif // IO_URING_ENABLED
+}
+
+void FileCopy::remove_batch(const Vector<Location>& p_files, Vector<std::error_code>& p_errors, Engine p_engine) {
+    p_errors.assign(p_files.size(), std::error_code());
+
+#ifdef IO_URING_ENABLED
+    // UNLINKAT needs kernel 5.11, older kernels remove the files with unlinkat.
+    if (p_engine == Engine::IoUring && get_io_uring().is_supported(IORING_OP_UNLINKAT)) {
+        Vector<IoUring::Operation> operations;
+        for (const Location& file : p_files) {
+            operations.push_back(prepare_io_uring_operation(IORING_OP_UNLINKAT, get_directory(file), get_name(file), 0, 0));
+        }
+        if (get_io_uring().run(operations)) {
+            for (size_t i = 0; i < operations.size(); ++i) {
+                if (operations[i].result < 0 && operations[i].result != -ENOENT) {
+                    p_errors[i] = std::error_code(-operations[i].result, std::generic_category());
+                }
+            }
+            return;
+        }
+    }
+#endif // IO_URING_ENABLED
+
+    for (size_t i = 0; i < p_files.size(); ++i) {
+#ifdef __linux__
+        if (p_files[i].directory >= 0) {
+            if (::unlinkat(p_files[i].directory, p_files[i].name, 0) != 0 && errno != ENOENT) {
+                p_errors[i] = std::error_code(errno, std::generic_category());
+            }
+            continue;
+        }
+#endif // __linux__
+        FileAccess::remove(*p_files[i].path, p_errors[i]);
+    }
+}
+
+bool FileCopy::move(const String& p_from, const String& p_to, const Options& p_options, Result& p_result) {
+    return move_location(Location(&p_from), Location(&p_to), p_options, p_result);
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,305 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "pack_stats.h"
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class FileCopy
+ * @brief Copies single files with a selectable copy engine.
+ *
+ * Every engine follows the rules of `std::filesystem::copy_file` with `copy_options::update_existing`:
+ * an existing destination is only replaced when it is older than the source, the destination receives the
+ * permissions of the source, and failures are reported by throwing `FileAccess::filesystem_error`.
+ *
+ * With the quick check, an existing destination is instead replaced unless it has the same size and
+ * modification time as the source, within a tolerance, like rsync decides which files to transfer. The check
+ * only keeps working between runs when the modification times of the sources are preserved on the copies.
+ *
+ * When cloning is requested on Linux and the destination is on the same device as the source, the file is
+ * first cloned with the `FICLONE` ioctl (btrfs, XFS and other reflink capable filesystems). If the filesystem
+ * cannot clone the file, it is copied with the selected engine instead.
+ *
+ * When verification is requested, the data is checksummed with `Checksum` as it passes through the copy
+ * buffer, so every engine copies with reads and writes instead of copy_file_range or sendfile, then the copy is
+ * read back and checked against the checksum of its source. A copy that does not match is removed and reported
+ * with `std::errc::io_error`. Clones and renames move no data and are not verified.
+ *
+ * When breaking links is requested, a destination that has other hard links is unlinked before it is replaced,
+ * so the new data does not show through the other links, which keep the old data.
+ *
+ * When a split size is set, the kernel and io_uring engines copy a file at least that large in ranges with
+ * `copy_range`, and several threads each claim the next range until none are left: the workers of the pool the
+ * copy runs on when it has several (see `ThreadPool::parallel_for`), helper threads started for the copy
+ * otherwise. The copy is preallocated and written under a hidden temporary name in the
+ * destination directory, then renamed over the destination once every range is complete, so the destination
+ * never holds a partial file. Verified copies are checksummed in order and are never split.
+ *
+ * When syncing is requested, the data of each copy is flushed to its device with fdatasync before it is closed,
+ * in a batch of `IORING_OP_FSYNC` submissions by the io_uring engine, so the copy survives a power loss once it is
+ * reported.
+ *
+ * The kernel and io_uring engines keep sparse files sparse: a source with fewer allocated blocks than its size
+ * is copied one data extent at a time, found with `SEEK_DATA` and `SEEK_HOLE`, and its holes are skipped. The
+ * blocks of a dense copy of 1 MB or more are reserved with `fallocate` before its data is written, so the copy is
+ * not fragmented. Verified copies are always written densely.
+ *
+ * The io_uring engine works on batches of files (see `copy_batch`). Single files, and systems where io_uring
+ * is unavailable, are copied with the kernel engine instead.
+ */
+class FileCopy {
+public:
+    /**
+     * @enum Engine
+     * @brief Enumeration defining the available copy engines.
+     */
+    enum class Engine {
+        Unknown = -1, ///< An unknown copy engine.
+        Filesystem,   ///< Copy with std::filesystem::copy_file.
+        Kernel,       ///< Copy inside the kernel with copy_file_range, then sendfile, then a read/write loop.
+        IoUring,      ///< Copy batches of files with io_uring, falling back to the kernel engine without it.
+        Max           ///< The maximum value for the Engine enumeration.
+    };
+
+    /**
+     * @enum Method
+     * @brief Enumeration defining the methods a file can actually be copied with.
+     */
+    enum class Method {
+        Unknown = -1,  ///< An unknown copy method.
+        None,          ///< The file was not copied.
+        Rename,        ///< The file was moved with renameat2, the source no longer exists.
+        Link,          ///< The file was hard linked to another destination with the same content.
+        Clone,         ///< The file was cloned with FICLONE and shares its data extents with the source.
+        Filesystem,    ///< The file was copied with std::filesystem::copy_file.
+        CopyFileRange, ///< The file was copied with copy_file_range.
+        Sendfile,      ///< The file was copied with sendfile.
+        ReadWrite,     ///< The file was copied with a read/write loop.
+        IoUring,       ///< The file was copied in a batch of io_uring submissions.
+        Max            ///< The maximum value for the Method enumeration.
+    };
+
+    /**
+     * @struct Options
+     * @brief Options controlling how a file is copied.
+     */
+    struct Options {
+        Engine engine; ///< The copy engine to use.
+        bool clone; ///< Flag indicating whether to try a copy-on-write clone before copying.
+        bool overwrite; ///< Flag indicating whether a move may replace an existing destination, defaults to `true`.
+        bool quick_check; ///< Flag indicating whether existing destinations are compared by size and modification time, defaults to `false`.
+        int64_t quick_check_tolerance; ///< The largest modification time difference the quick check accepts, in nanoseconds.
+        bool preserve_times; ///< Flag indicating whether copies receive the access and modification times of the source, defaults to `false`.
+        bool verify; ///< Flag indicating whether copies are read back and checked against their source, defaults to `false`.
+        bool break_links; ///< Flag indicating whether a destination with other hard links is unlinked before it is replaced, defaults to `false`.
+        uint64_t split_size; ///< The size in bytes from which a file is copied in ranges by several threads, 0 to never split, defaults to 0.
+        bool sync; ///< Flag indicating whether the data of each copy is flushed to its device with fdatasync before it is closed, Linux only, defaults to `false`.
+
+        /**
+         * @brief Constructor for the Options struct.
+         * @param p_engine The copy engine to use.
+         * @param p_clone `true` to try a copy-on-write clone before copying.
+         */
+        Options(Engine p_engine = Engine::Filesystem, bool p_clone = false);
+    };
+
+    /**
+     * @struct Result
+     * @brief Describes how a file was copied.
+     */
+    struct Result {
+        Method method; ///< The method that copied the file data.
+        uint64_t bytes; ///< The number of bytes written to the destination.
+        bool verified; ///< Set when the copy was read back and matched its source.
+        uint64_t checksum; ///< The checksum of the file data, set when the copy was verified.
+        uint64_t verify_time; ///< The time spent checksumming and reading back the copy, in nanoseconds.
+        uint64_t ranges; ///< The number of ranges the data was copied in, 0 when it was copied as a whole.
+        uint64_t holes; ///< The number of bytes of holes in a sparse source that were skipped instead of written.
+        bool synced; ///< Set when the data of the copy was flushed to its device.
+
+        /**
+         * @brief Constructor for the Result struct.
+         */
+        Result();
+    };
+
+    /**
+     * @struct Location
+     * @brief The location of a file, either a path or a name relative to an open directory.
+     *
+     * When a directory descriptor is given, the POSIX engines resolve the name relative to it with the `*at`
+     * system calls instead of resolving every component of the path again. The path is still required, it is used
+     * by the std::filesystem engine and in error reports.
+     */
+    struct Location {
+        const String* path; ///< The path of the file, must stay valid while the location is used.
+        int directory; ///< An open directory descriptor the name is relative to, or -1 to use the path.
+        const char* name; ///< The name of the file inside the directory.
+
+        /**
+         * @brief Constructor for the Location struct.
+         * @param p_path The path of the file.
+         * @param p_directory An open directory descriptor the name is relative to, or -1 to use the path.
+         * @param p_name The name of the file inside the directory.
+         */
+        Location(const String* p_path = nullptr, int p_directory = -1, const char* p_name = nullptr);
+    };
+
+    /**
+     * @struct Job
+     * @brief A file copied as part of a batch.
+     */
+    struct Job {
+        Location from; ///< The location of the source file.
+        Location to; ///< The location of the destination file.
+        bool copied; ///< Set when the file was copied or moved.
+        Result result; ///< Receives how the file was copied.
+        std::error_code error; ///< Set when the file could not be copied.
+
+        /**
+         * @brief Constructor for the Job struct.
+         * @param p_from The location of the source file.
+         * @param p_to The location of the destination file.
+         */
+        Job(const Location& p_from = Location(), const Location& p_to = Location());
+    };
+
+    /**
+     * @brief Get a string representation of an Engine enum value.
+     * @param p_engine The Engine enum value.
+     * @return A string representation of the Engine.
+     */
+    static String get_engine_name(Engine p_engine);
+
+    /**
+     * @brief Find an Engine enum value based on its string representation.
+     * @param p_engine The string representation of the Engine.
+     * @return The corresponding Engine enum value.
+     */
+    static Engine find_engine(const String& p_engine);
+
+    /**
+     * @brief Get a string representation of a Method enum value.
+     * @param p_method The Method enum value.
+     * @return A string representation of the Method.
+     */
+    static String get_method_name(Method p_method);
+
+    /**
+     * @brief Get the stats counter that counts files copied with a method.
+     * @param p_method The Method enum value.
+     * @return The corresponding counter, or PackStats::Counter::Unknown if there is none.
+     */
+    static PackStats::Counter get_method_counter(Method p_method);
+
+    /**
+     * @brief Copy a file.
+     * @param p_from The path of the source file.
+     * @param p_to The path of the destination file.
+     * @param p_options The options controlling the copy.
+     * @param p_result Receives how the file was copied.
+     * @return `true` if the file was copied, `false` if an up to date destination already exists.
+     */
+    static bool copy(const String& p_from, const String& p_to, const Options& p_options, Result& p_result);
+
+    /**
+     * @brief Move a file, renaming it when the source and destination share a device.
+     *
+     * On Linux, a file on the same device as the destination directory is renamed with `renameat2`, using
+     * `RENAME_NOREPLACE` unless overwriting is allowed. Otherwise the file is copied and the method of the result
+     * is not `Method::Rename`; the caller is then responsible for removing the source.
+     *
+     * @param p_from The path of the source file.
+     * @param p_to The path of the destination file.
+     * @param p_options The options controlling the move.
+     * @param p_result Receives how the file was moved.
+     * @return `true` if the file was moved or copied, `false` if an up to date destination already exists.
+     */
+    static bool move(const String& p_from, const String& p_to, const Options& p_options, Result& p_result);
+
+    /**
+     * @brief Check if an existing destination would be kept by `copy` instead of being replaced.
+     * @param p_from The path of the source file.
+     * @param p_to The path of the destination file.
+     * @param p_options The options the copy would use.
+     * @return `true` if the destination exists and is up to date with the source, `false` otherwise.
+     */
+    static bool is_destination_up_to_date(const String& p_from, const String& p_to, const Options& p_options);
+
+    /**
+     * @brief Clone a file to a new destination with the `FICLONE` ioctl, without ever copying its data.
+     *
+     * The destination must not exist yet and is created with owner-only permissions, the caller sets them.
+     *
+     * @param p_from The path of the source file.
+     * @param p_to The path of the destination file.
+     * @param p_result Receives how the file was cloned.
+     * @return `true` if the file was cloned, `false` if the destination exists or the file cannot be cloned.
+     */
+    static bool clone(const String& p_from, const String& p_to, Result& p_result);
+
+#ifdef __linux__
+    /**
+     * @brief Copy a region of an open file to a region of another, inside the kernel where possible.
+     *
+     * Both offsets are given explicitly and the file offsets of the descriptors are neither used nor changed, so
+     * several threads can copy regions of the same descriptors at once. The data is copied with copy_file_range,
+     * then with a pread/pwrite loop when the kernel cannot copy between the two files.
+     *
+     * @param p_from The descriptor of the source file.
+     * @param p_from_offset The offset of the region in the source file.
+     * @param p_to The descriptor of the destination file.
+     * @param p_to_offset The offset of the region in the destination file.
+     * @param p_size The size of the region in bytes.
+     * @param p_result Receives how the region was copied.
+     * @return The error that stopped the copy, or an empty error code.
+     */
+    static std::error_code copy_range(int p_from, uint64_t p_from_offset, int p_to, uint64_t p_to_offset, uint64_t p_size, Result& p_result);
+#endif // __linux__
+
+    /**
+     * @brief Flush every pending write of the filesystem holding a path to its device, with syncfs.
+     *
+     * One call makes every copy written to the filesystem durable, which is far cheaper than syncing each copy when
+     * many files were written.
+     *
+     * @param p_path The path of a directory on the filesystem.
+     * @return The error that prevented the sync, or an empty error code. Only supported on Linux.
+     */
+    static std::error_code sync_filesystem(const String& p_path);
+
+    /**
+     * @brief Get the number of files an engine copies together in one batch.
+     * @param p_engine The copy engine.
+     * @return The preferred batch size, 1 for engines that copy one file at a time.
+     */
+    static size_t get_batch_size(Engine p_engine);
+
+    /**
+     * @brief Copy or move a batch of files.
+     *
+     * The io_uring engine submits the open, statx, read, write and close calls of every file in the batch
+     * together, in as few submission rounds as possible. Other engines copy the files one at a time.
+     * Errors do not stop the batch, they are reported per job instead of being thrown.
+     *
+     * @param p_jobs The files to copy.
+     * @param p_options The options controlling the copies.
+     * @param p_move `true` to move the files as `move` does, `false` to copy them.
+     */
+    static void copy_batch(Vector<Job>& p_jobs, const Options& p_options, bool p_move = false);
+
+    /**
+     * @brief Remove a batch of files, with a single io_uring submission round when the engine is io_uring.
+     *
+     * Files that no longer exist are not reported as errors.
+     *
+     * @param p_files The locations of the files to remove.
+     * @param p_errors Receives the error of each removal.
+     * @param p_engine The copy engine.
+     */
+    static void remove_batch(const Vector<Location>& p_files, Vector<std::error_code>& p_errors, Engine p_engine);
+};
+
+PACKER_NAMESPACE_END
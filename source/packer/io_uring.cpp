@@ -0,0 +1,225 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "io_uring.h"
+
+#ifdef IO_URING_ENABLED
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+PACKER_NAMESPACE_BEGIN
+
+static int io_uring_setup(unsigned p_entries, io_uring_params* p_params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, p_entries, p_params));
+}
+
+static int io_uring_register(int p_fd, unsigned p_opcode, void* p_argument, unsigned p_count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, p_fd, p_opcode, p_argument, p_count));
+}
+
+static int io_uring_enter(int p_fd, unsigned p_to_submit, unsigned p_min_complete, unsigned p_flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, p_fd, p_to_submit, p_min_complete, p_flags, nullptr, 0));
+}
+
+static unsigned* ring_field(void* p_ring, uint32_t p_offset) {
+    return reinterpret_cast<unsigned*>(static_cast<char*>(p_ring) + p_offset);
+}
+
+IoUring::Operation::Operation(uint8_t p_opcode) :
+    result(0) {
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = p_opcode;
+}
+
+void IoUring::_probe() {
+    // The probe is followed by one entry for each opcode, the buffer is made of words to keep it aligned.
+    Vector<uint64_t> buffer((sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op) + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (io_uring_register(fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return;
+    }
+    for (unsigned i = 0; i < probe->ops_len; ++i) {
+        if (probe->ops[i].flags & IO_URING_OP_SUPPORTED) {
+            supported.set(probe->ops[i].op);
+        }
+    }
+}
+
+size_t IoUring::_reap(Vector<Operation>& p_operations) {
+    size_t reaped = 0;
+    unsigned head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = cqes[head & *cq_mask];
+        p_operations[cqe.user_data].result = cqe.res;
+        ++head;
+        ++reaped;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+void IoUring::_close() {
+    if (sqes != MAP_FAILED) {
+        ::munmap(sqes, sqes_size);
+        sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+        ::munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+        ::munmap(sq_ring, sq_ring_size);
+    }
+    sq_ring = cq_ring = MAP_FAILED;
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    supported.reset();
+}
+
+bool IoUring::is_valid() const {
+    return fd >= 0;
+}
+
+bool IoUring::is_supported(uint8_t p_opcode) const {
+    return fd >= 0 && supported.test(p_opcode);
+}
+
+bool IoUring::run(Vector<Operation>& p_operations) {
+    if (fd < 0) {
+        for (auto& operation : p_operations) {
+            operation.result = -ECANCELED;
+        }
+        errno = ECANCELED;
+        return false;
+    }
+
+    size_t queued = 0;
+    size_t completed = 0;
+    unsigned unsubmitted = 0;
+
+    while (completed < p_operations.size()) {
+        unsigned tail = *sq_tail;
+        while (queued < p_operations.size() && queued - completed < entries) {
+            unsigned index = tail & *sq_mask;
+            sqes[index] = p_operations[queued].sqe;
+            sqes[index].user_data = queued;
+            sq_array[index] = index;
+            ++tail;
+            ++unsubmitted;
+            ++queued;
+        }
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+        int result = io_uring_enter(fd, unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (result < 0) {
+            if (errno != EINTR) {
+                break;
+            }
+        } else {
+            unsubmitted -= static_cast<unsigned>(result);
+        }
+
+        completed += _reap(p_operations);
+    }
+
+    if (completed < p_operations.size()) {
+        // The kernel may still be using the buffers and descriptors of the operations in flight, wait for them
+        // before the caller releases them. The entries left in the submission ring would be submitted by the next
+        // round, so the ring is closed.
+        int error = errno;
+        size_t submitted = queued - unsubmitted;
+        while (completed < submitted) {
+            if (io_uring_enter(fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                break;
+            }
+            completed += _reap(p_operations);
+        }
+        for (size_t i = submitted; i < p_operations.size(); ++i) {
+            p_operations[i].result = -ECANCELED;
+        }
+        _close();
+        errno = error;
+        return false;
+    }
+
+    return true;
+}
+
+IoUring::IoUring(unsigned p_entries) :
+    fd(-1),
+    entries(0),
+    sq_ring(MAP_FAILED),
+    sq_ring_size(0),
+    cq_ring(MAP_FAILED),
+    cq_ring_size(0),
+    sqes(static_cast<io_uring_sqe*>(MAP_FAILED)),
+    sqes_size(0) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    int ring_fd = io_uring_setup(p_entries, &params);
+    if (ring_fd < 0) {
+        return;
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        ::close(ring_fd);
+        return;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring = sq_ring;
+    } else {
+        cq_ring = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            ::munmap(sq_ring, sq_ring_size);
+            sq_ring = MAP_FAILED;
+            ::close(ring_fd);
+            return;
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+        if (cq_ring != sq_ring) {
+            ::munmap(cq_ring, cq_ring_size);
+        }
+        ::munmap(sq_ring, sq_ring_size);
+        sq_ring = cq_ring = MAP_FAILED;
+        ::close(ring_fd);
+        return;
+    }
+
+    sq_tail = ring_field(sq_ring, params.sq_off.tail);
+    sq_mask = ring_field(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field(sq_ring, params.sq_off.array);
+    cq_head = ring_field(cq_ring, params.cq_off.head);
+    cq_tail = ring_field(cq_ring, params.cq_off.tail);
+    cq_mask = ring_field(cq_ring, params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(cq_ring) + params.cq_off.cqes);
+
+    // Never keep more operations in flight than the completion ring can hold.
+    entries = std::min(params.sq_entries, params.cq_entries);
+    fd = ring_fd;
+    _probe();
+}
+
+IoUring::~IoUring() {
+    _close();
+}
+
+PACKER_NAMESPACE_END
+
+#endif // IO_URING_ENABLED
@@ -0,0 +1,125 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#ifdef IO_URING_ENABLED
+
+#include <linux/io_uring.h>
+
+#include <bitset>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class IoUring
+ * @brief A minimal io_uring submission/completion ring driven through raw system calls.
+ *
+ * Operations are prepared as plain submission queue entries and run in batched rounds: each call to `run`
+ * submits as many operations as fit in the ring with a single system call and waits for their completions,
+ * repeating until every operation of the round has completed.
+ *
+ * The opcodes supported by the kernel are probed when the ring is created, since the ring itself is available
+ * from 5.1 but most file opcodes were added later. If submitting fails, the operations already in flight are
+ * waited for and the ring is closed, so no operation can outlive the round that prepared it.
+ */
+class IoUring {
+public:
+    /**
+     * @struct Operation
+     * @brief A single operation of a round and its result.
+     */
+    struct Operation {
+        io_uring_sqe sqe; ///< The submission queue entry describing the operation.
+        int32_t result; ///< The result of the operation, a negative errno value on failure.
+
+        /**
+         * @brief Constructor for the Operation struct, the entry is zeroed.
+         * @param p_opcode The io_uring opcode of the operation.
+         */
+        Operation(uint8_t p_opcode = IORING_OP_NOP);
+    };
+
+private:
+    int fd; ///< The ring file descriptor, or -1 if the ring could not be created.
+    unsigned entries; ///< The number of submission queue entries.
+
+    void* sq_ring; ///< The mapped submission ring.
+    size_t sq_ring_size; ///< The size of the mapped submission ring.
+    void* cq_ring; ///< The mapped completion ring, may alias the submission ring.
+    size_t cq_ring_size; ///< The size of the mapped completion ring.
+    io_uring_sqe* sqes; ///< The mapped submission queue entries.
+    size_t sqes_size; ///< The size of the mapped submission queue entries.
+
+    unsigned* sq_tail; ///< The submission ring tail.
+    unsigned* sq_mask; ///< The submission ring mask.
+    unsigned* sq_array; ///< The submission ring index array.
+    unsigned* cq_head; ///< The completion ring head.
+    unsigned* cq_tail; ///< The completion ring tail.
+    unsigned* cq_mask; ///< The completion ring mask.
+    io_uring_cqe* cqes; ///< The completion queue entries.
+
+    std::bitset<256> supported; ///< The opcodes supported by the kernel.
+
+    /**
+     * @brief Record the opcodes supported by the kernel, none are recorded on kernels without IORING_REGISTER_PROBE.
+     */
+    void _probe();
+
+    /**
+     * @brief Reap the completions available in the completion ring.
+     * @param p_operations The operations of the round, their results are set.
+     * @return The number of completions reaped.
+     */
+    size_t _reap(Vector<Operation>& p_operations);
+
+    /**
+     * @brief Unmap and close the ring, it can no longer be used.
+     */
+    void _close();
+
+public:
+    /**
+     * @brief Check if the ring was created, io_uring may be missing or blocked by the kernel.
+     * @return `true` if the ring can be used, `false` otherwise.
+     */
+    bool is_valid() const;
+
+    /**
+     * @brief Check if the kernel supports an opcode.
+     * @param p_opcode The io_uring opcode.
+     * @return `true` if the ring is valid and operations with the opcode can be run, `false` otherwise.
+     */
+    bool is_supported(uint8_t p_opcode) const;
+
+    /**
+     * @brief Run a round of operations and wait for all of them to complete.
+     *
+     * If submitting fails, the operations in flight are waited for, the operations that were never submitted
+     * receive `-ECANCELED` and the ring is closed, `errno` holds the error of the failed submission. Once the ring
+     * is closed every operation receives `-ECANCELED`.
+     *
+     * @param p_operations The operations to run, their results are set on completion.
+     * @return `true` if every operation completed, `false` if the ring failed.
+     */
+    bool run(Vector<Operation>& p_operations);
+
+    /**
+     * @brief Constructor for the IoUring class.
+     * @param p_entries The number of submission queue entries.
+     */
+    IoUring(unsigned p_entries = 256);
+
+    /**
+     * @brief Destructor for the IoUring class.
+     */
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+};
+
+PACKER_NAMESPACE_END
+
+#endif // IO_URING_ENABLED
@@ -0,0 +1,316 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "manifest.h"
+
+#include <cstring>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @brief The identifier at the start of every manifest file, including the format version.
+ */
+static const char manifest_magic[8] = { 'P', 'K', 'M', 'F', 0, 0, 0, 2 };
+
+/**
+ * @struct ManifestHeader
+ * @brief The header of a manifest file.
+ */
+struct ManifestHeader {
+    char magic[8]; ///< The manifest identifier.
+    uint64_t record_count; ///< The number of file records following the header.
+    uint64_t directory_count; ///< The number of directory records following the file records.
+    uint64_t paths_size; ///< The size of the path buffer following the records.
+    uint64_t filter_key; ///< The filter key the directory listings were recorded with.
+};
+
+/**
+ * @brief The value of a directory record flagging a directory that contained the ignore file.
+ */
+static constexpr uint64_t directory_ignored = 1;
+
+bool Manifest::FileState::operator==(const FileState& p_state) const {
+    return size == p_state.size && mtime == p_state.mtime && inode == p_state.inode;
+}
+
+Manifest::FileState::FileState(uint64_t p_size, int64_t p_mtime, uint64_t p_inode) :
+    size(p_size),
+    mtime(p_mtime),
+    inode(p_inode) {
+}
+
+bool Manifest::DirectoryState::operator==(const DirectoryState& p_state) const {
+    return mtime == p_state.mtime && ctime == p_state.ctime && inode == p_state.inode;
+}
+
+Manifest::DirectoryState::DirectoryState(int64_t p_mtime, int64_t p_ctime, uint64_t p_inode) :
+    mtime(p_mtime),
+    ctime(p_ctime),
+    inode(p_inode) {
+}
+
+Manifest::Listing::Listing(const char* p_entries, size_t p_length, bool p_ignored) :
+    entries(p_entries),
+    length(p_length),
+    ignored(p_ignored) {
+}
+
+int Manifest::_compare(uint64_t p_offset, size_t p_stored_length, const char* p_path, size_t p_length) const {
+    int result = std::memcmp(paths.data() + p_offset, p_path, std::min(p_stored_length, p_length));
+    if (result != 0) {
+        return result;
+    }
+    return p_stored_length < p_length ? -1 : (p_stored_length > p_length ? 1 : 0);
+}
+
+template <typename T>
+Vector<T> Manifest::_sort(const Vector<T>& p_records) const {
+    Vector<size_t> order(p_records.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this, &p_records](size_t p_a, size_t p_b) {
+        const T& a = p_records[p_a];
+        const T& b = p_records[p_b];
+        return _compare(a.source, a.source_length, paths.data() + b.source, b.source_length) < 0;
+    });
+
+    Vector<T> sorted;
+    sorted.reserve(p_records.size());
+    for (size_t index : order) {
+        sorted.push_back(p_records[index]);
+    }
+    return sorted;
+}
+
+template <typename T>
+bool Manifest::_validate(const Vector<T>& p_records) const {
+    for (size_t i = 0; i < p_records.size(); ++i) {
+        const T& record = p_records[i];
+        if (record.source + record.source_length > paths.size()) {
+            return false;
+        }
+        if (i > 0) {
+            const T& previous = p_records[i - 1];
+            if (_compare(previous.source, previous.source_length, paths.data() + record.source, record.source_length) >= 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Manifest::match(const char* p_source, size_t p_source_length, const char* p_destination, size_t p_destination_length, const FileState& p_state) const {
+    auto record = std::lower_bound(records.begin(), records.end(), 0, [this, p_source, p_source_length](const Record& p_record, int) {
+        return _compare(p_record.source, p_record.source_length, p_source, p_source_length) < 0;
+    });
+    if (record == records.end() || _compare(record->source, record->source_length, p_source, p_source_length) != 0) {
+        return false;
+    }
+    if (record->destination_length != p_destination_length || std::memcmp(paths.data() + record->destination, p_destination, p_destination_length) != 0) {
+        return false;
+    }
+    return FileState(record->size, record->mtime, record->inode) == p_state;
+}
+
+void Manifest::add(const char* p_source, size_t p_source_length, const char* p_destination, size_t p_destination_length, const FileState& p_state) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Record record;
+    record.source = paths.size();
+    record.source_length = static_cast<uint32_t>(p_source_length);
+    paths.append(p_source, p_source_length);
+    record.destination = paths.size();
+    record.destination_length = static_cast<uint32_t>(p_destination_length);
+    paths.append(p_destination, p_destination_length);
+    record.size = p_state.size;
+    record.mtime = p_state.mtime;
+    record.inode = p_state.inode;
+    records.push_back(record);
+}
+
+bool Manifest::find_directory(const char* p_source, size_t p_source_length, const DirectoryState& p_state, Listing& p_listing) const {
+    auto record = std::lower_bound(directories.begin(), directories.end(), 0, [this, p_source, p_source_length](const DirectoryRecord& p_record, int) {
+        return _compare(p_record.source, p_record.source_length, p_source, p_source_length) < 0;
+    });
+    if (record == directories.end() || _compare(record->source, record->source_length, p_source, p_source_length) != 0) {
+        return false;
+    }
+    if (!(DirectoryState(record->mtime, record->ctime, record->inode) == p_state)) {
+        return false;
+    }
+    p_listing = Listing(paths.data() + record->entries, record->entries_length, record->ignored == directory_ignored);
+    return true;
+}
+
+void Manifest::add_directory(const char* p_source, size_t p_source_length, const DirectoryState& p_state, const Listing& p_listing) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    DirectoryRecord record;
+    record.source = paths.size();
+    record.source_length = static_cast<uint32_t>(p_source_length);
+    paths.append(p_source, p_source_length);
+    record.entries = paths.size();
+    record.entries_length = static_cast<uint32_t>(p_listing.length);
+    paths.append(p_listing.entries, p_listing.length);
+    record.mtime = p_state.mtime;
+    record.ctime = p_state.ctime;
+    record.inode = p_state.inode;
+    record.ignored = p_listing.ignored ? directory_ignored : 0;
+    directories.push_back(record);
+}
+
+void Manifest::merge(const Manifest& p_manifest) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Search the records recorded so far, the records appended from the other manifest are never duplicates.
+    auto recorded = [this](auto& p_sorted, const auto& p_record, const String& p_paths) {
+        const char* source = p_paths.data() + p_record.source;
+        auto found = std::lower_bound(p_sorted.begin(), p_sorted.end(), 0, [this, source, &p_record](const auto& p_existing, int) {
+            return _compare(p_existing.source, p_existing.source_length, source, p_record.source_length) < 0;
+        });
+        return found != p_sorted.end() && _compare(found->source, found->source_length, source, p_record.source_length) == 0;
+    };
+
+    Vector<Record> sorted = _sort(records);
+    for (Record record : p_manifest.records) {
+        if (recorded(sorted, record, p_manifest.paths)) {
+            continue;
+        }
+        const char* source = p_manifest.paths.data() + record.source;
+        const char* destination = p_manifest.paths.data() + record.destination;
+        record.source = paths.size();
+        paths.append(source, record.source_length);
+        record.destination = paths.size();
+        paths.append(destination, record.destination_length);
+        records.push_back(record);
+    }
+
+    Vector<DirectoryRecord> sorted_directories = _sort(directories);
+    for (DirectoryRecord record : p_manifest.directories) {
+        if (recorded(sorted_directories, record, p_manifest.paths)) {
+            continue;
+        }
+        const char* source = p_manifest.paths.data() + record.source;
+        const char* entries = p_manifest.paths.data() + record.entries;
+        record.source = paths.size();
+        paths.append(source, record.source_length);
+        record.entries = paths.size();
+        paths.append(entries, record.entries_length);
+        directories.push_back(record);
+    }
+}
+
+size_t Manifest::get_entry_count() const {
+    return records.size();
+}
+
+size_t Manifest::get_directory_count() const {
+    return directories.size();
+}
+
+void Manifest::set_filter_key(uint64_t p_key) {
+    filter_key = p_key;
+}
+
+uint64_t Manifest::get_filter_key() const {
+    return filter_key;
+}
+
+void Manifest::clear_directories() {
+    directories.clear();
+}
+
+void Manifest::clear() {
+    paths.clear();
+    records.clear();
+    directories.clear();
+    filter_key = 0;
+}
+
+Error Manifest::save(const String& p_path) const {
+    Vector<Record> sorted = _sort(records);
+    Vector<DirectoryRecord> sorted_directories = _sort(directories);
+
+    ManifestHeader header;
+    std::memcpy(header.magic, manifest_magic, sizeof(header.magic));
+    header.record_count = sorted.size();
+    header.directory_count = sorted_directories.size();
+    header.paths_size = paths.size();
+    header.filter_key = filter_key;
+
+    // Write next to the manifest first, so an interrupted save never leaves a truncated manifest behind.
+    String temporary_path = p_path + ".tmp";
+    {
+        FileStreamO file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return Error::FileCantOpen;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(Record));
+        file.write(reinterpret_cast<const char*>(sorted_directories.data()), sorted_directories.size() * sizeof(DirectoryRecord));
+        file.write(paths.data(), paths.size());
+        if (!file.good()) {
+            return Error::Failed;
+        }
+    }
+
+    std::error_code error;
+    FileAccess::rename(temporary_path, p_path, error);
+    return error ? Error::Failed : Error::OK;
+}
+
+Error Manifest::load(const String& p_path) {
+    clear();
+
+    FileStreamI file(p_path, std::ios::binary);
+    if (!file.is_open()) {
+        return Error::FileNotFound;
+    }
+
+    ManifestHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, manifest_magic, sizeof(header.magic)) != 0) {
+        return Error::InvalidData;
+    }
+
+    // Check the sizes against the file before allocating, a damaged header must not request huge buffers.
+    std::error_code error;
+    uint64_t file_size = FileAccess::file_size(p_path, error);
+    if (error || header.record_count > file_size / sizeof(Record) || header.directory_count > file_size / sizeof(DirectoryRecord) || header.paths_size > file_size ||
+        file_size != sizeof(header) + header.record_count * sizeof(Record) + header.directory_count * sizeof(DirectoryRecord) + header.paths_size) {
+        return Error::InvalidData;
+    }
+
+    records.resize(header.record_count);
+    directories.resize(header.directory_count);
+    paths.resize(header.paths_size);
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(Record));
+    file.read(reinterpret_cast<char*>(directories.data()), directories.size() * sizeof(DirectoryRecord));
+    file.read(&paths[0], paths.size());
+    if (!file || !_validate(records) || !_validate(directories)) {
+        clear();
+        return Error::InvalidData;
+    }
+
+    for (const Record& record : records) {
+        if (record.destination + record.destination_length > paths.size()) {
+            clear();
+            return Error::InvalidData;
+        }
+    }
+    for (const DirectoryRecord& record : directories) {
+        // A listing must end with a complete entry, so reading it can never run past its end.
+        if (record.entries + record.entries_length > paths.size() || (record.entries_length > 0 && paths[record.entries + record.entries_length - 1] != '\0')) {
+            clear();
+            return Error::InvalidData;
+        }
+    }
+
+    filter_key = header.filter_key;
+    return Error::OK;
+}
+
+Manifest::Manifest() :
+    filter_key(0) {
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,275 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "error.h"
+
+#include <mutex>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class Manifest
+ * @brief A record of the files packed by a run, used to skip unchanged files on the next run.
+ *
+ * Each entry maps a source path to the destination path it was packed to and the state (size, modification
+ * time and inode) of the source when it was packed. Paths are stored relative to the source and destination
+ * directories of the pack.
+ *
+ * The manifest also caches source directories: the state (modification time, change time and inode) of each
+ * directory together with the entries of its listing that the pack kept, so an unchanged directory does not have
+ * to be listed and filtered again. The listings depend on the filter settings of the pack, which are summarized
+ * by an opaque filter key saved with the manifest.
+ *
+ * The manifest is saved as a flat binary file in native byte order: a header, fixed-size file records and
+ * directory records sorted by source path, then a single buffer holding every path and listing. Loading reads
+ * the file in one pass without building any per-entry structure, and lookups are binary searches over the sorted
+ * records. Entries can be added from several threads at once.
+ */
+class Manifest {
+public:
+    /**
+     * @struct FileState
+     * @brief The state of a source file, compared between runs to detect changes.
+     */
+    struct FileState {
+        uint64_t size; ///< The size of the file in bytes.
+        int64_t mtime; ///< The modification time of the file in nanoseconds.
+        uint64_t inode; ///< The inode of the file, 0 where inodes are not available.
+
+        /**
+         * @brief Check if two states are equal.
+         * @param p_state The state to compare with.
+         * @return `true` if the states are equal, `false` otherwise.
+         */
+        bool operator==(const FileState& p_state) const;
+
+        /**
+         * @brief Constructor for the FileState struct.
+         * @param p_size The size of the file in bytes.
+         * @param p_mtime The modification time of the file in nanoseconds.
+         * @param p_inode The inode of the file.
+         */
+        FileState(uint64_t p_size = 0, int64_t p_mtime = 0, uint64_t p_inode = 0);
+    };
+
+    /**
+     * @struct DirectoryState
+     * @brief The state of a source directory, compared between runs to detect added, removed or renamed entries.
+     */
+    struct DirectoryState {
+        int64_t mtime; ///< The modification time of the directory in nanoseconds.
+        int64_t ctime; ///< The status change time of the directory in nanoseconds, 0 where it is not available.
+        uint64_t inode; ///< The inode of the directory, 0 where inodes are not available.
+
+        /**
+         * @brief Check if two states are equal.
+         * @param p_state The state to compare with.
+         * @return `true` if the states are equal, `false` otherwise.
+         */
+        bool operator==(const DirectoryState& p_state) const;
+
+        /**
+         * @brief Constructor for the DirectoryState struct.
+         * @param p_mtime The modification time of the directory in nanoseconds.
+         * @param p_ctime The status change time of the directory in nanoseconds.
+         * @param p_inode The inode of the directory.
+         */
+        DirectoryState(int64_t p_mtime = 0, int64_t p_ctime = 0, uint64_t p_inode = 0);
+    };
+
+    /**
+     * @struct Listing
+     * @brief The cached listing of a directory.
+     *
+     * The entries are stored one after another, each one a type character followed by the null terminated entry
+     * name: `'d'` for a sub-directory and `'f'` for a file kept by the filter settings.
+     */
+    struct Listing {
+        const char* entries; ///< The entries, valid while the manifest is not modified.
+        size_t length; ///< The length of the entries in bytes.
+        bool ignored; ///< Flag indicating whether the directory contained the ignore file.
+
+        /**
+         * @brief Constructor for the Listing struct.
+         * @param p_entries The entries.
+         * @param p_length The length of the entries in bytes.
+         * @param p_ignored `true` if the directory contained the ignore file.
+         */
+        Listing(const char* p_entries = nullptr, size_t p_length = 0, bool p_ignored = false);
+    };
+
+private:
+    /**
+     * @struct Record
+     * @brief A manifest entry as stored in the manifest file.
+     */
+    struct Record {
+        uint64_t source; ///< The offset of the source path in the path buffer.
+        uint64_t destination; ///< The offset of the destination path in the path buffer.
+        uint32_t source_length; ///< The length of the source path.
+        uint32_t destination_length; ///< The length of the destination path.
+        uint64_t size; ///< The size of the source file.
+        int64_t mtime; ///< The modification time of the source file in nanoseconds.
+        uint64_t inode; ///< The inode of the source file.
+    };
+
+    /**
+     * @struct DirectoryRecord
+     * @brief A cached directory as stored in the manifest file.
+     */
+    struct DirectoryRecord {
+        uint64_t source; ///< The offset of the source path in the path buffer.
+        uint64_t entries; ///< The offset of the listing entries in the path buffer.
+        uint32_t source_length; ///< The length of the source path.
+        uint32_t entries_length; ///< The length of the listing entries.
+        int64_t mtime; ///< The modification time of the directory in nanoseconds.
+        int64_t ctime; ///< The status change time of the directory in nanoseconds.
+        uint64_t inode; ///< The inode of the directory.
+        uint64_t ignored; ///< Non-zero when the directory contained the ignore file.
+    };
+
+    String paths; ///< The buffer holding every path and listing.
+    Vector<Record> records; ///< The file entries, sorted by source path once loaded.
+    Vector<DirectoryRecord> directories; ///< The directory entries, sorted by source path once loaded.
+    uint64_t filter_key; ///< The filter key the directory listings were recorded with.
+    std::mutex mutex; ///< Guards adding entries.
+
+    /**
+     * @brief Compare a path stored in the path buffer with a path.
+     * @param p_offset The offset of the stored path.
+     * @param p_stored_length The length of the stored path.
+     * @param p_path The path characters.
+     * @param p_length The length of the path.
+     * @return A negative value, zero or a positive value when the stored path sorts before, with or after the path.
+     */
+    int _compare(uint64_t p_offset, size_t p_stored_length, const char* p_path, size_t p_length) const;
+
+    /**
+     * @brief Sort records by their source path.
+     * @param p_records The records to sort.
+     * @return The sorted records.
+     */
+    template <typename T>
+    Vector<T> _sort(const Vector<T>& p_records) const;
+
+    /**
+     * @brief Check that records reference the path buffer and are sorted by source path.
+     * @param p_records The records to check.
+     * @return `true` if the records are valid, `false` otherwise.
+     */
+    template <typename T>
+    bool _validate(const Vector<T>& p_records) const;
+
+public:
+    /**
+     * @brief Check if a file is recorded with the same destination and state.
+     *
+     * Only entries present when the manifest was loaded are searched, entries added since are not.
+     *
+     * @param p_source The source path of the file, relative to the source directory.
+     * @param p_source_length The length of the source path.
+     * @param p_destination The destination path of the file, relative to the destination directory.
+     * @param p_destination_length The length of the destination path.
+     * @param p_state The current state of the source file.
+     * @return `true` if the file is recorded with the same destination and state, `false` otherwise.
+     */
+    bool match(const char* p_source, size_t p_source_length, const char* p_destination, size_t p_destination_length, const FileState& p_state) const;
+
+    /**
+     * @brief Add an entry, this function is thread-safe.
+     * @param p_source The source path of the file, relative to the source directory.
+     * @param p_source_length The length of the source path.
+     * @param p_destination The destination path of the file, relative to the destination directory.
+     * @param p_destination_length The length of the destination path.
+     * @param p_state The state of the source file when it was packed.
+     */
+    void add(const char* p_source, size_t p_source_length, const char* p_destination, size_t p_destination_length, const FileState& p_state);
+
+    /**
+     * @brief Find the cached listing of a directory recorded with the same state.
+     *
+     * Only directories present when the manifest was loaded are searched, directories added since are not.
+     *
+     * @param p_source The source path of the directory, relative to the source directory.
+     * @param p_source_length The length of the source path.
+     * @param p_state The current state of the directory.
+     * @param p_listing Receives the cached listing.
+     * @return `true` if the directory is recorded with the same state, `false` otherwise.
+     */
+    bool find_directory(const char* p_source, size_t p_source_length, const DirectoryState& p_state, Listing& p_listing) const;
+
+    /**
+     * @brief Add a directory listing, this function is thread-safe.
+     * @param p_source The source path of the directory, relative to the source directory.
+     * @param p_source_length The length of the source path.
+     * @param p_state The state of the directory when it was listed.
+     * @param p_listing The listing to cache, in the format described by `Listing`.
+     */
+    void add_directory(const char* p_source, size_t p_source_length, const DirectoryState& p_state, const Listing& p_listing);
+
+    /**
+     * @brief Add the entries and cached directories of another manifest whose source paths are not recorded yet.
+     *
+     * A run that packs part of the tree records only the files it visited, merging the manifest it was checked
+     * against keeps the rest of the tree recorded.
+     *
+     * @param p_manifest The manifest to merge, usually the one loaded at the start of the run.
+     */
+    void merge(const Manifest& p_manifest);
+
+    /**
+     * @brief Get the number of file entries.
+     * @return The number of file entries.
+     */
+    size_t get_entry_count() const;
+
+    /**
+     * @brief Get the number of cached directories.
+     * @return The number of cached directories.
+     */
+    size_t get_directory_count() const;
+
+    /**
+     * @brief Set the filter key saved with the directory listings.
+     * @param p_key The filter key.
+     */
+    void set_filter_key(uint64_t p_key);
+
+    /**
+     * @brief Get the filter key the directory listings were recorded with.
+     * @return The filter key.
+     */
+    uint64_t get_filter_key() const;
+
+    /**
+     * @brief Remove every cached directory, keeping the file entries.
+     */
+    void clear_directories();
+
+    /**
+     * @brief Remove every entry and cached directory.
+     */
+    void clear();
+
+    /**
+     * @brief Save the manifest to a file, replacing it atomically.
+     * @param p_path The path of the manifest file.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error save(const String& p_path) const;
+
+    /**
+     * @brief Load the manifest from a file, replacing every entry.
+     * @param p_path The path of the manifest file.
+     * @return An `Error` code indicating the success or failure of the operation, the manifest is empty on failure.
+     */
+    Error load(const String& p_path);
+
+    /**
+     * @brief Constructor for the Manifest class.
+     */
+    Manifest();
+};
+
+PACKER_NAMESPACE_END
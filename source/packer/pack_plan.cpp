@@ -0,0 +1,324 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "pack_plan.h"
+
+#include <cstring>
+
+PACKER_NAMESPACE_BEGIN
+
+static const char* operation_names[] = {
+    "copy",
+    "move",
+    "skip"
+};
+
+static const char* reason_names[] = {
+    "none",
+    "unchanged",
+    "exists",
+    "up to date"
+};
+
+/**
+ * @brief The identifier at the start of every plan file, including the format version.
+ */
+static const char plan_magic[8] = { 'P', 'K', 'P', 'L', 0, 0, 0, 1 };
+
+/**
+ * @struct PlanHeader
+ * @brief The header of a plan file.
+ */
+struct PlanHeader {
+    char magic[8]; ///< The plan identifier.
+    uint64_t record_count; ///< The number of entry records following the header.
+    uint64_t directory_count; ///< The number of directory records following the entry records.
+    uint64_t read_root_size; ///< The size of the source directory following the records.
+    uint64_t write_root_size; ///< The size of the destination directory following the source directory.
+    uint64_t names_size; ///< The size of the name buffer following the destination directory.
+};
+
+PackPlan::Entry::Entry() :
+    operation(Operation::Unknown),
+    reason(Reason::Unknown),
+    size(0),
+    directory(0) {
+}
+
+void PackPlan::_count(const Record& p_record) {
+    counts[p_record.operation] += 1;
+    bytes[p_record.operation] += p_record.size;
+    if (p_record.operation == static_cast<uint8_t>(Operation::Skip)) {
+        skip_counts[p_record.reason] += 1;
+        skip_bytes[p_record.reason] += p_record.size;
+    }
+}
+
+String PackPlan::_get_path(const String& p_root, const DirectoryRecord& p_directory, uint64_t p_name, size_t p_length) const {
+    String path = p_root;
+    if (p_directory.path_length > 0) {
+        path += '/';
+        path.append(names, p_directory.path, p_directory.path_length);
+    }
+    path += '/';
+    path.append(names, p_name, p_length);
+    return path;
+}
+
+String PackPlan::get_operation_name(Operation p_operation) {
+    if (p_operation >= static_cast<Operation>(0) && p_operation < Operation::Max) {
+        return operation_names[static_cast<size_t>(p_operation)];
+    } else {
+        return "unknown";
+    }
+}
+
+String PackPlan::get_reason_name(Reason p_reason) {
+    if (p_reason >= static_cast<Reason>(0) && p_reason < Reason::Max) {
+        return reason_names[static_cast<size_t>(p_reason)];
+    } else {
+        return "unknown";
+    }
+}
+
+void PackPlan::set_roots(const String& p_read_root, const String& p_write_root) {
+    read_root = p_read_root;
+    write_root = p_write_root;
+}
+
+const String& PackPlan::get_read_root() const {
+    return read_root;
+}
+
+const String& PackPlan::get_write_root() const {
+    return write_root;
+}
+
+size_t PackPlan::add_directory(const String& p_path, bool p_create) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    DirectoryRecord record;
+    record.path = names.size();
+    record.path_length = static_cast<uint32_t>(p_path.size());
+    record.create = p_create ? 1 : 0;
+    names += p_path;
+    directories.push_back(record);
+    return directories.size() - 1;
+}
+
+void PackPlan::add(size_t p_directory, const String& p_name, const String& p_write_name, uint64_t p_size, Operation p_operation, Reason p_reason) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Record record;
+    std::memset(&record, 0, sizeof(record));
+    record.name = names.size();
+    record.size = p_size;
+    record.directory = static_cast<uint32_t>(p_directory);
+    record.name_length = static_cast<uint32_t>(p_name.size());
+    record.operation = static_cast<uint8_t>(p_operation);
+    record.reason = static_cast<uint8_t>(p_operation == Operation::Skip ? p_reason : Reason::None);
+    names += p_name;
+    if (p_write_name != p_name) {
+        record.write_name_length = static_cast<uint32_t>(p_write_name.size());
+        names += p_write_name;
+    }
+    records.push_back(record);
+    _count(record);
+}
+
+size_t PackPlan::get_entry_count() const {
+    return records.size();
+}
+
+PackPlan::Entry PackPlan::get_entry(size_t p_index) const {
+    const Record& record = records[p_index];
+    const DirectoryRecord& directory = directories[record.directory];
+
+    Entry entry;
+    entry.operation = static_cast<Operation>(record.operation);
+    entry.reason = static_cast<Reason>(record.reason);
+    entry.size = record.size;
+    entry.directory = record.directory;
+    entry.read_path = _get_path(read_root, directory, record.name, record.name_length);
+    if (record.write_name_length > 0) {
+        entry.write_path = _get_path(write_root, directory, record.name + record.name_length, record.write_name_length);
+    } else {
+        entry.write_path = _get_path(write_root, directory, record.name, record.name_length);
+    }
+    return entry;
+}
+
+size_t PackPlan::get_directory_count() const {
+    return directories.size();
+}
+
+String PackPlan::get_directory_path(size_t p_index) const {
+    const DirectoryRecord& directory = directories[p_index];
+    return names.substr(directory.path, directory.path_length);
+}
+
+String PackPlan::get_directory_write_path(size_t p_index) const {
+    const DirectoryRecord& directory = directories[p_index];
+    if (directory.path_length == 0) {
+        return write_root;
+    }
+    return write_root + "/" + names.substr(directory.path, directory.path_length);
+}
+
+bool PackPlan::get_directory_create(size_t p_index) const {
+    return directories[p_index].create != 0;
+}
+
+void PackPlan::set_directory_create(size_t p_index, bool p_create) {
+    std::lock_guard<std::mutex> lock(mutex);
+    directories[p_index].create = p_create ? 1 : 0;
+}
+
+size_t PackPlan::get_create_count() const {
+    size_t count = 0;
+    for (const DirectoryRecord& directory : directories) {
+        if (directory.create) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+uint64_t PackPlan::get_count(Operation p_operation) const {
+    if (p_operation < static_cast<Operation>(0) || p_operation >= Operation::Max) {
+        return 0;
+    }
+    return counts[static_cast<size_t>(p_operation)];
+}
+
+uint64_t PackPlan::get_bytes(Operation p_operation) const {
+    if (p_operation < static_cast<Operation>(0) || p_operation >= Operation::Max) {
+        return 0;
+    }
+    return bytes[static_cast<size_t>(p_operation)];
+}
+
+uint64_t PackPlan::get_skip_count(Reason p_reason) const {
+    if (p_reason < static_cast<Reason>(0) || p_reason >= Reason::Max) {
+        return 0;
+    }
+    return skip_counts[static_cast<size_t>(p_reason)];
+}
+
+uint64_t PackPlan::get_skip_bytes(Reason p_reason) const {
+    if (p_reason < static_cast<Reason>(0) || p_reason >= Reason::Max) {
+        return 0;
+    }
+    return skip_bytes[static_cast<size_t>(p_reason)];
+}
+
+void PackPlan::clear() {
+    read_root.clear();
+    write_root.clear();
+    names.clear();
+    records.clear();
+    directories.clear();
+    std::memset(counts, 0, sizeof(counts));
+    std::memset(bytes, 0, sizeof(bytes));
+    std::memset(skip_counts, 0, sizeof(skip_counts));
+    std::memset(skip_bytes, 0, sizeof(skip_bytes));
+}
+
+Error PackPlan::save(const String& p_path) const {
+    PlanHeader header;
+    std::memcpy(header.magic, plan_magic, sizeof(header.magic));
+    header.record_count = records.size();
+    header.directory_count = directories.size();
+    header.read_root_size = read_root.size();
+    header.write_root_size = write_root.size();
+    header.names_size = names.size();
+
+    FileStreamO file(p_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return Error::FileCantOpen;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    file.write(reinterpret_cast<const char*>(directories.data()), directories.size() * sizeof(DirectoryRecord));
+    file.write(read_root.data(), read_root.size());
+    file.write(write_root.data(), write_root.size());
+    file.write(names.data(), names.size());
+    return file.good() ? Error::OK : Error::Failed;
+}
+
+Error PackPlan::load(const String& p_path) {
+    clear();
+
+    FileStreamI file(p_path, std::ios::binary);
+    if (!file.is_open()) {
+        return Error::FileNotFound;
+    }
+
+    PlanHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, plan_magic, sizeof(header.magic)) != 0) {
+        return Error::InvalidData;
+    }
+
+    // Check the sizes against the file before allocating, a damaged header must not request huge buffers.
+    std::error_code error;
+    uint64_t file_size = FileAccess::file_size(p_path, error);
+    if (error || header.record_count > file_size / sizeof(Record) || header.directory_count > file_size / sizeof(DirectoryRecord) ||
+        header.read_root_size > file_size || header.write_root_size > file_size || header.names_size > file_size ||
+        file_size != sizeof(header) + header.record_count * sizeof(Record) + header.directory_count * sizeof(DirectoryRecord) + header.read_root_size + header.write_root_size + header.names_size) {
+        return Error::InvalidData;
+    }
+
+    records.resize(header.record_count);
+    directories.resize(header.directory_count);
+    read_root.resize(header.read_root_size);
+    write_root.resize(header.write_root_size);
+    names.resize(header.names_size);
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(Record));
+    file.read(reinterpret_cast<char*>(directories.data()), directories.size() * sizeof(DirectoryRecord));
+    file.read(&read_root[0], read_root.size());
+    file.read(&write_root[0], write_root.size());
+    file.read(&names[0], names.size());
+    if (!file) {
+        clear();
+        return Error::InvalidData;
+    }
+
+    for (const DirectoryRecord& directory : directories) {
+        if (directory.path + directory.path_length > names.size()) {
+            clear();
+            return Error::InvalidData;
+        }
+    }
+    for (const Record& record : records) {
+        if (record.directory >= directories.size() || record.name + record.name_length + record.write_name_length > names.size() ||
+            record.operation >= static_cast<uint8_t>(Operation::Max) || record.reason >= static_cast<uint8_t>(Reason::Max)) {
+            clear();
+            return Error::InvalidData;
+        }
+        _count(record);
+    }
+
+    return Error::OK;
+}
+
+PackPlan& PackPlan::operator=(const PackPlan& p_plan) {
+    read_root = p_plan.read_root;
+    write_root = p_plan.write_root;
+    names = p_plan.names;
+    records = p_plan.records;
+    directories = p_plan.directories;
+    std::memcpy(counts, p_plan.counts, sizeof(counts));
+    std::memcpy(bytes, p_plan.bytes, sizeof(bytes));
+    std::memcpy(skip_counts, p_plan.skip_counts, sizeof(skip_counts));
+    std::memcpy(skip_bytes, p_plan.skip_bytes, sizeof(skip_bytes));
+    return *this;
+}
+
+PackPlan::PackPlan(const PackPlan& p_plan) {
+    *this = p_plan;
+}
+
+PackPlan::PackPlan() {
+    clear();
+}
+
+PACKER_NAMESPACE_END
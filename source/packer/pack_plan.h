@@ -0,0 +1,296 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "error.h"
+
+#include <mutex>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class PackPlan
+ * @brief The operations a pack would perform, recorded without writing anything.
+ *
+ * A plan holds one entry per file the pack considered: the operation that would write it, or the reason it would be
+ * skipped, with the size of its source. It also holds the destination directories that would have to be created.
+ * Totals of files and bytes per operation and per skip reason are kept as entries are added.
+ *
+ * Entries are fixed-size records referring to their directory by index, so each path is stored once: directory paths
+ * relative to the pack directories (directories keep their names when packed), and file names with the destination
+ * name only stored when it differs from the source name. Entries can be added from several threads at once.
+ *
+ * A plan is saved as a flat binary file in native byte order: a header, the entry and directory records, the pack
+ * directories, then the buffer holding every name.
+ */
+class PackPlan {
+public:
+    /**
+     * @enum Operation
+     * @brief Enumeration defining what a pack does with a file.
+     */
+    enum class Operation {
+        Unknown = -1, ///< An unknown operation.
+        Copy,         ///< The file is copied to its destination.
+        Move,         ///< The file is moved to its destination.
+        Skip,         ///< The file is skipped, for the reason of the entry.
+        Max           ///< The maximum value for the Operation enumeration.
+    };
+
+    /**
+     * @enum Reason
+     * @brief Enumeration defining why a pack skips a file.
+     */
+    enum class Reason {
+        Unknown = -1, ///< An unknown reason.
+        None,         ///< The file is not skipped.
+        Unchanged,    ///< The file is unchanged since the last incremental pack.
+        Exists,       ///< The destination exists and overwriting is disabled.
+        UpToDate,     ///< The destination exists and is up to date with the file.
+        Max           ///< The maximum value for the Reason enumeration.
+    };
+
+    /**
+     * @struct Entry
+     * @brief A file of the plan.
+     */
+    struct Entry {
+        Operation operation; ///< The operation performed on the file.
+        Reason reason; ///< The reason the file is skipped.
+        uint64_t size; ///< The size of the source file in bytes.
+        size_t directory; ///< The index of the directory of the file.
+        String read_path; ///< The source file path.
+        String write_path; ///< The destination file path.
+
+        /**
+         * @brief Constructor for the Entry struct.
+         */
+        Entry();
+    };
+
+private:
+    /**
+     * @struct Record
+     * @brief A plan entry as stored in the plan file.
+     */
+    struct Record {
+        uint64_t name; ///< The offset of the source name in the name buffer, the destination name follows it when it differs.
+        uint64_t size; ///< The size of the source file.
+        uint32_t directory; ///< The index of the directory of the file.
+        uint32_t name_length; ///< The length of the source name.
+        uint32_t write_name_length; ///< The length of the destination name, 0 when it is the source name.
+        uint8_t operation; ///< The Operation of the entry.
+        uint8_t reason; ///< The Reason of the entry.
+        uint8_t padding[2]; ///< Unused, always zero.
+    };
+
+    /**
+     * @struct DirectoryRecord
+     * @brief A directory as stored in the plan file.
+     */
+    struct DirectoryRecord {
+        uint64_t path; ///< The offset of the directory path in the name buffer.
+        uint32_t path_length; ///< The length of the directory path, relative to the pack directories.
+        uint32_t create; ///< Non-zero when the destination directory has to be created.
+    };
+
+    String read_root; ///< The source directory of the pack.
+    String write_root; ///< The destination directory of the pack.
+    String names; ///< The buffer holding every name and directory path.
+    Vector<Record> records; ///< The entries, in the order they were added.
+    Vector<DirectoryRecord> directories; ///< The directories, in the order they were added.
+    uint64_t counts[static_cast<size_t>(Operation::Max)]; ///< The number of entries per operation.
+    uint64_t bytes[static_cast<size_t>(Operation::Max)]; ///< The bytes of the entries per operation.
+    uint64_t skip_counts[static_cast<size_t>(Reason::Max)]; ///< The number of skipped entries per reason.
+    uint64_t skip_bytes[static_cast<size_t>(Reason::Max)]; ///< The bytes of the skipped entries per reason.
+    std::mutex mutex; ///< Guards adding entries and directories.
+
+    /**
+     * @brief Add an entry to the totals.
+     * @param p_record The entry.
+     */
+    void _count(const Record& p_record);
+
+    /**
+     * @brief Build the path of a file of the plan.
+     * @param p_root The pack directory the path is in.
+     * @param p_directory The directory of the file.
+     * @param p_name The offset of the name in the name buffer.
+     * @param p_length The length of the name.
+     * @return The path of the file.
+     */
+    String _get_path(const String& p_root, const DirectoryRecord& p_directory, uint64_t p_name, size_t p_length) const;
+
+public:
+    /**
+     * @brief Get a string representation of an Operation enum value.
+     * @param p_operation The Operation enum value.
+     * @return A string representation of the Operation.
+     */
+    static String get_operation_name(Operation p_operation);
+
+    /**
+     * @brief Get a string representation of a Reason enum value.
+     * @param p_reason The Reason enum value.
+     * @return A string representation of the Reason.
+     */
+    static String get_reason_name(Reason p_reason);
+
+    /**
+     * @brief Set the source and destination directories of the pack.
+     * @param p_read_root The source directory.
+     * @param p_write_root The destination directory.
+     */
+    void set_roots(const String& p_read_root, const String& p_write_root);
+
+    /**
+     * @brief Get the source directory of the pack.
+     * @return The source directory.
+     */
+    const String& get_read_root() const;
+
+    /**
+     * @brief Get the destination directory of the pack.
+     * @return The destination directory.
+     */
+    const String& get_write_root() const;
+
+    /**
+     * @brief Add a directory, this function is thread-safe.
+     * @param p_path The path of the directory relative to the pack directories, empty for the pack directories themselves.
+     * @param p_create `true` if the destination directory has to be created.
+     * @return The index of the directory.
+     */
+    size_t add_directory(const String& p_path, bool p_create = false);
+
+    /**
+     * @brief Add an entry, this function is thread-safe.
+     * @param p_directory The index of the directory of the file.
+     * @param p_name The source name of the file.
+     * @param p_write_name The destination name of the file.
+     * @param p_size The size of the source file in bytes.
+     * @param p_operation The operation performed on the file.
+     * @param p_reason The reason the file is skipped, `Reason::None` unless the operation is `Operation::Skip`.
+     */
+    void add(size_t p_directory, const String& p_name, const String& p_write_name, uint64_t p_size, Operation p_operation, Reason p_reason = Reason::None);
+
+    /**
+     * @brief Get the number of entries.
+     * @return The number of entries.
+     */
+    size_t get_entry_count() const;
+
+    /**
+     * @brief Get an entry.
+     * @param p_index The index of the entry.
+     * @return The entry.
+     */
+    Entry get_entry(size_t p_index) const;
+
+    /**
+     * @brief Get the number of directories.
+     * @return The number of directories.
+     */
+    size_t get_directory_count() const;
+
+    /**
+     * @brief Get the path of a directory relative to the pack directories.
+     * @param p_index The index of the directory.
+     * @return The path of the directory, empty for the pack directories themselves.
+     */
+    String get_directory_path(size_t p_index) const;
+
+    /**
+     * @brief Get the destination path of a directory.
+     * @param p_index The index of the directory.
+     * @return The destination path of the directory.
+     */
+    String get_directory_write_path(size_t p_index) const;
+
+    /**
+     * @brief Check if the destination of a directory has to be created.
+     * @param p_index The index of the directory.
+     * @return `true` if the directory has to be created, `false` otherwise.
+     */
+    bool get_directory_create(size_t p_index) const;
+
+    /**
+     * @brief Set whether the destination of a directory has to be created, this function is thread-safe.
+     * @param p_index The index of the directory.
+     * @param p_create `true` if the directory has to be created.
+     */
+    void set_directory_create(size_t p_index, bool p_create);
+
+    /**
+     * @brief Get the number of destination directories to create.
+     * @return The number of directories to create.
+     */
+    size_t get_create_count() const;
+
+    /**
+     * @brief Get the number of entries with an operation.
+     * @param p_operation The operation.
+     * @return The number of entries.
+     */
+    uint64_t get_count(Operation p_operation) const;
+
+    /**
+     * @brief Get the total size of the entries with an operation.
+     * @param p_operation The operation.
+     * @return The total size in bytes.
+     */
+    uint64_t get_bytes(Operation p_operation) const;
+
+    /**
+     * @brief Get the number of entries skipped for a reason.
+     * @param p_reason The reason.
+     * @return The number of entries.
+     */
+    uint64_t get_skip_count(Reason p_reason) const;
+
+    /**
+     * @brief Get the total size of the entries skipped for a reason.
+     * @param p_reason The reason.
+     * @return The total size in bytes.
+     */
+    uint64_t get_skip_bytes(Reason p_reason) const;
+
+    /**
+     * @brief Remove every entry and directory.
+     */
+    void clear();
+
+    /**
+     * @brief Save the plan to a file.
+     * @param p_path The path of the plan file.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error save(const String& p_path) const;
+
+    /**
+     * @brief Load the plan from a file, replacing every entry.
+     * @param p_path The path of the plan file.
+     * @return An `Error` code indicating the success or failure of the operation, the plan is empty on failure.
+     */
+    Error load(const String& p_path);
+
+    /**
+     * @brief Assigns the contents of another PackPlan to this PackPlan.
+     * @param p_plan The PackPlan to copy from.
+     * @return Reference to this PackPlan.
+     */
+    PackPlan& operator=(const PackPlan& p_plan);
+
+    /**
+     * @brief Copy constructor for the PackPlan class.
+     * @param p_plan The PackPlan to copy from.
+     */
+    PackPlan(const PackPlan& p_plan);
+
+    /**
+     * @brief Constructor for the PackPlan class.
+     */
+    PackPlan();
+};
+
+PACKER_NAMESPACE_END
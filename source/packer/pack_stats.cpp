@@ -0,0 +1,87 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "pack_stats.h"
+
+PACKER_NAMESPACE_BEGIN
+
+static const char* counter_names[] = {
+    "files packed",
+    "bytes packed",
+    "files copied",
+    "files split",
+    "sparse files",
+    "hole bytes",
+    "syncs",
+    "files cloned",
+    "files renamed",
+    "files linked",
+    "files unchanged",
+    "directories unchanged",
+    "files up to date",
+    "files verified",
+    "bytes verified",
+    "verify nanoseconds",
+    "files deduplicated",
+    "bytes saved",
+    "files compressed",
+    "bytes compressed",
+    "filesystem copies",
+    "copy_file_range copies",
+    "sendfile copies",
+    "read/write copies",
+    "io_uring copies",
+};
+
+String PackStats::get_counter_name(Counter p_counter) {
+    if (p_counter >= static_cast<Counter>(0) && p_counter < Counter::Max) {
+        return counter_names[static_cast<size_t>(p_counter)];
+    } else {
+        return "unknown";
+    }
+}
+
+PackStats::Counter PackStats::find_counter(const String& p_counter) {
+    for (size_t i = 0; i < static_cast<size_t>(Counter::Max); ++i) {
+        if (p_counter == counter_names[i]) {
+            return static_cast<Counter>(i);
+        }
+    }
+    return Counter::Unknown;
+}
+
+void PackStats::add(Counter p_counter, uint64_t p_value) {
+    if (p_counter < static_cast<Counter>(0) || p_counter >= Counter::Max) {
+        return;
+    }
+    counters[static_cast<size_t>(p_counter)].fetch_add(p_value, std::memory_order_relaxed);
+}
+
+uint64_t PackStats::get(Counter p_counter) const {
+    if (p_counter < static_cast<Counter>(0) || p_counter >= Counter::Max) {
+        return 0;
+    }
+    return counters[static_cast<size_t>(p_counter)].load(std::memory_order_relaxed);
+}
+
+void PackStats::reset() {
+    for (auto& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+PackStats& PackStats::operator=(const PackStats& p_stats) {
+    for (size_t i = 0; i < static_cast<size_t>(Counter::Max); ++i) {
+        counters[i].store(p_stats.counters[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+PackStats::PackStats(const PackStats& p_stats) {
+    *this = p_stats;
+}
+
+PackStats::PackStats() {
+    reset();
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,108 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <cstdint>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class PackStats
+ * @brief Thread-safe counters collected while packing files.
+ */
+class PackStats {
+public:
+    /**
+     * @enum Counter
+     * @brief Enumerates the counters collected while packing.
+     */
+    enum class Counter {
+        Unknown = -1,          ///< An unknown counter.
+        FilesPacked,           ///< Files copied or moved to the destination.
+        BytesPacked,           ///< Bytes of file data written to the destination.
+        FilesCopied,           ///< Files whose data was copied.
+        FilesSplit,            ///< Files whose data was copied in ranges by several threads.
+        FilesSparse,           ///< Files whose holes were skipped instead of written.
+        HoleBytes,             ///< Bytes of holes in sparse sources that were skipped instead of written.
+        Syncs,                 ///< Copies flushed to their device one at a time, and syncs of the whole destination filesystem.
+        FilesCloned,           ///< Files cloned with FICLONE.
+        FilesRenamed,          ///< Files moved with a rename.
+        FilesLinked,           ///< Files hard linked to another destination with the same content.
+        FilesUnchanged,        ///< Files skipped because they are unchanged since the last pack.
+        DirectoriesUnchanged,  ///< Directories walked from their cached listing instead of being listed.
+        FilesUpToDate,         ///< Files skipped because their existing destination was up to date.
+        FilesVerified,         ///< Copies read back and checked against their sources.
+        BytesVerified,         ///< Bytes of file data checked against their sources.
+        VerifyNanoseconds,     ///< Time spent checksumming and reading back copies, summed over every thread.
+        FilesDeduplicated,     ///< Files linked or cloned to another destination with the same content instead of being copied.
+        BytesSaved,            ///< Bytes of file data not written because their file was deduplicated.
+        FilesCompressed,       ///< Files stored compressed in an archive.
+        BytesCompressed,       ///< Bytes stored in an archive for the compressed files.
+        FilesystemCopies,      ///< Files copied with std::filesystem::copy_file.
+        CopyFileRangeCopies,   ///< Files copied with copy_file_range.
+        SendfileCopies,        ///< Files copied with sendfile.
+        ReadWriteCopies,       ///< Files copied with a read/write loop.
+        IoUringCopies,         ///< Files copied with io_uring.
+        Max                    ///< The maximum value for the Counter enumeration.
+    };
+
+private:
+    std::atomic<uint64_t> counters[static_cast<size_t>(Counter::Max)]; ///< The counter values.
+
+public:
+    /**
+     * @brief Get a string representation of a Counter enum value.
+     * @param p_counter The Counter enum value.
+     * @return A string representation of the Counter.
+     */
+    static String get_counter_name(Counter p_counter);
+
+    /**
+     * @brief Find a Counter enum value based on its string representation.
+     * @param p_counter The string representation of the Counter.
+     * @return The corresponding Counter enum value.
+     */
+    static Counter find_counter(const String& p_counter);
+
+    /**
+     * @brief Add to a counter.
+     * @param p_counter The counter to add to.
+     * @param p_value The value to add.
+     */
+    void add(Counter p_counter, uint64_t p_value = 1);
+
+    /**
+     * @brief Get the value of a counter.
+     * @param p_counter The counter to get.
+     * @return The value of the counter.
+     */
+    uint64_t get(Counter p_counter) const;
+
+    /**
+     * @brief Reset every counter to zero.
+     */
+    void reset();
+
+    /**
+     * @brief Assigns the counter values of another PackStats to this PackStats.
+     * @param p_stats The PackStats to copy from.
+     * @return Reference to this PackStats.
+     */
+    PackStats& operator=(const PackStats& p_stats);
+
+    /**
+     * @brief Copy constructor for the PackStats class.
+     * @param p_stats The PackStats to copy from.
+     */
+    PackStats(const PackStats& p_stats);
+
+    /**
+     * @brief Constructor for the PackStats class, all counters start at zero.
+     */
+    PackStats();
+};
+
+PACKER_NAMESPACE_END
@@ -2,6 +2,19 @@
 
 #include "packer.h"
 
+#include <cstring>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <ctime>
+#endif // __linux__
+
 PACKER_NAMESPACE_BEGIN
 
 static const char* pack_mode_names[] = {
@@ -11,6 +24,71 @@ static const char* pack_mode_names[] = {
 };
 
 static Packer::Callback callback = nullptr;
+static std::mutex callback_mutex;
+
+#ifdef __linux__
+/**
+ * @brief The number of source directories held open by the POSIX traversal, across every pack of the process.
+ */
+static std::atomic<size_t> open_directory_count(0);
+
+/**
+ * @brief Gets how many source directories the POSIX traversal may hold open at once.
+ *
+ * Each open directory holds its source and, once created, its destination, so a quarter of the soft descriptor
+ * limit leaves half of it for the files being copied and the rest of the process.
+ *
+ * @return The number of directories.
+ */
+static size_t get_open_directory_limit() {
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) {
+        return SIZE_MAX;
+    }
+    return static_cast<size_t>(limit.rlim_cur / 4);
+}
+#endif // __linux__
+
+Packer::Directory::Directory(const String& p_write_path, const std::shared_ptr<Directory>& p_parent, const String& p_name) :
+    write_path(p_write_path),
+    created(false),
+    parent(p_parent),
+    name(p_name),
+    read_fd(-1),
+    write_fd(-1),
+    synced(false),
+    indexed(false),
+    plan_index(SIZE_MAX),
+    planned(false) {
+}
+
+Packer::Directory::~Directory() {
+#ifdef __linux__
+    if (read_fd >= 0) {
+        ::close(read_fd);
+        --open_directory_count;
+    }
+    if (write_fd >= 0) {
+        ::close(write_fd);
+    }
+#endif // __linux__
+}
+
+Packer::File::File() :
+    method(FileCopy::Method::None),
+    bytes(0),
+    state_valid(false),
+    matched(false) {
+}
+
+Packer::File::File(const String& p_read_path, const std::shared_ptr<Directory>& p_directory) :
+    read_path(p_read_path),
+    directory(p_directory),
+    method(FileCopy::Method::None),
+    bytes(0),
+    state_valid(false),
+    matched(false) {
+}
 
 String Packer::get_pack_mode_name(PackMode p_mode) {
     if (p_mode >= static_cast<PackMode>(0) && p_mode < PackMode::Max) {
@@ -52,225 +130,1930 @@ Packer::ExtensionAdjust Packer::find_extension_adjust(const String& p_adjust) {
     return ExtensionAdjust::Unknown;
 }
 
-void Packer::_pack_files(const String& p_read_path, const String& p_write_path) {
-#ifdef IGNORE_FILE_ENABLED
-    if (ignore_file_enabled) {
-        if (FileAccess::is_directory(p_read_path) == true) {
-            if (FileAccess::exists(p_read_path + "/" + ignore_file_name)) {
-                return;
-            }
-        }
+static const char* traversal_names[] = {
+    "filesystem",
+    "posix"
+};
+
+String Packer::get_traversal_name(Traversal p_traversal) {
+    if (p_traversal >= static_cast<Traversal>(0) && p_traversal < Traversal::Max) {
+        return traversal_names[static_cast<size_t>(p_traversal)];
+    } else {
+        return "unknown";
+    }
+}
+
+Packer::Traversal Packer::find_traversal(const String& p_traversal) {
+    for (size_t i = 0; i < static_cast<size_t>(Traversal::Max); ++i) {
+        if (p_traversal == traversal_names[i]) {
+            return static_cast<Traversal>(i);
+        }
+    }
+    return Traversal::Unknown;
+}
+
+static const char* dedup_mode_names[] = {
+    "none",
+    "hard_link",
+    "reflink"
+};
+
+static const char* output_mode_names[] = {
+    "directory",
+    "archive",
+    "tar"
+};
+
+static const char* durability_names[] = {
+    "none",
+    "file",
+    "batch",
+    "end"
+};
+
+String Packer::get_output_mode_name(OutputMode p_mode) {
+    if (p_mode >= static_cast<OutputMode>(0) && p_mode < OutputMode::Max) {
+        return output_mode_names[static_cast<size_t>(p_mode)];
+    } else {
+        return "unknown";
+    }
+}
+
+Packer::OutputMode Packer::find_output_mode(const String& p_mode) {
+    for (size_t i = 0; i < static_cast<size_t>(OutputMode::Max); ++i) {
+        if (p_mode == output_mode_names[i]) {
+            return static_cast<OutputMode>(i);
+        }
+    }
+    return OutputMode::Unknown;
+}
+
+String Packer::get_durability_name(Durability p_durability) {
+    if (p_durability >= static_cast<Durability>(0) && p_durability < Durability::Max) {
+        return durability_names[static_cast<size_t>(p_durability)];
+    } else {
+        return "unknown";
+    }
+}
+
+Packer::Durability Packer::find_durability(const String& p_durability) {
+    for (size_t i = 0; i < static_cast<size_t>(Durability::Max); ++i) {
+        if (p_durability == durability_names[i]) {
+            return static_cast<Durability>(i);
+        }
+    }
+    return Durability::Unknown;
+}
+
+String Packer::get_dedup_mode_name(DedupMode p_mode) {
+    if (p_mode >= static_cast<DedupMode>(0) && p_mode < DedupMode::Max) {
+        return dedup_mode_names[static_cast<size_t>(p_mode)];
+    } else {
+        return "unknown";
+    }
+}
+
+Packer::DedupMode Packer::find_dedup_mode(const String& p_mode) {
+    for (size_t i = 0; i < static_cast<size_t>(DedupMode::Max); ++i) {
+        if (p_mode == dedup_mode_names[i]) {
+            return static_cast<DedupMode>(i);
+        }
+    }
+    return DedupMode::Unknown;
+}
+
+/**
+ * @brief How long before the start of a pack a directory must have last changed for its listing to be cached.
+ *
+ * Directory times are truncated to the granularity of the filesystem (up to two seconds on FAT) and taken from
+ * a clock that can lag behind the current time, so an entry added just after a directory was listed could leave
+ * its times unchanged.
+ */
+static constexpr int64_t directory_cache_margin = 2000000000;
+
+/**
+ * @brief The most files each thread keeps for reuse, enough for the largest batch.
+ */
+static constexpr size_t spare_file_limit = 256;
+
+/**
+ * @brief Appends an entry to a directory listing cached in the manifest.
+ * @param p_listing The listing.
+ * @param p_type The type of the entry, `'d'` for a sub-directory or `'f'` for a file.
+ * @param p_path The path of the entry, only its name is appended.
+ */
+static void append_listing_entry(String& p_listing, char p_type, const String& p_path) {
+    p_listing.push_back(p_type);
+    p_listing.append(p_path, p_path.find_last_of('/') + 1, String::npos);
+    p_listing.push_back('\0');
+}
+
+#ifdef __linux__
+/**
+ * @brief The size of the buffer filled by each getdents64 call.
+ */
+static constexpr size_t directory_buffer_size = 1 << 16;
+
+/**
+ * @struct LinuxDirent64
+ * @brief The record layout returned by the getdents64 system call.
+ */
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+/**
+ * @struct DirectoryEntry
+ * @brief An entry listed from a directory.
+ */
+struct DirectoryEntry {
+    size_t name; ///< The offset of the null terminated entry name in the name buffer.
+    bool directory; ///< Flag indicating whether the entry is a directory, following symbolic links.
+};
+
+static void throw_directory_error(const String& p_path, int p_error) {
+    throw FileAccess::filesystem_error("cannot open directory", p_path, std::error_code(p_error, std::generic_category()));
+}
+
+/**
+ * @brief Lists an open directory with large getdents64 batches, classifying entries from their d_type.
+ *
+ * Only entries the filesystem does not type (DT_UNKNOWN) and symbolic links, which are followed like
+ * std::filesystem::is_directory does, cost an extra statx call.
+ *
+ * @param p_fd The open directory, it is read from its current offset.
+ * @param p_ignore_name The name of the ignore file, or nullptr.
+ * @param p_names Receives the entry names.
+ * @param p_entries Receives the entries, except "." and "..".
+ * @param p_ignored Set when the listing contains the ignore file.
+ * @return 0 on success, an errno value otherwise.
+ */
+static int list_directory(int p_fd, const char* p_ignore_name, Vector<char>& p_names, Vector<DirectoryEntry>& p_entries, bool& p_ignored) {
+    static thread_local Vector<char> buffer(directory_buffer_size);
+
+    while (true) {
+        long read = ::syscall(SYS_getdents64, p_fd, buffer.data(), buffer.size());
+        if (read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno;
+        }
+        if (read == 0) {
+            return 0;
+        }
+
+        for (long offset = 0; offset < read;) {
+            const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+            offset += record->d_reclen;
+
+            const char* name = record->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (p_ignore_name && std::strcmp(name, p_ignore_name) == 0) {
+                p_ignored = true;
+            }
+
+            bool directory = record->d_type == DT_DIR;
+            if (record->d_type == DT_UNKNOWN || record->d_type == DT_LNK) {
+                struct statx entry_stat;
+                directory = ::statx(p_fd, name, AT_STATX_SYNC_AS_STAT, STATX_TYPE, &entry_stat) == 0 && S_ISDIR(entry_stat.stx_mode);
+            }
+
+            p_entries.push_back({ p_names.size(), directory });
+            p_names.insert(p_names.end(), name, name + std::strlen(name) + 1);
+        }
+    }
+}
+#endif // __linux__
+
+void Packer::_pack_files(const String& p_read_path, const String& p_write_path, ThreadPool* p_pool, FileQueue* p_queue) {
+    Manifest::DirectoryState state;
+    Manifest::Listing listing;
+    bool listed = false;
+    bool cache = false;
+    if (incremental_enabled && _get_directory_state(p_read_path, -1, state)) {
+        listed = _find_listing(p_read_path, state, listing);
+        cache = !listed;
+    }
+
+#ifdef IGNORE_FILE_ENABLED
+    if (ignore_file_enabled && !listed) {
+        if (FileAccess::is_directory(p_read_path) == true) {
+            if (FileAccess::exists(p_read_path + "/" + ignore_file_name)) {
+                if (cache) {
+                    _cache_listing(p_read_path, state, Manifest::Listing(nullptr, 0, true));
+                }
+                return;
+            }
+        }
+    }
+#endif //IGNORE_FILE_ENABLED
+
+    if (listed && listing.ignored) {
+        return;
+    }
+
+    static thread_local PathBuilder builder;
+
+    std::shared_ptr<Directory> directory = std::make_shared<Directory>(p_write_path);
+    size_t batch_size = FileCopy::get_batch_size(copy_engine);
+    Vector<File> batch;
+    batch.reserve(batch_size);
+    String entries;
+
+    auto pack_entry = [&](const char* p_name, bool p_is_directory, bool p_matched) {
+        builder.assign(p_read_path);
+        builder.push(p_name);
+        const String& _read_path = builder.get_path();
+
+        if (p_is_directory) {
+            if (cache) {
+                append_listing_entry(entries, 'd', _read_path);
+            }
+            String directory_read_path = _read_path;
+            String directory_write_path = p_write_path + "/" + p_name;
+            if (p_pool) {
+                p_pool->push([this, directory_read_path, directory_write_path, p_pool, p_queue]() {
+                    _pack_files(directory_read_path, directory_write_path, p_pool, p_queue);
+                });
+            } else {
+                _pack_files(directory_read_path, directory_write_path, nullptr, p_queue);
+            }
+        } else {
+            // In incremental mode the pack mode is applied while listing, so only kept files are cached.
+            if (incremental_enabled && !p_matched && !_match_file(_read_path)) {
+                return;
+            }
+            if (cache) {
+                append_listing_entry(entries, 'f', _read_path);
+            }
+            File file = _take_file(builder, directory);
+            file.matched = incremental_enabled;
+            if (p_queue) {
+                p_queue->push(std::move(file));
+            } else if (_filter_file(file)) {
+                batch.push_back(std::move(file));
+                if (batch.size() >= batch_size) {
+                    _pack_batch(batch, move_files);
+                }
+            } else {
+                _recycle_file(file);
+            }
+        }
+    };
+
+    if (listed) {
+        for (const char* entry = listing.entries; entry < listing.entries + listing.length; entry += std::strlen(entry) + 1) {
+            if (entry[0] != '\0' && entry[1] != '\0') {
+                pack_entry(entry + 1, entry[0] == 'd', true);
+            }
+        }
+    } else {
+        for (auto& path : FileAccess::directory_iterator(p_read_path)) {
+#ifdef _WIN32
+            String name = path.path().filename().string();
+            pack_entry(name.c_str(), path.is_directory(), false);
+#else
+            // The native path already uses forward slashes, take the name from it instead of converting the path.
+            const String& native = path.path().native();
+            pack_entry(native.c_str() + native.find_last_of('/') + 1, path.is_directory(), false);
+#endif // _WIN32
+        }
+    }
+
+    if (cache) {
+        _cache_listing(p_read_path, state, Manifest::Listing(entries.data(), entries.size()));
+    }
+
+    if (!batch.empty()) {
+        _pack_batch(batch, move_files);
+    }
+}
+
+#ifdef __linux__
+void Packer::_pack_directory(const String& p_read_path, const std::shared_ptr<Directory>& p_directory, ThreadPool* p_pool, FileQueue* p_queue) {
+    const char* ignore_name = nullptr;
+#ifdef IGNORE_FILE_ENABLED
+    if (ignore_file_enabled) {
+        ignore_name = ignore_file_name.c_str();
+    }
+#endif //IGNORE_FILE_ENABLED
+
+    // Directories are opened once their listing starts, so queued directories hold no descriptors. Once the share
+    // of the descriptor limit set aside for directories is used, a directory is only open for its listing and its
+    // files are copied by path.
+    std::shared_ptr<Directory> parent = p_directory->parent.lock();
+    int read_fd;
+    if (parent && parent->read_fd >= 0) {
+        read_fd = ::openat(parent->read_fd, p_directory->name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    } else {
+        read_fd = ::open(p_read_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    parent.reset();
+    if (read_fd < 0) {
+        throw_directory_error(p_read_path, errno);
+    }
+    if (open_directory_count.fetch_add(1) < get_open_directory_limit()) {
+        p_directory->read_fd = read_fd;
+    } else {
+        --open_directory_count;
+    }
+
+    Manifest::DirectoryState state;
+    Manifest::Listing listing;
+    bool listed = false;
+    bool cache = false;
+    if (incremental_enabled && _get_directory_state(p_read_path, read_fd, state)) {
+        listed = _find_listing(p_read_path, state, listing);
+        cache = !listed;
+    }
+
+    Vector<char> names;
+    Vector<DirectoryEntry> entries;
+    bool ignored = listed && listing.ignored;
+
+    if (!listed) {
+        int error = list_directory(read_fd, ignore_name, names, entries, ignored);
+        if (p_directory->read_fd != read_fd) {
+            ::close(read_fd);
+        }
+        if (error != 0) {
+            throw_directory_error(p_read_path, error);
+        }
+        if (ignored && cache) {
+            _cache_listing(p_read_path, state, Manifest::Listing(nullptr, 0, true));
+        }
+    }
+    if (listed && p_directory->read_fd != read_fd) {
+        ::close(read_fd);
+    }
+    if (ignored) {
+        return;
+    }
+
+    static thread_local PathBuilder builder;
+
+    size_t batch_size = FileCopy::get_batch_size(copy_engine);
+    Vector<File> batch;
+    batch.reserve(batch_size);
+    String cached_entries;
+
+    auto pack_entry = [&](const char* p_name, bool p_is_directory, bool p_matched) {
+        builder.assign(p_read_path);
+        builder.push(p_name);
+        const String& _read_path = builder.get_path();
+
+        if (p_is_directory) {
+            if (cache) {
+                append_listing_entry(cached_entries, 'd', _read_path);
+            }
+            String directory_read_path = _read_path;
+            std::shared_ptr<Directory> directory = std::make_shared<Directory>(p_directory->write_path + "/" + p_name, p_directory, p_name);
+            if (p_pool) {
+                p_pool->push([this, directory_read_path, directory, p_pool, p_queue]() {
+                    _pack_directory(directory_read_path, directory, p_pool, p_queue);
+                });
+            } else {
+                _pack_directory(directory_read_path, directory, nullptr, p_queue);
+            }
+        } else {
+            if (incremental_enabled && !p_matched && !_match_file(_read_path)) {
+                return;
+            }
+            if (cache) {
+                append_listing_entry(cached_entries, 'f', _read_path);
+            }
+            File file = _take_file(builder, p_directory);
+            file.matched = incremental_enabled;
+            if (p_queue) {
+                p_queue->push(std::move(file));
+            } else if (_filter_file(file)) {
+                batch.push_back(std::move(file));
+                if (batch.size() >= batch_size) {
+                    _pack_batch(batch, move_files);
+                }
+            } else {
+                _recycle_file(file);
+            }
+        }
+    };
+
+    if (listed) {
+        for (const char* entry = listing.entries; entry < listing.entries + listing.length; entry += std::strlen(entry) + 1) {
+            if (entry[0] != '\0' && entry[1] != '\0') {
+                pack_entry(entry + 1, entry[0] == 'd', true);
+            }
+        }
+    } else {
+        for (const DirectoryEntry& entry : entries) {
+            pack_entry(names.data() + entry.name, entry.directory, false);
+        }
+    }
+
+    if (cache) {
+        _cache_listing(p_read_path, state, Manifest::Listing(cached_entries.data(), cached_entries.size()));
+    }
+
+    if (!batch.empty()) {
+        _pack_batch(batch, move_files);
+    }
+}
+#endif // __linux__
+
+void Packer::_pack_root(const String& p_read_path, const String& p_write_path, ThreadPool* p_pool, FileQueue* p_queue) {
+#ifdef __linux__
+    if (traversal == Traversal::Posix) {
+        _pack_directory(p_read_path, std::make_shared<Directory>(p_write_path), p_pool, p_queue);
+        return;
+    }
+#endif // __linux__
+
+    _pack_files(p_read_path, p_write_path, p_pool, p_queue);
+}
+
+void Packer::_create_directory(Directory& p_directory) {
+    if (p_directory.created) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(p_directory.mutex);
+    if (p_directory.created) {
+        return;
+    }
+
+#ifdef __linux__
+    if (p_directory.read_fd >= 0) {
+        // A parent that was closed or copied by path is not reopened, the directory is created from its path instead.
+        std::shared_ptr<Directory> parent = p_directory.parent.lock();
+        if (parent) {
+            _create_directory(*parent);
+        }
+        if (parent && parent->write_fd >= 0) {
+            if (::mkdirat(parent->write_fd, p_directory.name.c_str(), 0777) != 0 && errno != EEXIST) {
+                throw FileAccess::filesystem_error("cannot create directory", p_directory.write_path, std::error_code(errno, std::generic_category()));
+            }
+            p_directory.write_fd = ::openat(parent->write_fd, p_directory.name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        } else {
+            FileAccess::create_directories(p_directory.write_path);
+            p_directory.write_fd = ::open(p_directory.write_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+        if (p_directory.write_fd < 0) {
+            throw_directory_error(p_directory.write_path, errno);
+        }
+        p_directory.created = true;
+        return;
+    }
+#endif // __linux__
+
+    FileAccess::create_directories(p_directory.write_path);
+    p_directory.created = true;
+}
+
+bool Packer::_match_file(const String& p_read_path) const {
+    if (pack_mode == PackMode::Everything) {
+        return true;
+    }
+    return extension_matcher.match_path(p_read_path) == (pack_mode == PackMode::Include);
+}
+
+uint64_t Packer::_get_filter_key() const {
+    // FNV-1a over every setting that decides which entries a cached listing keeps.
+    uint64_t key = 14695981039346656037ull;
+    auto hash = [&key](const void* p_data, size_t p_size) {
+        const unsigned char* data = static_cast<const unsigned char*>(p_data);
+        for (size_t i = 0; i < p_size; ++i) {
+            key = (key ^ data[i]) * 1099511628211ull;
+        }
+    };
+
+    int mode = static_cast<int>(pack_mode);
+    hash(&mode, sizeof(mode));
+    hash(&extension_insensitive, sizeof(extension_insensitive));
+    if (pack_mode != PackMode::Everything) {
+        for (const String& extension : extensions) {
+            hash(extension.c_str(), extension.size() + 1);
+        }
+    }
+#ifdef IGNORE_FILE_ENABLED
+    hash(&ignore_file_enabled, sizeof(ignore_file_enabled));
+    if (ignore_file_enabled) {
+        hash(ignore_file_name.c_str(), ignore_file_name.size() + 1);
+    }
+#endif // IGNORE_FILE_ENABLED
+    return key;
+}
+
+bool Packer::_get_directory_state(const String& p_read_path, int p_fd, Manifest::DirectoryState& p_state) const {
+#ifdef __linux__
+    struct stat directory_stat;
+    if ((p_fd >= 0 ? ::fstat(p_fd, &directory_stat) : ::stat(p_read_path.c_str(), &directory_stat)) != 0) {
+        return false;
+    }
+    int64_t mtime = static_cast<int64_t>(directory_stat.st_mtim.tv_sec) * 1000000000 + directory_stat.st_mtim.tv_nsec;
+    int64_t ctime = static_cast<int64_t>(directory_stat.st_ctim.tv_sec) * 1000000000 + directory_stat.st_ctim.tv_nsec;
+    p_state = Manifest::DirectoryState(mtime, ctime, directory_stat.st_ino);
+#else
+    std::error_code error;
+    auto mtime = FileAccess::last_write_time(p_read_path, error);
+    if (error) {
+        return false;
+    }
+    p_state = Manifest::DirectoryState(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count(), 0, 0);
+#endif // __linux__
+    return true;
+}
+
+bool Packer::_find_listing(const String& p_read_path, const Manifest::DirectoryState& p_state, Manifest::Listing& p_listing) {
+    size_t offset = std::min(read_root_length, p_read_path.size());
+    if (previous_manifest.find_directory(p_read_path.c_str() + offset, p_read_path.size() - offset, p_state, p_listing)) {
+        // The listing is still valid, carry it over to the manifest of this pack.
+        manifest.add_directory(p_read_path.c_str() + offset, p_read_path.size() - offset, p_state, p_listing);
+        stats.add(PackStats::Counter::DirectoriesUnchanged);
+        return true;
+    }
+    return false;
+}
+
+void Packer::_cache_listing(const String& p_read_path, const Manifest::DirectoryState& p_state, const Manifest::Listing& p_listing) {
+    if (std::max(p_state.mtime, p_state.ctime) >= pack_time - directory_cache_margin) {
+        return;
+    }
+    size_t offset = std::min(read_root_length, p_read_path.size());
+    manifest.add_directory(p_read_path.c_str() + offset, p_read_path.size() - offset, p_state, p_listing);
+}
+
+bool Packer::_get_source_state(const File& p_file, Manifest::FileState& p_state) const {
+#ifdef __linux__
+    struct stat file_stat;
+    int directory = p_file.directory->read_fd;
+    const char* name = directory >= 0 ? p_file.read_path.c_str() + p_file.read_path.find_last_of('/') + 1 : p_file.read_path.c_str();
+    if (::fstatat(directory >= 0 ? directory : AT_FDCWD, name, &file_stat, 0) != 0) {
+        return false;
+    }
+    p_state = Manifest::FileState(file_stat.st_size, static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec, file_stat.st_ino);
+#else
+    std::error_code error;
+    uint64_t size = FileAccess::file_size(p_file.read_path, error);
+    if (error) {
+        return false;
+    }
+    auto mtime = FileAccess::last_write_time(p_file.read_path, error);
+    if (error) {
+        return false;
+    }
+    p_state = Manifest::FileState(size, std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count(), 0);
+#endif // __linux__
+    return true;
+}
+
+bool Packer::_is_indexed(Directory& p_directory, const char* p_name) const {
+    std::lock_guard<std::mutex> lock(p_directory.index_mutex);
+
+    if (p_directory.indexed == false) {
+#ifdef __linux__
+        int fd = ::open(p_directory.write_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            Vector<char> names;
+            Vector<DirectoryEntry> entries;
+            bool ignored = false;
+            int error = list_directory(fd, nullptr, names, entries, ignored);
+            ::close(fd);
+            if (error != 0) {
+                throw_directory_error(p_directory.write_path, error);
+            }
+            for (const DirectoryEntry& entry : entries) {
+                p_directory.index.insert(names.data() + entry.name);
+            }
+        } else if (errno != ENOENT) {
+            throw_directory_error(p_directory.write_path, errno);
+        }
+#else
+        if (FileAccess::is_directory(p_directory.write_path)) {
+            for (auto& path : FileAccess::directory_iterator(p_directory.write_path)) {
+                p_directory.index.insert(path.path().filename().string());
+            }
+        }
+#endif // __linux__
+        p_directory.indexed = true;
+    }
+
+    // Look the name up through a reused key rather than a temporary string.
+    static thread_local String key;
+    key.assign(p_name);
+    return p_directory.index.count(key) > 0;
+}
+
+Vector<Packer::File>& Packer::_get_spare_files() {
+    static thread_local Vector<File> files;
+    return files;
+}
+
+Packer::File Packer::_take_file(const PathBuilder& p_read_path, const std::shared_ptr<Directory>& p_directory) {
+    Vector<File>& spare = _get_spare_files();
+    File file;
+    if (!spare.empty()) {
+        file = std::move(spare.back());
+        spare.pop_back();
+    }
+    p_read_path.copy_to(file.read_path);
+    file.directory = p_directory;
+    return file;
+}
+
+void Packer::_recycle_file(File& p_file) {
+    Vector<File>& spare = _get_spare_files();
+    if (spare.size() >= spare_file_limit) {
+        return;
+    }
+    spare.push_back(std::move(p_file));
+
+    // Only the capacity of the paths is reused, the directory is released so its descriptors can close.
+    File& file = spare.back();
+    file.read_path.clear();
+    file.write_path.clear();
+    file.directory.reset();
+    file.method = FileCopy::Method::None;
+    file.bytes = 0;
+    file.state_valid = false;
+    file.matched = false;
+}
+
+void Packer::_recycle_files(Vector<File>& p_files, size_t p_offset) {
+    for (size_t i = p_offset; i < p_files.size(); ++i) {
+        _recycle_file(p_files[i]);
+    }
+    p_files.resize(p_offset);
+}
+
+void Packer::_pack_batch(Vector<File>& p_files, bool p_move) {
+    if (plan_target) {
+        FileCopy::Options options = _get_copy_options();
+        PackPlan::Operation operation = p_move ? PackPlan::Operation::Move : PackPlan::Operation::Copy;
+        for (File& file : p_files) {
+            if (overwrite_files && FileCopy::is_destination_up_to_date(file.read_path, file.write_path, options)) {
+                _plan_file(file, PackPlan::Operation::Skip, PackPlan::Reason::UpToDate);
+            } else {
+                _plan_file(file, operation);
+            }
+        }
+        _recycle_files(p_files);
+        return;
+    }
+
+    if (archive_target || tar_target) {
+        _archive_files(p_files);
+        _recycle_files(p_files);
+        return;
+    }
+
+    std::exception_ptr exception = _copy_files(p_files, p_move);
+    _finish_files(p_files, p_move);
+    _recycle_files(p_files);
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+bool Packer::_filter_file(File& p_file) {
+    const String& _read_path = p_file.read_path;
+
+    if (!p_file.matched && !_match_file(_read_path)) {
+        return false;
+    }
+
+    static thread_local PathBuilder builder;
+    builder.assign(p_file.directory->write_path);
+    builder.push(_read_path.c_str() + _read_path.find_last_of('/') + 1);
+
+    if (suffix_enabled) {
+        builder.remove_suffix(suffix_string);
+    }
+
+    if (extension_adjust != ExtensionAdjust::Default) {
+        builder.adjust_extension(extension_adjust == ExtensionAdjust::Upper);
+    }
+
+    String& _write_path = p_file.write_path;
+    builder.copy_to(_write_path);
+
+    if (incremental_enabled) {
+        p_file.state_valid = _get_source_state(p_file, p_file.state);
+        if (p_file.state_valid) {
+            const char* source = _read_path.c_str() + read_root_length;
+            size_t source_length = _read_path.size() - read_root_length;
+            const char* destination = _write_path.c_str() + write_root_length;
+            size_t destination_length = _write_path.size() - write_root_length;
+            if (previous_manifest.match(source, source_length, destination, destination_length, p_file.state)) {
+                manifest.add(source, source_length, destination, destination_length, p_file.state);
+                stats.add(PackStats::Counter::FilesUnchanged);
+                if (plan_target) {
+                    _plan_file(p_file, PackPlan::Operation::Skip, PackPlan::Reason::Unchanged);
+                }
+                return false;
+            }
+        }
+    }
+
+    if (overwrite_files == false && archive_target == nullptr && tar_target == nullptr && _destination_exists(p_file)) {
+        if (plan_target) {
+            _plan_file(p_file, PackPlan::Operation::Skip, PackPlan::Reason::Exists);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool Packer::_destination_exists(File& p_file) {
+    const String& _write_path = p_file.write_path;
+    const char* write_name = _write_path.c_str() + _write_path.find_last_of('/') + 1;
+    if (destination_index_enabled) {
+        return _is_indexed(*p_file.directory, write_name);
+    }
+#ifdef __linux__
+    // The destination directory is open once it has been created, resolve the file relative to it.
+    const Directory& directory = *p_file.directory;
+    if (directory.created && directory.write_fd >= 0) {
+        return ::faccessat(directory.write_fd, write_name, F_OK, 0) == 0;
+    }
+    return ::faccessat(AT_FDCWD, _write_path.c_str(), F_OK, 0) == 0;
+#else
+    return FileAccess::exists(_write_path);
+#endif // __linux__
+}
+
+FileCopy::Options Packer::_get_copy_options() const {
+    FileCopy::Options options(copy_engine, clone_files);
+    options.overwrite = overwrite_files;
+    options.quick_check = quick_check_enabled;
+    options.quick_check_tolerance = static_cast<int64_t>(quick_check_tolerance) * 1000000;
+    options.preserve_times = preserve_times;
+    options.verify = verify_files;
+    options.split_size = static_cast<uint64_t>(split_copy_size) << 20;
+    options.sync = durability == Durability::File;
+    // Destinations linked by a deduplicating run are replaced on their own, whatever the current dedup mode.
+    options.break_links = true;
+    return options;
+}
+
+void Packer::_plan_file(File& p_file, PackPlan::Operation p_operation, PackPlan::Reason p_reason) {
+    if (!p_file.state_valid) {
+        p_file.state_valid = _get_source_state(p_file, p_file.state);
+    }
+
+    Directory& directory = *p_file.directory;
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(directory.mutex);
+        if (directory.plan_index == SIZE_MAX) {
+            const String& write_path = directory.write_path;
+            directory.plan_index = plan_target->add_directory(write_path.size() > write_root_length ? write_path.substr(write_root_length) : String());
+        }
+        if (p_operation != PackPlan::Operation::Skip && !directory.planned) {
+            directory.planned = true;
+            plan_target->set_directory_create(directory.plan_index, !FileAccess::is_directory(directory.write_path));
+        }
+        index = directory.plan_index;
+    }
+
+    const String& read_path = p_file.read_path;
+    const String& write_path = p_file.write_path;
+    plan_target->add(index, read_path.substr(read_path.find_last_of('/') + 1), write_path.substr(write_path.find_last_of('/') + 1), p_file.state_valid ? p_file.state.size : 0, p_operation, p_reason);
+}
+
+void Packer::_plan_directories(PackPlan& p_plan) const {
+    std::unordered_map<String, size_t> indices;
+    size_t count = p_plan.get_directory_count();
+    for (size_t i = 0; i < count; ++i) {
+        indices[p_plan.get_directory_path(i)] = i;
+    }
+
+    // Directories are created with their parents, walk up from each one until a parent exists or is already flagged.
+    for (size_t i = 0; i < count; ++i) {
+        if (!p_plan.get_directory_create(i)) {
+            continue;
+        }
+        String path = p_plan.get_directory_path(i);
+        while (!path.empty()) {
+            size_t separator = path.find_last_of('/');
+            path = separator == String::npos ? String() : path.substr(0, separator);
+            String write_path = path.empty() ? p_plan.get_write_root() : p_plan.get_write_root() + "/" + path;
+
+            auto it = indices.find(path);
+            if (it != indices.end() && p_plan.get_directory_create(it->second)) {
+                break;
+            }
+            if (FileAccess::is_directory(write_path)) {
+                break;
+            }
+            if (it != indices.end()) {
+                p_plan.set_directory_create(it->second, true);
+            } else {
+                indices[path] = p_plan.add_directory(path, true);
+            }
+        }
+    }
+}
+
+bool Packer::_deduplicate_file(File& p_file, FileCopy::Result& p_result) {
+    if (!p_file.state_valid) {
+        p_file.state_valid = _get_source_state(p_file, p_file.state);
+        if (!p_file.state_valid) {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    if (FileAccess::exists(p_file.write_path, error) || error) {
+        if (error || !overwrite_files || FileAccess::hard_link_count(p_file.write_path, error) < 2 || error) {
+            return false;
+        }
+        // Only a destination the copy rules would replace is compared, its links are broken if it differs.
+        if (FileAccess::file_size(p_file.write_path, error) != p_file.state.size || error || FileCopy::is_destination_up_to_date(p_file.read_path, p_file.write_path, _get_copy_options())) {
+            return false;
+        }
+        if (!DedupIndex::compare_files(p_file.read_path, p_file.write_path, p_file.state.size)) {
+            return false;
+        }
+        p_result = FileCopy::Result();
+        return true;
+    }
+
+    String target;
+    if (!dedup_index.find(p_file.read_path, p_file.state.size, target)) {
+        return false;
+    }
+
+    if (dedup_mode == DedupMode::HardLink) {
+        FileAccess::create_hard_link(target, p_file.write_path, error);
+        if (error) {
+            return false;
+        }
+        p_result = FileCopy::Result();
+        p_result.method = FileCopy::Method::Link;
+        p_result.bytes = p_file.state.size;
+        return true;
+    }
+
+    if (!FileCopy::clone(target, p_file.write_path, p_result)) {
+        return false;
+    }
+    // The clone has the data of the earlier destination, its metadata still comes from its own source.
+    FileAccess::permissions(p_file.write_path, FileAccess::status(p_file.read_path).permissions());
+    if (preserve_times) {
+        FileAccess::last_write_time(p_file.write_path, FileAccess::last_write_time(p_file.read_path));
+    }
+    return true;
+}
+
+std::exception_ptr Packer::_copy_files(Vector<File>& p_files, bool p_move) {
+    Vector<FileCopy::Job> jobs;
+    jobs.reserve(p_files.size());
+
+    for (const File& file : p_files) {
+        const Directory& directory = *file.directory;
+        _create_directory(*file.directory);
+        if (directory.read_fd >= 0) {
+            const char* read_name = file.read_path.c_str() + file.read_path.find_last_of('/') + 1;
+            const char* write_name = file.write_path.c_str() + file.write_path.find_last_of('/') + 1;
+            jobs.emplace_back(FileCopy::Location(&file.read_path, directory.read_fd, read_name), FileCopy::Location(&file.write_path, directory.write_fd, write_name));
+        } else {
+            jobs.emplace_back(&file.read_path, &file.write_path);
+        }
+    }
+
+    FileCopy::Options options = _get_copy_options();
+
+    Vector<bool> deduplicated(p_files.size(), false);
+
+    if (dedup_mode == DedupMode::None) {
+        FileCopy::copy_batch(jobs, options, p_move);
+    } else {
+        auto deduplicate = [this, &p_files, &jobs, &deduplicated](size_t p_index) {
+            FileCopy::Job& job = jobs[p_index];
+            try {
+                deduplicated[p_index] = _deduplicate_file(p_files[p_index], job.result);
+            } catch (const FileAccess::filesystem_error& e) {
+                job.error = e.code();
+                deduplicated[p_index] = true;
+            }
+            job.copied = deduplicated[p_index] && !job.error && job.result.method != FileCopy::Method::None;
+            return deduplicated[p_index];
+        };
+
+        // Copies some of the jobs in one batch, then indexes their destinations for the files that follow.
+        auto copy_jobs = [this, &p_files, &jobs, &options, p_move](const Vector<size_t>& p_indices) {
+            if (p_indices.empty()) {
+                return;
+            }
+            Vector<FileCopy::Job> batch;
+            for (size_t i : p_indices) {
+                batch.push_back(jobs[i]);
+            }
+            FileCopy::copy_batch(batch, options, p_move);
+            for (size_t j = 0; j < p_indices.size(); ++j) {
+                const File& file = p_files[p_indices[j]];
+                jobs[p_indices[j]] = batch[j];
+                if (!batch[j].error && file.state_valid) {
+                    dedup_index.add(file.write_path, file.state.size);
+                }
+            }
+        };
+
+        // A file the size of another file of the batch waits for that file to be written, it may be a duplicate.
+        Vector<size_t> pending;
+        Vector<size_t> deferred;
+        std::unordered_set<uint64_t> sizes;
+        for (size_t i = 0; i < p_files.size(); ++i) {
+            if (!deduplicate(i)) {
+                bool shared = p_files[i].state_valid && !sizes.insert(p_files[i].state.size).second;
+                (shared ? deferred : pending).push_back(i);
+            }
+        }
+        copy_jobs(pending);
+
+        pending.clear();
+        for (size_t i : deferred) {
+            if (!deduplicate(i)) {
+                pending.push_back(i);
+            }
+        }
+        copy_jobs(pending);
+    }
+
+    std::exception_ptr exception;
+    size_t copied = 0;
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const FileCopy::Job& job = jobs[i];
+        if (job.error) {
+            if (!exception) {
+                exception = std::make_exception_ptr(FileAccess::filesystem_error("cannot copy file", *job.from.path, *job.to.path, job.error));
+            }
+            continue;
+        }
+
+        // An up to date destination is in sync with its source as much as a copied one.
+        const File& file = p_files[i];
+        if (incremental_enabled && !p_move && file.state_valid) {
+            manifest.add(file.read_path.c_str() + read_root_length, file.read_path.size() - read_root_length, file.write_path.c_str() + write_root_length, file.write_path.size() - write_root_length, file.state);
+        }
+
+        if (job.copied == false) {
+            stats.add(PackStats::Counter::FilesUpToDate);
+            continue;
+        }
+
+        stats.add(FileCopy::get_method_counter(job.result.method));
+        if (deduplicated[i]) {
+            stats.add(PackStats::Counter::FilesDeduplicated);
+            stats.add(PackStats::Counter::BytesSaved, job.result.bytes);
+        } else if (job.result.method != FileCopy::Method::Clone && job.result.method != FileCopy::Method::Rename) {
+            stats.add(PackStats::Counter::FilesCopied);
+            stats.add(PackStats::Counter::BytesPacked, job.result.bytes);
+        }
+        if (job.result.ranges > 0) {
+            stats.add(PackStats::Counter::FilesSplit);
+        }
+        if (job.result.holes > 0) {
+            stats.add(PackStats::Counter::FilesSparse);
+            stats.add(PackStats::Counter::HoleBytes, job.result.holes);
+        }
+        if (job.result.synced) {
+            stats.add(PackStats::Counter::Syncs);
+        }
+        if (job.result.verified) {
+            stats.add(PackStats::Counter::FilesVerified);
+            stats.add(PackStats::Counter::BytesVerified, job.result.bytes);
+            stats.add(PackStats::Counter::VerifyNanoseconds, job.result.verify_time);
+        }
+
+        if (destination_index_enabled) {
+            Directory& directory = *p_files[i].directory;
+            std::lock_guard<std::mutex> lock(directory.index_mutex);
+            if (directory.indexed) {
+                directory.index.insert(job.to.path->substr(job.to.path->find_last_of('/') + 1));
+            }
+        }
+
+        p_files[i].method = job.result.method;
+        p_files[i].bytes = deduplicated[i] || job.result.method == FileCopy::Method::Clone || job.result.method == FileCopy::Method::Rename ? 0 : job.result.bytes;
+        if (copied != i) {
+            std::swap(p_files[copied], p_files[i]);
+        }
+        ++copied;
+    }
+
+    _recycle_files(p_files, copied);
+    return exception;
+}
+
+void Packer::_finish_files(const Vector<File>& p_files, bool p_move) {
+    Vector<std::error_code> errors;
+    const File* failed = nullptr;
+    std::error_code error;
+
+    // Under the batched and end-of-run policies, sources are only removed once a sync has made their copies durable.
+    bool remove_sources = p_move && durability != Durability::Batch && durability != Durability::End;
+    if (remove_sources) {
+        Vector<FileCopy::Location> sources;
+        for (const File& file : p_files) {
+            if (file.method != FileCopy::Method::Rename) {
+                const char* read_name = file.read_path.c_str() + file.read_path.find_last_of('/') + 1;
+                sources.emplace_back(&file.read_path, file.directory->read_fd, read_name);
+            }
+        }
+        if (durability == Durability::File) {
+            // The copies were flushed with fdatasync, their directory entries must be durable too before the sources go.
+            Directory* synced = nullptr;
+            for (const File& file : p_files) {
+                if (file.method != FileCopy::Method::Rename && file.directory.get() != synced) {
+                    synced = file.directory.get();
+                    _sync_directory(*synced);
+                }
+            }
+        }
+        FileCopy::remove_batch(sources, errors, copy_engine);
+    } else {
+        _queue_sync(p_files, p_move);
+    }
+
+    std::lock_guard<std::mutex> lock(callback_mutex);
+
+    size_t removed = 0;
+    for (const File& file : p_files) {
+        if (remove_sources && file.method != FileCopy::Method::Rename) {
+            const std::error_code& remove_error = errors[removed++];
+            if (remove_error) {
+                if (!failed) {
+                    failed = &file;
+                    error = remove_error;
+                }
+                continue;
+            }
+        }
+
+        stats.add(PackStats::Counter::FilesPacked);
+
+        if (callback) {
+            callback(file.read_path, file.write_path, p_move);
+        }
+
+#ifdef LOG_ENABLED
+        if (log_enabled) {
+            static thread_local String message;
+            message.assign(p_move ? "Moved " : "Copied ");
+            message.append(file.read_path).append(" to ").append(file.write_path).append(" (").append(FileCopy::get_method_name(file.method)).append(")\n");
+            LOG_INFO(message);
+        }
+#endif // LOG_ENABLED
+    }
+
+    if (failed) {
+        throw FileAccess::filesystem_error("cannot remove file", failed->read_path, error);
+    }
+}
+
+void Packer::_sync_directory(Directory& p_directory) {
+#ifdef __linux__
+    int directory_fd = p_directory.write_fd;
+    if (directory_fd < 0) {
+        directory_fd = ::open(p_directory.write_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (directory_fd < 0) {
+            throw_directory_error(p_directory.write_path, errno);
+        }
+    }
+    int error = ::fsync(directory_fd) != 0 ? errno : 0;
+    if (directory_fd != p_directory.write_fd) {
+        ::close(directory_fd);
+    }
+    if (error != 0) {
+        throw FileAccess::filesystem_error("cannot sync directory", p_directory.write_path, std::error_code(error, std::generic_category()));
+    }
+
+    if (!p_directory.synced.exchange(true)) {
+        std::shared_ptr<Directory> parent = p_directory.parent.lock();
+        if (parent) {
+            _sync_directory(*parent);
+        }
+    }
+#endif // __linux__
+}
+
+void Packer::_queue_sync(const Vector<File>& p_files, bool p_move) {
+    if (durability != Durability::Batch && durability != Durability::End) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        for (const File& file : p_files) {
+            if (file.method == FileCopy::Method::Rename) {
+                continue;
+            }
+            ++sync_files;
+            sync_bytes += file.bytes;
+            if (p_move) {
+                sync_sources.push_back(file.read_path);
+            }
+        }
+        if (durability == Durability::End || (sync_files < static_cast<uint64_t>(sync_batch_files) && sync_bytes < static_cast<uint64_t>(sync_batch_size) << 20)) {
+            return;
+        }
+    }
+
+    _sync_destination();
+}
+
+void Packer::_sync_destination() {
+    // The sources are taken before the sync, copies finished while it runs wait for the next one.
+    Vector<String> sources;
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        sources.swap(sync_sources);
+        sync_files = 0;
+        sync_bytes = 0;
+    }
+
+    std::error_code error = FileCopy::sync_filesystem(sync_path);
+    if (error) {
+        throw FileAccess::filesystem_error("cannot sync destination", sync_path, error);
+    }
+    stats.add(PackStats::Counter::Syncs);
+
+    Vector<FileCopy::Location> locations;
+    locations.reserve(sources.size());
+    for (const String& source : sources) {
+        locations.emplace_back(&source);
+    }
+    Vector<std::error_code> errors;
+    FileCopy::remove_batch(locations, errors, copy_engine);
+    for (size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i]) {
+            throw FileAccess::filesystem_error("cannot remove file", sources[i], errors[i]);
+        }
+    }
+}
+
+void Packer::_begin_sync(const String& p_write_path) {
+    std::lock_guard<std::mutex> lock(sync_mutex);
+    sync_path = p_write_path;
+    sync_files = 0;
+    sync_bytes = 0;
+    sync_sources.clear();
+}
+
+void Packer::_end_sync() {
+    bool pending;
+    {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        pending = sync_files > 0;
+    }
+    if (pending) {
+        _sync_destination();
+    }
+}
+
+void Packer::_archive_files(const Vector<File>& p_files) {
+    const File* failed = nullptr;
+    std::error_code error;
+
+    for (const File& file : p_files) {
+        const Directory& directory = *file.directory;
+        FileCopy::Location source(&file.read_path);
+        if (directory.read_fd >= 0) {
+            source = FileCopy::Location(&file.read_path, directory.read_fd, file.read_path.c_str() + file.read_path.find_last_of('/') + 1);
+        }
+
+        const char* name = file.write_path.c_str() + write_root_length;
+        size_t name_length = file.write_path.size() - write_root_length;
+        uint64_t size = 0;
+        uint64_t stored_size = 0;
+        std::error_code add_error;
+        if (tar_target) {
+            add_error = tar_target->add(name, name_length, source, size);
+            stored_size = size;
+        } else {
+            bool compress = compression != Codec::Type::None && !store_matcher.match_path(file.read_path);
+            add_error = archive_target->add(name, name_length, source, compress, size, stored_size);
+        }
+        if (add_error) {
+            if (!failed) {
+                failed = &file;
+                error = add_error;
+            }
+            continue;
+        }
+
+        stats.add(PackStats::Counter::FilesPacked);
+        stats.add(PackStats::Counter::FilesCopied);
+        stats.add(PackStats::Counter::BytesPacked, size);
+        if (stored_size != size) {
+            stats.add(PackStats::Counter::FilesCompressed);
+            stats.add(PackStats::Counter::BytesCompressed, stored_size);
+        }
+
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        if (callback) {
+            callback(file.read_path, file.write_path, false);
+        }
+
+#ifdef LOG_ENABLED
+        if (log_enabled) {
+            static thread_local String message;
+            message.assign(tar_target ? "Streamed " : "Archived ");
+            message.append(file.read_path).append(" as ").append(file.write_path, write_root_length, String::npos).append("\n");
+            LOG_INFO(message);
+        }
+#endif // LOG_ENABLED
+    }
+
+    if (failed) {
+        throw FileAccess::filesystem_error(tar_target ? "cannot add file to tar stream" : "cannot add file to archive", failed->read_path, error);
+    }
+}
+
+Error Packer::_pack_archive(const String& p_read_path, const String& p_write_path) {
+    if (overwrite_files == false && FileAccess::exists(p_write_path)) {
+        return Error::AlreadyExists;
+    }
+
+    String parent = FileAccess::path(p_write_path).parent_path().string();
+    if (!parent.empty()) {
+        FileAccess::create_directories(parent);
+    }
+
+    ArchiveWriter archive;
+    archive.set_codec(compression, compression_block_size);
+    Error error = archive.open(p_write_path);
+    if (error != Error::OK) {
+        return error;
+    }
+
+    // The files are named as they would be in a destination directory at the archive path.
+    archive_target = &archive;
+    try {
+        _walk(p_read_path, p_write_path);
+    } catch (...) {
+        archive_target = nullptr;
+        throw;
+    }
+    archive_target = nullptr;
+
+    return archive.close();
+}
+
+Error Packer::_pack_tar(const String& p_read_path, const String& p_write_path) {
+    bool standard_output = TarWriter::is_standard_output(p_write_path);
+    if (!standard_output) {
+        if (overwrite_files == false && FileAccess::exists(p_write_path)) {
+            return Error::AlreadyExists;
+        }
+
+        String parent = FileAccess::path(p_write_path).parent_path().string();
+        if (!parent.empty()) {
+            FileAccess::create_directories(parent);
+        }
+    }
+
+    TarWriter tar;
+    Error error = tar.open(p_write_path);
+    if (error != Error::OK) {
+        return error;
+    }
+
+    // Files are written to the stream as the walkers find them, so a reader starts before the traversal ends.
+    tar_target = &tar;
+    try {
+        _walk(p_read_path, p_write_path);
+    } catch (...) {
+        tar_target = nullptr;
+        throw;
+    }
+    tar_target = nullptr;
+
+    return tar.close();
+}
+
+void Packer::_pack_changes(const HashSet<String>& p_files, const HashSet<String>& p_directories) {
+    String _read_path;
+    String _write_path;
+    if (_begin_pack(_read_path, _write_path) != Error::OK) {
+        return;
+    }
+
+    // A change is packed with the closest changed directory above it, the root covers everything.
+    auto covered = [&p_directories](const String& p_path) {
+        if (p_directories.count(String())) {
+            return true;
+        }
+        for (size_t separator = p_path.find_last_of('/'); separator != String::npos && separator > 0; separator = p_path.find_last_of('/', separator - 1)) {
+            if (p_directories.count(p_path.substr(0, separator))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    try {
+        for (const String& directory : p_directories) {
+            if (!directory.empty() && covered(directory)) {
+                continue;
+            }
+            String directory_read_path = directory.empty() ? _read_path : _read_path + "/" + directory;
+            std::error_code error;
+            if (FileAccess::is_directory(directory_read_path, error)) {
+                _walk(directory_read_path, directory.empty() ? _write_path : _write_path + "/" + directory);
+            }
+        }
+
+        std::unique_ptr<ThreadPool> pool;
+        if (ThreadPool::resolve_thread_count(thread_count) > 1) {
+            pool.reset(new ThreadPool(thread_count));
+        }
+
+        Vector<File> batch;
+        auto pack_batch = [this, &pool](Vector<File>& p_batch) {
+            if (pool) {
+                pool->push([this, p_batch]() mutable {
+                    _pack_batch(p_batch, move_files);
+                });
+                p_batch.clear();
+            } else {
+                _pack_batch(p_batch, move_files);
+            }
+        };
+
+        Map<String, std::shared_ptr<Directory>> directories;
+        size_t batch_size = FileCopy::get_batch_size(copy_engine);
+        for (const String& path : p_files) {
+            if (covered(path)) {
+                continue;
+            }
+            String file_read_path = _read_path + "/" + path;
+            std::error_code error;
+            if (!FileAccess::is_regular_file(file_read_path, error)) {
+                continue;
+            }
+
+            size_t separator = path.find_last_of('/');
+            String directory_path = separator == String::npos ? String() : path.substr(0, separator);
+            std::shared_ptr<Directory>& directory = directories[directory_path];
+            if (!directory) {
+                directory = std::make_shared<Directory>(directory_path.empty() ? _write_path : _write_path + "/" + directory_path);
+            }
+
+            File file(file_read_path, directory);
+            if (_filter_file(file)) {
+                batch.push_back(std::move(file));
+                if (batch.size() >= batch_size) {
+                    pack_batch(batch);
+                }
+            }
+        }
+
+        if (!batch.empty()) {
+            pack_batch(batch);
+        }
+        if (pool) {
+            pool->wait();
+        }
+        _end_sync();
+
+        // The batch recorded only the files it packed, the rest of the tree is kept from the manifest on disk,
+        // so a watch that is stopped or killed leaves the manifest as recent as its last batch.
+        if (incremental_enabled) {
+            manifest.merge(previous_manifest);
+            FileAccess::create_directories(_write_path);
+            if (manifest.save(_write_path + "/" + manifest_file_name) != Error::OK) {
+                LOG_ERROR("Cannot save the manifest of the changes packed\n");
+            }
+        }
+    } catch (const FileAccess::filesystem_error& e) {
+        LOG_ERROR(String(e.what()) + "\n");
+    }
+
+    dedup_index.clear();
+    previous_manifest.clear();
+    manifest.clear();
+}
+
+void Packer::_pack_pipeline(const String& p_read_path, const String& p_write_path) {
+    FileQueue scan_queue(queue_size);
+    FileQueue copy_queue(queue_size);
+    FileQueue finish_queue(queue_size);
+
+    std::mutex exception_mutex;
+    std::exception_ptr exception;
+
+    auto store_exception = [&exception_mutex, &exception](std::exception_ptr p_exception) {
+        std::lock_guard<std::mutex> lock(exception_mutex);
+        if (!exception) {
+            exception = p_exception;
+        }
+    };
+
+    // Each stage drains its input queue even after a failure so the stages before it can never block.
+    // A stage thread waits for one file, then takes up to a batch of the files already queued behind it.
+    auto run_stage = [&store_exception](int p_thread_count, size_t p_batch_size, FileQueue& p_input, FileQueue* p_output, std::function<void(Vector<File>&)> p_function) {
+        size_t count = ThreadPool::resolve_thread_count(p_thread_count);
+        std::shared_ptr<std::atomic<size_t>> running = std::make_shared<std::atomic<size_t>>(count);
+        Vector<std::thread> threads;
+        for (size_t i = 0; i < count; ++i) {
+            threads.emplace_back([running, &store_exception, p_batch_size, &p_input, p_output, p_function]() {
+                Vector<File> batch(1);
+                while (p_input.pop(batch[0])) {
+                    File file;
+                    while (batch.size() < p_batch_size && p_input.try_pop(file)) {
+                        batch.push_back(std::move(file));
+                    }
+                    try {
+                        p_function(batch);
+                    } catch (...) {
+                        store_exception(std::current_exception());
+                        batch.clear();
+                    }
+                    if (p_output) {
+                        for (File& f : batch) {
+                            p_output->push(std::move(f));
+                        }
+                    }
+                    batch.resize(1);
+                }
+                if (--*running == 0 && p_output) {
+                    p_output->close();
+                }
+            });
+        }
+        return threads;
+    };
+
+    size_t batch_size = FileCopy::get_batch_size(copy_engine);
+
+    Vector<std::thread> filter_threads = run_stage(filter_thread_count, 1, scan_queue, &copy_queue, [this](Vector<File>& p_files) {
+        if (!_filter_file(p_files[0])) {
+            p_files.clear();
+        }
+    });
+    Vector<std::thread> copy_threads = run_stage(copy_thread_count, batch_size, copy_queue, &finish_queue, [this, &store_exception](Vector<File>& p_files) {
+        std::exception_ptr exception = _copy_files(p_files, move_files);
+        if (exception) {
+            store_exception(exception);
+        }
+    });
+    Vector<std::thread> finish_threads = run_stage(post_thread_count, batch_size, finish_queue, nullptr, [this](Vector<File>& p_files) {
+        _finish_files(p_files, move_files);
+    });
+
+    try {
+        ThreadPool pool(thread_count);
+        pool.push([this, p_read_path, p_write_path, &pool, &scan_queue]() {
+            _pack_root(p_read_path, p_write_path, &pool, &scan_queue);
+        });
+        pool.wait();
+    } catch (...) {
+        store_exception(std::current_exception());
+    }
+    scan_queue.close();
+
+    for (auto* threads : { &filter_threads, &copy_threads, &finish_threads }) {
+        for (auto& thread : *threads) {
+            thread.join();
+        }
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void Packer::set_callback(Callback p_callback) {
+    callback = p_callback;
+}
+
+Packer::Callback Packer::get_callback() {
+    return callback;
+}
+
+void Packer::set_read_path(const String& p_path) {
+    read_path = p_path;
+}
+
+const String& Packer::get_read_path() const {
+    return read_path;
+}
+
+void Packer::set_write_path(const String& p_path) {
+    write_path = p_path;
+}
+
+const String& Packer::get_write_path() const {
+    return write_path;
+}
+
+size_t Packer::get_extension_count() const {
+    return extensions.size();
+}
+
+const String& Packer::get_extension(size_t p_index) const {
+    return extensions[p_index];
+}
+
+bool Packer::add_extension(const String& p_extension) {
+    for (const String& e : extensions) {
+        if (p_extension == e) {
+            return false;
+        }
+    }
+    extensions.push_back(p_extension);
+    return true;
+}
+
+bool Packer::remove_extension(const String& p_extension) {
+    for (size_t i = 0; i < extensions.size(); ++i) {
+        if (extensions[i] == p_extension) {
+            extensions.erase(extensions.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Packer::has_extension(const String& p_extension) const {
+    for (const String& e : extensions) {
+        if (p_extension == e) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Packer::clear_extensions() {
+    extensions.clear();
+}
+
+void Packer::set_pack_mode(PackMode p_mode) {
+    if (p_mode < static_cast<PackMode>(0) || p_mode >= PackMode::Max) {
+        return;
+    }
+    pack_mode = p_mode;
+}
+
+Packer::PackMode Packer::get_pack_mode() const {
+    return pack_mode;
+}
+
+void Packer::set_overwrite_files(bool p_enable) {
+    overwrite_files = p_enable;
+}
+
+bool Packer::get_overwrite_files() const {
+    return overwrite_files;
+}
+
+void Packer::set_move_files(bool p_enable) {
+    move_files = p_enable;
+}
+
+bool Packer::get_move_files() const {
+    return move_files;
+}
+
+void Packer::set_suffix_string(const String& p_suffix) {
+    suffix_string = p_suffix;
+}
+
+const String& Packer::get_suffix_string() const {
+    return suffix_string;
+}
+
+void Packer::set_suffix_enabled(bool p_enable) {
+    suffix_enabled = p_enable;
+}
+
+bool Packer::get_suffix_enabled() const {
+    return suffix_enabled;
+}
+
+void Packer::set_extension_insensitive(bool p_enable) {
+    extension_insensitive = p_enable;
+}
+
+bool Packer::get_extension_insensitive() const {
+    return extension_insensitive;
+}
+
+void Packer::set_extension_adjust(ExtensionAdjust p_case) {
+    if (p_case < static_cast<ExtensionAdjust>(0) || p_case >= ExtensionAdjust::Max) {
+        return;
+    }
+    extension_adjust = p_case;
+}
+
+Packer::ExtensionAdjust Packer::get_extension_adjust() const {
+    return extension_adjust;
+}
+
+void Packer::set_thread_count(int p_count) {
+    if (p_count < 0) {
+        return;
+    }
+    thread_count = p_count;
+}
+
+int Packer::get_thread_count() const {
+    return thread_count;
+}
+
+void Packer::set_pipeline_enabled(bool p_enable) {
+    pipeline_enabled = p_enable;
+}
+
+bool Packer::get_pipeline_enabled() const {
+    return pipeline_enabled;
+}
+
+void Packer::set_filter_thread_count(int p_count) {
+    if (p_count < 0) {
+        return;
+    }
+    filter_thread_count = p_count;
+}
+
+int Packer::get_filter_thread_count() const {
+    return filter_thread_count;
+}
+
+void Packer::set_copy_thread_count(int p_count) {
+    if (p_count < 0) {
+        return;
+    }
+    copy_thread_count = p_count;
+}
+
+int Packer::get_copy_thread_count() const {
+    return copy_thread_count;
+}
+
+void Packer::set_post_thread_count(int p_count) {
+    if (p_count < 0) {
+        return;
+    }
+    post_thread_count = p_count;
+}
+
+int Packer::get_post_thread_count() const {
+    return post_thread_count;
+}
+
+void Packer::set_queue_size(int p_size) {
+    if (p_size < 1) {
+        return;
+    }
+    queue_size = p_size;
+}
+
+int Packer::get_queue_size() const {
+    return queue_size;
+}
+
+void Packer::set_copy_engine(FileCopy::Engine p_engine) {
+    if (p_engine < static_cast<FileCopy::Engine>(0) || p_engine >= FileCopy::Engine::Max) {
+        return;
     }
-#endif //IGNORE_FILE_ENABLED
+    copy_engine = p_engine;
+}
 
-    bool write_directory_exists = false;
+FileCopy::Engine Packer::get_copy_engine() const {
+    return copy_engine;
+}
 
-    for (auto& path : FileAccess::directory_iterator(p_read_path)) {
-        String _read_path = path.path().string();
-        normalize_path_separators(_read_path);
+void Packer::set_clone_files(bool p_enable) {
+    clone_files = p_enable;
+}
 
-        if (FileAccess::is_directory(path)) {
-            _pack_files(_read_path, p_write_path + _read_path.substr(_read_path.find_last_of('/')));
-        } else {
-            if (pack_mode != PackMode::Everything) {
-                String extension = _read_path.substr(_read_path.find_last_of('.') + 1);
-                bool skip_file = pack_mode == PackMode::Include;
-
-                if (extension_insensitive) {
-                    std::transform(extension.begin(), extension.end(), extension.begin(), tolower);
-                    for (const String& e : extensions) {
-                        String transformed = e;
-                        std::transform(transformed.begin(), transformed.end(), transformed.begin(), tolower);
-
-                        if (extension == transformed) {
-                            skip_file = pack_mode == PackMode::Exclude;
-                            break;
-                        }
-                    }
-                } else {
-                    for (const String& e : extensions) {
-                        if (extension == e) {
-                            skip_file = pack_mode == PackMode::Exclude;
-                            break;
-                        }                        
-                    }
-                }
+bool Packer::get_clone_files() const {
+    return clone_files;
+}
 
-                if (skip_file) {
-                    continue;
-                }
-            }
+void Packer::set_traversal(Traversal p_traversal) {
+    if (p_traversal < static_cast<Traversal>(0) || p_traversal >= Traversal::Max) {
+        return;
+    }
+    traversal = p_traversal;
+}
 
-            String _write_path = p_write_path + _read_path.substr(_read_path.find_last_of('/'));
+Packer::Traversal Packer::get_traversal() const {
+    return traversal;
+}
 
-            if (suffix_enabled) {
-                remove_path_suffix(_write_path, suffix_string);
-            }
+void Packer::set_destination_index_enabled(bool p_enable) {
+    destination_index_enabled = p_enable;
+}
 
-            if (extension_adjust != ExtensionAdjust::Default) {
-                size_t ext_pos = _write_path.find_last_of('.') + 1;
-                if (ext_pos != String::npos) {
-                    std::transform(_write_path.begin() + ext_pos, _write_path.end(), _write_path.begin() + ext_pos, extension_adjust == ExtensionAdjust::Lower ? tolower : toupper);
-                }
-            }
+bool Packer::get_destination_index_enabled() const {
+    return destination_index_enabled;
+}
 
-            if (overwrite_files == false) {
-                if (FileAccess::exists(_write_path)) {
-                    continue;
-                }
-            }
+void Packer::set_incremental_enabled(bool p_enable) {
+    incremental_enabled = p_enable;
+}
 
-            if (write_directory_exists == false) {
-                write_directory_exists = true;
-                FileAccess::create_directories(p_write_path);
-            }
+bool Packer::get_incremental_enabled() const {
+    return incremental_enabled;
+}
 
-            if (copy_file(_read_path, _write_path, FileAccess::copy_options::update_existing) == false) {
-                continue;
-            }
+void Packer::set_manifest_file_name(const String& p_name) {
+    manifest_file_name = p_name;
+}
 
-            if (move_files) {
-                FileAccess::remove(_read_path);
-            }
+const String& Packer::get_manifest_file_name() const {
+    return manifest_file_name;
+}
 
-            if (callback) {
-                callback(_read_path, _write_path, move_files);
-            }
+void Packer::set_quick_check_enabled(bool p_enable) {
+    quick_check_enabled = p_enable;
+}
 
-#ifdef LOG_ENABLED
-            if (log_enabled) {
-                LOG_INFO((move_files ? "Moved " : "Copied ") + _read_path + " to " + _write_path + "\n");
-            }
-#endif // LOG_ENABLED
-        }
+bool Packer::get_quick_check_enabled() const {
+    return quick_check_enabled;
+}
+
+void Packer::set_quick_check_tolerance(int p_tolerance) {
+    if (p_tolerance < 0) {
+        return;
     }
+    quick_check_tolerance = p_tolerance;
 }
 
-void Packer::set_callback(Callback p_callback) {
-    callback = p_callback;
+int Packer::get_quick_check_tolerance() const {
+    return quick_check_tolerance;
 }
 
-Packer::Callback Packer::get_callback() {
-    return callback;
+void Packer::set_preserve_times(bool p_enable) {
+    preserve_times = p_enable;
 }
 
-void Packer::set_read_path(const String& p_path) {
-    read_path = p_path;
+bool Packer::get_preserve_times() const {
+    return preserve_times;
 }
 
-const String& Packer::get_read_path() const {
-    return read_path;
+void Packer::set_verify_files(bool p_enable) {
+    verify_files = p_enable;
 }
 
-void Packer::set_write_path(const String& p_path) {
-    write_path = p_path;
+bool Packer::get_verify_files() const {
+    return verify_files;
 }
 
-const String& Packer::get_write_path() const {
-    return write_path;
+void Packer::set_split_copy_size(int p_size) {
+    if (p_size < 0) {
+        return;
+    }
+    split_copy_size = p_size;
 }
 
-size_t Packer::get_extension_count() const {
-    return extensions.size();
+int Packer::get_split_copy_size() const {
+    return split_copy_size;
 }
 
-const String& Packer::get_extension(size_t p_index) const {
-    return extensions[p_index];
+void Packer::set_durability(Durability p_durability) {
+    if (p_durability < static_cast<Durability>(0) || p_durability >= Durability::Max) {
+        return;
+    }
+    durability = p_durability;
 }
 
-bool Packer::add_extension(const String& p_extension) {
-    for (const String& e : extensions) {
-        if (p_extension == e) {
-            return false;
-        }
+Packer::Durability Packer::get_durability() const {
+    return durability;
+}
+
+void Packer::set_sync_batch_files(int p_count) {
+    if (p_count < 1) {
+        return;
     }
-    extensions.push_back(p_extension);
-    return true;
+    sync_batch_files = p_count;
 }
 
-bool Packer::remove_extension(const String& p_extension) {
-    for (size_t i = 0; i < extensions.size(); ++i) {
-        if (extensions[i] == p_extension) {
-            extensions.erase(extensions.begin() + i);
-            return true;
-        }
+int Packer::get_sync_batch_files() const {
+    return sync_batch_files;
+}
+
+void Packer::set_sync_batch_size(int p_size) {
+    if (p_size < 1) {
+        return;
     }
-    return false;
+    sync_batch_size = p_size;
 }
 
-bool Packer::has_extension(const String& p_extension) const {
-    for (const String& e : extensions) {
-        if (p_extension == e) {
-            return true;
-        }
+int Packer::get_sync_batch_size() const {
+    return sync_batch_size;
+}
+
+void Packer::set_dedup_mode(DedupMode p_mode) {
+    if (p_mode < static_cast<DedupMode>(0) || p_mode >= DedupMode::Max) {
+        return;
     }
-    return false;
+    dedup_mode = p_mode;
 }
 
-void Packer::clear_extensions() {
-    extensions.clear();
+Packer::DedupMode Packer::get_dedup_mode() const {
+    return dedup_mode;
 }
 
-void Packer::set_pack_mode(PackMode p_mode) {
-    if (p_mode < static_cast<PackMode>(0) || p_mode >= PackMode::Max) {
+void Packer::set_output_mode(OutputMode p_mode) {
+    if (p_mode < static_cast<OutputMode>(0) || p_mode >= OutputMode::Max) {
         return;
     }
-    pack_mode = p_mode;
+    output_mode = p_mode;
 }
 
-Packer::PackMode Packer::get_pack_mode() const {
-    return pack_mode;
+Packer::OutputMode Packer::get_output_mode() const {
+    return output_mode;
 }
 
-void Packer::set_overwrite_files(bool p_enable) {
-    overwrite_files = p_enable;
+void Packer::set_compression(Codec::Type p_compression) {
+    if (p_compression != Codec::Type::None && Codec::get_codec(p_compression) == nullptr) {
+        return;
+    }
+    compression = p_compression;
 }
 
-bool Packer::get_overwrite_files() const {
-    return overwrite_files;
+Codec::Type Packer::get_compression() const {
+    return compression;
 }
 
-void Packer::set_move_files(bool p_enable) {
-    move_files = p_enable;
+void Packer::set_compression_block_size(int p_size) {
+    if (p_size < 1) {
+        return;
+    }
+    compression_block_size = p_size;
 }
 
-bool Packer::get_move_files() const {
-    return move_files;
+int Packer::get_compression_block_size() const {
+    return compression_block_size;
 }
 
-void Packer::set_suffix_string(const String& p_suffix) {
-    suffix_string = p_suffix;
+size_t Packer::get_store_extension_count() const {
+    return store_extensions.size();
 }
 
-const String& Packer::get_suffix_string() const {
-    return suffix_string;
+const String& Packer::get_store_extension(size_t p_index) const {
+    return store_extensions[p_index];
 }
 
-void Packer::set_suffix_enabled(bool p_enable) {
-    suffix_enabled = p_enable;
+bool Packer::add_store_extension(const String& p_extension) {
+    for (const String& e : store_extensions) {
+        if (p_extension == e) {
+            return false;
+        }
+    }
+    store_extensions.push_back(p_extension);
+    return true;
 }
 
-bool Packer::get_suffix_enabled() const {
-    return suffix_enabled;
+bool Packer::remove_store_extension(const String& p_extension) {
+    for (size_t i = 0; i < store_extensions.size(); ++i) {
+        if (store_extensions[i] == p_extension) {
+            store_extensions.erase(store_extensions.begin() + i);
+            return true;
+        }
+    }
+    return false;
 }
 
-void Packer::set_extension_insensitive(bool p_enable) {
-    extension_insensitive = p_enable;
+bool Packer::has_store_extension(const String& p_extension) const {
+    for (const String& e : store_extensions) {
+        if (p_extension == e) {
+            return true;
+        }
+    }
+    return false;
 }
 
-bool Packer::get_extension_insensitive() const {
-    return extension_insensitive;
+void Packer::clear_store_extensions() {
+    store_extensions.clear();
 }
 
-void Packer::set_extension_adjust(ExtensionAdjust p_case) {
-    if (p_case < static_cast<ExtensionAdjust>(0) || p_case >= ExtensionAdjust::Max) {
+void Packer::set_watch_delay(int p_delay) {
+    if (p_delay < 0) {
         return;
     }
-    extension_adjust = p_case;
+    watch_delay = p_delay;
 }
 
-Packer::ExtensionAdjust Packer::get_extension_adjust() const {
-    return extension_adjust;
+int Packer::get_watch_delay() const {
+    return watch_delay;
+}
+
+const PackStats& Packer::get_stats() const {
+    return stats;
 }
 
 #ifdef IGNORE_FILE_ENABLED
@@ -316,6 +2099,32 @@ void Packer::to_config_file(ConfigFile& p_file) const {
     p_file.set_value("suffix_enabled", suffix_enabled);
     p_file.set_value("extension_insensitive", extension_insensitive);
     p_file.set_value("extension_adjust", static_cast<int>(extension_adjust));
+    p_file.set_value("thread_count", thread_count);
+    p_file.set_value("pipeline_enabled", pipeline_enabled);
+    p_file.set_value("filter_thread_count", filter_thread_count);
+    p_file.set_value("copy_thread_count", copy_thread_count);
+    p_file.set_value("post_thread_count", post_thread_count);
+    p_file.set_value("queue_size", queue_size);
+    p_file.set_value("copy_engine", static_cast<int>(copy_engine));
+    p_file.set_value("clone_files", clone_files);
+    p_file.set_value("traversal", static_cast<int>(traversal));
+    p_file.set_value("destination_index_enabled", destination_index_enabled);
+    p_file.set_value("incremental_enabled", incremental_enabled);
+    p_file.set_value("manifest_file_name", manifest_file_name);
+    p_file.set_value("quick_check_enabled", quick_check_enabled);
+    p_file.set_value("quick_check_tolerance", quick_check_tolerance);
+    p_file.set_value("preserve_times", preserve_times);
+    p_file.set_value("verify_files", verify_files);
+    p_file.set_value("split_copy_size", split_copy_size);
+    p_file.set_value("durability", static_cast<int>(durability));
+    p_file.set_value("sync_batch_files", sync_batch_files);
+    p_file.set_value("sync_batch_size", sync_batch_size);
+    p_file.set_value("dedup_mode", static_cast<int>(dedup_mode));
+    p_file.set_value("output_mode", static_cast<int>(output_mode));
+    p_file.set_value("compression", static_cast<int>(compression));
+    p_file.set_value("compression_block_size", compression_block_size);
+    p_file.set_value("store_extensions", store_extensions);
+    p_file.set_value("watch_delay", watch_delay);
 
 #ifdef IGNORE_FILE_ENABLED
     p_file.set_value("ignore_file_name", ignore_file_name);
@@ -328,19 +2137,45 @@ void Packer::to_config_file(ConfigFile& p_file) const {
 }
 
 void Packer::from_config_file(const ConfigFile& p_file) {
-    read_path = p_file.get_value("read_path", DEFAULT_READ_PATH);
-    write_path = p_file.get_value("write_path", DEFAULT_WRITE_PATH);
+    read_path = p_file.get_value("read_path", DEFAULT_READ_PATH).operator const String&();
+    write_path = p_file.get_value("write_path", DEFAULT_WRITE_PATH).operator const String&();
     extensions = p_file.get_value("extensions", DEFAULT_EXTENTIONS);
     pack_mode = static_cast<PackMode>(p_file.get_value("pack_mode", static_cast<int>(DEFAULT_PACK_MODE)).operator const int());
     overwrite_files = p_file.get_value("overwrite_files", DEFAULT_OVERWRITE_FILES);
     move_files = p_file.get_value("move_files", DEFAULT_MOVE_FILES);
-    suffix_string = p_file.get_value("suffix_string", DEFAULT_SUFFIX_STRING);
+    suffix_string = p_file.get_value("suffix_string", DEFAULT_SUFFIX_STRING).operator const String&();
     suffix_enabled = p_file.get_value("suffix_enabled", DEFAULT_SUFFIX_ENABLED);
     extension_insensitive = p_file.get_value("extension_insensitive", DEFAULT_EXTENSION_INSENSITIVE);
     extension_adjust = static_cast<ExtensionAdjust>(p_file.get_value("extension_adjust", static_cast<int>(DEFAULT_EXTENSION_ADJUST)).operator const int());
+    thread_count = p_file.get_value("thread_count", DEFAULT_THREAD_COUNT).operator const int();
+    pipeline_enabled = p_file.get_value("pipeline_enabled", DEFAULT_PIPELINE_ENABLED);
+    filter_thread_count = p_file.get_value("filter_thread_count", DEFAULT_FILTER_THREAD_COUNT).operator const int();
+    copy_thread_count = p_file.get_value("copy_thread_count", DEFAULT_COPY_THREAD_COUNT).operator const int();
+    post_thread_count = p_file.get_value("post_thread_count", DEFAULT_POST_THREAD_COUNT).operator const int();
+    queue_size = p_file.get_value("queue_size", DEFAULT_QUEUE_SIZE).operator const int();
+    copy_engine = static_cast<FileCopy::Engine>(p_file.get_value("copy_engine", static_cast<int>(DEFAULT_COPY_ENGINE)).operator const int());
+    clone_files = p_file.get_value("clone_files", DEFAULT_CLONE_FILES);
+    traversal = static_cast<Traversal>(p_file.get_value("traversal", static_cast<int>(DEFAULT_TRAVERSAL)).operator const int());
+    destination_index_enabled = p_file.get_value("destination_index_enabled", DEFAULT_DESTINATION_INDEX_ENABLED);
+    incremental_enabled = p_file.get_value("incremental_enabled", DEFAULT_INCREMENTAL_ENABLED);
+    manifest_file_name = p_file.get_value("manifest_file_name", DEFAULT_MANIFEST_FILE_NAME).operator const String&();
+    quick_check_enabled = p_file.get_value("quick_check_enabled", DEFAULT_QUICK_CHECK_ENABLED);
+    quick_check_tolerance = p_file.get_value("quick_check_tolerance", DEFAULT_QUICK_CHECK_TOLERANCE).operator const int();
+    preserve_times = p_file.get_value("preserve_times", DEFAULT_PRESERVE_TIMES);
+    verify_files = p_file.get_value("verify_files", DEFAULT_VERIFY_FILES);
+    split_copy_size = p_file.get_value("split_copy_size", DEFAULT_SPLIT_COPY_SIZE).operator const int();
+    durability = static_cast<Durability>(p_file.get_value("durability", static_cast<int>(DEFAULT_DURABILITY)).operator const int());
+    sync_batch_files = p_file.get_value("sync_batch_files", DEFAULT_SYNC_BATCH_FILES).operator const int();
+    sync_batch_size = p_file.get_value("sync_batch_size", DEFAULT_SYNC_BATCH_SIZE).operator const int();
+    dedup_mode = static_cast<DedupMode>(p_file.get_value("dedup_mode", static_cast<int>(DEFAULT_DEDUP_MODE)).operator const int());
+    output_mode = static_cast<OutputMode>(p_file.get_value("output_mode", static_cast<int>(DEFAULT_OUTPUT_MODE)).operator const int());
+    compression = static_cast<Codec::Type>(p_file.get_value("compression", static_cast<int>(DEFAULT_COMPRESSION)).operator const int());
+    compression_block_size = p_file.get_value("compression_block_size", DEFAULT_COMPRESSION_BLOCK_SIZE).operator const int();
+    store_extensions = p_file.get_value("store_extensions", DEFAULT_STORE_EXTENSIONS);
+    watch_delay = p_file.get_value("watch_delay", DEFAULT_WATCH_DELAY).operator const int();
 
 #ifdef IGNORE_FILE_ENABLED
-    ignore_file_name = p_file.get_value("ignore_file_name", DEFAULT_IGNORE_FILE_NAME);
+    ignore_file_name = p_file.get_value("ignore_file_name", DEFAULT_IGNORE_FILE_NAME).operator const String&();
     ignore_file_enabled = p_file.get_value("ignore_file_enabled", DEFAULT_IGNORE_FILE_ENABLED);
 #endif // IGNORE_FILE_ENABLED
 
@@ -392,6 +2227,32 @@ void Packer::revert_state() {
     suffix_enabled = DEFAULT_SUFFIX_ENABLED;
     extension_insensitive = DEFAULT_EXTENSION_INSENSITIVE;
     extension_adjust = DEFAULT_EXTENSION_ADJUST;
+    thread_count = DEFAULT_THREAD_COUNT;
+    pipeline_enabled = DEFAULT_PIPELINE_ENABLED;
+    filter_thread_count = DEFAULT_FILTER_THREAD_COUNT;
+    copy_thread_count = DEFAULT_COPY_THREAD_COUNT;
+    post_thread_count = DEFAULT_POST_THREAD_COUNT;
+    queue_size = DEFAULT_QUEUE_SIZE;
+    copy_engine = DEFAULT_COPY_ENGINE;
+    clone_files = DEFAULT_CLONE_FILES;
+    traversal = DEFAULT_TRAVERSAL;
+    destination_index_enabled = DEFAULT_DESTINATION_INDEX_ENABLED;
+    incremental_enabled = DEFAULT_INCREMENTAL_ENABLED;
+    manifest_file_name = DEFAULT_MANIFEST_FILE_NAME;
+    quick_check_enabled = DEFAULT_QUICK_CHECK_ENABLED;
+    quick_check_tolerance = DEFAULT_QUICK_CHECK_TOLERANCE;
+    preserve_times = DEFAULT_PRESERVE_TIMES;
+    verify_files = DEFAULT_VERIFY_FILES;
+    split_copy_size = DEFAULT_SPLIT_COPY_SIZE;
+    durability = DEFAULT_DURABILITY;
+    sync_batch_files = DEFAULT_SYNC_BATCH_FILES;
+    sync_batch_size = DEFAULT_SYNC_BATCH_SIZE;
+    dedup_mode = DEFAULT_DEDUP_MODE;
+    output_mode = DEFAULT_OUTPUT_MODE;
+    compression = DEFAULT_COMPRESSION;
+    compression_block_size = DEFAULT_COMPRESSION_BLOCK_SIZE;
+    store_extensions = DEFAULT_STORE_EXTENSIONS;
+    watch_delay = DEFAULT_WATCH_DELAY;
 
 #ifdef IGNORE_FILE_ENABLED
     ignore_file_name = DEFAULT_IGNORE_FILE_NAME;
@@ -403,7 +2264,7 @@ void Packer::revert_state() {
 #endif // LOG_ENABLED
 }
 
-Error Packer::pack_files() {
+Error Packer::_begin_pack(String& p_read_path, String& p_write_path) {
     if (read_path.empty()) {
         return Error::Unconfigured;
     }
@@ -418,25 +2279,324 @@ Error Packer::pack_files() {
         }
     }
 
-    String _read_path = read_path;
-    normalize_path_separators(_read_path);
+    p_read_path = read_path;
+    normalize_path_separators(p_read_path);
 
-    if (!FileAccess::exists(_read_path)) {
+    if (!FileAccess::exists(p_read_path)) {
         return Error::DoesNotExist;
     }
 
-    if (!FileAccess::is_directory(_read_path)) {
-        _read_path = FileAccess::path(_read_path).parent_path().string();
+    if (!FileAccess::is_directory(p_read_path)) {
+        p_read_path = FileAccess::path(p_read_path).parent_path().string();
+    }
+
+    p_write_path = write_path;
+    normalize_path_separators(p_write_path);
+
+    stats.reset();
+    dedup_index.clear();
+    extension_matcher = ExtensionMatcher(extensions, extension_insensitive);
+    store_matcher = ExtensionMatcher(store_extensions, true);
+
+    read_root_length = p_read_path.size() + 1;
+    write_root_length = p_write_path.size() + 1;
+    _begin_sync(p_write_path);
+    manifest.clear();
+    if (incremental_enabled && output_mode == OutputMode::Directory) {
+        // A missing or damaged manifest only means every file is packed again.
+        previous_manifest.load(p_write_path + "/" + manifest_file_name);
+
+        // Cached listings kept the entries chosen by the previous filter settings, they are only reused with the same ones.
+        uint64_t filter_key = _get_filter_key();
+        if (previous_manifest.get_filter_key() != filter_key) {
+            previous_manifest.clear_directories();
+        }
+        manifest.set_filter_key(filter_key);
+
+#ifdef __linux__
+        struct timespec now;
+        ::clock_gettime(CLOCK_REALTIME, &now);
+        pack_time = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+        pack_time = std::chrono::duration_cast<std::chrono::nanoseconds>(FileAccess::file_time_type::clock::now().time_since_epoch()).count();
+#endif // __linux__
+    }
+
+    return Error::OK;
+}
+
+void Packer::_walk(const String& p_read_path, const String& p_write_path) {
+    if (ThreadPool::resolve_thread_count(thread_count) > 1) {
+        ThreadPool pool(thread_count);
+        pool.push([this, p_read_path, p_write_path, &pool]() {
+            _pack_root(p_read_path, p_write_path, &pool, nullptr);
+        });
+        pool.wait();
+    } else {
+        _pack_root(p_read_path, p_write_path, nullptr, nullptr);
+    }
+}
+
+Error Packer::pack_files() {
+    String _read_path;
+    String _write_path;
+    Error error = _begin_pack(_read_path, _write_path);
+    if (error != Error::OK) {
+        return error;
+    }
+
+    if (output_mode == OutputMode::Archive) {
+        return _pack_archive(_read_path, _write_path);
+    }
+
+    if (output_mode == OutputMode::Tar) {
+        return _pack_tar(_read_path, _write_path);
+    }
+
+#ifndef __linux__
+    if (durability != Durability::None) {
+        return Error::Unsupported;
+    }
+#endif // __linux__
+
+    if (pipeline_enabled) {
+        _pack_pipeline(_read_path, _write_path);
+    } else {
+        _walk(_read_path, _write_path);
+    }
+
+    dedup_index.clear();
+    _end_sync();
+
+    if (incremental_enabled) {
+        FileAccess::create_directories(_write_path);
+        error = manifest.save(_write_path + "/" + manifest_file_name);
+        previous_manifest.clear();
+        manifest.clear();
+        if (error != Error::OK) {
+            return error;
+        }
+    }
+
+    return Error::OK;
+}
+
+Error Packer::plan(PackPlan& p_plan) {
+    p_plan.clear();
+
+    if (output_mode != OutputMode::Directory) {
+        return Error::Unsupported;
+    }
+
+    String _read_path;
+    String _write_path;
+    Error error = _begin_pack(_read_path, _write_path);
+    if (error != Error::OK) {
+        return error;
+    }
+
+    p_plan.set_roots(_read_path, _write_path);
+    plan_target = &p_plan;
+    try {
+        _walk(_read_path, _write_path);
+    } catch (...) {
+        plan_target = nullptr;
+        previous_manifest.clear();
+        manifest.clear();
+        throw;
+    }
+    plan_target = nullptr;
+    previous_manifest.clear();
+    manifest.clear();
+
+    _plan_directories(p_plan);
+    return Error::OK;
+}
+
+Error Packer::execute(const PackPlan& p_plan) {
+    if (output_mode != OutputMode::Directory) {
+        return Error::Unsupported;
+    }
+
+    if (p_plan.get_read_root().empty() || p_plan.get_write_root().empty()) {
+        return Error::Unconfigured;
+    }
+
+#ifndef __linux__
+    if (durability != Durability::None) {
+        return Error::Unsupported;
+    }
+#endif // __linux__
+
+    stats.reset();
+    dedup_index.clear();
+    read_root_length = p_plan.get_read_root().size() + 1;
+    write_root_length = p_plan.get_write_root().size() + 1;
+    _begin_sync(p_plan.get_write_root());
+
+    // The plan decides between copying and moving, the setting is left as it is.
+    bool move = p_plan.get_count(PackPlan::Operation::Move) > 0;
+
+    Vector<std::shared_ptr<Directory>> directories(p_plan.get_directory_count());
+    size_t batch_size = FileCopy::get_batch_size(copy_engine);
+
+    try {
+        std::unique_ptr<ThreadPool> pool;
+        if (ThreadPool::resolve_thread_count(thread_count) > 1) {
+            pool.reset(new ThreadPool(thread_count));
+        }
+
+        Vector<File> batch;
+        auto pack_batch = [this, &pool, move](Vector<File>& p_batch) {
+            if (pool) {
+                pool->push([this, p_batch, move]() mutable {
+                    _pack_batch(p_batch, move);
+                });
+                p_batch.clear();
+            } else {
+                _pack_batch(p_batch, move);
+            }
+        };
+
+        for (size_t i = 0; i < p_plan.get_entry_count(); ++i) {
+            PackPlan::Entry entry = p_plan.get_entry(i);
+            if (entry.operation == PackPlan::Operation::Skip) {
+                continue;
+            }
+
+            std::shared_ptr<Directory>& directory = directories[entry.directory];
+            if (!directory) {
+                directory = std::make_shared<Directory>(p_plan.get_directory_write_path(entry.directory));
+            }
+
+            File file(entry.read_path, directory);
+            file.write_path = std::move(entry.write_path);
+            file.matched = true;
+            if (overwrite_files == false && _destination_exists(file)) {
+                continue;
+            }
+
+            batch.push_back(std::move(file));
+            if (batch.size() >= batch_size) {
+                pack_batch(batch);
+            }
+        }
+
+        if (!batch.empty()) {
+            pack_batch(batch);
+        }
+        if (pool) {
+            pool->wait();
+        }
+        _end_sync();
+    } catch (...) {
+        dedup_index.clear();
+        manifest.clear();
+        throw;
+    }
+
+    // Executing a plan does not save the manifest, the entries recorded by the copies are dropped.
+    dedup_index.clear();
+    manifest.clear();
+    return Error::OK;
+}
+
+Error Packer::watch() {
+    if (output_mode != OutputMode::Directory) {
+        return Error::Unsupported;
+    }
+
+    String _read_path;
+    String _write_path;
+    Error error = _begin_pack(_read_path, _write_path);
+    if (error != Error::OK) {
+        return error;
+    }
+
+    String ignore_name;
+#ifdef IGNORE_FILE_ENABLED
+    if (ignore_file_enabled) {
+        ignore_name = ignore_file_name;
+    }
+#endif // IGNORE_FILE_ENABLED
+
+    // The tree is watched before the initial pack, so files written while it runs are packed afterwards.
+    error = watcher.open(_read_path, ignore_name);
+    if (error != Error::OK) {
+        return error;
     }
 
-    String _write_path = write_path;
-    normalize_path_separators(_write_path);
+    using Clock = std::chrono::steady_clock;
+    HashSet<String> files;
+    HashSet<String> directories;
+    Vector<DirectoryWatcher::Change> changes;
+    Clock::time_point first_change;
+    Clock::time_point last_change;
+    std::chrono::milliseconds delay(watch_delay);
+    bool warned = false;
+
+    try {
+        error = pack_files();
+        if (error != Error::OK) {
+            watcher.close();
+            return error;
+        }
+
+        while (true) {
+            bool pending = !files.empty() || !directories.empty();
+            Clock::time_point deadline = std::min(last_change + delay, first_change + delay * 10);
+            int timeout = -1;
+            if (pending) {
+                // Round up, so the batch is not checked a millisecond early.
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()) + std::chrono::milliseconds(1);
+                timeout = static_cast<int>(std::max<int64_t>(0, remaining.count()));
+            }
+
+            changes.clear();
+            if (!watcher.wait(timeout, changes)) {
+                break;
+            }
+
+            if (!changes.empty()) {
+                last_change = Clock::now();
+                if (!pending) {
+                    first_change = last_change;
+                }
+                for (const DirectoryWatcher::Change& change : changes) {
+                    if (change.type == DirectoryWatcher::ChangeType::File) {
+                        files.insert(change.path);
+                    } else {
+                        // Lost events leave only the whole tree to pack.
+                        directories.insert(change.type == DirectoryWatcher::ChangeType::Overflow ? String() : change.path);
+                    }
+                }
+                if (!warned && !watcher.is_complete()) {
+                    LOG_WARN("Some directories cannot be watched, their changes are only packed by the next full pack\n");
+                    warned = true;
+                }
+                pending = true;
+                deadline = std::min(last_change + delay, first_change + delay * 10);
+            }
 
-    _pack_files(_read_path, _write_path);
+            if (pending && Clock::now() >= deadline) {
+                _pack_changes(files, directories);
+                files.clear();
+                directories.clear();
+            }
+        }
+    } catch (...) {
+        watcher.close();
+        throw;
+    }
 
+    watcher.close();
     return Error::OK;
 }
 
+void Packer::stop_watch() {
+    watcher.stop();
+}
+
 Packer::Packer() :
 #ifdef IGNORE_FILE_ENABLED
     ignore_file_name(DEFAULT_IGNORE_FILE_NAME),
@@ -454,7 +2614,41 @@ Packer::Packer() :
     suffix_string(DEFAULT_SUFFIX_STRING),
     suffix_enabled(DEFAULT_SUFFIX_ENABLED),
     extension_insensitive(DEFAULT_EXTENSION_INSENSITIVE),
-    extension_adjust(DEFAULT_EXTENSION_ADJUST) {
+    extension_adjust(DEFAULT_EXTENSION_ADJUST),
+    thread_count(DEFAULT_THREAD_COUNT),
+    pipeline_enabled(DEFAULT_PIPELINE_ENABLED),
+    filter_thread_count(DEFAULT_FILTER_THREAD_COUNT),
+    copy_thread_count(DEFAULT_COPY_THREAD_COUNT),
+    post_thread_count(DEFAULT_POST_THREAD_COUNT),
+    queue_size(DEFAULT_QUEUE_SIZE),
+    copy_engine(DEFAULT_COPY_ENGINE),
+    clone_files(DEFAULT_CLONE_FILES),
+    traversal(DEFAULT_TRAVERSAL),
+    destination_index_enabled(DEFAULT_DESTINATION_INDEX_ENABLED),
+    incremental_enabled(DEFAULT_INCREMENTAL_ENABLED),
+    manifest_file_name(DEFAULT_MANIFEST_FILE_NAME),
+    quick_check_enabled(DEFAULT_QUICK_CHECK_ENABLED),
+    quick_check_tolerance(DEFAULT_QUICK_CHECK_TOLERANCE),
+    preserve_times(DEFAULT_PRESERVE_TIMES),
+    verify_files(DEFAULT_VERIFY_FILES),
+    split_copy_size(DEFAULT_SPLIT_COPY_SIZE),
+    durability(DEFAULT_DURABILITY),
+    sync_batch_files(DEFAULT_SYNC_BATCH_FILES),
+    sync_batch_size(DEFAULT_SYNC_BATCH_SIZE),
+    sync_files(0),
+    sync_bytes(0),
+    dedup_mode(DEFAULT_DEDUP_MODE),
+    output_mode(DEFAULT_OUTPUT_MODE),
+    compression(DEFAULT_COMPRESSION),
+    compression_block_size(DEFAULT_COMPRESSION_BLOCK_SIZE),
+    store_extensions(DEFAULT_STORE_EXTENSIONS),
+    watch_delay(DEFAULT_WATCH_DELAY),
+    plan_target(nullptr),
+    archive_target(nullptr),
+    tar_target(nullptr),
+    read_root_length(0),
+    write_root_length(0),
+    pack_time(0) {
 }
 
 PACKER_NAMESPACE_END
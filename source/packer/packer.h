@@ -2,8 +2,19 @@
 
 #pragma once
 
+#include "archive_writer.h"
 #include "config_file.h"
+#include "dedup_index.h"
+#include "directory_watcher.h"
+#include "extension_matcher.h"
+#include "file_copy.h"
+#include "bounded_queue.h"
+#include "manifest.h"
+#include "pack_plan.h"
+#include "path_builder.h"
+#include "tar_writer.h"
 #include "log.h"
+#include "thread_pool.h"
 
 PACKER_NAMESPACE_BEGIN
 
@@ -67,6 +78,162 @@ PACKER_NAMESPACE_BEGIN
  */
 #define DEFAULT_EXTENSION_ADJUST Packer::ExtensionAdjust::Default
 
+/**
+ * @def DEFAULT_THREAD_COUNT
+ * @brief The default number of threads used to walk the source directory.
+ */
+#define DEFAULT_THREAD_COUNT 1
+
+/**
+ * @def DEFAULT_PIPELINE_ENABLED
+ * @brief The default option to pack files with the staged pipeline.
+ */
+#define DEFAULT_PIPELINE_ENABLED false
+
+/**
+ * @def DEFAULT_FILTER_THREAD_COUNT
+ * @brief The default number of threads in the pipeline filter stage.
+ */
+#define DEFAULT_FILTER_THREAD_COUNT 1
+
+/**
+ * @def DEFAULT_COPY_THREAD_COUNT
+ * @brief The default number of threads in the pipeline copy stage.
+ */
+#define DEFAULT_COPY_THREAD_COUNT 4
+
+/**
+ * @def DEFAULT_POST_THREAD_COUNT
+ * @brief The default number of threads in the pipeline post-action stage.
+ */
+#define DEFAULT_POST_THREAD_COUNT 1
+
+/**
+ * @def DEFAULT_QUEUE_SIZE
+ * @brief The default capacity of the queues joining the pipeline stages.
+ */
+#define DEFAULT_QUEUE_SIZE 1024
+
+/**
+ * @def DEFAULT_COPY_ENGINE
+ * @brief The default engine used to copy file data.
+ */
+#define DEFAULT_COPY_ENGINE FileCopy::Engine::Filesystem
+
+/**
+ * @def DEFAULT_CLONE_FILES
+ * @brief The default option to clone files on copy-on-write filesystems.
+ */
+#define DEFAULT_CLONE_FILES false
+
+/**
+ * @def DEFAULT_DESTINATION_INDEX_ENABLED
+ * @brief The default option to answer destination existence checks from an in-memory index.
+ */
+#define DEFAULT_DESTINATION_INDEX_ENABLED false
+
+/**
+ * @def DEFAULT_INCREMENTAL_ENABLED
+ * @brief The default option to skip files that are unchanged since the last pack.
+ */
+#define DEFAULT_INCREMENTAL_ENABLED false
+
+/**
+ * @def DEFAULT_MANIFEST_FILE_NAME
+ * @brief The default name of the manifest file saved in the destination directory.
+ */
+#define DEFAULT_MANIFEST_FILE_NAME ".pkmanifest"
+
+/**
+ * @def DEFAULT_QUICK_CHECK_ENABLED
+ * @brief The default option to compare existing destinations by size and modification time.
+ */
+#define DEFAULT_QUICK_CHECK_ENABLED false
+
+/**
+ * @def DEFAULT_QUICK_CHECK_TOLERANCE
+ * @brief The default largest modification time difference accepted by the quick check, in milliseconds.
+ */
+#define DEFAULT_QUICK_CHECK_TOLERANCE 0
+
+/**
+ * @def DEFAULT_PRESERVE_TIMES
+ * @brief The default option to give copies the modification times of their sources.
+ */
+#define DEFAULT_PRESERVE_TIMES false
+
+/**
+ * @def DEFAULT_VERIFY_FILES
+ * @brief The default option to read copies back and check them against their sources.
+ */
+#define DEFAULT_VERIFY_FILES false
+
+/**
+ * @def DEFAULT_SPLIT_COPY_SIZE
+ * @brief The default size in megabytes from which a file is copied in ranges by several threads, 0 to never split.
+ */
+#define DEFAULT_SPLIT_COPY_SIZE 0
+
+/**
+ * @def DEFAULT_DURABILITY
+ * @brief The default policy deciding when copies are flushed to the destination device.
+ */
+#define DEFAULT_DURABILITY Packer::Durability::None
+
+/**
+ * @def DEFAULT_SYNC_BATCH_FILES
+ * @brief The default number of copies after which the batched durability policy syncs the destination.
+ */
+#define DEFAULT_SYNC_BATCH_FILES 1000
+
+/**
+ * @def DEFAULT_SYNC_BATCH_SIZE
+ * @brief The default number of megabytes copied after which the batched durability policy syncs the destination.
+ */
+#define DEFAULT_SYNC_BATCH_SIZE 256
+
+/**
+ * @def DEFAULT_DEDUP_MODE
+ * @brief The default way files with the same content as an earlier file are written.
+ */
+#define DEFAULT_DEDUP_MODE Packer::DedupMode::None
+
+/**
+ * @def DEFAULT_OUTPUT_MODE
+ * @brief The default form the packed files are written in.
+ */
+#define DEFAULT_OUTPUT_MODE Packer::OutputMode::Directory
+
+/**
+ * @def DEFAULT_COMPRESSION
+ * @brief The default codec compressing the files of an archive.
+ */
+#define DEFAULT_COMPRESSION Codec::Type::None
+
+/**
+ * @def DEFAULT_COMPRESSION_BLOCK_SIZE
+ * @brief The default number of bytes of a file compressed in each block.
+ */
+#define DEFAULT_COMPRESSION_BLOCK_SIZE (1 << 20)
+
+/**
+ * @def DEFAULT_STORE_EXTENSIONS
+ * @brief The default extensions of already compressed formats, stored in archives without compression.
+ */
+#define DEFAULT_STORE_EXTENSIONS StringVector({ "7z", "bz2", "gif", "gz", "jpeg", "jpg", "mp3", "mp4", "ogg", "png", "rar", "webm", "webp", "xz", "zip", "zst" })
+
+/**
+ * @def DEFAULT_WATCH_DELAY
+ * @brief The default time in milliseconds changes must settle for before watch mode packs them.
+ */
+#define DEFAULT_WATCH_DELAY 500
+
+/**
+ * @def DEFAULT_TRAVERSAL
+ * @brief The default backend used to walk the source directory.
+ */
+#define DEFAULT_TRAVERSAL Packer::Traversal::Filesystem
+
 #ifdef IGNORE_FILE_ENABLED
 /**
  * @def DEFAULT_IGNORE_FILE_NAME
@@ -125,6 +292,54 @@ public:
         Max           ///< The maximum value for the ExtensionAdjust enumeration.
     };
 
+    /**
+     * @enum Traversal
+     * @brief Enumeration defining the backends used to walk the source directory.
+     */
+    enum class Traversal {
+        Unknown = -1, ///< An unknown traversal backend.
+        Filesystem,   ///< Walk with std::filesystem, resolving the full path of every entry.
+        Posix,        ///< Walk with an open directory descriptor per level and the `*at` system calls.
+        Max           ///< The maximum value for the Traversal enumeration.
+    };
+
+    /**
+     * @enum DedupMode
+     * @brief Enumeration defining how files with the same content as an earlier file are written.
+     */
+    enum class DedupMode {
+        Unknown = -1, ///< An unknown deduplication mode.
+        None,         ///< Copy every file.
+        HardLink,     ///< Hard link duplicates to the first destination with the same content.
+        Reflink,      ///< Clone duplicates from the first destination with the same content, where the filesystem supports it.
+        Max           ///< The maximum value for the DedupMode enumeration.
+    };
+
+    /**
+     * @enum OutputMode
+     * @brief Enumeration defining the form the packed files are written in.
+     */
+    enum class OutputMode {
+        Unknown = -1, ///< An unknown output mode.
+        Directory,    ///< Write each file to the destination directory.
+        Archive,      ///< Write every file into a single archive at the destination path.
+        Tar,          ///< Stream every file as a tar archive to the destination path or to standard output.
+        Max           ///< The maximum value for the OutputMode enumeration.
+    };
+
+    /**
+     * @enum Durability
+     * @brief Enumeration defining when copies are flushed to the destination device.
+     */
+    enum class Durability {
+        Unknown = -1, ///< An unknown durability policy.
+        None,         ///< Leave flushing to the operating system.
+        File,         ///< Flush each copy with fdatasync before it is reported.
+        Batch,        ///< Sync the destination filesystem after a number of files or bytes have been copied.
+        End,          ///< Sync the destination filesystem once, at the end of the pack.
+        Max           ///< The maximum value for the Durability enumeration.
+    };
+
     /**
      * @brief A callback function type for post-pack file operations notification.
      * @param p_read_path The source path of the file that was packed.
@@ -134,6 +349,81 @@ public:
     using Callback = void (*)(const String& p_read_path, const String& p_write_path, bool p_move);
 
 private:
+    /**
+     * @struct Directory
+     * @brief A destination directory shared by the files packed from one source directory.
+     *
+     * With the POSIX traversal the directory holds its open source and destination directories. A directory is
+     * only opened once its listing starts and is closed once its listing and the copies of its files finish, the
+     * link to its parent does not keep the parent open. Past a quarter of the descriptor limit, directories are
+     * only open while they are listed and their files are copied by path, so a wide tree never runs out of
+     * descriptors however many of its directories are queued or have files in flight.
+     */
+    struct Directory {
+        String write_path; ///< The destination directory path.
+        std::atomic<bool> created; ///< Flag indicating whether the destination directory has been created.
+
+        std::weak_ptr<Directory> parent; ///< The parent directory, used by the POSIX traversal to open and create this directory while the parent is open.
+        String name; ///< The name of the directory inside its parent.
+        int read_fd; ///< The open source directory with the POSIX traversal once its listing has started, -1 when its files are copied by path.
+        int write_fd; ///< The open destination directory once it has been created with the POSIX traversal, -1 otherwise.
+        std::atomic<bool> synced; ///< Flag indicating whether the entry of the destination directory in its parent has been synced.
+        std::mutex mutex; ///< Guards the creation of the destination directory.
+
+        HashSet<String> index; ///< The names found in the destination directory, when the destination index is enabled.
+        bool indexed; ///< Flag indicating whether the destination directory has been listed into the index.
+        std::mutex index_mutex; ///< Guards the destination index.
+
+        size_t plan_index; ///< The index of the directory in the plan being built, or `SIZE_MAX` before it is added.
+        bool planned; ///< Flag indicating whether the plan being built writes to the directory.
+
+        /**
+         * @brief Constructor for the Directory struct.
+         * @param p_write_path The destination directory path.
+         * @param p_parent The parent directory.
+         * @param p_name The name of the directory inside its parent.
+         */
+        Directory(const String& p_write_path, const std::shared_ptr<Directory>& p_parent = nullptr, const String& p_name = "");
+
+        /**
+         * @brief Destructor for the Directory struct, closes the open directories.
+         */
+        ~Directory();
+    };
+
+    /**
+     * @struct File
+     * @brief A file travelling through the pack stages.
+     */
+    struct File {
+        String read_path; ///< The source file path.
+        String write_path; ///< The destination file path, set by the filter stage.
+        std::shared_ptr<Directory> directory; ///< The destination directory of the file.
+        FileCopy::Method method; ///< The method the file data was copied with, set by the copy stage.
+        uint64_t bytes; ///< The number of bytes written for the file, set by the copy stage.
+        Manifest::FileState state; ///< The state of the source file, set by the filter stage in incremental mode.
+        bool state_valid; ///< Flag indicating whether the state of the source file was read.
+        bool matched; ///< Flag indicating whether the file is already known to pass the pack mode.
+
+        /**
+         * @brief Default constructor for the File struct.
+         */
+        File();
+
+        /**
+         * @brief Constructor for the File struct.
+         * @param p_read_path The source file path.
+         * @param p_directory The destination directory of the file.
+         */
+        File(const String& p_read_path, const std::shared_ptr<Directory>& p_directory);
+    };
+
+    /**
+     * @typedef FileQueue
+     * @brief A bounded queue joining two pack stages.
+     */
+    using FileQueue = BoundedQueue<File>;
+
     String read_path; ///< The source directory to pack files from.
     String write_path; ///< The destination directory to write packed files to.
 
@@ -149,6 +439,57 @@ private:
     bool extension_insensitive; ///< Flag indicating case-insensitivity for extensions.
     ExtensionAdjust extension_adjust; ///< The adjustment to apply to file extensions.
 
+    int thread_count; ///< The number of threads used to walk the source directory, 0 for all hardware threads.
+
+    bool pipeline_enabled; ///< Flag indicating whether files are packed with the staged pipeline.
+    int filter_thread_count; ///< The number of threads in the pipeline filter stage.
+    int copy_thread_count; ///< The number of threads in the pipeline copy stage.
+    int post_thread_count; ///< The number of threads in the pipeline post-action stage.
+    int queue_size; ///< The capacity of the queues joining the pipeline stages.
+
+    FileCopy::Engine copy_engine; ///< The engine used to copy file data.
+    bool clone_files; ///< Flag indicating whether files are cloned when the source and destination share a filesystem.
+
+    Traversal traversal; ///< The backend used to walk the source directory.
+    bool destination_index_enabled; ///< Flag indicating whether destination existence checks are answered from an in-memory index.
+
+    bool incremental_enabled; ///< Flag indicating whether files unchanged since the last pack are skipped.
+    String manifest_file_name; ///< The name of the manifest file saved in the destination directory.
+    bool quick_check_enabled; ///< Flag indicating whether existing destinations are compared by size and modification time.
+    int quick_check_tolerance; ///< The largest modification time difference accepted by the quick check, in milliseconds.
+    bool preserve_times; ///< Flag indicating whether copies receive the modification times of their sources.
+    bool verify_files; ///< Flag indicating whether copies are read back and checked against their sources.
+    int split_copy_size; ///< The size in megabytes from which a file is copied in ranges by several threads, 0 to never split.
+    Durability durability; ///< When copies are flushed to the destination device.
+    int sync_batch_files; ///< The number of copies after which the batched durability policy syncs the destination.
+    int sync_batch_size; ///< The number of megabytes copied after which the batched durability policy syncs the destination.
+    std::mutex sync_mutex; ///< Guards the copies waiting for a sync.
+    String sync_path; ///< The destination directory of the current pack, whose filesystem is synced.
+    uint64_t sync_files; ///< The number of files copied since the last sync.
+    uint64_t sync_bytes; ///< The number of bytes copied since the last sync.
+    Vector<String> sync_sources; ///< The sources of moved files, removed once a sync has made their copies durable.
+    DedupMode dedup_mode; ///< How files with the same content as an earlier file are written.
+    DedupIndex dedup_index; ///< The files written by the current pack, grouped by content.
+    OutputMode output_mode; ///< The form the packed files are written in.
+    Codec::Type compression; ///< The codec compressing the files of an archive.
+    int compression_block_size; ///< The number of bytes of a file compressed in each block.
+    Vector<String> store_extensions; ///< The extensions of files stored in archives without compression.
+    int watch_delay; ///< The time in milliseconds changes must settle for before watch mode packs them.
+    PackPlan* plan_target; ///< The plan receiving the files instead of copying them, nullptr when packing.
+    ArchiveWriter* archive_target; ///< The archive receiving the files of the current pack, nullptr when writing a directory.
+    TarWriter* tar_target; ///< The tar stream receiving the files of the current pack, nullptr when not streaming.
+    DirectoryWatcher watcher; ///< Watches the source directory in watch mode.
+    Manifest previous_manifest; ///< The manifest saved by the last pack.
+    Manifest manifest; ///< The manifest of the current pack.
+    size_t read_root_length; ///< The length of the source directory path of the current pack, including the separator.
+    size_t write_root_length; ///< The length of the destination directory path of the current pack, including the separator.
+    int64_t pack_time; ///< The time the current pack started, in nanoseconds of the clock used by directory times.
+
+    ExtensionMatcher extension_matcher; ///< The extensions compiled for matching at the start of each pack.
+    ExtensionMatcher store_matcher; ///< The store extensions compiled for matching at the start of each pack.
+
+    PackStats stats; ///< The counters collected during the last pack.
+
 #ifdef IGNORE_FILE_ENABLED
     String ignore_file_name; ///< The name of the ignore file to use.
     bool ignore_file_enabled; ///< Flag indicating whether ignore files are enabled.
@@ -160,10 +501,319 @@ private:
 
     /**
      * @brief Recursively packs files from the source directory to the destination directory.
+     *
+     * When a thread pool is given, sub-directories are queued on the pool instead of being walked recursively.
+     * When a queue is given, files are pushed to it instead of being packed on the calling thread.
+     *
      * @param p_read_path The current source directory to pack files from.
      * @param p_write_path The current destination directory to write packed files to.
+     * @param p_pool The thread pool walking the tree, or nullptr to walk it on the calling thread.
+     * @param p_queue The queue receiving the files found, or nullptr to pack them immediately.
+     */
+    void _pack_files(const String& p_read_path, const String& p_write_path, ThreadPool* p_pool, FileQueue* p_queue);
+
+#ifdef __linux__
+    /**
+     * @brief Recursively packs files from an open source directory with the POSIX traversal.
+     *
+     * Each directory is listed with large `getdents64` batches and entries are classified from their `d_type`,
+     * the ignore file is found in the same listing. Sub-directories are opened with `openat`, so no path is
+     * resolved from the root again. Threads and queues are used as in `_pack_files`.
+     *
+     * @param p_read_path The current source directory path, used to name the files found.
+     * @param p_directory The current directory, its source directory must be open.
+     * @param p_pool The thread pool walking the tree, or nullptr to walk it on the calling thread.
+     * @param p_queue The queue receiving the files found, or nullptr to pack them immediately.
+     */
+    void _pack_directory(const String& p_read_path, const std::shared_ptr<Directory>& p_directory, ThreadPool* p_pool, FileQueue* p_queue);
+#endif // __linux__
+
+    /**
+     * @brief Walks the source directory with the selected traversal backend.
+     * @param p_read_path The source directory to pack files from.
+     * @param p_write_path The destination directory to write packed files to.
+     * @param p_pool The thread pool walking the tree, or nullptr to walk it on the calling thread.
+     * @param p_queue The queue receiving the files found, or nullptr to pack them immediately.
+     */
+    void _pack_root(const String& p_read_path, const String& p_write_path, ThreadPool* p_pool, FileQueue* p_queue);
+
+    /**
+     * @brief Creates the destination directory of a directory and its parents, once.
+     * @param p_directory The directory to create.
+     */
+    void _create_directory(Directory& p_directory);
+
+    /**
+     * @brief Checks if a file exists in its destination directory using the destination index.
+     *
+     * The destination directory is listed once, in bulk, the first time one of its files is checked.
+     *
+     * @param p_directory The directory of the file.
+     * @param p_name The destination name of the file.
+     * @return `true` if the file exists in the destination directory, `false` otherwise.
      */
-    void _pack_files(const String& p_read_path, const String& p_write_path);
+    bool _is_indexed(Directory& p_directory, const char* p_name) const;
+
+    /**
+     * @brief Gets the files this thread keeps for reuse, so their paths keep their capacity.
+     * @return The files kept for reuse.
+     */
+    static Vector<File>& _get_spare_files();
+
+    /**
+     * @brief Takes a file kept for reuse by this thread, or a new file when there are none.
+     * @param p_read_path The source file path.
+     * @param p_directory The destination directory of the file.
+     * @return The file.
+     */
+    static File _take_file(const PathBuilder& p_read_path, const std::shared_ptr<Directory>& p_directory);
+
+    /**
+     * @brief Keeps a file for reuse by this thread.
+     * @param p_file The file, its paths are moved out.
+     */
+    static void _recycle_file(File& p_file);
+
+    /**
+     * @brief Keeps the files of a batch for reuse by this thread, from an index on, and removes them from the batch.
+     * @param p_files The files.
+     * @param p_offset The index of the first file to keep.
+     */
+    static void _recycle_files(Vector<File>& p_files, size_t p_offset = 0);
+
+    /**
+     * @brief Copies and finishes a batch of filtered files, then clears the batch.
+     * @param p_files The files to pack.
+     * @param p_move `true` to move the files, `false` to copy them.
+     */
+    void _pack_batch(Vector<File>& p_files, bool p_move);
+
+    /**
+     * @brief Applies the pack mode, suffix removal, extension adjustment, incremental and overwrite rules to a file.
+     * @param p_file The file to filter, its write path is set when it should be packed.
+     * @return `true` if the file should be packed, `false` if it should be skipped.
+     */
+    bool _filter_file(File& p_file);
+
+    /**
+     * @brief Checks if the destination of a filtered file exists.
+     * @param p_file The file.
+     * @return `true` if the destination exists, `false` otherwise.
+     */
+    bool _destination_exists(File& p_file);
+
+    /**
+     * @brief Checks if a file passes the pack mode and extension list.
+     * @param p_read_path The source file path.
+     * @return `true` if the file passes, `false` if it should be skipped.
+     */
+    bool _match_file(const String& p_read_path) const;
+
+    /**
+     * @brief Computes a key summarizing the settings that decide which entries a directory listing keeps.
+     * @return The filter key.
+     */
+    uint64_t _get_filter_key() const;
+
+    /**
+     * @brief Reads the modification time, change time and inode of a source directory.
+     * @param p_read_path The source directory path.
+     * @param p_fd The open source directory, or -1 to use the path.
+     * @param p_state Receives the state of the directory.
+     * @return `true` if the state was read, `false` otherwise.
+     */
+    bool _get_directory_state(const String& p_read_path, int p_fd, Manifest::DirectoryState& p_state) const;
+
+    /**
+     * @brief Finds the cached listing of an unchanged source directory in the previous manifest.
+     *
+     * A listing that is found is also added to the current manifest, it stays valid until the directory changes.
+     *
+     * @param p_read_path The source directory path.
+     * @param p_state The current state of the directory.
+     * @param p_listing Receives the cached listing.
+     * @return `true` if the directory is unchanged since it was cached, `false` otherwise.
+     */
+    bool _find_listing(const String& p_read_path, const Manifest::DirectoryState& p_state, Manifest::Listing& p_listing);
+
+    /**
+     * @brief Caches the listing of a source directory in the current manifest.
+     *
+     * Directories changed too close to the start of the pack are not cached, a change made after they were listed
+     * could leave their timestamps unchanged.
+     *
+     * @param p_read_path The source directory path.
+     * @param p_state The state of the directory before it was listed.
+     * @param p_listing The listing to cache.
+     */
+    void _cache_listing(const String& p_read_path, const Manifest::DirectoryState& p_state, const Manifest::Listing& p_listing);
+
+    /**
+     * @brief Reads the size, modification time and inode of a source file.
+     * @param p_file The file to read the state of.
+     * @param p_state Receives the state of the file.
+     * @return `true` if the state was read, `false` otherwise.
+     */
+    bool _get_source_state(const File& p_file, Manifest::FileState& p_state) const;
+
+    /**
+     * @brief Checks the settings and prepares the state shared by packing and planning.
+     * @param p_read_path Receives the normalized source directory.
+     * @param p_write_path Receives the normalized destination directory.
+     * @return An `Error` code indicating whether the settings allow a pack.
+     */
+    Error _begin_pack(String& p_read_path, String& p_write_path);
+
+    /**
+     * @brief Walks the source directory with the configured threads, without the pipeline.
+     * @param p_read_path The source directory.
+     * @param p_write_path The destination directory.
+     */
+    void _walk(const String& p_read_path, const String& p_write_path);
+
+    /**
+     * @brief Get the copy options described by the settings.
+     * @return The copy options.
+     */
+    FileCopy::Options _get_copy_options() const;
+
+    /**
+     * @brief Adds a file to the plan being built.
+     * @param p_file The file.
+     * @param p_operation The operation performed on the file.
+     * @param p_reason The reason the file is skipped.
+     */
+    void _plan_file(File& p_file, PackPlan::Operation p_operation, PackPlan::Reason p_reason = PackPlan::Reason::None);
+
+    /**
+     * @brief Flags the missing ancestors of the destination directories a plan creates, adding them to the plan.
+     * @param p_plan The plan.
+     */
+    void _plan_directories(PackPlan& p_plan) const;
+
+    /**
+     * @brief Writes a file as a link or clone of an earlier destination with the same content.
+     *
+     * Only files whose destination does not exist yet are deduplicated, existing destinations are left to the
+     * copy rules. A hard linked destination carries the times of the first file it was written for, so when
+     * overwriting, one that is out of date by the quick check is still up to date if its content matches its
+     * source. Files that cannot be linked or cloned, such as files on another filesystem, are copied.
+     *
+     * @param p_file The file to deduplicate, its source state is read if needed.
+     * @param p_result Receives how the file was written, its method is `FileCopy::Method::None` for an up to date destination.
+     * @return `true` if the file was deduplicated or is up to date, `false` if it still has to be copied.
+     */
+    bool _deduplicate_file(File& p_file, FileCopy::Result& p_result);
+
+    /**
+     * @brief Copies a batch of filtered files to their destinations, creating the destination directories if needed.
+     *
+     * The files are copied together with FileCopy::copy_batch, so the io_uring engine can submit their system
+     * calls in shared rounds. A failure does not stop the rest of the batch from being copied.
+     *
+     * With deduplication, each file is first looked up among the files already written by the pack.
+     *
+     * @param p_files The files to copy, only the files that were copied are kept.
+     * @param p_move `true` to move the files, `false` to copy them.
+     * @return The exception describing the first file that failed to copy, or nullptr.
+     */
+    std::exception_ptr _copy_files(Vector<File>& p_files, bool p_move);
+
+    /**
+     * @brief Runs the post-copy actions for a batch of files: removal when moving, the callback and logging.
+     * @param p_files The files that were copied.
+     * @param p_move `true` if the files were moved, `false` if they were copied.
+     */
+    void _finish_files(const Vector<File>& p_files, bool p_move);
+
+    /**
+     * @brief Flushes the entries of a destination directory to its device with fsync.
+     *
+     * The first sync of a directory also syncs its parents, so the entries of newly created directories are
+     * durable too. Used before the sources of moved files are removed under the per-file durability policy.
+     *
+     * @param p_directory The directory to sync.
+     * @throws FileAccess::filesystem_error If the directory cannot be opened or synced.
+     */
+    void _sync_directory(Directory& p_directory);
+
+    /**
+     * @brief Counts a batch of copies towards the next sync of the batched and end-of-run durability policies.
+     *
+     * The sources of moved files are kept until a sync covers their copies. Under the batched policy, the
+     * destination is synced and the kept sources removed once enough files or bytes have been copied.
+     *
+     * @param p_files The files that were copied.
+     * @param p_move `true` if the files were moved, `false` if they were copied.
+     * @throws FileAccess::filesystem_error If the destination cannot be synced or a source cannot be removed.
+     */
+    void _queue_sync(const Vector<File>& p_files, bool p_move);
+
+    /**
+     * @brief Syncs the destination filesystem, then removes the sources of the moved files it made durable.
+     *
+     * A source is only removed after a successful sync, so a failed sync leaves it in place.
+     *
+     * @throws FileAccess::filesystem_error If the destination cannot be synced or a source cannot be removed.
+     */
+    void _sync_destination();
+
+    /**
+     * @brief Starts tracking the copies of a pack for the durability policy.
+     * @param p_write_path The destination directory of the pack.
+     */
+    void _begin_sync(const String& p_write_path);
+
+    /**
+     * @brief Syncs the copies of a pack that are still waiting for a sync, at the end of the pack.
+     * @throws FileAccess::filesystem_error If the destination cannot be synced or a source cannot be removed.
+     */
+    void _end_sync();
+
+    /**
+     * @brief Adds a batch of filtered files to the archive or the tar stream being written, then runs the callback and logging.
+     * @param p_files The files to add.
+     */
+    void _archive_files(const Vector<File>& p_files);
+
+    /**
+     * @brief Packs files into a single archive.
+     * @param p_read_path The source directory to pack files from.
+     * @param p_write_path The path of the archive.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error _pack_archive(const String& p_read_path, const String& p_write_path);
+
+    /**
+     * @brief Streams files as a tar archive, starting as soon as the first file is found.
+     * @param p_read_path The source directory to pack files from.
+     * @param p_write_path The path of the tar file, or `TarWriter::standard_output_path`.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error _pack_tar(const String& p_read_path, const String& p_write_path);
+
+    /**
+     * @brief Packs the files and directories changed since the last batch of watch mode.
+     *
+     * Directories are walked like the source directory and files are filtered and packed on their own, files and
+     * directories inside a changed directory are packed with it. In incremental mode the manifest is saved after
+     * every batch. Errors are logged so watching can continue.
+     *
+     * @param p_files The changed files, relative to the source directory.
+     * @param p_directories The changed directories, relative to the source directory, empty for the whole tree.
+     */
+    void _pack_changes(const HashSet<String>& p_files, const HashSet<String>& p_directories);
+
+    /**
+     * @brief Packs files through the staged pipeline.
+     *
+     * Directory enumeration, filtering, copying and post-copy actions each run on their own threads and
+     * are joined by bounded queues, so copying starts before the walk has finished.
+     *
+     * @param p_read_path The source directory to pack files from.
+     * @param p_write_path The destination directory to write packed files to.
+     */
+    void _pack_pipeline(const String& p_read_path, const String& p_write_path);
 
 public:
     /**
@@ -194,6 +844,62 @@ public:
      */
     static ExtensionAdjust find_extension_adjust(const String& p_adjust);
 
+    /**
+     * @brief Get a string representation of a Traversal enum value.
+     * @param p_traversal The Traversal enum value.
+     * @return A string representation of the Traversal.
+     */
+    static String get_traversal_name(Traversal p_traversal);
+
+    /**
+     * @brief Find a Traversal enum value based on its string representation.
+     * @param p_traversal The string representation of the Traversal.
+     * @return The corresponding Traversal enum value.
+     */
+    static Traversal find_traversal(const String& p_traversal);
+
+    /**
+     * @brief Get a string representation of a DedupMode enum value.
+     * @param p_mode The DedupMode enum value.
+     * @return A string representation of the DedupMode.
+     */
+    static String get_dedup_mode_name(DedupMode p_mode);
+
+    /**
+     * @brief Find a DedupMode enum value based on its string representation.
+     * @param p_mode The string representation of the DedupMode.
+     * @return The corresponding DedupMode enum value.
+     */
+    static DedupMode find_dedup_mode(const String& p_mode);
+
+    /**
+     * @brief Get a string representation of an OutputMode enum value.
+     * @param p_mode The OutputMode enum value.
+     * @return A string representation of the OutputMode.
+     */
+    static String get_output_mode_name(OutputMode p_mode);
+
+    /**
+     * @brief Find an OutputMode enum value based on its string representation.
+     * @param p_mode The string representation of the OutputMode.
+     * @return The corresponding OutputMode enum value.
+     */
+    static OutputMode find_output_mode(const String& p_mode);
+
+    /**
+     * @brief Get a string representation of a Durability enum value.
+     * @param p_durability The Durability enum value.
+     * @return A string representation of the Durability.
+     */
+    static String get_durability_name(Durability p_durability);
+
+    /**
+     * @brief Find a Durability enum value based on its string representation.
+     * @param p_durability The string representation of the Durability.
+     * @return The corresponding Durability enum value.
+     */
+    static Durability find_durability(const String& p_durability);
+
     /**
      * @brief Set a callback function to be notified after post-pack file operations.
      * @param p_callback The callback function to set.
@@ -295,6 +1001,9 @@ public:
 
     /**
      * @brief Set whether to move files instead of copying them.
+     *
+     * On Linux, files on the same device as the destination are renamed instead of copied and removed.
+     *
      * @param p_enable `true` to enable moving, `false` to disable it.
      */
     void set_move_files(bool p_enable);
@@ -353,6 +1062,449 @@ public:
      */
     ExtensionAdjust get_extension_adjust() const;
 
+    /**
+     * @brief Set the number of threads used to walk the source directory.
+     *
+     * With more than one thread, directories are walked by a work-stealing thread pool. The files that
+     * are packed are the same as with a single thread, but the order in which they are packed is not.
+     *
+     * @param p_count The number of threads, or 0 to use every hardware thread.
+     */
+    void set_thread_count(int p_count);
+
+    /**
+     * @brief Get the number of threads used to walk the source directory.
+     * @return The number of threads, or 0 if every hardware thread is used.
+     */
+    int get_thread_count() const;
+
+    /**
+     * @brief Enable or disable the staged pipeline.
+     *
+     * The pipeline splits packing into directory enumeration, filtering, copying and post-copy actions, each
+     * running on its own threads and joined by bounded queues. Enumeration uses the thread count.
+     *
+     * @param p_enable `true` to enable the pipeline, `false` to disable it.
+     */
+    void set_pipeline_enabled(bool p_enable);
+
+    /**
+     * @brief Check if the staged pipeline is enabled.
+     * @return `true` if the pipeline is enabled, `false` otherwise.
+     */
+    bool get_pipeline_enabled() const;
+
+    /**
+     * @brief Set the number of threads in the pipeline filter stage.
+     * @param p_count The number of threads, or 0 to use every hardware thread.
+     */
+    void set_filter_thread_count(int p_count);
+
+    /**
+     * @brief Get the number of threads in the pipeline filter stage.
+     * @return The number of threads, or 0 if every hardware thread is used.
+     */
+    int get_filter_thread_count() const;
+
+    /**
+     * @brief Set the number of threads in the pipeline copy stage.
+     * @param p_count The number of threads, or 0 to use every hardware thread.
+     */
+    void set_copy_thread_count(int p_count);
+
+    /**
+     * @brief Get the number of threads in the pipeline copy stage.
+     * @return The number of threads, or 0 if every hardware thread is used.
+     */
+    int get_copy_thread_count() const;
+
+    /**
+     * @brief Set the number of threads in the pipeline post-action stage.
+     * @param p_count The number of threads, or 0 to use every hardware thread.
+     */
+    void set_post_thread_count(int p_count);
+
+    /**
+     * @brief Get the number of threads in the pipeline post-action stage.
+     * @return The number of threads, or 0 if every hardware thread is used.
+     */
+    int get_post_thread_count() const;
+
+    /**
+     * @brief Set the capacity of the queues joining the pipeline stages.
+     * @param p_size The maximum number of files waiting between two stages, at least 1.
+     */
+    void set_queue_size(int p_size);
+
+    /**
+     * @brief Get the capacity of the queues joining the pipeline stages.
+     * @return The maximum number of files waiting between two stages.
+     */
+    int get_queue_size() const;
+
+    /**
+     * @brief Set the engine used to copy file data.
+     *
+     * The kernel engine is only available on Linux, other platforms copy with std::filesystem instead.
+     * The method each file was actually copied with is logged and counted in the stats.
+     *
+     * @param p_engine The copy engine to set.
+     */
+    void set_copy_engine(FileCopy::Engine p_engine);
+
+    /**
+     * @brief Get the engine used to copy file data.
+     * @return The current copy engine.
+     */
+    FileCopy::Engine get_copy_engine() const;
+
+    /**
+     * @brief Set whether files are cloned when the source and destination share a filesystem.
+     *
+     * Cloned files share their data extents with the source (FICLONE on btrfs, XFS and similar filesystems).
+     * Files that cannot be cloned are copied with the copy engine. Cloned and copied files are counted in the stats.
+     *
+     * @param p_enable `true` to enable cloning, `false` to disable it.
+     */
+    void set_clone_files(bool p_enable);
+
+    /**
+     * @brief Check if files are cloned when the source and destination share a filesystem.
+     * @return `true` if cloning is enabled, `false` otherwise.
+     */
+    bool get_clone_files() const;
+
+    /**
+     * @brief Set the backend used to walk the source directory.
+     *
+     * The POSIX traversal keeps the source and destination directory of each level open and resolves entries
+     * relative to them with `openat`, `fstatat`, `mkdirat` and `unlinkat`. It is only available on Linux, other
+     * platforms walk with std::filesystem instead.
+     *
+     * @param p_traversal The traversal backend to set.
+     */
+    void set_traversal(Traversal p_traversal);
+
+    /**
+     * @brief Get the backend used to walk the source directory.
+     * @return The current traversal backend.
+     */
+    Traversal get_traversal() const;
+
+    /**
+     * @brief Set whether destination existence checks are answered from an in-memory index.
+     *
+     * When overwriting is disabled, each destination directory is listed once into an in-memory set instead of
+     * checking every file with its own system call. The set is updated as files are written and is released
+     * with its directory, so memory stays bounded by the directories in flight rather than the whole tree.
+     *
+     * @param p_enable `true` to enable the destination index, `false` to disable it.
+     */
+    void set_destination_index_enabled(bool p_enable);
+
+    /**
+     * @brief Check if destination existence checks are answered from an in-memory index.
+     * @return `true` if the destination index is enabled, `false` otherwise.
+     */
+    bool get_destination_index_enabled() const;
+
+    /**
+     * @brief Set whether files unchanged since the last pack are skipped.
+     *
+     * In incremental mode, each pack saves a manifest in the destination directory recording the source path,
+     * size, modification time and inode of every file it packed or found up to date, along with its destination path. On the next
+     * pack, files whose recorded state and destination still match are skipped without being opened. Files
+     * that are moved are not recorded, their source no longer exists.
+     *
+     * The manifest also caches the listing of each source directory with its modification time, change time and
+     * inode. A directory whose state is unchanged is not listed or filtered again: its cached sub-directories are
+     * walked and its cached files are checked against the manifest directly. Directories changed shortly before
+     * or during a pack are not cached, since a later change could keep the same timestamps.
+     *
+     * @param p_enable `true` to enable incremental mode, `false` to disable it.
+     */
+    void set_incremental_enabled(bool p_enable);
+
+    /**
+     * @brief Check if files unchanged since the last pack are skipped.
+     * @return `true` if incremental mode is enabled, `false` otherwise.
+     */
+    bool get_incremental_enabled() const;
+
+    /**
+     * @brief Set the name of the manifest file saved in the destination directory.
+     * @param p_name The name of the manifest file.
+     */
+    void set_manifest_file_name(const String& p_name);
+
+    /**
+     * @brief Get the name of the manifest file saved in the destination directory.
+     * @return The name of the manifest file.
+     */
+    const String& get_manifest_file_name() const;
+
+    /**
+     * @brief Set whether existing destinations are compared by size and modification time.
+     *
+     * By default, an existing destination is replaced whenever it is older than its source, even when only the
+     * timestamps differ. With the quick check, it is kept when it has the same size and modification time as the
+     * source, within the tolerance, and replaced otherwise. Enable preserved times so the copies keep matching
+     * their sources on later packs.
+     *
+     * @param p_enable `true` to enable the quick check, `false` to disable it.
+     */
+    void set_quick_check_enabled(bool p_enable);
+
+    /**
+     * @brief Check if existing destinations are compared by size and modification time.
+     * @return `true` if the quick check is enabled, `false` otherwise.
+     */
+    bool get_quick_check_enabled() const;
+
+    /**
+     * @brief Set the largest modification time difference accepted by the quick check.
+     *
+     * A tolerance helps with filesystems that store coarse timestamps, such as FAT with its two second resolution.
+     *
+     * @param p_tolerance The tolerance in milliseconds, negative values are ignored.
+     */
+    void set_quick_check_tolerance(int p_tolerance);
+
+    /**
+     * @brief Get the largest modification time difference accepted by the quick check.
+     * @return The tolerance in milliseconds.
+     */
+    int get_quick_check_tolerance() const;
+
+    /**
+     * @brief Set whether copies receive the access and modification times of their sources.
+     * @param p_enable `true` to preserve times, `false` to let copies take the time they were written.
+     */
+    void set_preserve_times(bool p_enable);
+
+    /**
+     * @brief Check if copies receive the access and modification times of their sources.
+     * @return `true` if times are preserved, `false` otherwise.
+     */
+    bool get_preserve_times() const;
+
+    /**
+     * @brief Set whether copies are read back and checked against their sources.
+     *
+     * The source data is checksummed while it is copied and the copy is read back and checked against it. A copy
+     * that does not match is removed and the pack fails; when moving, a source is only removed once its copy has
+     * been verified.
+     *
+     * @param p_enable `true` to verify copies, `false` to trust them.
+     */
+    void set_verify_files(bool p_enable);
+
+    /**
+     * @brief Check if copies are read back and checked against their sources.
+     * @return `true` if copies are verified, `false` otherwise.
+     */
+    bool get_verify_files() const;
+
+    /**
+     * @brief Set the size from which a file is copied in ranges by several threads.
+     *
+     * A file at least this large is split into ranges that the threads walking the source copy concurrently, so a
+     * single large file does not leave the other threads idle once the rest of the tree is packed. With a single
+     * thread, and on the copy threads of the pipeline, each split copy starts its own helper threads instead. The
+     * copy is preallocated and only replaces its destination once every range is complete. Only the kernel and
+     * io_uring engines split files, and verified copies are never split.
+     *
+     * @param p_size The size in megabytes, 0 to never split, negative values are ignored.
+     */
+    void set_split_copy_size(int p_size);
+
+    /**
+     * @brief Get the size from which a file is copied in ranges by several threads.
+     * @return The size in megabytes, 0 when files are never split.
+     */
+    int get_split_copy_size() const;
+
+    /**
+     * @brief Set when copies are flushed to the destination device.
+     *
+     * Without a policy a power loss can leave truncated copies behind, even after a move has removed their
+     * sources. Flushing each copy with fdatasync makes every copy durable before it is reported, at the cost of
+     * waiting for the device once per file. The batched policy instead syncs the whole destination filesystem
+     * with syncfs after a number of files or bytes, see `set_sync_batch_files` and `set_sync_batch_size`, and
+     * the end-of-run policy syncs it once when the pack ends. Under both, the sources of moved files are only
+     * removed once a sync has made their copies durable, and a pack that fails keeps the sources that were not
+     * synced yet. Renamed files move no data and are not synced. The policy applies to destination directories
+     * and is only supported on Linux, elsewhere packing with a policy returns `Error::Unsupported`.
+     *
+     * @param p_durability The durability policy to set.
+     */
+    void set_durability(Durability p_durability);
+
+    /**
+     * @brief Get when copies are flushed to the destination device.
+     * @return The current durability policy.
+     */
+    Durability get_durability() const;
+
+    /**
+     * @brief Set the number of copies after which the batched durability policy syncs the destination.
+     * @param p_count The number of files, at least 1.
+     */
+    void set_sync_batch_files(int p_count);
+
+    /**
+     * @brief Get the number of copies after which the batched durability policy syncs the destination.
+     * @return The number of files.
+     */
+    int get_sync_batch_files() const;
+
+    /**
+     * @brief Set the amount of data copied after which the batched durability policy syncs the destination.
+     * @param p_size The size in megabytes, at least 1.
+     */
+    void set_sync_batch_size(int p_size);
+
+    /**
+     * @brief Get the amount of data copied after which the batched durability policy syncs the destination.
+     * @return The size in megabytes.
+     */
+    int get_sync_batch_size() const;
+
+    /**
+     * @brief Set how files with the same content as an earlier file are written.
+     *
+     * Files are grouped by size, then by a checksum of their first few kilobytes, then by a checksum of their
+     * whole content, so only files that share their size with another file are ever read. A duplicate is hard
+     * linked or cloned from the first destination written with its content. Hard links share their permissions
+     * and times with that destination. Existing destinations with other hard links are unlinked before they are
+     * replaced, so an update never shows through to the files they were linked with. Only files written by the
+     * same pack are deduplicated.
+     *
+     * @param p_mode The deduplication mode to set.
+     */
+    void set_dedup_mode(DedupMode p_mode);
+
+    /**
+     * @brief Get how files with the same content as an earlier file are written.
+     * @return The current deduplication mode.
+     */
+    DedupMode get_dedup_mode() const;
+
+    /**
+     * @brief Set the form the packed files are written in.
+     *
+     * In archive mode the write path names the archive file, which is written with `ArchiveWriter` under the
+     * destination paths the files would have relative to a destination directory. An existing archive is only
+     * replaced when overwriting is enabled. Files are always copied into the archive: moving, deduplication,
+     * incremental mode and the pipeline only apply to directories.
+     *
+     * In tar mode the files are streamed with `TarWriter` to the file at the write path, or to standard output
+     * when the write path is `-`, under the same names. Each file is written to the stream as soon as it passes
+     * the filters, and the same rules as for archives apply.
+     *
+     * @param p_mode The output mode to set.
+     */
+    void set_output_mode(OutputMode p_mode);
+
+    /**
+     * @brief Get the form the packed files are written in.
+     * @return The current output mode.
+     */
+    OutputMode get_output_mode() const;
+
+    /**
+     * @brief Set the codec compressing the files of an archive.
+     *
+     * Files are split into blocks compressed on the worker threads, and files whose extension is in the store
+     * list are stored as is. Compression only applies to archive output. Codecs that were not built are ignored.
+     *
+     * @param p_compression The codec to set, `Codec::Type::None` to store every file as is.
+     */
+    void set_compression(Codec::Type p_compression);
+
+    /**
+     * @brief Get the codec compressing the files of an archive.
+     * @return The current codec.
+     */
+    Codec::Type get_compression() const;
+
+    /**
+     * @brief Set the number of bytes of a file compressed in each block.
+     *
+     * Smaller blocks spread a single file over more threads and make random access cheaper, larger blocks compress
+     * better.
+     *
+     * @param p_size The block size in bytes, at least 1.
+     */
+    void set_compression_block_size(int p_size);
+
+    /**
+     * @brief Get the number of bytes of a file compressed in each block.
+     * @return The block size in bytes.
+     */
+    int get_compression_block_size() const;
+
+    /**
+     * @brief Get the number of extensions in the store list.
+     * @return The number of store extensions.
+     */
+    size_t get_store_extension_count() const;
+
+    /**
+     * @brief Get an extension at a specified index in the store list.
+     * @param p_index The index of the extension to retrieve.
+     * @return The extension at the specified index.
+     */
+    const String& get_store_extension(size_t p_index) const;
+
+    /**
+     * @brief Add an extension to the store list, files with it are stored in archives without compression.
+     * @param p_extension The extension to add.
+     * @return `true` if the extension was added, `false` if it already exists.
+     */
+    bool add_store_extension(const String& p_extension);
+
+    /**
+     * @brief Remove an extension from the store list.
+     * @param p_extension The extension to remove.
+     * @return `true` if the extension was removed, `false` if it does not exist.
+     */
+    bool remove_store_extension(const String& p_extension);
+
+    /**
+     * @brief Check if a specific extension exists in the store list.
+     * @param p_extension The extension to check.
+     * @return `true` if the extension exists, `false` otherwise.
+     */
+    bool has_store_extension(const String& p_extension) const;
+
+    /**
+     * @brief Clear the store list, every file is compressed.
+     */
+    void clear_store_extensions();
+
+    /**
+     * @brief Set how long changes must settle before watch mode packs them.
+     *
+     * Changes are collected until none has arrived for the delay, so a burst of exports is packed as one batch.
+     * A stream of changes that never settles is still packed once it has lasted ten times the delay.
+     *
+     * @param p_delay The delay in milliseconds.
+     */
+    void set_watch_delay(int p_delay);
+
+    /**
+     * @brief Get how long changes must settle before watch mode packs them.
+     * @return The delay in milliseconds.
+     */
+    int get_watch_delay() const;
+
+    /**
+     * @brief Get the counters collected during the last pack.
+     * @return The pack stats.
+     */
+    const PackStats& get_stats() const;
+
 #ifdef IGNORE_FILE_ENABLED
     /**
      * @brief Set the name of the ignore file to use.
@@ -446,6 +1598,58 @@ public:
      */
     Error pack_files();
 
+    /**
+     * @brief Plan a pack without writing anything.
+     *
+     * The source directory is walked and filtered exactly as `pack_files` would, and each file is recorded with the
+     * operation that would write it or the reason it would be skipped; existing destinations are checked against
+     * the overwrite, quick check and update rules. The destination directories that would be created are recorded
+     * too. The pipeline setting is ignored, the walk uses the thread count. The manifest of an incremental pack is
+     * read but not saved. Plans only describe directory output.
+     *
+     * @param p_plan Receives the plan.
+     * @return An `Error` code indicating the success or failure of the operation, `Error::Unsupported` when the
+     * output mode is not `OutputMode::Directory`.
+     */
+    Error plan(PackPlan& p_plan);
+
+    /**
+     * @brief Run the operations of a plan without walking the source directory.
+     *
+     * The files the plan writes are copied or moved with the current copy settings, and destination directories
+     * are created as they are needed. A destination that appeared since the plan was made is still only replaced
+     * when overwriting is enabled and it is not up to date. The manifest of an incremental pack is not updated.
+     *
+     * @param p_plan The plan to run.
+     * @return An `Error` code indicating the success or failure of the operation, `Error::Unsupported` when the
+     * output mode is not `OutputMode::Directory`.
+     */
+    Error execute(const PackPlan& p_plan);
+
+    /**
+     * @brief Pack files, then keep packing the files that change until `stop_watch` is called.
+     *
+     * The source directory is watched with inotify before an initial `pack_files`, so nothing written while it
+     * runs is missed. Afterwards only the files that are written or moved into the tree are packed, with the same
+     * filters and copy settings. Changes are collected into batches, see `set_watch_delay`, and directories
+     * created or moved into the tree are packed whole. An ignore file appearing stops watching the directories
+     * below it, and an ignore file disappearing watches and packs them again. Files that are deleted or moved out
+     * of the tree are left at the destination. The manifest of an incremental pack is read for each batch and
+     * saved again once the batch is packed, so the next run does not repeat the batches of a watch that was
+     * stopped or killed. While nothing changes the thread sleeps in the kernel.
+     *
+     * Watching is only supported on Linux and with directory output.
+     *
+     * @return An `Error` code indicating the success or failure of the operation, `Error::Unsupported` when the
+     * platform or the output mode cannot be watched.
+     */
+    Error watch();
+
+    /**
+     * @brief Make `watch` return once its current batch is packed, this function is thread-safe.
+     */
+    void stop_watch();
+
     /**
      * @brief Constructor for the Packer class.
      */
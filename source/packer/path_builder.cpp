@@ -0,0 +1,72 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "path_builder.h"
+
+#include <cstring>
+
+PACKER_NAMESPACE_BEGIN
+
+void PathBuilder::assign(const String& p_path) {
+    assign(p_path.data(), p_path.size());
+}
+
+void PathBuilder::assign(const char* p_path, size_t p_length) {
+    path.assign(p_path, p_length);
+    size_t separator = path.find_last_of('/');
+    name = separator == String::npos ? 0 : separator + 1;
+}
+
+size_t PathBuilder::push(const char* p_name) {
+    return push(p_name, std::strlen(p_name));
+}
+
+size_t PathBuilder::push(const char* p_name, size_t p_length) {
+    size_t size = path.size();
+    path.push_back('/');
+    path.append(p_name, p_length);
+    name = size + 1;
+    return size;
+}
+
+void PathBuilder::truncate(size_t p_size) {
+    path.resize(p_size);
+    size_t separator = path.find_last_of('/');
+    name = separator == String::npos ? 0 : separator + 1;
+}
+
+bool PathBuilder::remove_suffix(const String& p_suffix) {
+    if (!remove_path_suffix(path, p_suffix)) {
+        return false;
+    }
+    size_t separator = path.find_last_of('/');
+    name = separator == String::npos ? 0 : separator + 1;
+    return true;
+}
+
+void PathBuilder::adjust_extension(bool p_upper) {
+    size_t ext_pos = path.find_last_of('.') + 1;
+    std::transform(path.begin() + ext_pos, path.end(), path.begin() + ext_pos, p_upper ? toupper : tolower);
+}
+
+const String& PathBuilder::get_path() const {
+    return path;
+}
+
+const char* PathBuilder::get_name() const {
+    return path.c_str() + name;
+}
+
+size_t PathBuilder::size() const {
+    return path.size();
+}
+
+void PathBuilder::copy_to(String& p_path) const {
+    p_path.assign(path);
+}
+
+PathBuilder::PathBuilder(size_t p_capacity) :
+    name(0) {
+    path.reserve(p_capacity);
+}
+
+PACKER_NAMESPACE_END
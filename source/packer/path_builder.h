@@ -0,0 +1,101 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class PathBuilder
+ * @brief A reusable buffer that builds paths by appending and truncating components in place.
+ *
+ * The buffer keeps its capacity when it is reassigned or truncated, so once it has grown to the longest path it
+ * holds, building paths, removing suffixes and adjusting extensions never allocates. Copying the path into a
+ * string that already has enough capacity does not allocate either. A builder is not thread-safe, each thread
+ * keeps its own.
+ */
+class PathBuilder {
+    String path; ///< The path being built.
+    size_t name; ///< The offset of the last component of the path.
+
+public:
+    /**
+     * @brief Replace the path.
+     * @param p_path The new path.
+     */
+    void assign(const String& p_path);
+
+    /**
+     * @brief Replace the path.
+     * @param p_path The characters of the new path.
+     * @param p_length The number of characters.
+     */
+    void assign(const char* p_path, size_t p_length);
+
+    /**
+     * @brief Append a component to the path, separated by a forward slash.
+     * @param p_name The null terminated component.
+     * @return The size of the path before the component was appended, to truncate back to.
+     */
+    size_t push(const char* p_name);
+
+    /**
+     * @brief Append a component to the path, separated by a forward slash.
+     * @param p_name The characters of the component.
+     * @param p_length The number of characters.
+     * @return The size of the path before the component was appended, to truncate back to.
+     */
+    size_t push(const char* p_name, size_t p_length);
+
+    /**
+     * @brief Shorten the path, dropping the components appended after it had this size.
+     * @param p_size The size returned by `push`.
+     */
+    void truncate(size_t p_size);
+
+    /**
+     * @brief Remove the first occurrence of a suffix after the first forward slash, like remove_path_suffix.
+     * @param p_suffix The suffix to remove.
+     * @return `true` if the suffix was found and removed, `false` otherwise.
+     */
+    bool remove_suffix(const String& p_suffix);
+
+    /**
+     * @brief Change the case of the characters after the last dot of the path.
+     * @param p_upper `true` for upper case, `false` for lower case.
+     */
+    void adjust_extension(bool p_upper);
+
+    /**
+     * @brief Get the path.
+     * @return The path.
+     */
+    const String& get_path() const;
+
+    /**
+     * @brief Get the last component of the path.
+     * @return The null terminated last component.
+     */
+    const char* get_name() const;
+
+    /**
+     * @brief Get the size of the path.
+     * @return The number of characters of the path.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Copy the path into a string, reusing its capacity.
+     * @param p_path Receives the path.
+     */
+    void copy_to(String& p_path) const;
+
+    /**
+     * @brief Constructor for the PathBuilder class.
+     * @param p_capacity The number of characters to reserve.
+     */
+    PathBuilder(size_t p_capacity = 256);
+};
+
+PACKER_NAMESPACE_END
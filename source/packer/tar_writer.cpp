@@ -0,0 +1,466 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "tar_writer.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include <iostream>
+#endif // __linux__
+
+PACKER_NAMESPACE_BEGIN
+
+const char* const TarWriter::standard_output_path = "-";
+
+/**
+ * @brief The size of a tar block, headers and padded data are a whole number of blocks.
+ */
+static constexpr size_t tar_block_size = 512;
+
+/**
+ * @brief The length of the name field of a ustar header.
+ */
+static constexpr size_t tar_name_length = 100;
+
+/**
+ * @brief The length of the prefix field of a ustar header.
+ */
+static constexpr size_t tar_prefix_length = 155;
+
+/**
+ * @brief The size of the buffer used to copy data when the kernel cannot move it.
+ */
+static constexpr size_t tar_buffer_size = 1 << 20;
+
+#ifdef __linux__
+/**
+ * @brief The largest number of bytes moved by a single splice or sendfile call.
+ */
+static constexpr size_t tar_chunk_size = 1 << 30;
+#endif // __linux__
+
+static const char tar_zeros[tar_block_size * 2] = {};
+
+/**
+ * @brief Writes a value as zero-padded octal digits followed by a null, returns false if it does not fit.
+ */
+static bool write_octal(char* p_field, size_t p_width, uint64_t p_value) {
+    for (size_t i = p_width - 1; i > 0; --i) {
+        p_field[i - 1] = static_cast<char>('0' + (p_value & 7));
+        p_value >>= 3;
+    }
+    p_field[p_width - 1] = '\0';
+    return p_value == 0;
+}
+
+/**
+ * @brief Finds where a name is split between the prefix and the name fields, returns false if it cannot be.
+ *
+ * Names that fit the name field are not split and get a prefix length of 0. Longer names are split at a slash,
+ * which is dropped, so that the prefix and the rest of the name each fit their field.
+ */
+static bool split_name(const char* p_name, size_t p_length, size_t& p_prefix_length) {
+    p_prefix_length = 0;
+    if (p_length <= tar_name_length) {
+        return true;
+    }
+    size_t last = std::min(p_length - 1, tar_prefix_length);
+    for (size_t i = p_length - tar_name_length - 1; i <= last; ++i) {
+        if (p_name[i] == '/' && i > 0 && i + 1 < p_length) {
+            p_prefix_length = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Appends a pax record, whose length counts the digits of the length itself.
+ */
+static void append_pax_record(String& p_records, const char* p_key, const char* p_value, size_t p_value_length) {
+    size_t length = std::strlen(p_key) + p_value_length + 3;
+    size_t total = length + std::to_string(length).size();
+    if (std::to_string(total).size() > std::to_string(length).size()) {
+        ++total;
+    }
+    p_records.append(std::to_string(total)).append(" ").append(p_key).append("=").append(p_value, p_value_length).append("\n");
+}
+
+/**
+ * @brief Fills a header block, the fields that are not given are left empty.
+ */
+static void fill_header(char* p_header, const char* p_name, size_t p_length, size_t p_prefix_length, char p_type, uint64_t p_size, uint32_t p_mode, int64_t p_mtime) {
+    std::memset(p_header, 0, tar_block_size);
+    if (p_prefix_length > 0) {
+        std::memcpy(p_header + 345, p_name, p_prefix_length);
+        std::memcpy(p_header, p_name + p_prefix_length + 1, p_length - p_prefix_length - 1);
+    } else {
+        std::memcpy(p_header, p_name, std::min(p_length, tar_name_length));
+    }
+
+    // The owner is left as user and group 0, so the stream does not depend on who packed it.
+    write_octal(p_header + 100, 8, p_mode & 07777);
+    write_octal(p_header + 108, 8, 0);
+    write_octal(p_header + 116, 8, 0);
+    if (!write_octal(p_header + 124, 12, p_size)) {
+        // The size is held by a pax record instead.
+        write_octal(p_header + 124, 12, 0);
+    }
+    if (!write_octal(p_header + 136, 12, p_mtime > 0 ? static_cast<uint64_t>(p_mtime) : 0)) {
+        write_octal(p_header + 136, 12, 0);
+    }
+    p_header[156] = p_type;
+    std::memcpy(p_header + 257, "ustar", 6);
+    std::memcpy(p_header + 263, "00", 2);
+
+    // The checksum is computed with its own field filled with spaces.
+    std::memset(p_header + 148, ' ', 8);
+    uint32_t checksum = 0;
+    for (size_t i = 0; i < tar_block_size; ++i) {
+        checksum += static_cast<uint8_t>(p_header[i]);
+    }
+    write_octal(p_header + 148, 7, checksum);
+    p_header[155] = ' ';
+}
+
+#ifdef __linux__
+/**
+ * @brief Writes a whole buffer to a file descriptor, returns false on error.
+ */
+static bool write_fd(int p_fd, const char* p_data, size_t p_size) {
+    while (p_size > 0) {
+        ssize_t written = ::write(p_fd, p_data, p_size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p_data += written;
+        p_size -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief Moves the data of a file into the stream, with splice into a pipe and with sendfile otherwise.
+ * @param p_sent Receives the number of bytes moved, less than the size when the file shrank.
+ */
+static std::error_code send_data(int p_from, int p_to, bool p_pipe, uint64_t p_size, uint64_t& p_sent) {
+    loff_t offset = 0;
+    bool kernel = true;
+    while (static_cast<uint64_t>(offset) < p_size) {
+        size_t chunk = std::min<uint64_t>(p_size - offset, tar_chunk_size);
+        ssize_t moved;
+        if (kernel) {
+            if (p_pipe) {
+                moved = ::splice(p_from, &offset, p_to, nullptr, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+            } else {
+                off_t position = offset;
+                moved = ::sendfile(p_to, p_from, &position, chunk);
+                offset = position;
+            }
+            if (moved < 0 && (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+                // The stream or the file does not support moving data in the kernel, so it is copied instead.
+                kernel = false;
+                continue;
+            }
+        } else {
+            static thread_local Vector<char> buffer(tar_buffer_size);
+            moved = ::pread(p_from, buffer.data(), std::min(chunk, buffer.size()), offset);
+            if (moved > 0) {
+                if (!write_fd(p_to, buffer.data(), moved)) {
+                    p_sent = offset;
+                    return std::error_code(errno, std::generic_category());
+                }
+                offset += moved;
+            }
+        }
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            p_sent = offset;
+            return std::error_code(errno, std::generic_category());
+        }
+        if (moved == 0) {
+            break;
+        }
+    }
+    p_sent = offset;
+    return std::error_code();
+}
+#endif // __linux__
+
+bool TarWriter::_write(const char* p_data, size_t p_size) {
+#ifdef __linux__
+    return write_fd(fd, p_data, p_size);
+#else
+    stream->write(p_data, p_size);
+    return stream->good();
+#endif // __linux__
+}
+
+bool TarWriter::_write_headers(const char* p_name, size_t p_length, uint64_t p_size, uint32_t p_mode, int64_t p_mtime) {
+    static thread_local String records;
+    static thread_local Vector<char> headers;
+    records.clear();
+
+    size_t prefix_length;
+    if (!split_name(p_name, p_length, prefix_length)) {
+        append_pax_record(records, "path", p_name, p_length);
+    }
+    char size_field[12];
+    if (!write_octal(size_field, sizeof(size_field), p_size)) {
+        String size = std::to_string(p_size);
+        append_pax_record(records, "size", size.c_str(), size.size());
+    }
+
+    size_t records_size = (records.size() + tar_block_size - 1) / tar_block_size * tar_block_size;
+    headers.assign(records.empty() ? tar_block_size : tar_block_size * 2 + records_size, '\0');
+    char* header = headers.data();
+    if (!records.empty()) {
+        static const char pax_name[] = "././@PaxHeader";
+        fill_header(header, pax_name, sizeof(pax_name) - 1, 0, 'x', records.size(), 0644, p_mtime);
+        std::memcpy(header + tar_block_size, records.data(), records.size());
+        header += tar_block_size + records_size;
+    }
+    // With a pax path record the ustar name only has to be a readable truncation.
+    fill_header(header, p_name, p_length, prefix_length, '0', p_size, p_mode, p_mtime);
+    return _write(headers.data(), headers.size());
+}
+
+bool TarWriter::is_standard_output(const String& p_path) {
+    return p_path == standard_output_path;
+}
+
+Error TarWriter::open(const String& p_path) {
+    abort();
+
+#ifdef __linux__
+    if (is_standard_output(p_path)) {
+        return open(STDOUT_FILENO);
+    }
+    int file = ::open(p_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (file < 0) {
+        return Error::FileCantOpen;
+    }
+    Error error = open(file);
+    if (error != Error::OK) {
+        ::close(file);
+        return error;
+    }
+    owns_fd = true;
+#else
+    if (is_standard_output(p_path)) {
+        stream = &std::cout;
+        entry_count = 0;
+        return Error::OK;
+    }
+    file.open(p_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return Error::FileCantOpen;
+    }
+    stream = &file;
+    entry_count = 0;
+#endif // __linux__
+    path = p_path;
+    return Error::OK;
+}
+
+#ifdef __linux__
+Error TarWriter::open(int p_fd) {
+    abort();
+
+    struct stat stream_stat;
+    if (p_fd < 0 || ::fstat(p_fd, &stream_stat) != 0) {
+        return Error::FileCantOpen;
+    }
+    fd = p_fd;
+    owns_fd = false;
+    pipe = S_ISFIFO(stream_stat.st_mode);
+    path.clear();
+    entry_count = 0;
+    return Error::OK;
+}
+#endif // __linux__
+
+std::error_code TarWriter::add(const char* p_name, size_t p_length, const FileCopy::Location& p_source, uint64_t& p_size) {
+#ifdef __linux__
+    int source = ::openat(p_source.directory >= 0 ? p_source.directory : AT_FDCWD, p_source.directory >= 0 ? p_source.name : p_source.path->c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0) {
+        return std::error_code(errno, std::generic_category());
+    }
+    struct stat source_stat;
+    if (::fstat(source, &source_stat) != 0) {
+        int error = errno;
+        ::close(source);
+        return std::error_code(error, std::generic_category());
+    }
+    uint64_t size = source_stat.st_size;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!_write_headers(p_name, p_length, size, source_stat.st_mode, source_stat.st_mtim.tv_sec)) {
+        int error = errno;
+        ::close(source);
+        return std::error_code(error, std::generic_category());
+    }
+
+    uint64_t sent = 0;
+    std::error_code error = send_data(source, fd, pipe, size, sent);
+    ::close(source);
+    if (!error && sent < size) {
+        // The file shrank after its header was written, the header still gives the size the stream must hold.
+        error = std::make_error_code(std::errc::io_error);
+    }
+    uint64_t padding = (tar_block_size - size % tar_block_size) % tar_block_size;
+    for (uint64_t remaining = size - sent + padding; remaining > 0;) {
+        size_t zeros = std::min<uint64_t>(remaining, sizeof(tar_zeros));
+        if (!_write(tar_zeros, zeros)) {
+            return std::error_code(errno, std::generic_category());
+        }
+        remaining -= zeros;
+    }
+    if (error) {
+        return error;
+    }
+#else
+    std::error_code error;
+    uint64_t size = FileAccess::file_size(*p_source.path, error);
+    if (error) {
+        return error;
+    }
+    auto mtime = FileAccess::last_write_time(*p_source.path, error);
+    if (error) {
+        return error;
+    }
+    FileAccess::file_status status = FileAccess::status(*p_source.path, error);
+    if (error) {
+        return error;
+    }
+
+    FileStreamI source(*p_source.path, std::ios::binary);
+    if (!source.is_open()) {
+        return std::make_error_code(std::errc::no_such_file_or_directory);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t seconds = std::chrono::duration_cast<std::chrono::seconds>(mtime.time_since_epoch()).count();
+    if (!_write_headers(p_name, p_length, size, static_cast<uint32_t>(status.permissions()), seconds)) {
+        return std::make_error_code(std::errc::io_error);
+    }
+    static thread_local Vector<char> buffer(tar_buffer_size);
+    uint64_t remaining = size;
+    while (remaining > 0) {
+        source.read(buffer.data(), std::min<uint64_t>(remaining, buffer.size()));
+        if (source.gcount() <= 0) {
+            break;
+        }
+        stream->write(buffer.data(), source.gcount());
+        remaining -= source.gcount();
+    }
+    uint64_t padding = (tar_block_size - size % tar_block_size) % tar_block_size;
+    for (uint64_t zeros = remaining + padding; zeros > 0;) {
+        size_t length = std::min<uint64_t>(zeros, sizeof(tar_zeros));
+        stream->write(tar_zeros, length);
+        zeros -= length;
+    }
+    if (remaining > 0 || !stream->good()) {
+        return std::make_error_code(std::errc::io_error);
+    }
+#endif // __linux__
+
+    ++entry_count;
+    p_size = size;
+    return std::error_code();
+}
+
+Error TarWriter::close() {
+    if (!is_open()) {
+        return Error::Unconfigured;
+    }
+
+    bool written = _write(tar_zeros, sizeof(tar_zeros));
+#ifdef __linux__
+    if (owns_fd) {
+        written = ::close(fd) == 0 && written;
+    }
+    fd = -1;
+#else
+    stream->flush();
+    written = stream->good() && written;
+    if (stream == &file) {
+        file.close();
+        written = !file.fail() && written;
+    }
+    stream = nullptr;
+#endif // __linux__
+
+    if (!written) {
+        std::error_code error;
+        if (!path.empty()) {
+            FileAccess::remove(path, error);
+        }
+        path.clear();
+        return Error::Failed;
+    }
+    path.clear();
+    return Error::OK;
+}
+
+void TarWriter::abort() {
+    if (!is_open()) {
+        return;
+    }
+#ifdef __linux__
+    if (owns_fd) {
+        ::close(fd);
+    }
+    fd = -1;
+#else
+    if (stream == &file) {
+        file.close();
+    }
+    stream = nullptr;
+#endif // __linux__
+    std::error_code error;
+    if (!path.empty()) {
+        FileAccess::remove(path, error);
+    }
+    path.clear();
+}
+
+bool TarWriter::is_open() const {
+#ifdef __linux__
+    return fd >= 0;
+#else
+    return stream != nullptr;
+#endif // __linux__
+}
+
+size_t TarWriter::get_entry_count() const {
+    return entry_count;
+}
+
+TarWriter::TarWriter() :
+#ifdef __linux__
+    fd(-1),
+    owns_fd(false),
+    pipe(false),
+#else
+    stream(nullptr),
+#endif // __linux__
+    entry_count(0) {
+}
+
+TarWriter::~TarWriter() {
+    abort();
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,136 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "error.h"
+#include "file_copy.h"
+
+#include <mutex>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class TarWriter
+ * @brief Writes files as a POSIX tar stream to a file, a pipe or standard output.
+ *
+ * Each file is written as a ustar header followed by its data padded to 512 bytes, and the stream ends with two
+ * empty blocks. Names that do not fit the name and prefix fields of a ustar header, and files too large for its
+ * size field, are preceded by a pax extended header holding the full value. The stream is written front to back
+ * without seeking, so files are added as soon as they are found and the reader of a pipe receives them while the
+ * traversal is still running.
+ *
+ * On Linux the data of each file is moved into the stream by the kernel: with splice when the stream is a pipe
+ * and with sendfile otherwise, falling back to reading and writing when neither is supported. Files can be added
+ * from several threads at once, each file is written whole while holding the lock.
+ */
+class TarWriter {
+public:
+    /**
+     * @brief The path naming standard output.
+     */
+    static const char* const standard_output_path;
+
+private:
+#ifdef __linux__
+    int fd; ///< The stream, or -1.
+    bool owns_fd; ///< Flag indicating whether the stream was opened by the writer and is closed with it.
+    bool pipe; ///< Flag indicating whether the stream is a pipe, which data is spliced into.
+#else
+    FileStreamO file; ///< The file being written, unused for standard output.
+    std::ostream* stream; ///< The stream, or `nullptr`.
+#endif // __linux__
+    String path; ///< The path of the file being written, empty for a stream that was not opened from a path.
+    size_t entry_count; ///< The number of files added.
+    std::mutex mutex; ///< Guards the stream.
+
+    /**
+     * @brief Write a buffer to the stream.
+     * @param p_data The buffer.
+     * @param p_size The size of the buffer.
+     * @return `true` if the buffer was written, `false` otherwise.
+     */
+    bool _write(const char* p_data, size_t p_size);
+
+    /**
+     * @brief Write the headers of a file, a pax extended header first when the ustar header cannot hold it.
+     * @param p_name The characters of the name.
+     * @param p_length The number of characters.
+     * @param p_size The size of the file.
+     * @param p_mode The permission bits of the file.
+     * @param p_mtime The modification time of the file in seconds.
+     * @return `true` if the headers were written, `false` otherwise.
+     */
+    bool _write_headers(const char* p_name, size_t p_length, uint64_t p_size, uint32_t p_mode, int64_t p_mtime);
+
+public:
+    /**
+     * @brief Check if a path names standard output.
+     * @param p_path The path.
+     * @return `true` if the path is `standard_output_path`, `false` otherwise.
+     */
+    static bool is_standard_output(const String& p_path);
+
+    /**
+     * @brief Start writing a stream, closing any stream already open.
+     * @param p_path The path of the file to write, replaced if it exists, or `standard_output_path`.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error open(const String& p_path);
+
+#ifdef __linux__
+    /**
+     * @brief Start writing a stream to an open file descriptor, closing any stream already open.
+     * @param p_fd The file descriptor, which stays open when the writer is closed.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error open(int p_fd);
+#endif // __linux__
+
+    /**
+     * @brief Add a file to the stream, this function is thread-safe.
+     * @param p_name The characters of the entry name.
+     * @param p_length The number of characters.
+     * @param p_source The location of the source file.
+     * @param p_size Receives the size of the file.
+     * @return The error that prevented adding the file, or an empty error code.
+     */
+    std::error_code add(const char* p_name, size_t p_length, const FileCopy::Location& p_source, uint64_t& p_size);
+
+    /**
+     * @brief Write the end of the stream and close it.
+     * @return An `Error` code indicating the success or failure of the operation.
+     */
+    Error close();
+
+    /**
+     * @brief Stop writing the stream, a file opened from a path is removed.
+     */
+    void abort();
+
+    /**
+     * @brief Check if a stream is being written.
+     * @return `true` if a stream is open, `false` otherwise.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Get the number of files added so far.
+     * @return The number of files.
+     */
+    size_t get_entry_count() const;
+
+    /**
+     * @brief Constructor for the TarWriter class.
+     */
+    TarWriter();
+
+    /**
+     * @brief Destructor for the TarWriter class, a stream that was not closed is aborted.
+     */
+    ~TarWriter();
+
+    TarWriter(const TarWriter&) = delete;
+    TarWriter& operator=(const TarWriter&) = delete;
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,192 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "thread_pool.h"
+
+PACKER_NAMESPACE_BEGIN
+
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+bool ThreadPool::_pop_task(size_t p_index, Task& p_task) {
+    {
+        Worker& worker = *workers[p_index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            p_task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker& victim = *workers[(p_index + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            p_task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::_worker_loop(size_t p_index) {
+    current_pool = this;
+    current_worker = p_index;
+
+    while (true) {
+        Task task;
+        if (_pop_task(p_index, task)) {
+            try {
+                task();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+            }
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle_condition.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_condition.wait(lock, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+size_t ThreadPool::resolve_thread_count(size_t p_thread_count) {
+    if (p_thread_count == 0) {
+        p_thread_count = std::thread::hardware_concurrency();
+    }
+    return p_thread_count > 0 ? p_thread_count : 1;
+}
+
+size_t ThreadPool::get_thread_count() const {
+    return threads.size();
+}
+
+size_t ThreadPool::get_current_thread_count() {
+    return current_pool ? current_pool->get_thread_count() : 0;
+}
+
+void ThreadPool::push(Task p_task) {
+    size_t index = current_pool == this ? current_worker : next_worker++ % workers.size();
+
+    ++pending;
+    {
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(p_task));
+        ++queued;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    work_condition.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle_condition.wait(lock, [this]() { return pending == 0; });
+    if (exception) {
+        std::exception_ptr rethrow = exception;
+        exception = nullptr;
+        std::rethrow_exception(rethrow);
+    }
+}
+
+void ThreadPool::parallel_for(size_t p_count, const std::function<void(size_t)>& p_function) {
+    ThreadPool* pool = current_pool;
+    if (pool == nullptr || p_count < 2) {
+        for (size_t i = 0; i < p_count; ++i) {
+            p_function(i);
+        }
+        return;
+    }
+
+    // Helper tasks may start after the call returns, they only touch the shared state and find no index left.
+    struct State {
+        std::atomic<size_t> next;
+        std::atomic<size_t> done;
+        size_t count;
+        const std::function<void(size_t)>* function;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::exception_ptr exception;
+
+        State(size_t p_count, const std::function<void(size_t)>* p_function) :
+            next(0),
+            done(0),
+            count(p_count),
+            function(p_function) {
+        }
+    };
+    auto state = std::make_shared<State>(p_count, &p_function);
+    auto run = [](State& p_state) {
+        for (size_t i = p_state.next++; i < p_state.count; i = p_state.next++) {
+            try {
+                (*p_state.function)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(p_state.mutex);
+                if (!p_state.exception) {
+                    p_state.exception = std::current_exception();
+                }
+            }
+            if (++p_state.done == p_state.count) {
+                std::lock_guard<std::mutex> lock(p_state.mutex);
+                p_state.condition.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(p_count, pool->get_thread_count()) - 1;
+    for (size_t i = 0; i < helpers; ++i) {
+        pool->push([state, run]() {
+            run(*state);
+        });
+    }
+    run(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->condition.wait(lock, [&state]() { return state->done == state->count; });
+    if (state->exception) {
+        std::rethrow_exception(state->exception);
+    }
+}
+
+ThreadPool::ThreadPool(size_t p_thread_count) :
+    queued(0),
+    pending(0),
+    next_worker(0),
+    stopping(false) {
+    p_thread_count = resolve_thread_count(p_thread_count);
+
+    for (size_t i = 0; i < p_thread_count; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < p_thread_count; ++i) {
+        threads.emplace_back(&ThreadPool::_worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_condition.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,132 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class ThreadPool
+ * @brief A fixed size pool of worker threads that balance work by stealing tasks from each other.
+ *
+ * Every worker owns a deque of tasks. Tasks pushed from a worker go to the back of its own deque and
+ * are taken back from the back (depth first), while idle workers steal from the front of other
+ * workers' deques (breadth first). Tasks pushed from outside the pool are spread round-robin.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief The type of task executed by the pool.
+     */
+    using Task = std::function<void()>;
+
+private:
+    /**
+     * @struct Worker
+     * @brief The task deque owned by a single worker thread.
+     */
+    struct Worker {
+        std::mutex mutex; ///< Guards the task deque.
+        std::deque<Task> tasks; ///< The tasks queued on this worker.
+    };
+
+    Vector<std::unique_ptr<Worker>> workers; ///< The per-thread task deques.
+    Vector<std::thread> threads; ///< The worker threads.
+
+    std::mutex mutex; ///< Guards sleeping, waking and the stored exception.
+    std::condition_variable work_condition; ///< Signalled when tasks are queued or the pool stops.
+    std::condition_variable idle_condition; ///< Signalled when the last pending task completes.
+
+    std::atomic<size_t> queued; ///< The number of tasks waiting in any deque.
+    std::atomic<size_t> pending; ///< The number of tasks queued or running.
+    std::atomic<size_t> next_worker; ///< The round-robin index used for external pushes.
+    bool stopping; ///< Flag indicating the worker threads should exit.
+
+    std::exception_ptr exception; ///< The first exception thrown by a task.
+
+    /**
+     * @brief Take a task from the worker's own deque, or steal one from another worker.
+     * @param p_index The index of the worker looking for work.
+     * @param p_task The task that was found.
+     * @return `true` if a task was found, `false` otherwise.
+     */
+    bool _pop_task(size_t p_index, Task& p_task);
+
+    /**
+     * @brief The main loop of a worker thread.
+     * @param p_index The index of the worker.
+     */
+    void _worker_loop(size_t p_index);
+
+public:
+    /**
+     * @brief Get the number of threads to use for a requested thread count.
+     * @param p_thread_count The requested thread count, or 0 to use every hardware thread.
+     * @return The number of threads to use, at least 1.
+     */
+    static size_t resolve_thread_count(size_t p_thread_count);
+
+    /**
+     * @brief Get the number of worker threads in the pool.
+     * @return The number of worker threads.
+     */
+    size_t get_thread_count() const;
+
+    /**
+     * @brief Get the number of worker threads of the pool the calling thread belongs to.
+     * @return The number of worker threads, 0 when the calling thread is not a worker.
+     */
+    static size_t get_current_thread_count();
+
+    /**
+     * @brief Queue a task on the pool.
+     *
+     * When called from a worker thread the task is queued on that worker's own deque.
+     *
+     * @param p_task The task to queue.
+     */
+    void push(Task p_task);
+
+    /**
+     * @brief Block until every queued task, including tasks queued by other tasks, has completed.
+     *
+     * If any task threw an exception, the first one is rethrown here once the pool is idle.
+     */
+    void wait();
+
+    /**
+     * @brief Run a function for every index of a range, on the pool of the calling thread.
+     *
+     * When called from a worker thread, helper tasks are queued on that worker's pool and the calling thread
+     * takes part, every thread claiming the next index until none are left, so the call never waits on a task
+     * that has not started and cannot deadlock the pool. Outside a pool the indices are run in order on the
+     * calling thread. If the function throws, the first exception is rethrown once every index has run.
+     *
+     * @param p_count The number of indices.
+     * @param p_function The function to run for each index.
+     */
+    static void parallel_for(size_t p_count, const std::function<void(size_t)>& p_function);
+
+    /**
+     * @brief Constructor for the ThreadPool class.
+     * @param p_thread_count The number of worker threads, or 0 to use every hardware thread.
+     */
+    ThreadPool(size_t p_thread_count);
+
+    /**
+     * @brief Destructor for the ThreadPool class, waits for the worker threads to exit.
+     */
+    ~ThreadPool();
+};
+
+PACKER_NAMESPACE_END
@@ -3,9 +3,11 @@
 #pragma once
 
 #include <type_traits>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_set>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -66,6 +68,17 @@ using Vector = std::vector<T, ALLOC>;
 template <class K, class T, class COMPARE = std::less<K>, class ALLOC = std::allocator<std::pair<const K, T>>>
 using Map = std::map<K, T, COMPARE, ALLOC>;
 
+/**
+ * @typedef HashSet
+ * @brief Alias for std::unordered_set, representing a hashed set of unique keys.
+ * @tparam K The key type.
+ * @tparam HASH The hash function for keys (optional).
+ * @tparam EQUAL The equality function for keys (optional).
+ * @tparam ALLOC The allocator type for memory management (optional).
+ */
+template <class K, class HASH = std::hash<K>, class EQUAL = std::equal_to<K>, class ALLOC = std::allocator<K>>
+using HashSet = std::unordered_set<K, HASH, EQUAL, ALLOC>;
+
 /**
  * @typedef StringVector
  * @brief Alias for a vector of String, representing a collection of strings.
@@ -1,9 +1,13 @@
 // See LICENSE for full copyright and licensing information.
 
+#include "test_checksum.h"
+#include "test_codec.h"
 #include "test_config_file.h"
 #include "test_crypto.h"
+#include "test_extension_matcher.h"
 #include "test_variant.h"
 #include "test_packer.h"
+#include "test_path_builder.h"
 
 USING_NAMESPACE_PACKER
 
@@ -11,6 +15,10 @@ int main() {
     TestCrypto test_crypto;
     TestVariant test_variant;
     TestConfigFile test_config_file;
+    TestExtensionMatcher test_extension_matcher;
+    TestChecksum test_checksum;
+    TestCodec test_codec;
+    TestPathBuilder test_path_builder;
     TestPacker test_packer;
 
     return TestSuite::run_tests(true);
@@ -0,0 +1,67 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "test_checksum.h"
+
+PACKER_NAMESPACE_BEGIN
+
+TestResult TestChecksum::test(uint32_t p_initial, size_t p_num_tests) {
+    std::srand(p_initial);
+
+    for (size_t i = 0; i < p_num_tests; ++i) {
+        // Cover empty and partial stripes, whole blocks and lengths spanning several blocks.
+        size_t size = i < 200 ? i : std::rand() % (1 << 14);
+        String data(size, '\0');
+        for (char& c : data) {
+            c = static_cast<char>(std::rand());
+        }
+
+        uint64_t expected = Checksum::compute(data.data(), data.size());
+
+        for (int k = 0; k < static_cast<int>(Checksum::Kernel::Max); ++k) {
+            Checksum::Kernel kernel = static_cast<Checksum::Kernel>(k);
+            if (!Checksum::is_kernel_supported(kernel)) {
+                continue;
+            }
+
+            Checksum checksum(kernel);
+            for (size_t offset = 0; offset < data.size();) {
+                size_t piece = std::min<size_t>(std::rand() % 300, data.size() - offset);
+                checksum.update(data.data() + offset, piece);
+                offset += piece;
+            }
+            if (checksum.digest() != expected) {
+                return TEST_FAILED("Kernel '" + Checksum::get_kernel_name(kernel) + "' does not agree for " + std::to_string(size) + " bytes.");
+            }
+        }
+
+        if (size > 0) {
+            data[std::rand() % size] ^= 1 << (std::rand() % 8);
+            if (Checksum::compute(data.data(), data.size()) == expected) {
+                return TEST_FAILED("Changing a bit of " + std::to_string(size) + " bytes does not change the checksum.");
+            }
+        }
+    }
+
+    // Zero padding of the last stripe must not make a shorter input collide with a longer one.
+    String zeros(100, '\0');
+    if (Checksum::compute(zeros.data(), 99) == Checksum::compute(zeros.data(), 100)) {
+        return TEST_FAILED("Trailing zeros do not change the checksum.");
+    }
+
+    Checksum checksum;
+    checksum.update("Packer", 6);
+    checksum.reset();
+    if (checksum.digest() != Checksum::compute(nullptr, 0)) {
+        return TEST_FAILED("Resetting the checksum does not forget the data.");
+    }
+    if (!Checksum::is_kernel_supported(Checksum::Kernel::Scalar) || Checksum::find_kernel(Checksum::get_kernel_name(Checksum::get_best_kernel())) != Checksum::get_best_kernel()) {
+        return TEST_FAILED("Kernels are not reported correctly.");
+    }
+    return TEST_PASSED();
+}
+
+TestChecksum::TestChecksum() {
+    ADD_TEST("Checksum", [this]() { return test(); });
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,38 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "test_suite.h"
+
+#include <checksum.h>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class TestChecksum
+ * @brief Represents a test suite for the Checksum class.
+ *
+ * This class defines test cases for the checksum kernels and for streaming data in pieces.
+ */
+class TestChecksum : public TestSuite {
+    /**
+     * @brief Test that every supported kernel and every way of splitting the data give the same checksum.
+     *
+     * This function checksums randomly generated data of many lengths, in one call and in random pieces.
+     *
+     * @param p_initial The initial value for randomization.
+     * @param p_num_tests The number of buffers to check.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test(uint32_t p_initial = 0xBEADBEEF, size_t p_num_tests = 1 << 9);
+
+public:
+    /**
+     * @brief Constructs a new TestChecksum object.
+     *
+     * Initializes the test suite with checksum test cases.
+     */
+    TestChecksum();
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,97 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "test_codec.h"
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @brief Builds blocks exercising literals, short and long matches, overlapping runs and incompressible data.
+ */
+static Vector<String> get_blocks() {
+    Vector<String> blocks = { "", "a", "abcd", "abcdabcdabcd", String(1000, 'z'), "The quick brown fox jumps over the lazy dog. " };
+
+    String text;
+    for (int i = 0; i < 4000; ++i) {
+        text += "line " + std::to_string(i % 97) + " of the asset manifest\n";
+    }
+    blocks.push_back(text);
+
+    String noise(70000, '\0');
+    uint32_t state = 12345;
+    for (char& c : noise) {
+        state = state * 1103515245 + 12345;
+        c = static_cast<char>(state >> 24);
+    }
+    blocks.push_back(noise);
+    blocks.push_back(noise.substr(0, 30000) + text + noise.substr(0, 30000));
+    return blocks;
+}
+
+TestResult TestCodec::test() {
+    for (int type = static_cast<int>(Codec::Type::None) + 1; type < static_cast<int>(Codec::Type::Max); ++type) {
+        const Codec* codec = Codec::get_codec(static_cast<Codec::Type>(type));
+        if (codec == nullptr) {
+            continue;
+        }
+        String name = Codec::get_type_name(codec->get_type());
+
+        for (const String& block : get_blocks()) {
+            Vector<char> compressed(block.size() * 2 + 64);
+            size_t size = codec->compress(block.data(), block.size(), compressed.data(), compressed.size());
+            if (size == 0) {
+                return TEST_FAILED("The " + name + " codec could not compress a block of " + std::to_string(block.size()) + " bytes.");
+            }
+            String decompressed(block.size(), '\0');
+            if (!codec->decompress(compressed.data(), size, &decompressed[0], decompressed.size()) || decompressed != block) {
+                return TEST_FAILED("The " + name + " codec did not restore a block of " + std::to_string(block.size()) + " bytes.");
+            }
+            if (block.size() >= 1000 && block == String(block.size(), block[0]) && size * 10 > block.size()) {
+                return TEST_FAILED("The " + name + " codec did not shrink a repeated byte.");
+            }
+        }
+
+        // A destination too small for the compressed block is reported instead of overrun.
+        String text = get_blocks()[6];
+        Vector<char> small(16);
+        if (codec->compress(text.data(), text.size(), small.data(), small.size()) != 0) {
+            return TEST_FAILED("The " + name + " codec wrote past its destination.");
+        }
+    }
+
+    if (Codec::get_codec(Codec::Type::None) != nullptr || Codec::get_codec(Codec::Type::LZ) == nullptr) {
+        return TEST_FAILED("The built-in codecs are wrong.");
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestCodec::test_corrupt() {
+    const Codec* codec = Codec::get_codec(Codec::Type::LZ);
+    String text = get_blocks()[6];
+    Vector<char> compressed(text.size() * 2);
+    size_t size = codec->compress(text.data(), text.size(), compressed.data(), compressed.size());
+    String decompressed(text.size(), '\0');
+
+    for (size_t cut : { size_t(0), size_t(1), size / 2, size - 1 }) {
+        if (codec->decompress(compressed.data(), cut, &decompressed[0], decompressed.size())) {
+            return TEST_FAILED("A block truncated to " + std::to_string(cut) + " bytes was accepted.");
+        }
+    }
+    if (codec->decompress(compressed.data(), size, &decompressed[0], decompressed.size() - 1)) {
+        return TEST_FAILED("A block was accepted for a destination of the wrong size.");
+    }
+
+    // Damaged blocks may decompress to the wrong data, but must never read or write out of bounds.
+    for (size_t i = 0; i < size; i += 7) {
+        Vector<char> damaged(compressed.begin(), compressed.begin() + size);
+        damaged[i] = static_cast<char>(damaged[i] ^ 0x5a);
+        codec->decompress(damaged.data(), damaged.size(), &decompressed[0], decompressed.size());
+    }
+    return TEST_PASSED();
+}
+
+TestCodec::TestCodec() {
+    ADD_TEST("Codec", [this]() { return test(); });
+    ADD_TEST("Codec corrupt", [this]() { return test_corrupt(); });
+}
+
+PACKER_NAMESPACE_END
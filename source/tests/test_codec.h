@@ -0,0 +1,39 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "test_suite.h"
+
+#include <codec.h>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class TestCodec
+ * @brief Represents a test suite for the Codec class.
+ *
+ * This class defines test cases for compressing and decompressing blocks with every codec that was built.
+ */
+class TestCodec : public TestSuite {
+    /**
+     * @brief Test that blocks of varied content decompress to exactly what was compressed.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test();
+
+    /**
+     * @brief Test that truncated and damaged blocks are rejected instead of being decompressed.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_corrupt();
+
+public:
+    /**
+     * @brief Constructs a new TestCodec object.
+     *
+     * Initializes the test suite with codec test cases.
+     */
+    TestCodec();
+};
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,70 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "test_extension_matcher.h"
+
+PACKER_NAMESPACE_BEGIN
+
+static String random_extension() {
+    static const char characters[] = "aAbBcCxXyYzZ019_";
+    String extension(std::rand() % 4, '\0');
+    for (char& c : extension) {
+        c = characters[std::rand() % (sizeof(characters) - 1)];
+    }
+    return extension;
+}
+
+static bool linear_match(const Vector<String>& p_extensions, String p_extension, bool p_insensitive) {
+    if (p_insensitive) {
+        std::transform(p_extension.begin(), p_extension.end(), p_extension.begin(), tolower);
+    }
+    for (String extension : p_extensions) {
+        if (p_insensitive) {
+            std::transform(extension.begin(), extension.end(), extension.begin(), tolower);
+        }
+        if (extension == p_extension) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TestResult TestExtensionMatcher::test(uint32_t p_initial, size_t p_num_tests) {
+    std::srand(p_initial);
+
+    Vector<String> extensions = { "txt", "PNG", "tar", "TXT", "" };
+    for (int i = 0; i < 40; ++i) {
+        extensions.push_back(random_extension());
+    }
+
+    for (bool insensitive : { false, true }) {
+        ExtensionMatcher matcher(extensions, insensitive);
+
+        for (size_t i = 0; i < p_num_tests; ++i) {
+            String extension = random_extension();
+            if (matcher.match(extension) != linear_match(extensions, extension, insensitive)) {
+                return TEST_FAILED("Matching '" + extension + "' does not agree with a linear scan.");
+            }
+        }
+
+        if (!matcher.match_path("dir/file.txt") || matcher.match_path("dir/file.doc") || !matcher.match_path("dir/archive.tar")) {
+            return TEST_FAILED("Paths are not matched by their extension.");
+        }
+        if (matcher.match_path("dir/file.png") != insensitive || matcher.match_path("dir/FILE.Tar") != insensitive) {
+            return TEST_FAILED("Case sensitivity is not respected.");
+        }
+    }
+
+    if (ExtensionMatcher().match("") || ExtensionMatcher().get_extension_count() != 0) {
+        return TEST_FAILED("An empty matcher matches an extension.");
+    }
+    if (ExtensionMatcher({ "txt", "TXT", "txt" }, true).get_extension_count() != 1) {
+        return TEST_FAILED("Duplicate extensions are stored more than once.");
+    }
+    return TEST_PASSED();
+}
+
+TestExtensionMatcher::TestExtensionMatcher() {
+    ADD_TEST("ExtensionMatcher", [this]() { return test(); });
+}
+
+PACKER_NAMESPACE_END
@@ -0,0 +1,38 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "test_suite.h"
+
+#include <extension_matcher.h>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class TestExtensionMatcher
+ * @brief Represents a test suite for the ExtensionMatcher class.
+ *
+ * This class defines test cases for matching extensions and paths, with and without case sensitivity.
+ */
+class TestExtensionMatcher : public TestSuite {
+    /**
+     * @brief Test matching extensions and paths against a compiled matcher.
+     *
+     * This function compares the matcher with a linear scan over randomly generated extensions.
+     *
+     * @param p_initial The initial value for randomization.
+     * @param p_num_tests The number of extensions to check.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test(uint32_t p_initial = 0xBEADBEEF, size_t p_num_tests = 1 << 14);
+
+public:
+    /**
+     * @brief Constructs a new TestExtensionMatcher object.
+     *
+     * Initializes the test suite with extension matcher test cases.
+     */
+    TestExtensionMatcher();
+};
+
+PACKER_NAMESPACE_END
@@ -1,6 +1,18 @@
 // See LICENSE for full copyright and licensing information.
 
 #include "test_packer.h"
+#include <archive_reader.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // __linux__
 
 PACKER_NAMESPACE_BEGIN
 
@@ -145,11 +157,1845 @@ TestResult TestPacker::test() {
     return TEST_PASSED();
 }
 
+void TestPacker::create_tree() {
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    for (int i = 0; i < 4; ++i) {
+        String directory = read_path;
+        for (int depth = 0; depth <= i; ++depth) {
+            directory += "/dir_" + std::to_string(i) + "_" + std::to_string(depth);
+            FileAccess::create_directories(directory);
+            for (const auto& file_name : files) {
+                FileStreamO stream(directory + "/" + file_name, std::ios::binary);
+                stream << "Hello World!";
+            }
+        }
+    }
+
+#ifdef IGNORE_FILE_ENABLED
+    String ignored = read_path + "/dir_3_0/ignored";
+    FileAccess::create_directories(ignored);
+    FileStreamO(ignored + "/ignored.txt", std::ios::binary) << "Hello World!";
+    FileStreamO(ignored + "/" + packer.get_ignore_file_name(), std::ios::binary).close();
+#endif // IGNORE_FILE_ENABLED
+}
+
+Vector<String> TestPacker::collect_files(const String& p_path) {
+    Vector<String> result;
+    if (!FileAccess::exists(p_path)) {
+        return result;
+    }
+    for (auto& path : FileAccess::recursive_directory_iterator(p_path)) {
+        if (!FileAccess::is_directory(path)) {
+            String file_path = path.path().string();
+            normalize_path_separators(file_path);
+            result.push_back(file_path.substr(p_path.length()));
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+TestResult TestPacker::test_threads() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Include);
+    packer.clear_extensions();
+    packer.add_extension("txt");
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_string("(1)");
+    packer.set_suffix_enabled(true);
+    packer.set_extension_insensitive(true);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Lower);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(true);
+#endif // IGNORE_FILE_ENABLED
+
+    create_tree();
+    packer.set_thread_count(1);
+    packer.pack_files();
+    Vector<String> expected = collect_files(write_path);
+
+    if (expected.empty()) {
+        return TEST_FAILED("Single threaded packing did not pack any files.");
+    }
+
+    create_tree();
+    packer.set_thread_count(4);
+    packer.pack_files();
+    Vector<String> result = collect_files(write_path);
+
+    if (result != expected) {
+        packer.set_thread_count(DEFAULT_THREAD_COUNT);
+        return TEST_FAILED("Multi threaded packing does not match single threaded packing.");
+    }
+
+    create_tree();
+    packer.set_pipeline_enabled(true);
+    packer.set_queue_size(2);
+    packer.pack_files();
+    result = collect_files(write_path);
+
+    packer.set_pipeline_enabled(DEFAULT_PIPELINE_ENABLED);
+    packer.set_queue_size(DEFAULT_QUEUE_SIZE);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (result != expected) {
+        return TEST_FAILED("Pipelined packing does not match single threaded packing.");
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_copy_engines() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String contents(3 << 20, '\0');
+    for (size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<char>(i * 31 + (i >> 12));
+    }
+
+    for (int i = 0; i < static_cast<int>(FileCopy::Engine::Max) * 2; ++i) {
+        FileCopy::Engine engine = static_cast<FileCopy::Engine>(i / 2);
+        packer.set_clone_files(i % 2 == 1);
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/nested");
+        FileStreamO(read_path + "/nested/large.bin", std::ios::binary) << contents;
+        FileStreamO(read_path + "/empty.bin", std::ios::binary).close();
+
+        packer.set_copy_engine(engine);
+        packer.pack_files();
+
+        StringStream copied;
+        copied << FileStreamI(write_path + "/nested/large.bin", std::ios::binary).rdbuf();
+        if (copied.str() != contents || !FileAccess::exists(write_path + "/empty.bin")) {
+            packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+            packer.set_clone_files(DEFAULT_CLONE_FILES);
+            return TEST_FAILED("Copy engine '" + FileCopy::get_engine_name(engine) + "' did not copy files correctly.");
+        }
+
+        const PackStats& stats = packer.get_stats();
+        uint64_t method_count = 0;
+        for (int j = 0; j < static_cast<int>(FileCopy::Method::Max); ++j) {
+            method_count += stats.get(FileCopy::get_method_counter(static_cast<FileCopy::Method>(j)));
+        }
+        uint64_t cloned_count = stats.get(PackStats::Counter::FilesCloned);
+        uint64_t copied_count = stats.get(PackStats::Counter::FilesCopied);
+        if (stats.get(PackStats::Counter::FilesPacked) != 2 || method_count != 2 || cloned_count + copied_count != 2) {
+            packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+            packer.set_clone_files(DEFAULT_CLONE_FILES);
+            return TEST_FAILED("Copy engine '" + FileCopy::get_engine_name(engine) + "' did not report its copies.");
+        }
+    }
+
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_clone_files(DEFAULT_CLONE_FILES);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_move() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(true);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+    FileAccess::create_directories(read_path);
+    FileAccess::create_directories(write_path);
+    FileStreamO(read_path + "/moved.txt", std::ios::binary) << "Moved";
+    FileStreamO(read_path + "/kept.txt", std::ios::binary) << "Source";
+    FileStreamO(write_path + "/kept.txt", std::ios::binary) << "Destination";
+
+    packer.pack_files();
+
+    StringStream kept;
+    kept << FileStreamI(write_path + "/kept.txt", std::ios::binary).rdbuf();
+
+    bool moved = FileAccess::exists(write_path + "/moved.txt") && !FileAccess::exists(read_path + "/moved.txt");
+    bool protected_file = kept.str() == "Destination" && FileAccess::exists(read_path + "/kept.txt");
+    uint64_t renamed = packer.get_stats().get(PackStats::Counter::FilesRenamed);
+
+    packer.set_move_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!moved) {
+        return TEST_FAILED("File was not moved.");
+    }
+    if (!protected_file) {
+        return TEST_FAILED("Existing file was replaced while overwrite is disabled.");
+    }
+#ifdef __linux__
+    if (renamed != 1) {
+        return TEST_FAILED("File on the same device was not renamed.");
+    }
+#endif // __linux__
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_batches() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_copy_engine(FileCopy::Engine::IoUring);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    Vector<String> contents;
+    for (int i = 0; i < 100; ++i) {
+        String directory = read_path + "/dir_" + std::to_string(i % 3);
+        FileAccess::create_directories(directory);
+        contents.push_back(String(static_cast<size_t>(i) * 3001, static_cast<char>('a' + i % 26)));
+        FileStreamO(directory + "/file_" + std::to_string(i) + ".bin", std::ios::binary) << contents.back();
+    }
+
+    String error;
+    for (int pass = 0; pass < 2 && error.empty(); ++pass) {
+        packer.set_pipeline_enabled(pass == 1);
+        FileAccess::remove_all(write_path);
+        packer.pack_files();
+
+        for (int i = 0; i < 100; ++i) {
+            StringStream copied;
+            copied << FileStreamI(write_path + "/dir_" + std::to_string(i % 3) + "/file_" + std::to_string(i) + ".bin", std::ios::binary).rdbuf();
+            if (copied.str() != contents[i]) {
+                error = "Batched copy did not copy files correctly.";
+                break;
+            }
+        }
+        if (error.empty() && packer.get_stats().get(PackStats::Counter::FilesPacked) != 100) {
+            error = "Batched copy did not report its copies.";
+        }
+    }
+
+    if (error.empty()) {
+        packer.pack_files();
+        if (packer.get_stats().get(PackStats::Counter::FilesPacked) != 0) {
+            error = "Batched copy replaced up to date files.";
+        }
+    }
+
+    packer.set_pipeline_enabled(DEFAULT_PIPELINE_ENABLED);
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_traversal() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Include);
+    packer.clear_extensions();
+    packer.add_extension("txt");
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_string("(1)");
+    packer.set_suffix_enabled(true);
+    packer.set_extension_insensitive(true);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Lower);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(true);
+#endif // IGNORE_FILE_ENABLED
+
+    create_tree();
+    packer.set_traversal(Packer::Traversal::Filesystem);
+    packer.pack_files();
+    Vector<String> expected = collect_files(write_path);
+
+    String error;
+    packer.set_traversal(Packer::Traversal::Posix);
+
+    for (int pass = 0; pass < 3 && error.empty(); ++pass) {
+        create_tree();
+        packer.set_thread_count(pass == 1 ? 4 : 1);
+        packer.set_pipeline_enabled(pass == 2);
+        packer.pack_files();
+
+        if (collect_files(write_path) != expected) {
+            error = "POSIX traversal does not match std::filesystem traversal.";
+        }
+    }
+
+    if (error.empty()) {
+        packer.pack_files();
+        if (packer.get_stats().get(PackStats::Counter::FilesPacked) != 0) {
+            error = "POSIX traversal replaced existing files.";
+        }
+    }
+
+    if (error.empty()) {
+        create_tree();
+        packer.set_move_files(true);
+        packer.set_copy_engine(FileCopy::Engine::IoUring);
+        packer.pack_files();
+
+        if (collect_files(write_path) != expected || packer.get_stats().get(PackStats::Counter::FilesPacked) != expected.size()) {
+            error = "POSIX traversal did not move every file.";
+        }
+    }
+
+    packer.set_traversal(DEFAULT_TRAVERSAL);
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_move_files(false);
+    packer.set_pipeline_enabled(DEFAULT_PIPELINE_ENABLED);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_traversal_descriptors() {
+#ifdef __linux__
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_traversal(Packer::Traversal::Posix);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // Queued directories hold no descriptors and files in flight past the limit are copied by path, so a wide tree
+    // packs with far fewer descriptors than directories.
+    const rlim_t descriptor_limit = 256;
+    const int directory_count = 1000;
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+    for (int i = 0; i < directory_count; ++i) {
+        String directory = read_path + "/" + std::to_string(i);
+        FileAccess::create_directories(directory + "/nested");
+        FileStreamO(directory + "/nested/file.txt", std::ios::binary) << "File " << i;
+    }
+
+    String error;
+    struct rlimit limit;
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur > descriptor_limit) {
+        struct rlimit lowered = limit;
+        lowered.rlim_cur = descriptor_limit;
+        ::setrlimit(RLIMIT_NOFILE, &lowered);
+
+        for (int pass = 0; pass < 2 && error.empty(); ++pass) {
+            packer.set_thread_count(4);
+            packer.set_pipeline_enabled(pass == 1);
+            try {
+                packer.pack_files();
+            } catch (const std::exception& e) {
+                error = String("Packing more directories than the descriptor limit failed: ") + e.what();
+            }
+            if (error.empty() && packer.get_stats().get(PackStats::Counter::FilesPacked) != static_cast<uint64_t>(directory_count)) {
+                error = "Packing more directories than the descriptor limit did not pack every file.";
+            }
+            FileAccess::remove_all(write_path);
+        }
+
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    packer.set_traversal(DEFAULT_TRAVERSAL);
+    packer.set_pipeline_enabled(DEFAULT_PIPELINE_ENABLED);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+#endif // __linux__
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_destination_index() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_string("(1)");
+    packer.set_suffix_enabled(true);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_destination_index_enabled(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String error;
+    for (int i = 0; i < static_cast<int>(Packer::Traversal::Max) && error.empty(); ++i) {
+        packer.set_traversal(static_cast<Packer::Traversal>(i));
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/nested");
+        FileAccess::create_directories(write_path + "/nested");
+        FileStreamO(read_path + "/nested/kept.txt", std::ios::binary) << "Source";
+        FileStreamO(write_path + "/nested/kept.txt", std::ios::binary) << "Destination";
+        FileStreamO(read_path + "/nested/copied.txt", std::ios::binary) << "Copied";
+        FileStreamO(read_path + "/same.txt", std::ios::binary) << "Same";
+        FileStreamO(read_path + "/same(1).txt", std::ios::binary) << "Same";
+
+        packer.pack_files();
+
+        StringStream kept;
+        kept << FileStreamI(write_path + "/nested/kept.txt", std::ios::binary).rdbuf();
+        if (kept.str() != "Destination") {
+            error = "Existing file was replaced with the destination index enabled.";
+        } else if (!FileAccess::exists(write_path + "/nested/copied.txt") || !FileAccess::exists(write_path + "/same.txt")) {
+            error = "Files missing from the destination were not copied with the destination index enabled.";
+        } else if (packer.get_stats().get(PackStats::Counter::FilesPacked) != 2) {
+            error = "A file written during the pack was not added to the destination index.";
+        }
+    }
+
+    packer.set_destination_index_enabled(DEFAULT_DESTINATION_INDEX_ENABLED);
+    packer.set_traversal(DEFAULT_TRAVERSAL);
+    packer.set_suffix_enabled(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_incremental() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_incremental_enabled(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String error;
+    for (int i = 0; i < static_cast<int>(Packer::Traversal::Max) && error.empty(); ++i) {
+        packer.set_traversal(static_cast<Packer::Traversal>(i));
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/nested");
+        FileStreamO(read_path + "/nested/changed.txt", std::ios::binary) << "Before";
+        FileStreamO(read_path + "/unchanged.txt", std::ios::binary) << "Unchanged";
+
+        packer.pack_files();
+        const PackStats& stats = packer.get_stats();
+        if (stats.get(PackStats::Counter::FilesPacked) != 2 || !FileAccess::exists(write_path + "/" + packer.get_manifest_file_name())) {
+            error = "The first incremental pack did not pack every file.";
+            break;
+        }
+
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesPacked) != 0 || stats.get(PackStats::Counter::FilesUnchanged) != 2) {
+            error = "Unchanged files were packed again.";
+            break;
+        }
+
+        FileStreamO(read_path + "/nested/changed.txt", std::ios::binary) << "After the change";
+        packer.pack_files();
+
+        StringStream changed;
+        changed << FileStreamI(write_path + "/nested/changed.txt", std::ios::binary).rdbuf();
+        if (stats.get(PackStats::Counter::FilesPacked) != 1 || stats.get(PackStats::Counter::FilesUnchanged) != 1 || changed.str() != "After the change") {
+            error = "A changed file was not packed again.";
+            break;
+        }
+
+        FileStreamO(write_path + "/" + packer.get_manifest_file_name(), std::ios::binary) << "Damaged";
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesUnchanged) != 0) {
+            error = "Files were skipped with a damaged manifest.";
+            break;
+        }
+
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesUnchanged) != 2) {
+            error = "Up to date files were not recorded in the manifest.";
+        }
+    }
+
+    packer.set_incremental_enabled(DEFAULT_INCREMENTAL_ENABLED);
+    packer.set_traversal(DEFAULT_TRAVERSAL);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_directory_cache() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Include);
+    packer.set_extension_insensitive(false);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_incremental_enabled(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String error;
+    for (int i = 0; i < static_cast<int>(Packer::Traversal::Max) && error.empty(); ++i) {
+        packer.set_traversal(static_cast<Packer::Traversal>(i));
+        packer.clear_extensions();
+        packer.add_extension("txt");
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/nested/deep");
+        FileStreamO(read_path + "/root.txt", std::ios::binary) << "Root";
+        FileStreamO(read_path + "/skipped.dat", std::ios::binary) << "Skipped";
+        FileStreamO(read_path + "/nested/nested.txt", std::ios::binary) << "Nested";
+        FileStreamO(read_path + "/nested/deep/deep.txt", std::ios::binary) << "Deep";
+
+        // Directories changed just before a pack are not cached, let the new ones settle first.
+        std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+
+        packer.pack_files();
+        const PackStats& stats = packer.get_stats();
+        if (stats.get(PackStats::Counter::FilesPacked) != 3 || stats.get(PackStats::Counter::DirectoriesUnchanged) != 0) {
+            error = "The first incremental pack did not list every directory.";
+            break;
+        }
+
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::DirectoriesUnchanged) != 3 || stats.get(PackStats::Counter::FilesUnchanged) != 3 || stats.get(PackStats::Counter::FilesPacked) != 0) {
+            error = "Unchanged directories were listed again.";
+            break;
+        }
+
+        FileStreamO(read_path + "/nested/added.txt", std::ios::binary) << "Added";
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::DirectoriesUnchanged) != 2 || stats.get(PackStats::Counter::FilesPacked) != 1 || !FileAccess::exists(write_path + "/nested/added.txt")) {
+            error = "A file added to a cached directory was not packed.";
+            break;
+        }
+
+        packer.add_extension("dat");
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::DirectoriesUnchanged) != 0 || stats.get(PackStats::Counter::FilesPacked) != 1 || !FileAccess::exists(write_path + "/skipped.dat")) {
+            error = "Cached listings were reused after the extensions changed.";
+        }
+    }
+
+    packer.set_incremental_enabled(DEFAULT_INCREMENTAL_ENABLED);
+    packer.set_traversal(DEFAULT_TRAVERSAL);
+    packer.set_pack_mode(DEFAULT_PACK_MODE);
+    packer.clear_extensions();
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_quick_check() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_quick_check_enabled(true);
+    packer.set_preserve_times(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String source_path = read_path + "/asset.bin";
+    String destination_path = write_path + "/asset.bin";
+
+    String error;
+    for (int i = 0; i < static_cast<int>(FileCopy::Engine::Max) && error.empty(); ++i) {
+        FileCopy::Engine engine = static_cast<FileCopy::Engine>(i);
+        packer.set_copy_engine(engine);
+        packer.set_dedup_mode(Packer::DedupMode::HardLink);
+        packer.set_quick_check_tolerance(0);
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path);
+        FileStreamO(source_path, std::ios::binary) << "Asset";
+
+        packer.pack_files();
+        const PackStats& stats = packer.get_stats();
+        if (stats.get(PackStats::Counter::FilesPacked) != 1 || FileAccess::last_write_time(destination_path) != FileAccess::last_write_time(source_path)) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' did not preserve the modification time.";
+            break;
+        }
+
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesPacked) != 0 || stats.get(PackStats::Counter::FilesUpToDate) != 1) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' replaced a matching destination.";
+            break;
+        }
+
+        // A source touched slightly later is kept within the tolerance, and replaced without it.
+        FileAccess::last_write_time(source_path, FileAccess::last_write_time(destination_path) + std::chrono::milliseconds(500));
+        packer.set_quick_check_tolerance(1000);
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesUpToDate) != 1) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' ignored the quick check tolerance.";
+            break;
+        }
+        packer.set_quick_check_tolerance(0);
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesPacked) != 1) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' kept a destination with a different time.";
+            break;
+        }
+
+        // A newer destination of a different size is replaced, where the default rules would keep it.
+        FileStreamO(destination_path, std::ios::binary) << "Edited destination";
+        FileAccess::last_write_time(destination_path, FileAccess::last_write_time(source_path) + std::chrono::hours(1));
+        packer.pack_files();
+
+        StringStream copied;
+        copied << FileStreamI(destination_path, std::ios::binary).rdbuf();
+        if (stats.get(PackStats::Counter::FilesPacked) != 1 || copied.str() != "Asset") {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' kept a destination with a different size.";
+        }
+    }
+
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_quick_check_enabled(DEFAULT_QUICK_CHECK_ENABLED);
+    packer.set_quick_check_tolerance(DEFAULT_QUICK_CHECK_TOLERANCE);
+    packer.set_preserve_times(DEFAULT_PRESERVE_TIMES);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_verify() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_verify_files(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String contents(3 << 20, '\0');
+    for (size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<char>(i * 17 + (i >> 11));
+    }
+
+    String error;
+    for (int i = 0; i < static_cast<int>(FileCopy::Engine::Max) * 2 && error.empty(); ++i) {
+        FileCopy::Engine engine = static_cast<FileCopy::Engine>(i / 2);
+        bool move = i % 2 == 1;
+        packer.set_copy_engine(engine);
+        packer.set_move_files(move);
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/nested");
+        FileStreamO(read_path + "/nested/large.bin", std::ios::binary) << contents;
+        FileStreamO(read_path + "/empty.bin", std::ios::binary).close();
+
+        packer.pack_files();
+
+        StringStream copied;
+        copied << FileStreamI(write_path + "/nested/large.bin", std::ios::binary).rdbuf();
+        const PackStats& stats = packer.get_stats();
+        uint64_t verified = stats.get(PackStats::Counter::FilesVerified) + stats.get(PackStats::Counter::FilesRenamed);
+        if (copied.str() != contents || verified != 2 || stats.get(PackStats::Counter::FilesPacked) != 2) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' did not verify its copies.";
+            break;
+        }
+        if (stats.get(PackStats::Counter::FilesVerified) == 2 && (stats.get(PackStats::Counter::BytesVerified) != contents.size() || stats.get(PackStats::Counter::VerifyNanoseconds) == 0)) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' did not report its verification.";
+            break;
+        }
+        if (move && (FileAccess::exists(read_path + "/nested/large.bin") || FileAccess::exists(read_path + "/empty.bin"))) {
+            error = "Verified sources were not removed by a move.";
+        }
+    }
+
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_verify_files(DEFAULT_VERIFY_FILES);
+    packer.set_move_files(false);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_split_copy() {
+#ifdef __linux__
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_preserve_times(true);
+    packer.set_split_copy_size(1);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // The large file ends part way through its last range.
+    String large((5 << 20) + 12345, '\0');
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>(i * 13 + (i >> 20));
+    }
+    String small(1000, 's');
+
+    String error;
+    // Split copies run on the pool with several threads, and on helper threads with one thread or the pipeline.
+    const int pass_count = 3;
+    int engine_count = static_cast<int>(FileCopy::Engine::Max) - static_cast<int>(FileCopy::Engine::Kernel);
+    for (int i = 0; i < engine_count * pass_count && error.empty(); ++i) {
+        FileCopy::Engine engine = static_cast<FileCopy::Engine>(static_cast<int>(FileCopy::Engine::Kernel) + i / pass_count);
+        int pass = i % pass_count;
+        packer.set_copy_engine(engine);
+        packer.set_thread_count(pass == 0 ? 4 : 1);
+        packer.set_pipeline_enabled(pass == 2);
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/nested");
+        FileAccess::create_directories(write_path + "/nested");
+        FileStreamO(read_path + "/nested/large.bin", std::ios::binary) << large;
+        FileStreamO(read_path + "/small.bin", std::ios::binary) << small;
+        // An older destination is replaced by the split copy.
+        FileStreamO(write_path + "/nested/large.bin", std::ios::binary) << "old";
+        FileAccess::last_write_time(write_path + "/nested/large.bin", FileAccess::last_write_time(read_path + "/nested/large.bin") - std::chrono::hours(1));
+
+        packer.pack_files();
+
+        StringStream copied;
+        copied << FileStreamI(write_path + "/nested/large.bin", std::ios::binary).rdbuf();
+        const PackStats& stats = packer.get_stats();
+        if (copied.str() != large || stats.get(PackStats::Counter::FilesPacked) != 2 || stats.get(PackStats::Counter::BytesPacked) != large.size() + small.size()) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' did not copy the split file.";
+        } else if (stats.get(PackStats::Counter::FilesSplit) != 1) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' did not split the large file only.";
+        } else if (FileAccess::last_write_time(write_path + "/nested/large.bin") != FileAccess::last_write_time(read_path + "/nested/large.bin")) {
+            error = "The split copy did not receive the modification time of its source.";
+        } else if (std::distance(FileAccess::directory_iterator(write_path + "/nested"), FileAccess::directory_iterator()) != 1) {
+            error = "The split copy left its temporary file behind.";
+        }
+    }
+
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    packer.set_pipeline_enabled(DEFAULT_PIPELINE_ENABLED);
+    packer.set_preserve_times(DEFAULT_PRESERVE_TIMES);
+    packer.set_split_copy_size(DEFAULT_SPLIT_COPY_SIZE);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+#endif // __linux__
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_sparse() {
+#ifdef __linux__
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_thread_count(4);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    auto get_allocated = [](const String& p_path) {
+        struct stat file_stat;
+        return ::stat(p_path.c_str(), &file_stat) == 0 ? static_cast<uint64_t>(file_stat.st_blocks) * 512 : 0;
+    };
+
+    // Two data extents between holes, the last hole runs to the end of the file.
+    const uint64_t size = 8 << 20;
+    String data(64 << 10, '\0');
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 7 + 1);
+    }
+    String expected(size, '\0');
+    expected.replace(1 << 20, data.size(), data);
+    expected.replace(5 << 20, data.size(), data);
+    String dense(2 << 20, 'd');
+
+    String error;
+    for (int i = 0; i < 4 && error.empty(); ++i) {
+        FileCopy::Engine engine = i / 2 == 0 ? FileCopy::Engine::Kernel : FileCopy::Engine::IoUring;
+        bool split = i % 2 == 1;
+        packer.set_copy_engine(engine);
+        packer.set_split_copy_size(split ? 1 : 0);
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path);
+        FileStreamO(read_path + "/image.bin", std::ios::binary).close();
+        FileAccess::resize_file(read_path + "/image.bin", size);
+        {
+            FileStreamO file(read_path + "/image.bin", std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(1 << 20);
+            file << data;
+            file.seekp(5 << 20);
+            file << data;
+        }
+        FileStreamO(read_path + "/dense.bin", std::ios::binary) << dense;
+
+        packer.pack_files();
+
+        StringStream copied;
+        copied << FileStreamI(write_path + "/image.bin", std::ios::binary).rdbuf();
+        StringStream copied_dense;
+        copied_dense << FileStreamI(write_path + "/dense.bin", std::ios::binary).rdbuf();
+        const PackStats& stats = packer.get_stats();
+        String name = "Copy engine '" + FileCopy::get_engine_name(engine) + "'" + (split ? " with split copies" : "");
+        if (copied.str() != expected || copied_dense.str() != dense) {
+            error = name + " did not copy the files.";
+        } else if (split && stats.get(PackStats::Counter::FilesSplit) != 2) {
+            error = name + " did not split the files.";
+        } else if (get_allocated(read_path + "/image.bin") >= size) {
+            // The filesystem cannot hold holes, there are none to keep.
+            if (stats.get(PackStats::Counter::FilesSparse) != 0) {
+                error = name + " found holes in a dense file.";
+            }
+        } else if (stats.get(PackStats::Counter::FilesSparse) != 1 || stats.get(PackStats::Counter::HoleBytes) < size - 2 * (1 << 20)) {
+            error = name + " did not count the holes it skipped.";
+        } else if (get_allocated(write_path + "/image.bin") >= size) {
+            error = name + " filled the holes of the sparse file.";
+        } else if (stats.get(PackStats::Counter::BytesPacked) + stats.get(PackStats::Counter::HoleBytes) != size + dense.size()) {
+            error = name + " did not count the bytes it wrote.";
+        }
+    }
+
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    packer.set_split_copy_size(DEFAULT_SPLIT_COPY_SIZE);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+#endif // __linux__
+    return TEST_PASSED();
+}
+
+/**
+ * @brief The number of moved files whose source still existed when they were reported.
+ */
+static std::atomic<int> reported_sources(0);
+
+static void count_reported_source(const String& p_read_path, const String& /*p_write_path*/, bool p_move) {
+    if (p_move && FileAccess::exists(p_read_path)) {
+        ++reported_sources;
+    }
+}
+
+TestResult TestPacker::test_durability() {
+#ifdef __linux__
+    packer.set_read_path(read_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_sync_batch_files(2);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // Moves only copy across devices, a tmpfs destination keeps their sources until they are removed.
+    String other_device_path = "/dev/shm/PackerDurability";
+    struct stat shm_stat;
+    struct stat current_stat;
+    bool other_device = ::stat("/dev/shm", &shm_stat) == 0 && ::stat(".", &current_stat) == 0 && shm_stat.st_dev != current_stat.st_dev;
+
+    const int file_count = 5;
+    String error;
+    for (int i = 0; i < static_cast<int>(Packer::Durability::Max) * 2 && error.empty(); ++i) {
+        Packer::Durability durability = static_cast<Packer::Durability>(i / 2);
+        bool move = i % 2 == 1;
+        if (move && !other_device) {
+            continue;
+        }
+        String destination = move ? other_device_path : write_path;
+        packer.set_durability(durability);
+        packer.set_move_files(move);
+        packer.set_write_path(destination);
+        packer.set_copy_engine(FileCopy::Engine::Kernel);
+        Packer::set_callback(count_reported_source);
+        reported_sources = 0;
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(destination);
+        FileAccess::create_directories(read_path + "/nested");
+        for (int j = 0; j < file_count; ++j) {
+            FileStreamO(read_path + (j % 2 ? "/nested/" : "/") + std::to_string(j) + ".txt", std::ios::binary) << "File " << j;
+        }
+
+        packer.pack_files();
+        Packer::set_callback(nullptr);
+
+        const PackStats& stats = packer.get_stats();
+        uint64_t syncs = stats.get(PackStats::Counter::Syncs);
+        uint64_t expected = durability == Packer::Durability::File ? file_count : durability == Packer::Durability::Batch ? (file_count + 1) / 2 : durability == Packer::Durability::End ? 1 : 0;
+        String name = "Durability '" + Packer::get_durability_name(durability) + "'" + (move ? " with moves" : "");
+        for (int j = 0; j < file_count && error.empty(); ++j) {
+            String path = String(j % 2 ? "/nested/" : "/") + std::to_string(j) + ".txt";
+            StringStream copied;
+            copied << FileStreamI(destination + path, std::ios::binary).rdbuf();
+            if (copied.str() != "File " + std::to_string(j) || (move && FileAccess::exists(read_path + path))) {
+                error = name + " did not pack '" + path + "'.";
+            }
+        }
+        if (error.empty() && syncs != expected) {
+            error = name + " synced " + std::to_string(syncs) + " times instead of " + std::to_string(expected) + ".";
+        }
+        // Sources are removed before their files are reported, unless they wait for the sync at the end.
+        // A batch may be synced before its last file is reported, so how many sources remain then varies.
+        int expected_sources = durability == Packer::Durability::End ? file_count : 0;
+        if (error.empty() && move && durability != Packer::Durability::Batch && reported_sources != expected_sources) {
+            error = name + " removed sources before their copies were synced.";
+        }
+    }
+
+    Packer::set_callback(nullptr);
+    packer.set_durability(DEFAULT_DURABILITY);
+    packer.set_sync_batch_files(DEFAULT_SYNC_BATCH_FILES);
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_move_files(false);
+    packer.set_overwrite_files(false);
+    packer.set_write_path(write_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+    FileAccess::remove_all(other_device_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+#endif // __linux__
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_dedup() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_quick_check_enabled(true);
+    packer.set_preserve_times(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // Two large duplicates, a file that only differs at its end, and two small duplicates.
+    String large(100000, '\0');
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>(i * 31 + (i >> 9));
+    }
+    String changed = large;
+    changed.back() ^= 1;
+
+    auto read_file = [](const String& p_path) {
+        StringStream stream;
+        stream << FileStreamI(p_path, std::ios::binary).rdbuf();
+        return stream.str();
+    };
+
+    String error;
+    for (int i = 0; i < static_cast<int>(FileCopy::Engine::Max) && error.empty(); ++i) {
+        FileCopy::Engine engine = static_cast<FileCopy::Engine>(i);
+        packer.set_copy_engine(engine);
+        packer.set_dedup_mode(Packer::DedupMode::HardLink);
+
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path + "/a");
+        FileAccess::create_directories(read_path + "/b");
+        FileStreamO(read_path + "/a/large.bin", std::ios::binary) << large;
+        FileStreamO(read_path + "/b/large.bin", std::ios::binary) << large;
+        FileStreamO(read_path + "/b/changed.bin", std::ios::binary) << changed;
+        FileStreamO(read_path + "/a/small.txt", std::ios::binary) << "Small";
+        FileStreamO(read_path + "/b/small.txt", std::ios::binary) << "Small";
+        FileAccess::last_write_time(read_path + "/b/large.bin", FileAccess::last_write_time(read_path + "/a/large.bin") - std::chrono::hours(2));
+
+        packer.pack_files();
+        const PackStats& stats = packer.get_stats();
+        if (stats.get(PackStats::Counter::FilesPacked) != 5 || stats.get(PackStats::Counter::FilesDeduplicated) != 2 || stats.get(PackStats::Counter::BytesSaved) != large.size() + 5) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' did not deduplicate the duplicates.";
+            break;
+        }
+        if (FileAccess::hard_link_count(write_path + "/b/large.bin") != 2 || FileAccess::hard_link_count(write_path + "/b/changed.bin") != 1 || read_file(write_path + "/b/changed.bin") != changed) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' linked files with different content.";
+            break;
+        }
+
+        // A link carries the times of the file it was linked to, its content keeps it up to date.
+        packer.pack_files();
+        if (stats.get(PackStats::Counter::FilesPacked) != 0 || stats.get(PackStats::Counter::FilesUpToDate) != 5 || FileAccess::hard_link_count(write_path + "/b/large.bin") != 2) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' replaced an up to date link.";
+            break;
+        }
+
+        // Replacing one of the links must not change the file it was linked to, even once dedup is disabled.
+        packer.set_dedup_mode(Packer::DedupMode::None);
+        FileStreamO(read_path + "/b/large.bin", std::ios::binary) << "Edited";
+        FileAccess::last_write_time(read_path + "/b/large.bin", FileAccess::last_write_time(write_path + "/b/large.bin") + std::chrono::hours(1));
+        packer.pack_files();
+        if (read_file(write_path + "/b/large.bin") != "Edited" || read_file(write_path + "/a/large.bin") != large) {
+            error = "Copy engine '" + FileCopy::get_engine_name(engine) + "' wrote through a hard link.";
+        }
+    }
+
+    packer.set_copy_engine(DEFAULT_COPY_ENGINE);
+    packer.set_dedup_mode(DEFAULT_DEDUP_MODE);
+    packer.set_quick_check_enabled(DEFAULT_QUICK_CHECK_ENABLED);
+    packer.set_preserve_times(DEFAULT_PRESERVE_TIMES);
+    packer.set_overwrite_files(false);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_plan() {
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // The destination of top.txt exists, and c only holds a directory so it is created as the parent of c/d.
+    FileAccess::create_directories(read_path + "/a/b");
+    FileAccess::create_directories(read_path + "/c/d");
+    FileAccess::create_directories(write_path);
+    FileStreamO(read_path + "/top.txt", std::ios::binary) << "Top";
+    FileStreamO(read_path + "/a/one.txt", std::ios::binary) << "One";
+    FileStreamO(read_path + "/a/b/two.txt", std::ios::binary) << "Two!";
+    FileStreamO(read_path + "/c/d/three.txt", std::ios::binary) << "Three";
+    FileStreamO(write_path + "/top.txt", std::ios::binary) << "Old";
+
+    String plan_path = FileAccess::current_path().string() + "/" + "Plan.bin";
+    String error;
+    PackPlan plan;
+    if (packer.plan(plan) != Error::OK) {
+        error = "Planning failed.";
+    } else if (plan.get_count(PackPlan::Operation::Copy) != 3 || plan.get_bytes(PackPlan::Operation::Copy) != 12 || plan.get_count(PackPlan::Operation::Move) != 0) {
+        error = "The plan does not copy the new files.";
+    } else if (plan.get_count(PackPlan::Operation::Skip) != 1 || plan.get_skip_count(PackPlan::Reason::Exists) != 1 || plan.get_skip_bytes(PackPlan::Reason::Exists) != 3) {
+        error = "The plan does not skip the existing destination.";
+    } else if (plan.get_create_count() != 4) {
+        error = "The plan does not create the missing directories.";
+    } else if (FileAccess::exists(write_path + "/a") || FileAccess::exists(write_path + "/c")) {
+        error = "Planning wrote to the destination.";
+    } else {
+        PackPlan loaded;
+        if (plan.save(plan_path) != Error::OK || loaded.load(plan_path) != Error::OK || loaded.get_entry_count() != plan.get_entry_count() ||
+            loaded.get_bytes(PackPlan::Operation::Copy) != 12 || loaded.get_create_count() != 4) {
+            error = "The plan did not load the way it was saved.";
+        } else if (packer.execute(loaded) != Error::OK || packer.get_stats().get(PackStats::Counter::FilesPacked) != 3) {
+            error = "Executing the plan did not pack the files.";
+        } else {
+            StringStream stream;
+            stream << FileStreamI(write_path + "/c/d/three.txt", std::ios::binary).rdbuf() << FileStreamI(write_path + "/top.txt", std::ios::binary).rdbuf();
+            if (stream.str() != "ThreeOld") {
+                error = "Executing the plan did not write the planned files.";
+            }
+        }
+    }
+
+    // Plans describe loose files, an archive or a tar stream cannot be planned or written from one.
+    for (int i = static_cast<int>(Packer::OutputMode::Archive); i < static_cast<int>(Packer::OutputMode::Max) && error.empty(); ++i) {
+        packer.set_output_mode(static_cast<Packer::OutputMode>(i));
+        PackPlan output_plan;
+        if (packer.plan(output_plan) != Error::Unsupported || packer.execute(plan) != Error::Unsupported) {
+            error = "Planning output mode '" + Packer::get_output_mode_name(static_cast<Packer::OutputMode>(i)) + "' should not be supported.";
+        }
+    }
+    packer.set_output_mode(DEFAULT_OUTPUT_MODE);
+
+    FileAccess::remove(plan_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_allocations() {
+    String error;
+#ifdef __linux__
+    packer.set_read_path(read_path);
+    packer.set_write_path(write_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_string("_copy");
+    packer.set_suffix_enabled(true);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Upper);
+    packer.set_traversal(Packer::Traversal::Posix);
+    packer.set_thread_count(1);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // Every destination exists, so each file is listed, named and filtered out without being copied.
+    auto count_allocations = [this](size_t p_num_files) {
+        FileAccess::remove_all(read_path);
+        FileAccess::remove_all(write_path);
+        FileAccess::create_directories(read_path);
+        FileAccess::create_directories(write_path);
+        for (size_t i = 0; i < p_num_files; ++i) {
+            String name = "a_source_file_with_a_long_name_" + std::to_string(i);
+            FileStreamO(read_path + "/" + name + "_copy.txt", std::ios::binary) << "File";
+            FileStreamO(write_path + "/" + name + ".TXT", std::ios::binary) << "File";
+        }
+
+        packer.pack_files();
+        uint64_t count = get_allocation_count();
+        packer.pack_files();
+        return get_allocation_count() - count;
+    };
+
+    uint64_t few = count_allocations(32);
+    uint64_t many = count_allocations(2048);
+    if (packer.get_stats().get(PackStats::Counter::FilesPacked) != 0) {
+        error = "Existing files were replaced.";
+    } else if (many > few + 32) {
+        // Listing buffers grow geometrically, so only a few allocations depend on the number of files.
+        error = "Walking 2048 files made " + std::to_string(many) + " allocations, against " + std::to_string(few) + " for 32 files.";
+    }
+
+    packer.set_suffix_string(DEFAULT_SUFFIX_STRING);
+    packer.set_suffix_enabled(DEFAULT_SUFFIX_ENABLED);
+    packer.set_extension_insensitive(DEFAULT_EXTENSION_INSENSITIVE);
+    packer.set_extension_adjust(DEFAULT_EXTENSION_ADJUST);
+    packer.set_traversal(DEFAULT_TRAVERSAL);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+#endif // __linux__
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_archive() {
+    String archive_path = write_path + "/Pack.pkar";
+    packer.set_read_path(read_path);
+    packer.set_write_path(archive_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_output_mode(Packer::OutputMode::Archive);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String large(300000, '\0');
+    for (size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>(i * 7 + (i >> 11));
+    }
+    std::map<String, String> files = { { "top.txt", "Top" }, { "a/one.txt", "One" }, { "a/b/large.bin", large }, { "a/b/empty.txt", "" } };
+    FileAccess::create_directories(read_path + "/a/b");
+    for (const auto& file : files) {
+        FileStreamO(read_path + "/" + file.first, std::ios::binary) << file.second;
+    }
+
+    auto read_file = [](const String& p_path) {
+        StringStream stream;
+        stream << FileStreamI(p_path, std::ios::binary).rdbuf();
+        return stream.str();
+    };
+
+    String error;
+    Error pack_error = packer.pack_files();
+    String archive = read_file(archive_path);
+    Archive::Trailer trailer;
+    if (pack_error != Error::OK || archive.size() < sizeof(Archive::Header) + sizeof(trailer)) {
+        error = "The archive was not written.";
+    } else if (FileAccess::exists(archive_path + ".tmp") || FileAccess::exists(write_path + "/a")) {
+        error = "Archive mode left files next to the archive.";
+    } else {
+        std::memcpy(&trailer, archive.data() + archive.size() - sizeof(trailer), sizeof(trailer));
+        if (std::memcmp(archive.data(), Archive::magic, sizeof(Archive::magic)) != 0 || std::memcmp(trailer.magic, Archive::magic, sizeof(Archive::magic)) != 0 ||
+            trailer.entry_count != files.size() || trailer.index_offset % 8 != 0 || trailer.buckets_offset != trailer.index_offset + trailer.entry_count * sizeof(Archive::Entry) ||
+            trailer.bucket_bits != Archive::get_bucket_bits(files.size()) || trailer.buckets_offset + ((1ull << trailer.bucket_bits) + 1) * sizeof(uint64_t) + sizeof(trailer) != archive.size()) {
+            error = "The archive header, trailer or index is malformed.";
+        }
+    }
+
+    // Read every entry in index order, checking that the index is sorted by hash.
+    uint64_t previous_hash = 0;
+    for (uint64_t i = 0; error.empty() && i < trailer.entry_count; ++i) {
+        Archive::Entry entry;
+        std::memcpy(&entry, archive.data() + trailer.index_offset + i * sizeof(entry), sizeof(entry));
+        String name = archive.substr(trailer.names_offset + entry.name, entry.name_length);
+        auto file = files.find(name);
+        if (file == files.end() || entry.hash != Archive::hash(name.data(), name.size()) || entry.hash < previous_hash) {
+            error = "The archive index entry '" + name + "' is wrong or out of order.";
+        } else if (archive.compare(entry.offset, entry.size, file->second) != 0 || entry.flags != 0) {
+            error = "The archive data of '" + name + "' does not match its source.";
+        }
+        previous_hash = entry.hash;
+    }
+
+    if (error.empty() && (packer.get_stats().get(PackStats::Counter::FilesPacked) != files.size() || packer.get_stats().get(PackStats::Counter::BytesPacked) != large.size() + 6)) {
+        error = "The archived files were not counted.";
+    }
+    if (error.empty() && packer.pack_files() != Error::AlreadyExists) {
+        error = "An existing archive was replaced while overwrite is disabled.";
+    }
+
+    packer.set_output_mode(DEFAULT_OUTPUT_MODE);
+    packer.set_write_path(write_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_archive_reader() {
+    String archive_path = write_path + "/Pack.pkar";
+    String extract_path = write_path + "/Extract";
+    packer.set_read_path(read_path);
+    packer.set_write_path(archive_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_output_mode(Packer::OutputMode::Archive);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // Enough files for extraction to be split across several threads.
+    std::map<String, String> files;
+    for (int i = 0; i < 300; ++i) {
+        String name = "d" + std::to_string(i % 7) + "/s" + std::to_string(i % 3) + "/f" + std::to_string(i) + ".txt";
+        files[name] = String(i * 13, static_cast<char>('a' + i % 26));
+    }
+    for (const auto& file : files) {
+        FileAccess::create_directories(FileAccess::path(read_path + "/" + file.first).parent_path());
+        FileStreamO(read_path + "/" + file.first, std::ios::binary) << file.second;
+    }
+
+    auto read_file = [](const String& p_path) {
+        StringStream stream;
+        stream << FileStreamI(p_path, std::ios::binary).rdbuf();
+        return stream.str();
+    };
+
+    String error;
+    ArchiveReader reader;
+    if (packer.pack_files() != Error::OK || reader.open(archive_path) != Error::OK) {
+        error = "The archive could not be written and opened.";
+    } else if (reader.get_member_count() != files.size()) {
+        error = "The archive does not hold every file.";
+    }
+
+    // Look every file up by name from several threads at once, comparing the views with the sources.
+    std::atomic<int> mismatches(0);
+    Vector<std::thread> threads;
+    for (int t = 0; error.empty() && t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (const auto& file : files) {
+                ArchiveReader::Member member;
+                if (!reader.find(file.first, member) || String(member.data, member.size) != file.second ||
+                    String(member.name, member.name_length) != file.first) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ArchiveReader::Member member;
+    if (error.empty() && (mismatches != 0 || reader.find("d0/missing.txt", member) || reader.find("", member))) {
+        error = "A member lookup returned the wrong member.";
+    }
+
+    uint64_t previous_offset = 0;
+    for (size_t i = 0; error.empty() && i < reader.get_member_count(); ++i) {
+        if (!reader.get_member(i, member) || member.offset < previous_offset) {
+            error = "The members are not iterated in the order of their data.";
+        }
+        previous_offset = member.offset;
+    }
+
+    for (FileCopy::Engine engine : { FileCopy::Engine::Kernel, FileCopy::Engine::Filesystem }) {
+        if (!error.empty()) {
+            break;
+        }
+        FileCopy::Options options(engine);
+        options.preserve_times = true;
+        FileAccess::remove_all(extract_path);
+        if (reader.extract(extract_path, options, engine == FileCopy::Engine::Kernel ? 4 : 1) != Error::OK) {
+            error = "The archive could not be extracted.";
+        }
+        for (const auto& file : files) {
+            if (!error.empty()) {
+                break;
+            }
+            String path = extract_path + "/" + file.first;
+            if (read_file(path) != file.second) {
+                error = "The extracted file '" + file.first + "' does not match its source with the " + FileCopy::get_engine_name(engine) + " engine.";
+            } else if (FileAccess::last_write_time(path) != FileAccess::last_write_time(read_path + "/" + file.first)) {
+                error = "The extracted file '" + file.first + "' did not receive the modification time of its source.";
+            }
+        }
+    }
+
+    reader.close();
+    packer.set_output_mode(DEFAULT_OUTPUT_MODE);
+    packer.set_write_path(write_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_archive_compression() {
+    String archive_path = write_path + "/Pack.pkar";
+    String extract_path = write_path + "/Extract";
+    packer.set_read_path(read_path);
+    packer.set_write_path(archive_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_output_mode(Packer::OutputMode::Archive);
+    packer.set_compression(Codec::Type::LZ);
+    packer.set_compression_block_size(1 << 14);
+    packer.set_thread_count(4);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    String text;
+    for (int i = 0; text.size() < 300000; ++i) {
+        text += "entry " + std::to_string(i % 113) + " of the level table\n";
+    }
+    String noise(50000, '\0');
+    uint32_t state = 1;
+    for (char& c : noise) {
+        state = state * 1103515245 + 12345;
+        c = static_cast<char>(state >> 24);
+    }
+    // The image compresses well but its extension is in the store list, the noise does not compress at all.
+    std::map<String, String> files = { { "level.txt", text }, { "art/image.PNG", text.substr(0, 40000) }, { "noise.bin", noise }, { "small.txt", "tiny" } };
+    FileAccess::create_directories(read_path + "/art");
+    for (const auto& file : files) {
+        FileStreamO(read_path + "/" + file.first, std::ios::binary) << file.second;
+    }
+
+    auto read_file = [](const String& p_path) {
+        StringStream stream;
+        stream << FileStreamI(p_path, std::ios::binary).rdbuf();
+        return stream.str();
+    };
+
+    String error;
+    ArchiveReader reader;
+    ArchiveReader::Member member;
+    if (packer.pack_files() != Error::OK || reader.open(archive_path) != Error::OK) {
+        error = "The compressed archive could not be written and opened.";
+    } else if (packer.get_stats().get(PackStats::Counter::FilesCompressed) != 1 || packer.get_stats().get(PackStats::Counter::BytesCompressed) * 4 > text.size()) {
+        error = "Only the level table should have been compressed, and it should have shrunk.";
+    } else if (!reader.find("level.txt", member) || member.codec != Codec::Type::LZ || member.size != text.size() || member.block_count != (text.size() + (1 << 14) - 1) >> 14) {
+        error = "The level table was not split into compressed blocks.";
+    }
+
+    // Read parts of the file that start, end and span inside different blocks.
+    for (uint64_t offset : { uint64_t(0), uint64_t(100), uint64_t(16383), uint64_t(50000), uint64_t(text.size() - 7) }) {
+        if (!error.empty()) {
+            break;
+        }
+        size_t size = std::min<uint64_t>(40000, text.size() - offset);
+        String part(size, '\0');
+        if (!reader.read(member, offset, &part[0], size) || part != text.substr(offset, size)) {
+            error = "Reading " + std::to_string(size) + " bytes at " + std::to_string(offset) + " of the level table returned the wrong data.";
+        }
+    }
+    if (error.empty() && reader.read(member, text.size() - 1, &text[0], 2)) {
+        error = "A read past the end of a member succeeded.";
+    }
+
+    for (const char* name : { "art/image.PNG", "noise.bin", "small.txt" }) {
+        if (error.empty() && (!reader.find(name, member) || member.codec != Codec::Type::None || String(member.data, member.size) != files[name])) {
+            error = "'" + String(name) + "' should have been stored as is.";
+        }
+    }
+
+    if (error.empty() && reader.extract(extract_path, FileCopy::Options(FileCopy::Engine::Kernel), 4) != Error::OK) {
+        error = "The compressed archive could not be extracted.";
+    }
+    for (const auto& file : files) {
+        if (error.empty() && read_file(extract_path + "/" + file.first) != file.second) {
+            error = "The extracted file '" + file.first + "' does not match its source.";
+        }
+    }
+
+    reader.close();
+    packer.set_output_mode(DEFAULT_OUTPUT_MODE);
+    packer.set_compression(DEFAULT_COMPRESSION);
+    packer.set_compression_block_size(DEFAULT_COMPRESSION_BLOCK_SIZE);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    packer.set_write_path(write_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_tar() {
+    String tar_path = write_path + "/Pack.tar";
+    packer.set_read_path(read_path);
+    packer.set_write_path(tar_path);
+    packer.set_pack_mode(Packer::PackMode::Include);
+    packer.clear_extensions();
+    packer.add_extension("txt");
+    packer.set_overwrite_files(false);
+    packer.set_move_files(false);
+    packer.set_suffix_string("(1)");
+    packer.set_suffix_enabled(true);
+    packer.set_extension_insensitive(true);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Upper);
+    packer.set_output_mode(Packer::OutputMode::Tar);
+    packer.set_thread_count(4);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(false);
+#endif // IGNORE_FILE_ENABLED
+
+    // The long directory is split between the prefix and name fields, the long file name needs a pax header.
+    String long_directory = "d/" + String(120, 'x');
+    String long_name = String(130, 'y') + ".txt";
+    std::map<String, String> sources = {
+        { "a/b(1).txt", "suffixed" },
+        { "a/empty.txt", "" },
+        { "block.txt", String(512, 'k') },
+        { "skip.bin", "excluded" },
+        { long_directory + "/c.txt", String(1000, 'c') },
+        { "e/" + long_name, "long" },
+    };
+    for (int i = 0; i < 100; ++i) {
+        sources["many/f" + std::to_string(i) + ".txt"] = String(i * 37, static_cast<char>('a' + i % 26));
+    }
+    for (const auto& file : sources) {
+        FileAccess::create_directories(FileAccess::path(read_path + "/" + file.first).parent_path());
+        FileStreamO(read_path + "/" + file.first, std::ios::binary) << file.second;
+    }
+
+    std::map<String, String> expected;
+    for (const auto& file : sources) {
+        String name = file.first;
+        if (name == "skip.bin") {
+            continue;
+        }
+        if (name == "a/b(1).txt") {
+            name = "a/b.txt";
+        }
+        expected[name.substr(0, name.size() - 3) + "TXT"] = file.second;
+    }
+
+    // Reads a tar archive, checking the header checksums and applying pax path and size records.
+    auto parse_tar = [](const String& p_tar, std::map<String, String>& p_files) {
+        size_t position = 0;
+        String pax_path;
+        uint64_t pax_size = 0;
+        while (position + 512 <= p_tar.size()) {
+            const char* header = p_tar.data() + position;
+            if (header[0] == '\0') {
+                return p_tar.size() - position == 1024 && p_tar.find_first_not_of('\0', position) == String::npos;
+            }
+            uint32_t checksum = 0;
+            for (size_t i = 0; i < 512; ++i) {
+                checksum += (i >= 148 && i < 156) ? ' ' : static_cast<uint8_t>(header[i]);
+            }
+            if (std::strtoul(String(header + 148, 7).c_str(), nullptr, 8) != checksum || std::memcmp(header + 257, "ustar", 6) != 0) {
+                return false;
+            }
+            uint64_t size = std::strtoull(String(header + 124, 12).c_str(), nullptr, 8);
+            if (pax_size) {
+                size = pax_size;
+            }
+            position += 512;
+            if (position + size > p_tar.size()) {
+                return false;
+            }
+            String data = p_tar.substr(position, size);
+            position += (size + 511) / 512 * 512;
+
+            if (header[156] == 'x') {
+                // Each record is "<length> <key>=<value>\n".
+                for (size_t record = 0; record < data.size();) {
+                    size_t length = std::strtoul(data.c_str() + record, nullptr, 10);
+                    size_t key = data.find(' ', record) + 1;
+                    size_t value = data.find('=', key) + 1;
+                    if (length == 0 || record + length > data.size() || data[record + length - 1] != '\n') {
+                        return false;
+                    }
+                    String key_name = data.substr(key, value - 1 - key);
+                    String value_text = data.substr(value, record + length - 1 - value);
+                    if (key_name == "path") {
+                        pax_path = value_text;
+                    } else if (key_name == "size") {
+                        pax_size = std::strtoull(value_text.c_str(), nullptr, 10);
+                    }
+                    record += length;
+                }
+                continue;
+            }
+
+            String name = pax_path;
+            if (name.empty()) {
+                String prefix(header + 345, strnlen(header + 345, 155));
+                name = String(header, strnlen(header, 100));
+                if (!prefix.empty()) {
+                    name = prefix + "/" + name;
+                }
+            }
+            if (header[156] != '0' || p_files.count(name)) {
+                return false;
+            }
+            p_files[name] = data;
+            pax_path.clear();
+            pax_size = 0;
+        }
+        return false;
+    };
+
+    auto read_file = [](const String& p_path) {
+        StringStream stream;
+        stream << FileStreamI(p_path, std::ios::binary).rdbuf();
+        return stream.str();
+    };
+
+    String error;
+    std::map<String, String> files;
+    if (packer.pack_files() != Error::OK) {
+        error = "The tar archive could not be written.";
+    } else if (!parse_tar(read_file(tar_path), files)) {
+        error = "The tar archive is malformed.";
+    } else if (files != expected) {
+        error = "The tar archive does not hold the filtered files under their adjusted names.";
+    } else if (packer.pack_files() != Error::AlreadyExists) {
+        error = "An existing tar archive was replaced without overwriting enabled.";
+    }
+
+#ifdef __linux__
+    // Stream into a pipe, which data is spliced into, while another thread reads it.
+    int fds[2];
+    if (error.empty() && ::pipe(fds) != 0) {
+        error = "A pipe could not be created.";
+    } else if (error.empty()) {
+        String streamed;
+        std::thread reader([&streamed, &fds]() {
+            char buffer[4096];
+            ssize_t size;
+            while ((size = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+                streamed.append(buffer, size);
+            }
+        });
+        TarWriter tar;
+        bool written = tar.open(fds[1]) == Error::OK;
+        for (const auto& file : sources) {
+            String path = read_path + "/" + file.first;
+            uint64_t size = 0;
+            written = written && !tar.add(file.first.c_str(), file.first.size(), FileCopy::Location(&path), size) && size == file.second.size();
+        }
+        written = tar.close() == Error::OK && written;
+        ::close(fds[1]);
+        reader.join();
+        ::close(fds[0]);
+
+        files.clear();
+        if (!written || !parse_tar(streamed, files)) {
+            error = "The tar stream written to a pipe is malformed.";
+        } else if (files != sources) {
+            error = "The tar stream written to a pipe does not hold every file.";
+        }
+    }
+#endif // __linux__
+
+    packer.set_output_mode(DEFAULT_OUTPUT_MODE);
+    packer.set_pack_mode(DEFAULT_PACK_MODE);
+    packer.set_suffix_enabled(DEFAULT_SUFFIX_ENABLED);
+    packer.set_extension_insensitive(DEFAULT_EXTENSION_INSENSITIVE);
+    packer.set_extension_adjust(DEFAULT_EXTENSION_ADJUST);
+    packer.set_thread_count(DEFAULT_THREAD_COUNT);
+    packer.set_write_path(write_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+    return TEST_PASSED();
+}
+
+TestResult TestPacker::test_watch() {
+#ifdef __linux__
+    String outside_path = write_path + "/Outside";
+    String pack_path = write_path + "/Pack";
+    packer.set_read_path(read_path);
+    packer.set_write_path(pack_path);
+    packer.set_pack_mode(Packer::PackMode::Everything);
+    packer.set_overwrite_files(true);
+    packer.set_move_files(false);
+    packer.set_suffix_enabled(false);
+    packer.set_extension_adjust(Packer::ExtensionAdjust::Default);
+    packer.set_watch_delay(20);
+    packer.set_incremental_enabled(true);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(true);
+#endif // IGNORE_FILE_ENABLED
+
+    auto write_file = [](const String& p_path, const String& p_contents) {
+        FileAccess::create_directories(FileAccess::path(p_path).parent_path());
+        FileStreamO(p_path, std::ios::binary) << p_contents;
+    };
+    auto read_file = [](const String& p_path) {
+        StringStream stream;
+        stream << FileStreamI(p_path, std::ios::binary).rdbuf();
+        return stream.str();
+    };
+    // Waits for a packed file to hold the given contents, the watcher packs it on its own thread.
+    auto wait_for = [&read_file](const String& p_path, const String& p_contents) {
+        for (int i = 0; i < 500; ++i) {
+            if (FileAccess::exists(p_path) && read_file(p_path) == p_contents) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    };
+
+    write_file(read_path + "/initial.txt", "initial");
+    write_file(read_path + "/art/old.txt", "old");
+
+    Error watch_error = Error::Failed;
+    std::thread watch_thread([this, &watch_error]() {
+        watch_error = packer.watch();
+    });
+
+    String error;
+    if (!wait_for(pack_path + "/initial.txt", "initial") || !wait_for(pack_path + "/art/old.txt", "old")) {
+        error = "The initial pack did not run.";
+    }
+
+    write_file(read_path + "/art/new.txt", "new");
+    // The change is moved in with a later time, a rewrite could share the coarse timestamp of the first copy.
+    write_file(outside_path + "/old.txt", "changed");
+    FileAccess::last_write_time(outside_path + "/old.txt", FileAccess::last_write_time(pack_path + "/art/old.txt") + std::chrono::seconds(1));
+    FileAccess::rename(outside_path + "/old.txt", read_path + "/art/old.txt");
+    if (error.empty() && (!wait_for(pack_path + "/art/new.txt", "new") || !wait_for(pack_path + "/art/old.txt", "changed"))) {
+        error = "Written files were not packed.";
+    }
+
+    // A directory moved into the tree is packed whole, including its sub-directories.
+    write_file(outside_path + "/set/a.txt", "a");
+    write_file(outside_path + "/set/deep/b.txt", "b");
+    FileAccess::rename(outside_path + "/set", read_path + "/set");
+    write_file(read_path + "/created/c.txt", "c");
+    if (error.empty() && (!wait_for(pack_path + "/set/a.txt", "a") || !wait_for(pack_path + "/set/deep/b.txt", "b") || !wait_for(pack_path + "/created/c.txt", "c"))) {
+        error = "Directories moved into or created in the tree were not packed.";
+    }
+
+    // Files moved into the watched directories are packed too.
+    write_file(outside_path + "/moved.txt", "moved");
+    FileAccess::rename(outside_path + "/moved.txt", read_path + "/set/deep/moved.txt");
+    if (error.empty() && !wait_for(pack_path + "/set/deep/moved.txt", "moved")) {
+        error = "A file moved into the tree was not packed.";
+    }
+
+#ifdef IGNORE_FILE_ENABLED
+    String ignore_path = read_path + "/set/" + packer.get_ignore_file_name();
+    write_file(ignore_path, "");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    write_file(read_path + "/set/deep/ignored.txt", "ignored");
+    write_file(read_path + "/art/after.txt", "after");
+    if (error.empty() && !wait_for(pack_path + "/art/after.txt", "after")) {
+        error = "A file written after an ignore file appeared was not packed.";
+    } else if (error.empty() && FileAccess::exists(pack_path + "/set/deep/ignored.txt")) {
+        error = "A file below a new ignore file was packed.";
+    }
+
+    FileAccess::remove(ignore_path);
+    if (error.empty() && !wait_for(pack_path + "/set/deep/ignored.txt", "ignored")) {
+        error = "The files below a removed ignore file were not packed.";
+    }
+    write_file(read_path + "/set/deep/later.txt", "later");
+    if (error.empty() && !wait_for(pack_path + "/set/deep/later.txt", "later")) {
+        error = "The directories below a removed ignore file were not watched again.";
+    }
+#endif // IGNORE_FILE_ENABLED
+
+    packer.stop_watch();
+    watch_thread.join();
+    if (error.empty() && watch_error != Error::OK) {
+        error = "Watching failed with '" + get_error_name(watch_error) + "'.";
+    }
+
+    // Every batch saved the manifest, so an incremental pack finds nothing left to pack.
+    if (error.empty() && (packer.pack_files() != Error::OK || packer.get_stats().get(PackStats::Counter::FilesPacked) != 0)) {
+        error = "The manifest was not saved after the changes were packed.";
+    }
+
+    packer.set_output_mode(Packer::OutputMode::Archive);
+    if (error.empty() && packer.watch() != Error::Unsupported) {
+        error = "Watching an archive should not be supported.";
+    }
+
+    packer.set_output_mode(DEFAULT_OUTPUT_MODE);
+    packer.set_overwrite_files(DEFAULT_OVERWRITE_FILES);
+    packer.set_watch_delay(DEFAULT_WATCH_DELAY);
+    packer.set_incremental_enabled(DEFAULT_INCREMENTAL_ENABLED);
+#ifdef IGNORE_FILE_ENABLED
+    packer.set_ignore_file_enabled(DEFAULT_IGNORE_FILE_ENABLED);
+#endif // IGNORE_FILE_ENABLED
+    packer.set_write_path(write_path);
+    FileAccess::remove_all(read_path);
+    FileAccess::remove_all(write_path);
+
+    if (!error.empty()) {
+        return TEST_FAILED(error);
+    }
+#endif // __linux__
+    return TEST_PASSED();
+}
+
 TestPacker::TestPacker() :
     read_path(FileAccess::current_path().string() + "/" + "Read"),
     write_path(FileAccess::current_path().string() + "/" + "Write"),
     files({ "lower_case(1).txt", "UPPER_CASE(1).TXT" }) {
     ADD_TEST("Packer", [this]() { return test(); });
+    ADD_TEST("Packer threads", [this]() { return test_threads(); });
+    ADD_TEST("Packer copy engines", [this]() { return test_copy_engines(); });
+    ADD_TEST("Packer batches", [this]() { return test_batches(); });
+    ADD_TEST("Packer traversal", [this]() { return test_traversal(); });
+    ADD_TEST("Packer traversal descriptors", [this]() { return test_traversal_descriptors(); });
+    ADD_TEST("Packer destination index", [this]() { return test_destination_index(); });
+    ADD_TEST("Packer incremental", [this]() { return test_incremental(); });
+    ADD_TEST("Packer directory cache", [this]() { return test_directory_cache(); });
+    ADD_TEST("Packer quick check", [this]() { return test_quick_check(); });
+    ADD_TEST("Packer verify", [this]() { return test_verify(); });
+    ADD_TEST("Packer split copy", [this]() { return test_split_copy(); });
+    ADD_TEST("Packer sparse", [this]() { return test_sparse(); });
+    ADD_TEST("Packer durability", [this]() { return test_durability(); });
+    ADD_TEST("Packer dedup", [this]() { return test_dedup(); });
+    ADD_TEST("Packer plan", [this]() { return test_plan(); });
+    ADD_TEST("Packer allocations", [this]() { return test_allocations(); });
+    ADD_TEST("Packer archive", [this]() { return test_archive(); });
+    ADD_TEST("Packer archive reader", [this]() { return test_archive_reader(); });
+    ADD_TEST("Packer archive compression", [this]() { return test_archive_compression(); });
+    ADD_TEST("Packer tar", [this]() { return test_tar(); });
+    ADD_TEST("Packer watch", [this]() { return test_watch(); });
+    ADD_TEST("Packer move", [this]() { return test_move(); });
 }
 
 TestPacker::~TestPacker() {
@@ -30,6 +30,152 @@ class TestPacker : public TestSuite {
      */
     bool test_packer();
 
+    /**
+     * @brief Create a nested directory tree in the read path.
+     *
+     * The tree contains several levels of sub-directories, and one sub-directory holding an ignore file.
+     */
+    void create_tree();
+
+    /**
+     * @brief Collect the relative paths of all files under a directory.
+     * @param p_path The directory to collect files from.
+     * @return The sorted relative paths of the files.
+     */
+    Vector<String> collect_files(const String& p_path);
+
+    /**
+     * @brief Test that packing with several threads, or through the pipeline, produces the same result as packing with one.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_threads();
+
+    /**
+     * @brief Test that every copy engine packs identical file contents and reports the methods it used.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_copy_engines();
+
+    /**
+     * @brief Test that moving files within one device renames them and never replaces protected files.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_move();
+
+    /**
+     * @brief Test that the io_uring engine copies batches of files in the walk and in the pipeline.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_batches();
+
+    /**
+     * @brief Test that the POSIX traversal packs the same files as the std::filesystem traversal.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_traversal();
+
+    /**
+     * @brief Test that the POSIX traversal packs more directories than the process may hold open.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_traversal_descriptors();
+
+    /**
+     * @brief Test that the destination index protects existing files and files written during the pack.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_destination_index();
+
+    /**
+     * @brief Test that incremental mode skips unchanged files and packs changed ones.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_incremental();
+
+    /**
+     * @brief Test that incremental mode walks unchanged directories from their cached listings.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_directory_cache();
+
+    /**
+     * @brief Test that the quick check keeps destinations matching their sources and replaces the others.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_quick_check();
+
+    /**
+     * @brief Test that every copy engine verifies its copies, and that moved sources are removed once verified.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_verify();
+
+    /**
+     * @brief Test that large files are copied in ranges by several threads and replace their destination whole.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_split_copy();
+
+    /**
+     * @brief Test that sparse files keep their holes, whole and split, and that the skipped bytes are counted.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_sparse();
+
+    /**
+     * @brief Test that each durability policy syncs its copies, and that moved sources outlive their copies until a sync.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_durability();
+
+    /**
+     * @brief Test that duplicate files are hard linked to the first copy of their content, and that replacing one leaves the others intact.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_dedup();
+
+    /**
+     * @brief Test that a plan records what a pack would do without writing anything, and that executing it packs the files.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_plan();
+
+    /**
+     * @brief Test that walking and filtering files does not allocate per file once the buffers it reuses have grown.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_allocations();
+
+    /**
+     * @brief Test that archive mode writes every file into a single archive with a sorted index.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_archive();
+
+    /**
+     * @brief Test that an archive reader finds, iterates and extracts the members of an archive.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_archive_reader();
+
+    /**
+     * @brief Test that archive members are compressed in blocks, skipping stored extensions and incompressible data.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_archive_compression();
+
+    /**
+     * @brief Test that tar mode streams the filtered files as a valid tar archive, to a file and through a pipe.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_tar();
+
+    /**
+     * @brief Test that watch mode packs files as they are written, moved in and un-ignored, and skips ignored subtrees.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_watch();
+
     /**
      * @brief Run the Packer test cases.
      *
@@ -0,0 +1,92 @@
+// See LICENSE for full copyright and licensing information.
+
+#include "test_path_builder.h"
+
+PACKER_NAMESPACE_BEGIN
+
+TestResult TestPathBuilder::test() {
+    PathBuilder builder;
+    builder.assign("root/dir");
+    if (builder.get_path() != "root/dir" || String(builder.get_name()) != "dir") {
+        return TEST_FAILED("The path was not assigned.");
+    }
+
+    size_t mark = builder.push("sub");
+    builder.push("file_copy.TXT", 9);
+    if (builder.get_path() != "root/dir/sub/file_copy" || String(builder.get_name()) != "file_copy" || builder.size() != 22) {
+        return TEST_FAILED("Components were not appended.");
+    }
+
+    builder.truncate(mark);
+    if (builder.get_path() != "root/dir" || String(builder.get_name()) != "dir") {
+        return TEST_FAILED("The path was not truncated.");
+    }
+
+    // Suffix removal and extension adjustment must agree with the string functions they replace.
+    for (const char* name : { "file_copy.TXT", "file.txt_copy", "file.Tar", "file", "_copy", "a_copy_copy.Md" }) {
+        for (bool upper : { false, true }) {
+            builder.assign("root/dir");
+            builder.push(name);
+
+            String expected = String("root/dir/") + name;
+            bool removed = remove_path_suffix(expected, "_copy");
+            size_t ext_pos = expected.find_last_of('.') + 1;
+            std::transform(expected.begin() + ext_pos, expected.end(), expected.begin() + ext_pos, upper ? toupper : tolower);
+
+            if (builder.remove_suffix("_copy") != removed) {
+                return TEST_FAILED("Removing the suffix of '" + String(name) + "' does not agree with remove_path_suffix.");
+            }
+            builder.adjust_extension(upper);
+            if (builder.get_path() != expected) {
+                return TEST_FAILED("Building '" + String(name) + "' gave '" + builder.get_path() + "' instead of '" + expected + "'.");
+            }
+            if (String(builder.get_name()) != expected.substr(expected.find_last_of('/') + 1)) {
+                return TEST_FAILED("The name of '" + expected + "' is not its last component.");
+            }
+        }
+    }
+
+    String copy;
+    builder.copy_to(copy);
+    if (copy != builder.get_path()) {
+        return TEST_FAILED("The path was not copied.");
+    }
+
+    return TEST_PASSED();
+}
+
+TestResult TestPathBuilder::test_allocations(size_t p_num_paths) {
+    String directory = "a_rather_long_source_directory/with_several/nested_components";
+    String names[] = { "first_file_with_a_long_name_copy.txt", "second.TXT", "third_file_copy.Tar" };
+
+    PathBuilder builder;
+    String path;
+    uint64_t allocations = 0;
+
+    // The first round grows the builder and the destination, the others must reuse their capacity.
+    for (size_t round = 0; round < 2; ++round) {
+        uint64_t count = get_allocation_count();
+        for (size_t i = 0; i < p_num_paths; ++i) {
+            const String& name = names[i % 3];
+            builder.assign(directory);
+            size_t mark = builder.push(name.data(), name.size());
+            builder.remove_suffix("_copy");
+            builder.adjust_extension(i % 2 == 0);
+            builder.copy_to(path);
+            builder.truncate(mark);
+        }
+        allocations = get_allocation_count() - count;
+    }
+
+    if (allocations != 0) {
+        return TEST_FAILED("Building " + std::to_string(p_num_paths) + " paths made " + std::to_string(allocations) + " allocations.");
+    }
+    return TEST_PASSED();
+}
+
+TestPathBuilder::TestPathBuilder() {
+    ADD_TEST("PathBuilder", [this]() { return test(); });
+    ADD_TEST("PathBuilder allocations", [this]() { return test_allocations(); });
+}
+
+PACKER_NAMESPACE_END
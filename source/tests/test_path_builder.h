@@ -0,0 +1,40 @@
+// See LICENSE for full copyright and licensing information.
+
+#pragma once
+
+#include "test_suite.h"
+
+#include <path_builder.h>
+
+PACKER_NAMESPACE_BEGIN
+
+/**
+ * @class TestPathBuilder
+ * @brief Represents a test suite for the PathBuilder class.
+ *
+ * This class defines test cases for building, truncating and adjusting paths in place.
+ */
+class TestPathBuilder : public TestSuite {
+    /**
+     * @brief Test that paths are built like string concatenation, suffix removal and extension adjustment would build them.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test();
+
+    /**
+     * @brief Test that building paths does not allocate once the builder and the destination string have grown.
+     * @param p_num_paths The number of paths to build.
+     * @return The result of the test, indicating success or failure.
+     */
+    TestResult test_allocations(size_t p_num_paths = 1 << 12);
+
+public:
+    /**
+     * @brief Constructs a new TestPathBuilder object.
+     *
+     * Initializes the test suite with path builder test cases.
+     */
+    TestPathBuilder();
+};
+
+PACKER_NAMESPACE_END
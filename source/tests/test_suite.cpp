@@ -2,6 +2,31 @@
 
 #include "test_suite.h"
 
+#include <cstdlib>
+#include <new>
+
+/**
+ * @brief The number of heap allocations made by each thread.
+ */
+static thread_local uint64_t allocation_count = 0;
+
+void* operator new(std::size_t p_size) {
+    ++allocation_count;
+    void* memory = std::malloc(p_size ? p_size : 1);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* p_memory) noexcept {
+    std::free(p_memory);
+}
+
+void operator delete(void* p_memory, std::size_t) noexcept {
+    std::free(p_memory);
+}
+
 PACKER_NAMESPACE_BEGIN
 
 bool TestResult::operator==(Error p_error) const {
@@ -57,4 +82,8 @@ int TestSuite::run_tests(bool p_pause) {
     return EXIT_SUCCESS;
 }
 
+uint64_t TestSuite::get_allocation_count() {
+    return allocation_count;
+}
+
 PACKER_NAMESPACE_END
@@ -99,6 +99,12 @@ public:
      * @return The number of test failures (0 for success).
      */
     static int run_tests(bool p_pause = false);
+
+    /**
+     * @brief Gets the number of heap allocations made by the calling thread, to check code that must not allocate.
+     * @return The number of calls to the global operator new made by the calling thread.
+     */
+    static uint64_t get_allocation_count();
 };
 
 /**